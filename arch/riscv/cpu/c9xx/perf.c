@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Performance counter events of the T-Head C9xx cores
+ */
+
+#include <common.h>
+#include <asm/perf.h>
+
+/* Values for mhpmeventN, as listed in the C910 user manual */
+enum c9xx_perf_event {
+	C9XX_L1I_ACCESS		= 0x01,
+	C9XX_L1I_MISS		= 0x02,
+	C9XX_IUTLB_MISS		= 0x03,
+	C9XX_DUTLB_MISS		= 0x04,
+	C9XX_JTLB_MISS		= 0x05,
+	C9XX_BRANCH_MISS	= 0x06,
+	C9XX_BRANCH		= 0x07,
+	C9XX_IBRANCH_MISS	= 0x08,
+	C9XX_IBRANCH		= 0x09,
+	C9XX_LSU_SPEC_FAIL	= 0x0a,
+	C9XX_STORE		= 0x0b,
+	C9XX_L1D_READ_ACCESS	= 0x0c,
+	C9XX_L1D_READ_MISS	= 0x0d,
+	C9XX_L1D_WRITE_ACCESS	= 0x0e,
+	C9XX_L1D_WRITE_MISS	= 0x0f,
+	C9XX_L2_READ_ACCESS	= 0x10,
+	C9XX_L2_READ_MISS	= 0x11,
+	C9XX_L2_WRITE_ACCESS	= 0x12,
+	C9XX_L2_WRITE_MISS	= 0x13,
+};
+
+static const u8 c9xx_perf_events[PERF_EVENT_COUNT] = {
+	[PERF_EVENT_L1I_MISS]		= C9XX_L1I_MISS,
+	[PERF_EVENT_L1D_READ_MISS]	= C9XX_L1D_READ_MISS,
+	[PERF_EVENT_L1D_WRITE_MISS]	= C9XX_L1D_WRITE_MISS,
+	[PERF_EVENT_L2_READ_MISS]	= C9XX_L2_READ_MISS,
+	[PERF_EVENT_L2_WRITE_MISS]	= C9XX_L2_WRITE_MISS,
+	[PERF_EVENT_ITLB_MISS]		= C9XX_IUTLB_MISS,
+	[PERF_EVENT_DTLB_MISS]		= C9XX_DUTLB_MISS,
+	[PERF_EVENT_JTLB_MISS]		= C9XX_JTLB_MISS,
+	[PERF_EVENT_BRANCH_MISS]	= C9XX_BRANCH_MISS,
+	[PERF_EVENT_IBRANCH_MISS]	= C9XX_IBRANCH_MISS,
+};
+
+ulong perf_hw_event(enum perf_event event)
+{
+	if (event < 0 || event >= PERF_EVENT_COUNT)
+		return 0;
+
+	return c9xx_perf_events[event];
+}
@@ -0,0 +1,183 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Access to the RISC-V hardware performance counters
+ */
+
+#ifndef _ASM_RISCV_PERF_H
+#define _ASM_RISCV_PERF_H
+
+/* Counters 0 and 2 are mcycle and minstret, 3 onwards are mhpmcounterN */
+#define PERF_COUNTER_CYCLE	0
+#define PERF_COUNTER_INSTRET	2
+#define PERF_COUNTER_HPM	3
+#define PERF_COUNTER_MAX	31
+
+/**
+ * enum perf_event - Events counted by perf_start()
+ *
+ * These are mapped to the event numbers of the CPU by perf_hw_event().
+ * Events the CPU cannot count are left out of the results.
+ */
+enum perf_event {
+	PERF_EVENT_CYCLES,
+	PERF_EVENT_INSTRUCTIONS,
+	PERF_EVENT_L1I_MISS,
+	PERF_EVENT_L1D_READ_MISS,
+	PERF_EVENT_L1D_WRITE_MISS,
+	PERF_EVENT_L2_READ_MISS,
+	PERF_EVENT_L2_WRITE_MISS,
+	PERF_EVENT_ITLB_MISS,
+	PERF_EVENT_DTLB_MISS,
+	PERF_EVENT_JTLB_MISS,
+	PERF_EVENT_BRANCH_MISS,
+	PERF_EVENT_IBRANCH_MISS,
+
+	PERF_EVENT_COUNT,
+};
+
+/**
+ * struct perf_counts - Value of the counters for each event
+ *
+ * @count: Counter value, indexed by enum perf_event
+ */
+struct perf_counts {
+	u64 count[PERF_EVENT_COUNT];
+};
+
+/**
+ * perf_hw_event() - Get the CPU event number for an event
+ *
+ * This is provided by the CPU code. The default only knows about cycles and
+ * instructions, which have their own counters.
+ *
+ * @event:	Event to look up
+ * @return value to write to mhpmeventN, 0 if the CPU cannot count @event
+ */
+ulong perf_hw_event(enum perf_event event);
+
+/**
+ * perf_counter_config() - Select the event counted by an mhpmcounter
+ *
+ * @counter:	Counter number, PERF_COUNTER_HPM to PERF_COUNTER_MAX
+ * @hw_event:	CPU event number, 0 to stop counting
+ * @return 0 if OK, -EINVAL if @counter is not an mhpmcounter
+ */
+int perf_counter_config(uint counter, ulong hw_event);
+
+/**
+ * perf_counter_read() - Read a counter
+ *
+ * @counter:	Counter number, up to PERF_COUNTER_MAX
+ * @return counter value, 0 if @counter does not exist
+ */
+u64 perf_counter_read(uint counter);
+
+/**
+ * perf_counter_write() - Set the value of a counter
+ *
+ * @counter:	Counter number, up to PERF_COUNTER_MAX
+ * @val:	Value to write
+ */
+void perf_counter_write(uint counter, u64 val);
+
+/**
+ * perf_counter_enable() - Start or stop counters
+ *
+ * @mask:	Bit mask of the counters to change
+ * @enable:	true to start the counters, false to stop them
+ */
+void perf_counter_enable(u32 mask, bool enable);
+
+/**
+ * perf_start() - Set up the counters for all the events the CPU supports
+ *
+ * The counters are given one event each and started. They are not reset, so
+ * measurements are made by taking the difference of two perf_read() calls.
+ * If there are not enough counters, the last events are not counted.
+ *
+ * @return 0 if OK, -ENOSPC if the CPU has too few counters
+ */
+int perf_start(void);
+
+/**
+ * perf_supported() - Check whether an event is counted
+ *
+ * @event:	Event to check
+ * @return true if perf_start() set up a counter for @event
+ */
+bool perf_supported(enum perf_event event);
+
+/**
+ * perf_read() - Read the counters of all events
+ *
+ * @counts:	Returns the counter values. Events which are not counted read
+ *		as 0.
+ */
+void perf_read(struct perf_counts *counts);
+
+/**
+ * perf_event_name() - Get the name of an event
+ *
+ * @event:	Event to look up
+ * @return name of the event
+ */
+const char *perf_event_name(enum perf_event event);
+
+/**
+ * perf_print() - Print the events counted between two perf_read() calls
+ *
+ * @start:	Counters at the start
+ * @end:	Counters at the end
+ * @bytes:	Number of bytes processed, to print cycles per byte, or 0
+ */
+void perf_print(const struct perf_counts *start,
+		const struct perf_counts *end, ulong bytes);
+
+/**
+ * struct perf_bench - State of a benchmark
+ *
+ * @start: Counters at the start of the benchmark
+ */
+struct perf_bench {
+	struct perf_counts start;
+};
+
+/**
+ * perf_bench_start() - Start measuring a piece of code
+ *
+ * This can be put around a memory copy, hash or decompression routine, for
+ * example, to see how well it uses the CPU. It does nothing unless
+ * CONFIG_RISCV_PERF is enabled.
+ *
+ * @bench:	Benchmark state
+ */
+static inline void perf_bench_start(struct perf_bench *bench)
+{
+	if (!IS_ENABLED(CONFIG_RISCV_PERF))
+		return;
+
+	perf_start();
+	perf_read(&bench->start);
+}
+
+/**
+ * perf_bench_end() - Stop measuring and print the results
+ *
+ * @bench:	Benchmark state set up by perf_bench_start()
+ * @name:	Name of the benchmark to print
+ * @bytes:	Number of bytes processed, or 0
+ */
+static inline void perf_bench_end(struct perf_bench *bench, const char *name,
+				  ulong bytes)
+{
+	struct perf_counts end;
+
+	if (!IS_ENABLED(CONFIG_RISCV_PERF))
+		return;
+
+	perf_read(&end);
+	printf("%s:\n", name);
+	perf_print(&bench->start, &end, bytes);
+}
+
+#endif /* _ASM_RISCV_PERF_H */
@@ -12,6 +12,7 @@
 #include <dm/root.h>
 #include <image.h>
 #include <opensbi.h>
+#include <prof.h>
 #include <asm/byteorder.h>
 #include <asm/csr.h>
 #include <asm/io.h>
@@ -51,6 +52,9 @@ static void announce_and_cleanup(int fake)
 {
 	printf("\nStarting kernel ...%s\n\n", fake ?
 		"(fake run for tracing)" : "");
+	/* The sampling interrupt must not fire in the kernel */
+	if (IS_ENABLED(CONFIG_PROF))
+		prof_stop();
 	bootstage_mark_name(BOOTSTAGE_ID_BOOTM_HANDOFF, "start_kernel");
 #ifdef CONFIG_BOOTSTAGE_FDT
 	bootstage_fdt_add_report();
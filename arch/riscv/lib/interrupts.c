@@ -79,6 +79,9 @@ ulong handle_trap(ulong cause, ulong epc, struct pt_regs *regs)
 	is_irq = (cause & MCAUSE_INT);
 	irq = (cause & ~MCAUSE_INT);
 
+	/* trap_entry does not save x0, so its slot can hold the PC */
+	regs->sepc = epc;
+
 	debug("[%s,%d]\n", __func__, __LINE__);
 	if (is_irq) {
 		switch (irq) {
@@ -89,7 +92,7 @@ ulong handle_trap(ulong cause, ulong epc, struct pt_regs *regs)
 			break;
 		case IRQ_M_TIMER:
 		case IRQ_S_TIMER:
-			timer_interrupt(0);	/* handle timer interrupt */
+			timer_interrupt(regs);	/* handle timer interrupt */
 			break;
 		default:
 			_exit_trap(cause, epc, regs);
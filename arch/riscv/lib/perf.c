@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Access to the RISC-V hardware performance counters
+ *
+ * mcycle and minstret always count cycles and instructions. The other events
+ * are given to mhpmcounter3 onwards, in the order of enum perf_event, so the
+ * counter used by an event can be worked out at any time without keeping
+ * any state.
+ */
+
+#include <common.h>
+#include <asm/csr.h>
+#include <asm/perf.h>
+
+#define PERF_HPM_CASES(op)						\
+	op(3) op(4) op(5) op(6) op(7) op(8) op(9) op(10) op(11) op(12)	\
+	op(13) op(14) op(15) op(16) op(17) op(18) op(19) op(20) op(21)	\
+	op(22) op(23) op(24) op(25) op(26) op(27) op(28) op(29) op(30)	\
+	op(31)
+
+static const char *const perf_event_names[PERF_EVENT_COUNT] = {
+	[PERF_EVENT_CYCLES]		= "cycles",
+	[PERF_EVENT_INSTRUCTIONS]	= "instructions",
+	[PERF_EVENT_L1I_MISS]		= "L1-icache-misses",
+	[PERF_EVENT_L1D_READ_MISS]	= "L1-dcache-read-misses",
+	[PERF_EVENT_L1D_WRITE_MISS]	= "L1-dcache-write-misses",
+	[PERF_EVENT_L2_READ_MISS]	= "L2-cache-read-misses",
+	[PERF_EVENT_L2_WRITE_MISS]	= "L2-cache-write-misses",
+	[PERF_EVENT_ITLB_MISS]		= "iTLB-misses",
+	[PERF_EVENT_DTLB_MISS]		= "dTLB-misses",
+	[PERF_EVENT_JTLB_MISS]		= "jTLB-misses",
+	[PERF_EVENT_BRANCH_MISS]	= "branch-misses",
+	[PERF_EVENT_IBRANCH_MISS]	= "indirect-branch-misses",
+};
+
+__weak ulong perf_hw_event(enum perf_event event)
+{
+	return 0;
+}
+
+int perf_counter_config(uint counter, ulong hw_event)
+{
+	switch (counter) {
+#define PERF_CONFIG(n)							\
+	case n:								\
+		csr_write(CSR_MHPMEVENT3 + (n) - 3, hw_event);		\
+		return 0;
+	PERF_HPM_CASES(PERF_CONFIG)
+#undef PERF_CONFIG
+	default:
+		return -EINVAL;
+	}
+}
+
+u64 perf_counter_read(uint counter)
+{
+	switch (counter) {
+	case PERF_COUNTER_CYCLE:
+		return csr_read(CSR_MCYCLE);
+	case PERF_COUNTER_INSTRET:
+		return csr_read(CSR_MINSTRET);
+#define PERF_READ(n)							\
+	case n:								\
+		return csr_read(CSR_MHPMCOUNTER3 + (n) - 3);
+	PERF_HPM_CASES(PERF_READ)
+#undef PERF_READ
+	default:
+		return 0;
+	}
+}
+
+void perf_counter_write(uint counter, u64 val)
+{
+	switch (counter) {
+	case PERF_COUNTER_CYCLE:
+		csr_write(CSR_MCYCLE, val);
+		break;
+	case PERF_COUNTER_INSTRET:
+		csr_write(CSR_MINSTRET, val);
+		break;
+#define PERF_WRITE(n)							\
+	case n:								\
+		csr_write(CSR_MHPMCOUNTER3 + (n) - 3, val);		\
+		break;
+	PERF_HPM_CASES(PERF_WRITE)
+#undef PERF_WRITE
+	}
+}
+
+void perf_counter_enable(u32 mask, bool enable)
+{
+	/* Bit 1 is the time counter, which cannot be stopped */
+	mask &= ~BIT(1);
+	if (enable)
+		csr_clear(CSR_MCOUNTINHIBIT, mask);
+	else
+		csr_set(CSR_MCOUNTINHIBIT, mask);
+}
+
+/* Get the counter used for an event, -1 if it is not counted */
+static int perf_event_counter(enum perf_event event)
+{
+	int counter = PERF_COUNTER_HPM;
+	int i;
+
+	if (event == PERF_EVENT_CYCLES)
+		return PERF_COUNTER_CYCLE;
+	if (event == PERF_EVENT_INSTRUCTIONS)
+		return PERF_COUNTER_INSTRET;
+	if (event < 0 || event >= PERF_EVENT_COUNT || !perf_hw_event(event))
+		return -1;
+
+	for (i = PERF_EVENT_INSTRUCTIONS + 1; i < event; i++) {
+		if (perf_hw_event(i))
+			counter++;
+	}
+
+	return counter <= PERF_COUNTER_MAX ? counter : -1;
+}
+
+bool perf_supported(enum perf_event event)
+{
+	return perf_event_counter(event) >= 0;
+}
+
+int perf_start(void)
+{
+	u32 mask = BIT(PERF_COUNTER_CYCLE) | BIT(PERF_COUNTER_INSTRET);
+	int i, counter, ret = 0;
+
+	for (i = 0; i < PERF_EVENT_COUNT; i++) {
+		if (!perf_hw_event(i))
+			continue;
+		counter = perf_event_counter(i);
+		if (counter < 0) {
+			ret = -ENOSPC;
+			continue;
+		}
+		perf_counter_config(counter, perf_hw_event(i));
+		mask |= BIT(counter);
+	}
+	perf_counter_enable(mask, true);
+
+	return ret;
+}
+
+void perf_read(struct perf_counts *counts)
+{
+	int i, counter;
+
+	for (i = 0; i < PERF_EVENT_COUNT; i++) {
+		counter = perf_event_counter(i);
+		counts->count[i] = counter < 0 ? 0 : perf_counter_read(counter);
+	}
+}
+
+const char *perf_event_name(enum perf_event event)
+{
+	if (event < 0 || event >= PERF_EVENT_COUNT)
+		return "unknown";
+
+	return perf_event_names[event];
+}
+
+/* Print a ratio with two decimals */
+static void perf_print_ratio(u64 num, u64 den, const char *what)
+{
+	u64 val;
+
+	if (!den)
+		return;
+	val = num * 100 / den;
+	printf("  # %llu.%02llu %s", val / 100, val % 100, what);
+}
+
+void perf_print(const struct perf_counts *start,
+		const struct perf_counts *end, ulong bytes)
+{
+	u64 delta[PERF_EVENT_COUNT];
+	int i;
+
+	for (i = 0; i < PERF_EVENT_COUNT; i++)
+		delta[i] = end->count[i] - start->count[i];
+
+	for (i = 0; i < PERF_EVENT_COUNT; i++) {
+		if (!perf_supported(i))
+			continue;
+		printf("%20llu  %s", delta[i], perf_event_name(i));
+		if (i == PERF_EVENT_INSTRUCTIONS)
+			perf_print_ratio(delta[i], delta[PERF_EVENT_CYCLES],
+					 "insn per cycle");
+		else if (i == PERF_EVENT_CYCLES && bytes)
+			perf_print_ratio(delta[i], bytes, "cycles per byte");
+		else if (i != PERF_EVENT_CYCLES)
+			perf_print_ratio(delta[i] * 1000,
+					 delta[PERF_EVENT_INSTRUCTIONS],
+					 "per 1000 insn");
+		printf("\n");
+	}
+}
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sampling for the statistical profiler, using the M-mode timer interrupt
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <prof.h>
+#include <timer.h>
+#include <asm/csr.h>
+#include <asm/ptrace.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/**
+ * riscv_get_time() - get the timer counter
+ *
+ * Platform code needs to implement this.
+ *
+ * @time:	the 64-bit timer count
+ * @return:	0 on success, -ve on error
+ */
+extern int riscv_get_time(u64 *time);
+
+/**
+ * riscv_set_timecmp() - set the timer compare register of a hart
+ *
+ * Platform code needs to implement this.
+ *
+ * @hart:	hart ID
+ * @cmp:	timer count at which the timer interrupt is raised
+ * @return:	0 on success, -ve on error
+ */
+extern int riscv_set_timecmp(int hart, u64 cmp);
+
+/* Time between two samples, in timer ticks */
+static u64 prof_ticks;
+/* MSTATUS.MIE before the profiler turned it on */
+static ulong prof_mstatus_mie;
+
+static int prof_arm(void)
+{
+	u64 now;
+	int ret;
+
+	ret = riscv_get_time(&now);
+	if (ret)
+		return ret;
+
+	return riscv_set_timecmp(csr_read(CSR_MHARTID), now + prof_ticks);
+}
+
+void timer_interrupt(struct pt_regs *regs)
+{
+	prof_sample(instruction_pointer(regs));
+	prof_arm();
+}
+
+int arch_prof_start(uint period_us)
+{
+	int ret;
+
+	if (!gd->timer) {
+		ret = dm_timer_init();
+		if (ret)
+			return ret;
+	}
+
+	prof_ticks = max_t(u64, (u64)timer_get_rate(gd->timer) * period_us /
+			   1000000, 1);
+	ret = prof_arm();
+	if (ret)
+		return ret;
+
+	prof_mstatus_mie = csr_read(CSR_MSTATUS) & SR_MIE;
+	csr_set(CSR_MIE, MIE_MTIE);
+	csr_set(CSR_MSTATUS, SR_MIE);
+
+	return 0;
+}
+
+void arch_prof_stop(void)
+{
+	csr_clear(CSR_MIE, MIE_MTIE);
+	riscv_set_timecmp(csr_read(CSR_MHARTID), ~0ULL);
+	if (!prof_mstatus_mie)
+		csr_clear(CSR_MSTATUS, SR_MIE);
+}
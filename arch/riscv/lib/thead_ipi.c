@@ -4,6 +4,27 @@
  * SPDX-License-Identifier: GPL-2.0+
  */
 
+#include <common.h>
+#include <asm/csr.h>
+#include <asm/io.h>
+
+/* The CLINT follows the PLIC, whose base is given by a custom CSR */
+#define CLINT_OFFSET			0x04000000
+/* mtime compare register, split in two 32-bit halves */
+#define MTIMECMP_REG(base, hart)	((ulong)(base) + 0x4000 + (hart) * 8)
+
+int riscv_set_timecmp(int hart, u64 cmp)
+{
+	ulong reg = MTIMECMP_REG(csr_read(CSR_PLIC_BASE) + CLINT_OFFSET, hart);
+
+	/* Do not let the comparator match while only one half is written */
+	writel(~0U, (void __iomem *)(reg + 4));
+	writel((u32)cmp, (void __iomem *)reg);
+	writel(cmp >> 32, (void __iomem *)(reg + 4));
+
+	return 0;
+}
+
 int riscv_send_ipi(int hart)
 {
 	return 0;
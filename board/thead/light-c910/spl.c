@@ -6,6 +6,7 @@
 
 #include <linux/types.h>
 #include <common.h>
+#include <bootstage.h>
 #include <console.h>
 #include <cpu_func.h>
 #include <asm/csr.h>
@@ -349,6 +350,9 @@ static void light_board_init_r(gd_t *gd, ulong dummy)
 	entry = (void (*)(long, long))CONFIG_SYS_TEXT_BASE;
 	invalidate_icache_all();
 	flush_dcache_range(CONFIG_SYS_TEXT_BASE, CONFIG_SYS_TEXT_BASE + CONFIG_SYS_MONITOR_LEN);
+
+	bootstage_mark_name(BOOTSTAGE_ID_END_SPL, "end spl");
+	bootstage_stash_default();
 	entry(0, 0);
 
 	while (1);
@@ -356,6 +360,7 @@ static void light_board_init_r(gd_t *gd, ulong dummy)
 
 void board_init_f(ulong dummy)
 {
+	int span;
 	int ret;
 
 	light_pre_reset_config();
@@ -372,6 +377,7 @@ void board_init_f(ulong dummy)
 	preloader_console_init();
 
 #ifdef CONFIG_PMIC_VOL_INIT
+	span = bootstage_profile_start("pmic_init");
 	ret = pmic_ddr_regu_init();
 	if (ret) {
 		printf("%s pmic init failed %d \n",__func__,ret);
@@ -389,15 +395,26 @@ void board_init_f(ulong dummy)
 		printf("%s set apcpu voltage failed \n",__func__);
 		hang();
 	}
+	bootstage_profile_end(span);
 
 #endif
+	span = bootstage_profile_start("clk_config");
 	ddr_clk_config(0);
 	cpu_clk_config(0);
+	bootstage_profile_end(span);
 
+	span = bootstage_profile_start("init_ddr");
 	init_ddr();
+	bootstage_profile_end(span);
+	span = bootstage_profile_start("ddr_scramble");
 	setup_ddr_scramble();
+	bootstage_profile_end(span);
+	span = bootstage_profile_start("ddr_parity");
 	setup_ddr_parity();
+	bootstage_profile_end(span);
+	span = bootstage_profile_start("ddr_pmp");
 	setup_ddr_pmp();
+	bootstage_profile_end(span);
 
 	printf("ddr initialized, jump to uboot\n");
 	light_board_init_r(NULL, 0);
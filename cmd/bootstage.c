@@ -13,6 +13,14 @@ static int do_bootstage_report(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+static int do_bootstage_flame(cmd_tbl_t *cmdtp, int flag, int argc,
+			      char * const argv[])
+{
+	bootstage_report_folded();
+
+	return 0;
+}
+
 static int get_base_size(int argc, char * const argv[], ulong *basep,
 			 ulong *sizep)
 {
@@ -59,6 +67,7 @@ static int do_bootstage_stash(cmd_tbl_t *cmdtp, int flag, int argc,
 
 static cmd_tbl_t cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
+	U_BOOT_CMD_MKENT(flame, 2, 1, do_bootstage_flame, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
 };
@@ -89,6 +98,7 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	"Boot stage command",
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
+	"flame                       - Print spans as folded stacks\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
 	"unstash [<start> [<size>]]  - Unstash data from memory"
 );
@@ -13,12 +13,15 @@
 #include <mapmem.h>
 #include <errno.h>
 #include <asm/io.h>
+#include <dm/device-internal.h>
 #include <dm/root.h>
 #include <dm/util.h>
 
 static int do_dm_dump_all(cmd_tbl_t *cmdtp, int flag, int argc,
 			  char * const argv[])
 {
+	/* Show the devices whose binding was put off too */
+	dm_lazy_bind_all();
 	dm_dump_all();
 
 	return 0;
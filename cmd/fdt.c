@@ -15,6 +15,7 @@
 #include <asm/global_data.h>
 #include <linux/libfdt.h>
 #include <fdt_support.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <asm/io.h>
 
@@ -693,21 +694,36 @@ static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	else if (strncmp(argv[1], "ap", 2) == 0) {
 		unsigned long addr;
 		struct fdt_header *blob;
+		void **blobs;
+		int count, i;
 		int ret;
 
-		if (argc != 3)
+		if (argc < 3)
 			return CMD_RET_USAGE;
 
 		if (!working_fdt)
 			return CMD_RET_FAILURE;
 
-		addr = simple_strtoul(argv[2], NULL, 16);
-		blob = map_sysmem(addr, 0);
-		if (!fdt_valid(&blob))
+		count = argc - 2;
+		blobs = calloc(count, sizeof(*blobs));
+		if (!blobs)
 			return CMD_RET_FAILURE;
 
+		for (i = 0; i < count; i++) {
+			addr = simple_strtoul(argv[i + 2], NULL, 16);
+			blob = map_sysmem(addr, 0);
+			if (!fdt_valid(&blob)) {
+				free(blobs);
+				return CMD_RET_FAILURE;
+			}
+			blobs[i] = blob;
+		}
+
 		/* apply method prints messages on error */
-		ret = fdt_overlay_apply_verbose(working_fdt, blob);
+		ret = fdt_overlay_apply_list(working_fdt,
+					     fdt_totalsize(working_fdt), blobs,
+					     count);
+		free(blobs);
 		if (ret)
 			return CMD_RET_FAILURE;
 	}
@@ -1060,7 +1076,7 @@ static int fdt_print(const char *pathp, char *prop, int depth)
 static char fdt_help_text[] =
 	"addr [-c]  <addr> [<length>]   - Set the [control] fdt location to <addr>\n"
 #ifdef CONFIG_OF_LIBFDT_OVERLAY
-	"fdt apply <addr>                    - Apply overlay to the DT\n"
+	"fdt apply <addr> [<addr>...]        - Apply overlays to the DT, in order\n"
 #endif
 #ifdef CONFIG_OF_BOARD_SETUP
 	"fdt boardsetup                      - Do board-specific set up\n"
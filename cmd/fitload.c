@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Load the sub-images of a FIT with external data without reading the
+ * whole file to memory first.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <image.h>
+
+static int do_fitload(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	struct fit_lazy_info info;
+	const char *conf = NULL;
+	bool raw = false;
+	ulong addr, time;
+	int ret;
+
+	if (argc > 1 && !strcmp(argv[1], "-r")) {
+		raw = true;
+		argc--;
+		argv++;
+	}
+	if (argc < 5 || argc > 6)
+		return CMD_RET_USAGE;
+	addr = simple_strtoul(argv[3], NULL, 16);
+	if (argc > 5)
+		conf = argv[5];
+
+	if (raw)
+		ret = fit_lazy_init_blk(&info, argv[1], argv[2],
+					simple_strtoul(argv[4], NULL, 16));
+	else
+		ret = fit_lazy_init_file(&info, argv[1], argv[2], argv[4]);
+	if (ret) {
+		printf("Cannot open FIT (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("## Loading FIT Image to %08lx ...\n", addr);
+	time = get_timer(0);
+	ret = fit_lazy_load(&info, addr, conf, env_get_yesno("verify"));
+	time = get_timer(time);
+	if (ret)
+		return CMD_RET_FAILURE;
+	printf("   Done in %lu ms\n", time);
+
+	env_set_hex("fileaddr", addr);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	fitload,	7,	0,	do_fitload,
+	"load the images of a FIT configuration from storage",
+	"<interface> <dev[:part]> <addr> <filename> [<conf>]\n"
+	"    - read the structure of FIT file 'filename' to 'addr', then read\n"
+	"      each sub-image used by configuration 'conf' (or the default\n"
+	"      one) straight to its load address\n"
+	"fitload -r <interface> <dev[:part]> <addr> <blk> [<conf>]\n"
+	"    - same for a FIT stored raw at block 'blk' of the partition\n"
+	"Boot the result with 'bootm <addr>#<conf>'"
+);
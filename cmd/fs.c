@@ -40,6 +40,24 @@ U_BOOT_CMD(
 	"      If 'pos' is 0 or omitted, the file is read from the start."
 )
 
+static int do_load_files_wrapper(cmd_tbl_t *cmdtp, int flag, int argc,
+				 char * const argv[])
+{
+	return do_load_files(cmdtp, flag, argc, argv, FS_TYPE_ANY);
+}
+
+U_BOOT_CMD(
+	loadfiles,	CONFIG_SYS_MAXARGS,	0,	do_load_files_wrapper,
+	"load several binary files from a filesystem",
+	"<interface> <dev[:part]> <addr> <filename> [<addr> <filename> ...]\n"
+	"    - Load each file 'filename' from partition 'part' on device\n"
+	"       type 'interface' instance 'dev' to the address 'addr' before\n"
+	"       it in memory. The partition is mounted once, and all files\n"
+	"       are looked up before any is loaded. On ext4 the blocks of\n"
+	"       all the files are read in the order they are on the device.\n"
+	"      'fileaddr' and 'filesize' are set for the last file."
+)
+
 static int do_save_wrapper(cmd_tbl_t *cmdtp, int flag, int argc,
 				char * const argv[])
 {
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Show malloc() usage statistics
+ */
+
+#include <common.h>
+#include <command.h>
+#include <display_options.h>
+#include <malloc.h>
+
+static void malloc_show_size(const char *name, ulong size)
+{
+	printf("%-14s", name);
+	print_size(size, "\n");
+}
+
+static int do_malloc_stats(void)
+{
+	struct malloc_statistics st;
+	ulong start, end;
+	int i;
+
+	malloc_get_statistics(&st);
+
+	printf("pool          %08lx, ", st.pool_start);
+	print_size(st.pool_size, "\n");
+	malloc_show_size("brk used", st.brk_used);
+	malloc_show_size("brk peak", st.brk_peak);
+	malloc_show_size("in use", st.in_use);
+	malloc_show_size("peak in use", st.peak_in_use);
+	printf("%-14s", "free");
+	print_size(st.free_bytes, "");
+	printf(" in %lu chunk(s) + top\n", st.free_chunks);
+	malloc_show_size("largest free", st.largest_free);
+
+	printf("\ncalls         malloc %lu, calloc %lu, realloc %lu, memalign %lu, free %lu\n",
+	       st.mallocs, st.callocs, st.reallocs, st.memaligns, st.frees);
+	printf("failures      %lu", st.failures);
+	if (st.failures)
+		printf(", largest %lu bytes", st.largest_failure);
+	putc('\n');
+
+	puts("\nrequest size       count\n");
+	for (i = 0; i < MALLOC_HIST_BUCKETS; i++) {
+		if (!st.hist[i])
+			continue;
+		start = i ? (16UL << (i - 1)) + 1 : 0;
+		end = 16UL << i;
+		if (i == MALLOC_HIST_BUCKETS - 1)
+			printf("%8lu -          %10lu\n", start, st.hist[i]);
+		else
+			printf("%8lu - %-8lu %10lu\n", start, end, st.hist[i]);
+	}
+
+	if (st.slab_size) {
+		printf("\nslab          %08lx, ", st.slab_start);
+		print_size(st.slab_size, "\n");
+		puts("object  pages   in use     peak\n");
+		for (i = 0; i < MALLOC_SLAB_CLASSES; i++)
+			printf("%6lu %6lu %8lu %8lu\n", st.slab[i].size,
+			       st.slab[i].pages, st.slab[i].in_use,
+			       st.slab[i].peak);
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
+static int do_malloc(cmd_tbl_t *cmdtp, int flag, int argc,
+		     char * const argv[])
+{
+	if (argc < 2 || !strcmp(argv[1], "stats"))
+		return do_malloc_stats();
+	if (!strcmp(argv[1], "reset")) {
+		malloc_reset_statistics();
+		return CMD_RET_SUCCESS;
+	}
+
+	return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(
+	malloc,	2,	1,	do_malloc,
+	"show malloc() usage",
+	"[stats] - show pool usage, fragmentation and call statistics\n"
+	"malloc reset - reset the call statistics and the peak usage"
+);
@@ -95,6 +95,7 @@ static void print_mmcinfo(struct mmc *mmc)
 }
 static struct mmc *init_mmc_device(int dev, bool force_init)
 {
+	struct blk_desc *bd;
 	struct mmc *mmc;
 	mmc = find_mmc_device(dev);
 	if (!mmc) {
@@ -111,10 +112,8 @@ static struct mmc *init_mmc_device(int dev, bool force_init)
 	if (mmc_init(mmc))
 		return NULL;
 
-#ifdef CONFIG_BLOCK_CACHE
-	struct blk_desc *bd = mmc_get_blk_desc(mmc);
-	blkcache_invalidate(bd->if_type, bd->devnum);
-#endif
+	bd = mmc_get_blk_desc(mmc);
+	blk_invalidate(bd->if_type, bd->devnum);
 
 	return mmc;
 }
@@ -549,6 +548,9 @@ static int do_mmc_rescan(cmd_tbl_t *cmdtp, int flag,
 {
 	struct mmc *mmc;
 
+	/* The card may have been swapped */
+	blk_invalidate(IF_TYPE_MMC, curr_device);
+
 #ifdef CONFIG_TARGET_LIGHT_C910
 	mmc = find_mmc_device(curr_device);
 	if (!mmc) {
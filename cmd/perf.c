@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Commands to count hardware events
+ */
+
+#include <common.h>
+#include <command.h>
+#include <hash.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <asm/perf.h>
+
+static int do_perf_list(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	int i;
+
+	for (i = 0; i < PERF_EVENT_COUNT; i++) {
+		if (perf_supported(i))
+			printf("%s\n", perf_event_name(i));
+	}
+
+	return 0;
+}
+
+static int do_perf_run(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char * const argv[])
+{
+	struct perf_counts start, end;
+	int ret;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	if (perf_start())
+		printf("Warning: not enough counters for all events\n");
+	perf_read(&start);
+	ret = run_command(argv[1], flag);
+	perf_read(&end);
+	perf_print(&start, &end, 0);
+
+	return ret ? CMD_RET_FAILURE : 0;
+}
+
+static int perf_bench_memcpy(ulong size, uint loops)
+{
+	struct perf_bench bench;
+	void *src, *dst;
+	uint i;
+
+	src = malloc_cache_aligned(size);
+	dst = malloc_cache_aligned(size);
+	if (!src || !dst) {
+		free(src);
+		free(dst);
+		return -ENOMEM;
+	}
+
+	memset(src, 0x5a, size);
+	perf_bench_start(&bench);
+	for (i = 0; i < loops; i++)
+		memcpy(dst, src, size);
+	perf_bench_end(&bench, "memcpy", size * loops);
+	free(src);
+	free(dst);
+
+	return 0;
+}
+
+static int perf_bench_hash(const char *algo_name, ulong size, uint loops)
+{
+	u8 output[HASH_MAX_DIGEST_SIZE];
+	struct perf_bench bench;
+	struct hash_algo *algo;
+	void *buf;
+	uint i;
+	int ret;
+
+	ret = hash_lookup_algo(algo_name, &algo);
+	if (ret)
+		return ret;
+
+	buf = malloc_cache_aligned(size);
+	if (!buf)
+		return -ENOMEM;
+
+	memset(buf, 0x5a, size);
+	perf_bench_start(&bench);
+	for (i = 0; i < loops; i++)
+		algo->hash_func_ws(buf, size, output, algo->chunk_size);
+	perf_bench_end(&bench, algo->name, size * loops);
+	free(buf);
+
+	return 0;
+}
+
+static int do_perf_bench(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char * const argv[])
+{
+	const char *algo = NULL;
+	uint loops = 1;
+	ulong size;
+	int ret;
+
+	if (argc < 3)
+		return CMD_RET_USAGE;
+	if (!strcmp(argv[1], "hash")) {
+		if (!CONFIG_IS_ENABLED(HASH) || argc < 4)
+			return CMD_RET_USAGE;
+		algo = argv[2];
+		argc--;
+		argv++;
+	} else if (strcmp(argv[1], "memcpy")) {
+		return CMD_RET_USAGE;
+	}
+
+	size = simple_strtoul(argv[2], NULL, 16);
+	if (argc > 3)
+		loops = simple_strtoul(argv[3], NULL, 10);
+	if (!size || !loops)
+		return CMD_RET_USAGE;
+
+	if (CONFIG_IS_ENABLED(HASH) && algo)
+		ret = perf_bench_hash(algo, size, loops);
+	else
+		ret = perf_bench_memcpy(size, loops);
+	if (ret) {
+		printf("Benchmark failed (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+static cmd_tbl_t cmd_perf_sub[] = {
+	U_BOOT_CMD_MKENT(list, 1, 1, do_perf_list, "", ""),
+	U_BOOT_CMD_MKENT(run, 2, 0, do_perf_run, "", ""),
+	U_BOOT_CMD_MKENT(bench, 5, 0, do_perf_bench, "", ""),
+};
+
+static int do_perf(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* Strip off leading 'perf' command argument */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], cmd_perf_sub, ARRAY_SIZE(cmd_perf_sub));
+
+	if (c)
+		return c->cmd(cmdtp, flag, argc, argv);
+	else
+		return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(perf, 6, 0, do_perf,
+	"count hardware events",
+	"list                                - List the events counted\n"
+	"perf run <command>                       - Count events while running a command\n"
+	"perf bench memcpy <size> [<loops>]       - Count events copying memory\n"
+	"perf bench hash <algo> <size> [<loops>]  - Count events hashing memory"
+);
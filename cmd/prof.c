@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Commands for the statistical profiler
+ */
+
+#include <common.h>
+#include <command.h>
+#include <env.h>
+#include <mapmem.h>
+#include <prof.h>
+
+/* Sample every 100us unless told otherwise */
+#define PROF_PERIOD_US		100
+/* Number of functions listed unless told otherwise */
+#define PROF_REPORT_COUNT	20
+
+static int prof_start_period(int argc, char * const argv[])
+{
+	uint period_us = PROF_PERIOD_US;
+	int ret;
+
+	if (argc > 1)
+		period_us = simple_strtoul(argv[1], NULL, 10);
+	if (!period_us)
+		return CMD_RET_USAGE;
+
+	ret = prof_start(period_us);
+	if (ret) {
+		printf("Cannot start profiler (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+static int do_prof_start(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char * const argv[])
+{
+	return prof_start_period(argc, argv);
+}
+
+static int do_prof_stop(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	prof_stop();
+
+	return 0;
+}
+
+static int do_prof_reset(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char * const argv[])
+{
+	prof_reset();
+
+	return 0;
+}
+
+static int do_prof_report(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	int count = PROF_REPORT_COUNT;
+
+	if (argc > 1)
+		count = simple_strtoul(argv[1], NULL, 10);
+	prof_report(count);
+
+	return 0;
+}
+
+static int do_prof_run(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char * const argv[])
+{
+	int ret;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	prof_reset();
+	ret = prof_start_period(argc - 1, argv + 1);
+	if (ret)
+		return ret;
+	ret = run_command(argv[1], flag);
+	prof_stop();
+	prof_report(PROF_REPORT_COUNT);
+
+	return ret ? CMD_RET_FAILURE : 0;
+}
+
+static int do_prof_export(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	size_t size, needed;
+	ulong addr;
+	char *buf;
+	int ret;
+
+	if (argc < 3)
+		return CMD_RET_USAGE;
+	addr = simple_strtoul(argv[1], NULL, 16);
+	size = simple_strtoul(argv[2], NULL, 16);
+
+	buf = map_sysmem(addr, size);
+	ret = prof_export(buf, size, &needed);
+	unmap_sysmem(buf);
+	if (ret == -ENOSPC) {
+		printf("Error: truncated (%#zx bytes needed)\n", needed + 1);
+		return CMD_RET_FAILURE;
+	} else if (ret) {
+		printf("Cannot export profile (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+	printf("Profile dumped to %08lx, size %#zx\n", addr, needed);
+	env_set_hex("filesize", needed);
+
+	return 0;
+}
+
+static cmd_tbl_t cmd_prof_sub[] = {
+	U_BOOT_CMD_MKENT(start, 2, 0, do_prof_start, "", ""),
+	U_BOOT_CMD_MKENT(stop, 1, 0, do_prof_stop, "", ""),
+	U_BOOT_CMD_MKENT(reset, 1, 0, do_prof_reset, "", ""),
+	U_BOOT_CMD_MKENT(report, 2, 1, do_prof_report, "", ""),
+	U_BOOT_CMD_MKENT(run, 3, 0, do_prof_run, "", ""),
+	U_BOOT_CMD_MKENT(export, 3, 0, do_prof_export, "", ""),
+};
+
+static int do_prof(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* Strip off leading 'prof' command argument */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], cmd_prof_sub, ARRAY_SIZE(cmd_prof_sub));
+
+	if (c)
+		return c->cmd(cmdtp, flag, argc, argv);
+	else
+		return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(prof, 4, 0, do_prof,
+	"statistical profiler",
+	"start [<period_us>]         - Start sampling, every 100us by default\n"
+	"prof stop                        - Stop sampling\n"
+	"prof reset                       - Throw away the samples\n"
+	"prof report [<count>]            - Print the busiest functions\n"
+	"prof run <command> [<period_us>] - Profile a single command\n"
+	"prof export <addr> <size>        - Write the samples to memory as text"
+);
@@ -11,6 +11,7 @@
  */
 
 #include <common.h>
+#include <blk.h>
 #include <command.h>
 #include <console.h>
 #include <dm.h>
@@ -645,6 +646,8 @@ static int do_usb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		if (do_usb_stop_keyboard(1) != 0)
 			return 1;
 		usb_stop();
+		/* The devices found by the rescan may be different ones */
+		blk_invalidate(IF_TYPE_USB, -1);
 		do_usb_start();
 		return 0;
 	}
@@ -655,6 +658,7 @@ static int do_usb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			return 1;
 		printf("stopping USB..\n");
 		usb_stop();
+		blk_invalidate(IF_TYPE_USB, -1);
 		return 0;
 	}
 	if (!usb_started) {
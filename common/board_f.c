@@ -798,17 +798,15 @@ static int jump_to_copy(void)
 static int initf_bootstage(void)
 {
 	bool from_spl = IS_ENABLED(CONFIG_SPL_BOOTSTAGE) &&
-			IS_ENABLED(CONFIG_BOOTSTAGE_STASH);
+			(IS_ENABLED(CONFIG_BOOTSTAGE_STASH) ||
+			 IS_ENABLED(CONFIG_SPL_BLOBLIST));
 	int ret;
 
 	ret = bootstage_init(!from_spl);
 	if (ret)
 		return ret;
 	if (from_spl) {
-		const void *stash = map_sysmem(CONFIG_BOOTSTAGE_STASH_ADDR,
-					       CONFIG_BOOTSTAGE_STASH_SIZE);
-
-		ret = bootstage_unstash(stash, CONFIG_BOOTSTAGE_STASH_SIZE);
+		ret = bootstage_unstash_default();
 		if (ret && ret != -ENOENT) {
 			debug("Failed to unstash bootstage: err=%d\n", ret);
 			return ret;
@@ -870,10 +868,10 @@ static const init_fnc_t init_sequence_f[] = {
 #endif
 	initf_malloc,
 	log_init,
-	initf_bootstage,	/* uses its own timer, so does not need DM */
 #ifdef CONFIG_BLOBLIST
-	bloblist_init,
+	bloblist_init,		/* may hold bootstage records from SPL */
 #endif
+	initf_bootstage,	/* uses its own timer, so does not need DM */
 	setup_spl_handoff,
 	initf_console_record,
 #if defined(CONFIG_HAVE_FSP)
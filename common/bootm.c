@@ -68,8 +68,18 @@ static inline void boot_start_lmb(bootm_headers_t *images) { }
 static int bootm_start(cmd_tbl_t *cmdtp, int flag, int argc,
 		       char * const argv[])
 {
+#ifdef CONFIG_LMB
+	/* Drop any region tables left over from a previous bootm */
+	lmb_release(&images.lmb);
+#endif
 	memset((void *)&images, 0, sizeof(images));
 	images.verify = env_get_yesno("verify");
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+	fit_digest_release();
+#endif
+#if CONFIG_IS_ENABLED(FIT_LAZY_LOAD)
+	fit_lazy_recheck();
+#endif
 
 	boot_start_lmb(&images);
 
@@ -86,6 +96,9 @@ static int bootm_find_os(cmd_tbl_t *cmdtp, int flag, int argc,
 	bool ep_found = false;
 	int ret;
 
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+	fit_digest_begin();
+#endif
 	/* get kernel image header, start address and length */
 	os_hdr = boot_get_kernel(cmdtp, flag, argc, argv,
 			&images, &images.os.image_start, &images.os.image_len);
@@ -240,12 +253,16 @@ int bootm_find_images(int flag, int argc, char * const argv[])
 {
 	int ret;
 
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+	fit_digest_begin();
+#endif
 	/* find ramdisk */
 	ret = boot_get_ramdisk(argc, argv, &images, IH_INITRD_ARCH,
 			       &images.rd_start, &images.rd_end);
 	if (ret) {
 		puts("Ramdisk image is corrupt or invalid\n");
-		return 1;
+		ret = 1;
+		goto out;
 	}
 
 #if IMAGE_ENABLE_OF_LIBFDT
@@ -254,7 +271,8 @@ int bootm_find_images(int flag, int argc, char * const argv[])
 			   &images.ft_addr, &images.ft_len);
 	if (ret) {
 		puts("Could not find a valid device tree\n");
-		return 1;
+		ret = 1;
+		goto out;
 	}
 	if (CONFIG_IS_ENABLED(CMD_FDT))
 		set_working_fdt_addr(map_to_sysmem(images.ft_addr));
@@ -267,7 +285,8 @@ int bootm_find_images(int flag, int argc, char * const argv[])
 			    NULL, NULL);
 	if (ret) {
 		printf("FPGA image is corrupted or invalid\n");
-		return 1;
+		ret = 1;
+		goto out;
 	}
 #endif
 
@@ -276,11 +295,18 @@ int bootm_find_images(int flag, int argc, char * const argv[])
 			       NULL, NULL);
 	if (ret) {
 		printf("Loadable(s) is corrupt or invalid\n");
-		return 1;
+		ret = 1;
+		goto out;
 	}
 #endif
+	ret = 0;
+out:
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+	/* Image data may be overwritten from here on */
+	fit_digest_release();
+#endif
 
-	return 0;
+	return ret;
 }
 
 static int bootm_find_other(cmd_tbl_t *cmdtp, int flag, int argc,
@@ -540,6 +566,12 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	if (!ret && (states & BOOTM_STATE_FINDOTHER))
 		ret = bootm_find_other(cmdtp, flag, argc, argv);
 
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+	/* Close the window opened by bootm_find_os(), whatever happened */
+	if (states & (BOOTM_STATE_FINDOS | BOOTM_STATE_FINDOTHER))
+		fit_digest_release();
+#endif
+
 	/* Load the OS */
 	if (!ret && (states & BOOTM_STATE_LOADOS)) {
 		iflag = bootm_disable_interrupts();
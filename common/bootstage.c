@@ -10,7 +10,9 @@
  */
 
 #include <common.h>
+#include <bloblist.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <sort.h>
 #include <spl.h>
 #include <linux/compiler.h>
@@ -20,6 +22,9 @@ DECLARE_GLOBAL_DATA_PTR;
 
 enum {
 	RECORD_COUNT = CONFIG_VAL(BOOTSTAGE_RECORD_COUNT),
+
+	/* Spans stop here, leaving room for the marks of the boot stages */
+	SPAN_RECORD_COUNT = RECORD_COUNT - RECORD_COUNT / 4,
 };
 
 struct bootstage_record {
@@ -28,16 +33,22 @@ struct bootstage_record {
 	const char *name;
 	int flags;		/* see enum bootstage_flags */
 	enum bootstage_id id;
+	enum bootstage_id parent;	/* Enclosing span, 0 if none */
 };
 
 struct bootstage_data {
 	uint rec_count;
 	uint next_id;
+	enum bootstage_id span;		/* Innermost open span, 0 if none */
+	uint span_dropped;		/* Spans left out for lack of room */
 	struct bootstage_record record[RECORD_COUNT];
 };
 
+/* Spans nested deeper than this are reported at this depth */
+#define BOOTSTAGE_SPAN_DEPTH	16
+
 enum {
-	BOOTSTAGE_VERSION	= 0,
+	BOOTSTAGE_VERSION	= 1,
 	BOOTSTAGE_MAGIC		= 0xb00757a3,
 	BOOTSTAGE_DIGITS	= 9,
 };
@@ -214,6 +225,62 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+int bootstage_span_start(const char *name)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+
+	if (!data)
+		return -ENOSPC;
+	if (data->rec_count >= SPAN_RECORD_COUNT) {
+		data->span_dropped++;
+		return -ENOSPC;
+	}
+
+	/*
+	 * Devices can be unbound and their names freed, so keep a copy. Names
+	 * recorded before the full malloc() is ready are copied by
+	 * bootstage_relocate() instead
+	 */
+	if (gd->flags & GD_FLG_FULL_MALLOC_INIT) {
+		name = strdup(name);
+		if (!name)
+			return -ENOMEM;
+	}
+
+	rec = &data->record[data->rec_count++];
+	rec->id = data->next_id++;
+	rec->name = name;
+	rec->flags = BOOTSTAGEF_SPAN;
+	rec->parent = data->span;
+	rec->time_us = 0;
+	rec->start_us = timer_get_boot_us();
+	data->span = rec->id;
+
+	return rec->id;
+}
+
+void bootstage_span_end(int id)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+	int i;
+
+	if (!data || id < 0)
+		return;
+
+	/* The span was most likely started recently */
+	for (i = data->rec_count - 1; i >= 0; i--) {
+		rec = &data->record[i];
+		if (rec->id == id && (rec->flags & BOOTSTAGEF_SPAN)) {
+			rec->time_us = (uint32_t)timer_get_boot_us() -
+				rec->start_us;
+			data->span = rec->parent;
+			break;
+		}
+	}
+}
+
 /**
  * Get a record name as a printable string
  *
@@ -309,6 +376,11 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 				rec->start_us ? "accum" : "mark",
 				rec->time_us))
 			return -EINVAL;
+
+		/* Spans also say when they started */
+		if ((rec->flags & BOOTSTAGEF_SPAN) &&
+		    fdt_setprop_cell(blob, node, "start", rec->start_us))
+			return -EINVAL;
 	}
 
 	return 0;
@@ -347,14 +419,77 @@ void bootstage_report(void)
 		printf("Overflowed internal boot id table by %d entries\n"
 		       "Please increase CONFIG_(SPL_)BOOTSTAGE_RECORD_COUNT\n",
 		       data->rec_count - RECORD_COUNT);
+	if (data->span_dropped)
+		printf("Dropped %u spans to keep room for the boot stages\n"
+		       "Please increase CONFIG_(SPL_)BOOTSTAGE_RECORD_COUNT\n",
+		       data->span_dropped);
 
 	puts("\nAccumulated time:\n");
 	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
-		if (rec->start_us)
+		if (rec->start_us && !(rec->flags & BOOTSTAGEF_SPAN))
 			prev = print_time_record(rec, -1);
 	}
 }
 
+static struct bootstage_record *find_span(struct bootstage_data *data,
+					  enum bootstage_id id)
+{
+	struct bootstage_record *rec = find_id(data, id);
+
+	return rec && (rec->flags & BOOTSTAGEF_SPAN) ? rec : NULL;
+}
+
+/* Get the duration of a span, up to now if it has not ended yet */
+static ulong span_time(struct bootstage_data *data,
+		       struct bootstage_record *rec, uint32_t now)
+{
+	struct bootstage_record *open;
+
+	for (open = find_span(data, data->span); open;
+	     open = find_span(data, open->parent)) {
+		if (open == rec)
+			return now - rec->start_us;
+	}
+
+	return rec->time_us;
+}
+
+void bootstage_report_folded(void)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *stack[BOOTSTAGE_SPAN_DEPTH];
+	struct bootstage_record *rec, *child, *parent;
+	uint32_t now = timer_get_boot_us();
+	char buf[20];
+	long self;
+	int i, j, depth;
+
+	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
+		if (!(rec->flags & BOOTSTAGEF_SPAN))
+			continue;
+
+		/* Leave out the time spent in nested spans */
+		self = span_time(data, rec, now);
+		for (j = 0, child = data->record; j < data->rec_count;
+		     j++, child++) {
+			if ((child->flags & BOOTSTAGEF_SPAN) &&
+			    child->parent == rec->id)
+				self -= span_time(data, child, now);
+		}
+
+		depth = 0;
+		for (parent = rec; parent && depth < BOOTSTAGE_SPAN_DEPTH;
+		     parent = find_span(data, parent->parent))
+			stack[depth++] = parent;
+		while (depth--) {
+			printf("%s%c", get_record_name(buf, sizeof(buf),
+						       stack[depth]),
+			       depth ? ';' : ' ');
+		}
+		printf("%ld\n", self > 0 ? self : 0);
+	}
+}
+
 /**
  * Append data to a memory buffer
  *
@@ -480,7 +615,7 @@ int bootstage_unstash(const void *base, int size)
 
 	/* Read the name strings */
 	ptr += rec_size;
-	for (rec = data->record + data->next_id, i = 0; i < hdr->count;
+	for (rec = data->record + data->rec_count, i = 0; i < hdr->count;
 	     i++, rec++) {
 		rec->name = ptr;
 		if (spl_phase() == PHASE_SPL)
@@ -498,6 +633,74 @@ int bootstage_unstash(const void *base, int size)
 	return 0;
 }
 
+/* Get the number of bytes needed by bootstage_stash() */
+static int bootstage_stash_size(void)
+{
+	const struct bootstage_data *data = gd->bootstage;
+	const struct bootstage_record *rec;
+	char buf[20];
+	int size;
+	int i;
+
+	size = sizeof(struct bootstage_hdr);
+	for (rec = data->record, i = 0; i < data->rec_count; i++, rec++) {
+		size += sizeof(*rec);
+		size += strlen(get_record_name(buf, sizeof(buf), rec)) + 1;
+	}
+
+	return size;
+}
+
+int bootstage_stash_default(void)
+{
+	void *stash;
+	int ret;
+
+#if CONFIG_IS_ENABLED(BLOBLIST)
+	if (gd->bloblist) {
+		int size = bootstage_stash_size();
+
+		ret = bloblist_ensure_size(BLOBLISTT_BOOTSTAGE, size, &stash);
+		if (ret)
+			return ret;
+		ret = bootstage_stash(stash, size);
+		if (ret)
+			return ret;
+
+		/* The bloblist may already have been finished */
+		return bloblist_finish();
+	}
+#endif
+	if (!IS_ENABLED(CONFIG_BOOTSTAGE_STASH))
+		return -ENOENT;
+
+	stash = map_sysmem(CONFIG_BOOTSTAGE_STASH_ADDR,
+			   CONFIG_BOOTSTAGE_STASH_SIZE);
+	ret = bootstage_stash(stash, CONFIG_BOOTSTAGE_STASH_SIZE);
+	unmap_sysmem(stash);
+
+	return ret;
+}
+
+int bootstage_unstash_default(void)
+{
+	const void *stash;
+
+#if CONFIG_IS_ENABLED(BLOBLIST)
+	stash = bloblist_find(BLOBLISTT_BOOTSTAGE, 0);
+	if (stash)
+		return bootstage_unstash(stash, -1);
+#endif
+	if (!IS_ENABLED(CONFIG_BOOTSTAGE_STASH))
+		return -ENOENT;
+
+	/* The records keep pointing to the names in the stash */
+	stash = map_sysmem(CONFIG_BOOTSTAGE_STASH_ADDR,
+			   CONFIG_BOOTSTAGE_STASH_SIZE);
+
+	return bootstage_unstash(stash, CONFIG_BOOTSTAGE_STASH_SIZE);
+}
+
 int bootstage_get_size(void)
 {
 	struct bootstage_data *data = gd->bootstage;
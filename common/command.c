@@ -9,6 +9,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <command.h>
 #include <console.h>
 #include <env.h>
@@ -625,10 +626,13 @@ enum command_ret_t cmd_process(int flag, int argc, char * const argv[],
 	/* If OK so far, then do the command */
 	if (!rc) {
 		int newrep;
+		int span;
 
 		if (ticks)
 			*ticks = get_timer(0);
+		span = bootstage_profile_start(cmdtp->name);
 		rc = cmd_call(cmdtp, flag, argc, argv, &newrep);
+		bootstage_profile_end(span);
 		if (ticks)
 			*ticks = get_timer(*ticks);
 		*repeatable &= newrep;
@@ -19,6 +19,10 @@ void malloc_stats();
 
 DECLARE_GLOBAL_DATA_PTR;
 
+static void malloc_slab_init(void);
+static Void_t *dl_malloc(size_t bytes);
+static void dl_free(Void_t *mem);
+
 /*
   Emulation of sbrk for WIN32
   All code within the ifdef WIN32 is untested by me.
@@ -610,6 +614,7 @@ void mem_malloc_init(ulong start, ulong size)
 	memset((void *)mem_malloc_start, 0x0, size);
 #endif
 	malloc_bin_reloc();
+	malloc_slab_init();
 }
 
 /* field-extraction macros */
@@ -1155,7 +1160,7 @@ static void malloc_extend_top(nb) INTERNAL_SIZE_T nb;
 	SIZE_SZ|PREV_INUSE;
       /* If possible, release the rest. */
       if (old_top_size >= MINSIZE)
-	fREe(chunk2mem(old_top));
+	dl_free(chunk2mem(old_top));
     }
   }
 
@@ -1234,9 +1239,9 @@ static void malloc_extend_top(nb) INTERNAL_SIZE_T nb;
 */
 
 #if __STD_C
-Void_t* mALLOc(size_t bytes)
+static Void_t* dl_malloc(size_t bytes)
 #else
-Void_t* mALLOc(bytes) size_t bytes;
+static Void_t* dl_malloc(bytes) size_t bytes;
 #endif
 {
   mchunkptr victim;                  /* inspected/selected chunk */
@@ -1506,9 +1511,9 @@ Void_t* mALLOc(bytes) size_t bytes;
 
 
 #if __STD_C
-void fREe(Void_t* mem)
+static void dl_free(Void_t* mem)
 #else
-void fREe(mem) Void_t* mem;
+static void dl_free(mem) Void_t* mem;
 #endif
 {
   mchunkptr p;         /* chunk corresponding to mem */
@@ -1644,9 +1649,9 @@ void fREe(mem) Void_t* mem;
 
 
 #if __STD_C
-Void_t* rEALLOc(Void_t* oldmem, size_t bytes)
+static Void_t* dl_realloc(Void_t* oldmem, size_t bytes)
 #else
-Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
+static Void_t* dl_realloc(oldmem, bytes) Void_t* oldmem; size_t bytes;
 #endif
 {
   INTERNAL_SIZE_T    nb;      /* padded request size */
@@ -1672,7 +1677,7 @@ Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
 
 #ifdef REALLOC_ZERO_BYTES_FREES
   if (!bytes) {
-	fREe(oldmem);
+	dl_free(oldmem);
 	return NULL;
   }
 #endif
@@ -1680,7 +1685,7 @@ Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
   if ((long)bytes < 0) return NULL;
 
   /* realloc of null is supposed to be same as malloc */
-  if (oldmem == NULL) return mALLOc(bytes);
+  if (oldmem == NULL) return dl_malloc(bytes);
 
 #if CONFIG_VAL(SYS_MALLOC_F_LEN)
 	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT)) {
@@ -1705,7 +1710,7 @@ Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
     /* Note the extra SIZE_SZ overhead. */
     if(oldsize - SIZE_SZ >= nb) return oldmem; /* do nothing */
     /* Must alloc, copy, free. */
-    newmem = mALLOc(bytes);
+    newmem = dl_malloc(bytes);
     if (!newmem)
 	return NULL; /* propagate failure */
     MALLOC_COPY(newmem, oldmem, oldsize - 2*SIZE_SZ);
@@ -1808,7 +1813,7 @@ Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
 
     /* Must allocate */
 
-    newmem = mALLOc (bytes);
+    newmem = dl_malloc(bytes);
 
     if (newmem == NULL)  /* propagate failure */
       return NULL;
@@ -1825,7 +1830,7 @@ Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
 
     /* Otherwise copy, free, and exit */
     MALLOC_COPY(newmem, oldmem, oldsize - SIZE_SZ);
-    fREe(oldmem);
+    dl_free(oldmem);
     return newmem;
   }
 
@@ -1839,7 +1844,7 @@ Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
     set_head_size(newp, nb);
     set_head(remainder, remainder_size | PREV_INUSE);
     set_inuse_bit_at_offset(remainder, remainder_size);
-    fREe(chunk2mem(remainder)); /* let free() deal with it */
+    dl_free(chunk2mem(remainder)); /* let free() deal with it */
   }
   else
   {
@@ -1874,9 +1879,9 @@ Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
 
 
 #if __STD_C
-Void_t* mEMALIGn(size_t alignment, size_t bytes)
+static Void_t* dl_memalign(size_t alignment, size_t bytes)
 #else
-Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
+static Void_t* dl_memalign(alignment, bytes) size_t alignment; size_t bytes;
 #endif
 {
   INTERNAL_SIZE_T    nb;      /* padded  request size */
@@ -1899,7 +1904,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
 
   /* If need less alignment than we give anyway, just relay to malloc */
 
-  if (alignment <= MALLOC_ALIGNMENT) return mALLOc(bytes);
+  if (alignment <= MALLOC_ALIGNMENT) return dl_malloc(bytes);
 
   /* Otherwise, ensure that it is at least a minimum chunk size */
 
@@ -1908,7 +1913,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
   /* Call malloc with worst case padding to hit alignment. */
 
   nb = request2size(bytes);
-  m  = (char*)(mALLOc(nb + alignment + MINSIZE));
+  m  = (char*)(dl_malloc(nb + alignment + MINSIZE));
 
   /*
   * The attempt to over-allocate (with a size large enough to guarantee the
@@ -1924,7 +1929,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
      * Use bytes not nb, since mALLOc internally calls request2size too, and
      * each call increases the size to allocate, to account for the header.
      */
-    m  = (char*)(mALLOc(bytes));
+    m  = (char*)(dl_malloc(bytes));
     /* Aligned -> return it */
     if ((((unsigned long)(m)) % alignment) == 0)
       return m;
@@ -1932,10 +1937,10 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
      * Otherwise, try again, requesting enough extra space to be able to
      * acquire alignment.
      */
-    fREe(m);
+    dl_free(m);
     /* Add in extra bytes to match misalignment of unexpanded allocation */
     extra = alignment - (((unsigned long)(m)) % alignment);
-    m  = (char*)(mALLOc(bytes + extra));
+    m  = (char*)(dl_malloc(bytes + extra));
     /*
      * m might not be the same as before. Validate that the previous value of
      * extra still works for the current value of m.
@@ -1944,7 +1949,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
     if (m) {
       extra2 = alignment - (((unsigned long)(m)) % alignment);
       if (extra2 > extra) {
-        fREe(m);
+        dl_free(m);
         m = NULL;
       }
     }
@@ -1994,7 +1999,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
     set_head(newp, newsize | PREV_INUSE);
     set_inuse_bit_at_offset(newp, newsize);
     set_head_size(p, leadsize);
-    fREe(chunk2mem(p));
+    dl_free(chunk2mem(p));
     p = newp;
 
     assert (newsize >= nb && (((unsigned long)(chunk2mem(p))) % alignment) == 0);
@@ -2009,7 +2014,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
     remainder = chunk_at_offset(p, nb);
     set_head(remainder, remainder_size | PREV_INUSE);
     set_head_size(p, nb);
-    fREe(chunk2mem(remainder));
+    dl_free(chunk2mem(remainder));
   }
 
   check_inuse_chunk(p);
@@ -2058,9 +2063,9 @@ Void_t* pvALLOc(bytes) size_t bytes;
 */
 
 #if __STD_C
-Void_t* cALLOc(size_t n, size_t elem_size)
+static Void_t* dl_calloc(size_t n, size_t elem_size)
 #else
-Void_t* cALLOc(n, elem_size) size_t n; size_t elem_size;
+static Void_t* dl_calloc(n, elem_size) size_t n; size_t elem_size;
 #endif
 {
   mchunkptr p;
@@ -2076,7 +2081,7 @@ Void_t* cALLOc(n, elem_size) size_t n; size_t elem_size;
   INTERNAL_SIZE_T oldtopsize = chunksize(top);
 #endif
 #endif
-  Void_t* mem = mALLOc (sz);
+  Void_t* mem = dl_malloc(sz);
 
   if ((long)n < 0) return NULL;
 
@@ -2116,6 +2121,354 @@ Void_t* cALLOc(n, elem_size) size_t n; size_t elem_size;
   }
 }
 
+/*
+  U-Boot front end: optional small-object slab and allocation statistics.
+
+  The dl_*() routines above are the plain dlmalloc allocator. The public
+  entry points below sit in front of them, so that small requests can be
+  served from fixed-size slabs (CONFIG_SYS_MALLOC_SLAB) and every call can
+  be accounted for (CONFIG_SYS_MALLOC_STATS). Internal calls between the
+  dl_*() routines bypass both.
+*/
+
+static inline int malloc_ready(void)
+{
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	/* Pre-relocation allocations come from malloc_simple() */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return 0;
+#endif
+	return 1;
+}
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+
+#define SLAB_PAGE_SIZE	4096
+#define SLAB_PAGES	(CONFIG_SYS_MALLOC_SLAB_SIZE / SLAB_PAGE_SIZE)
+
+static const ushort slab_obj_size[MALLOC_SLAB_CLASSES] = {
+	16, 32, 64, 128, 256
+};
+
+/**
+ * struct slab_class - State of one object size
+ *
+ * @free:	List of free objects, linked through their first word
+ * @pages:	Number of slab pages given to this size
+ * @in_use:	Number of objects currently allocated
+ * @peak:	Highest value of @in_use seen
+ */
+struct slab_class {
+	void *free;
+	ulong pages;
+	ulong in_use;
+	ulong peak;
+};
+
+static struct slab_class slab_class[MALLOC_SLAB_CLASSES];
+static u8 slab_page_class[SLAB_PAGES];
+static ulong slab_start, slab_end, slab_next_page;
+
+/* Take the slab area from the end of the malloc() pool */
+static void malloc_slab_init(void)
+{
+	ulong end = mem_malloc_end & ~(ulong)(SLAB_PAGE_SIZE - 1);
+
+	memset(slab_class, '\0', sizeof(slab_class));
+	slab_start = 0;
+	slab_end = 0;
+	if (end - mem_malloc_start < 2 * CONFIG_SYS_MALLOC_SLAB_SIZE)
+		return;
+
+	slab_end = end;
+	slab_start = end - SLAB_PAGES * SLAB_PAGE_SIZE;
+	slab_next_page = slab_start;
+	mem_malloc_end = slab_start;
+}
+
+static inline int malloc_slab_owns(const void *mem)
+{
+	return (ulong)mem >= slab_start && (ulong)mem < slab_end;
+}
+
+static inline int malloc_slab_index(const void *mem)
+{
+	return slab_page_class[((ulong)mem - slab_start) / SLAB_PAGE_SIZE];
+}
+
+static void *malloc_slab_alloc(size_t bytes)
+{
+	struct slab_class *sc;
+	ulong page, obj;
+	void *mem;
+	int idx;
+
+	for (idx = 0; idx < MALLOC_SLAB_CLASSES; idx++) {
+		if (bytes <= slab_obj_size[idx])
+			break;
+	}
+	if (idx == MALLOC_SLAB_CLASSES)
+		return NULL;
+
+	sc = &slab_class[idx];
+	if (!sc->free) {
+		/* Out of slab pages: let dlmalloc handle the request */
+		if (slab_next_page >= slab_end)
+			return NULL;
+		page = slab_next_page;
+		slab_next_page += SLAB_PAGE_SIZE;
+		slab_page_class[(page - slab_start) / SLAB_PAGE_SIZE] = idx;
+		for (obj = page + SLAB_PAGE_SIZE - slab_obj_size[idx];
+		     obj >= page; obj -= slab_obj_size[idx]) {
+			*(void **)obj = sc->free;
+			sc->free = (void *)obj;
+		}
+		sc->pages++;
+	}
+
+	mem = sc->free;
+	sc->free = *(void **)mem;
+	if (++sc->in_use > sc->peak)
+		sc->peak = sc->in_use;
+
+	return mem;
+}
+
+static void malloc_slab_free(void *mem)
+{
+	struct slab_class *sc = &slab_class[malloc_slab_index(mem)];
+
+	*(void **)mem = sc->free;
+	sc->free = mem;
+	sc->in_use--;
+}
+
+static inline size_t malloc_slab_size(const void *mem)
+{
+	return slab_obj_size[malloc_slab_index(mem)];
+}
+
+#else
+
+static inline void malloc_slab_init(void) {}
+static inline int malloc_slab_owns(const void *mem) { return 0; }
+static inline void *malloc_slab_alloc(size_t bytes) { return NULL; }
+static inline void malloc_slab_free(void *mem) {}
+static inline size_t malloc_slab_size(const void *mem) { return 0; }
+
+#endif /* SYS_MALLOC_SLAB */
+
+/* Space taken up by an allocation, including dlmalloc overhead */
+static size_t malloc_mem_size(Void_t *mem)
+{
+	if (malloc_slab_owns(mem))
+		return malloc_slab_size(mem);
+
+	return chunksize(mem2chunk(mem));
+}
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_STATS)
+
+static struct malloc_statistics mstats;
+
+static int malloc_hist_bucket(size_t bytes)
+{
+	int bucket;
+
+	if (bytes <= 16)
+		return 0;
+	bucket = fls(min_t(size_t, bytes - 1, UINT_MAX)) - 4;
+
+	return min(bucket, MALLOC_HIST_BUCKETS - 1);
+}
+
+static void malloc_stats_alloc(ulong *counter, size_t bytes, Void_t *mem,
+			       size_t old_size)
+{
+	(*counter)++;
+	mstats.hist[malloc_hist_bucket(bytes)]++;
+	if (!mem) {
+		mstats.failures++;
+		if (bytes > mstats.largest_failure)
+			mstats.largest_failure = bytes;
+		return;
+	}
+	mstats.in_use += malloc_mem_size(mem) - old_size;
+	if (mstats.in_use > mstats.peak_in_use)
+		mstats.peak_in_use = mstats.in_use;
+}
+
+static void malloc_stats_free(Void_t *mem)
+{
+	mstats.frees++;
+	mstats.in_use -= malloc_mem_size(mem);
+}
+
+void malloc_get_statistics(struct malloc_statistics *st)
+{
+	mbinptr b;
+	mchunkptr p;
+	ulong size;
+	int i;
+
+	*st = mstats;
+	st->pool_start = mem_malloc_start;
+	st->pool_size = mem_malloc_end - mem_malloc_start;
+	st->brk_used = mem_malloc_brk - mem_malloc_start;
+	st->brk_peak = max_sbrked_mem;
+
+	/* Free space: the top chunk plus everything sitting in the bins */
+	st->free_bytes = 0;
+	st->free_chunks = 0;
+	st->largest_free = 0;
+	if (top != initial_top) {
+		st->free_bytes = chunksize(top);
+		st->largest_free = chunksize(top);
+	}
+	for (i = 1; i < NAV; ++i) {
+		b = bin_at(i);
+		for (p = last(b); p != b; p = p->bk) {
+			size = chunksize(p);
+			st->free_bytes += size;
+			st->free_chunks++;
+			if (size > st->largest_free)
+				st->largest_free = size;
+		}
+	}
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	st->slab_start = slab_start;
+	st->slab_size = slab_end - slab_start;
+	for (i = 0; i < MALLOC_SLAB_CLASSES; i++) {
+		st->slab[i].size = slab_obj_size[i];
+		st->slab[i].pages = slab_class[i].pages;
+		st->slab[i].in_use = slab_class[i].in_use;
+		st->slab[i].peak = slab_class[i].peak;
+	}
+#endif
+}
+
+void malloc_reset_statistics(void)
+{
+	ulong in_use = mstats.in_use;
+
+	memset(&mstats, '\0', sizeof(mstats));
+	mstats.in_use = in_use;
+	mstats.peak_in_use = in_use;
+}
+
+#define malloc_stat_count(name)	(&mstats.name)
+
+#else
+
+static inline void malloc_stats_alloc(ulong *counter, size_t bytes,
+				      Void_t *mem, size_t old_size) {}
+static inline void malloc_stats_free(Void_t *mem) {}
+
+#define malloc_stat_count(name)	NULL
+
+#endif /* SYS_MALLOC_STATS */
+
+#define malloc_accounting() \
+	(CONFIG_IS_ENABLED(SYS_MALLOC_STATS) || \
+	 CONFIG_IS_ENABLED(SYS_MALLOC_SLAB))
+
+Void_t *mALLOc(size_t bytes)
+{
+	Void_t *mem;
+
+	if (!malloc_ready())
+		return dl_malloc(bytes);
+
+	mem = malloc_slab_alloc(bytes);
+	if (!mem)
+		mem = dl_malloc(bytes);
+	malloc_stats_alloc(malloc_stat_count(mallocs), bytes, mem, 0);
+
+	return mem;
+}
+
+void fREe(Void_t *mem)
+{
+	if (!mem || !malloc_ready()) {
+		dl_free(mem);
+		return;
+	}
+
+	malloc_stats_free(mem);
+	if (malloc_slab_owns(mem))
+		malloc_slab_free(mem);
+	else
+		dl_free(mem);
+}
+
+Void_t *rEALLOc(Void_t *oldmem, size_t bytes)
+{
+	Void_t *mem;
+	size_t old_size;
+
+	if (!malloc_ready() || !malloc_accounting())
+		return dl_realloc(oldmem, bytes);
+	if (!oldmem)
+		return mALLOc(bytes);
+	/* Nothing is kept, so account for this as a free() */
+	if (!bytes) {
+		fREe(oldmem);
+		return NULL;
+	}
+
+	if (malloc_slab_owns(oldmem)) {
+		old_size = malloc_slab_size(oldmem);
+		if (bytes <= old_size)
+			return oldmem;
+		mem = mALLOc(bytes);
+		if (mem) {
+			memcpy(mem, oldmem, old_size);
+			fREe(oldmem);
+		}
+		return mem;
+	}
+
+	old_size = malloc_mem_size(oldmem);
+	mem = dl_realloc(oldmem, bytes);
+	malloc_stats_alloc(malloc_stat_count(reallocs), bytes, mem, old_size);
+
+	return mem;
+}
+
+Void_t *mEMALIGn(size_t alignment, size_t bytes)
+{
+	Void_t *mem;
+
+	if (!malloc_ready())
+		return dl_memalign(alignment, bytes);
+	if (alignment <= MALLOC_ALIGNMENT)
+		return mALLOc(bytes);
+
+	mem = dl_memalign(alignment, bytes);
+	malloc_stats_alloc(malloc_stat_count(memaligns), bytes, mem, 0);
+
+	return mem;
+}
+
+Void_t *cALLOc(size_t n, size_t elem_size)
+{
+	Void_t *mem;
+	size_t sz = n * elem_size;
+
+	if (!malloc_ready())
+		return dl_calloc(n, elem_size);
+
+	mem = malloc_slab_alloc(sz);
+	if (mem)
+		memset(mem, '\0', sz);
+	else
+		mem = dl_calloc(n, elem_size);
+	malloc_stats_alloc(malloc_stat_count(callocs), sz, mem, 0);
+
+	return mem;
+}
+
 /*
 
   cfree just calls free. It is needed/defined on some systems
@@ -2237,6 +2590,8 @@ size_t malloc_usable_size(mem) Void_t* mem;
   mchunkptr p;
   if (mem == NULL)
     return 0;
+  else if (malloc_slab_owns(mem))
+    return malloc_slab_size(mem);
   else
   {
     p = mem2chunk(mem);
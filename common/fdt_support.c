@@ -9,7 +9,9 @@
 #include <common.h>
 #include <abuf.h>
 #include <env.h>
+#include <malloc.h>
 #include <mapmem.h>
+#include <sort.h>
 #include <stdio_dev.h>
 #include <linux/ctype.h>
 #include <linux/types.h>
@@ -187,6 +189,20 @@ static inline int fdt_setprop_uxx(void *fdt, int nodeoffset, const char *name,
 		return fdt_setprop_u32(fdt, nodeoffset, name, (uint32_t)val);
 }
 
+/*
+ * Update an entry of the memory reserve map in place. Deleting it and adding
+ * it again would move the whole blob twice.
+ */
+static void fdt_set_mem_rsv(void *fdt, int n, uint64_t addr, uint64_t size)
+{
+	struct fdt_reserve_entry *re;
+
+	re = (struct fdt_reserve_entry *)((char *)fdt +
+					  fdt_off_mem_rsvmap(fdt)) + n;
+	re->address = cpu_to_fdt64(addr);
+	re->size = cpu_to_fdt64(size);
+}
+
 int fdt_root(void *fdt)
 {
 	char *serial;
@@ -233,20 +249,24 @@ int fdt_initrd(void *fdt, ulong initrd_start, ulong initrd_end)
 
 	/*
 	 * Look for an existing entry and update it.  If we don't find
-	 * the entry, we will j be the next available slot.
+	 * the entry, add a new one.
 	 */
 	for (j = 0; j < total; j++) {
 		err = fdt_get_mem_rsv(fdt, j, &addr, &size);
 		if (addr == initrd_start) {
-			fdt_del_mem_rsv(fdt, j);
+			fdt_set_mem_rsv(fdt, j, initrd_start,
+					initrd_end - initrd_start);
 			break;
 		}
 	}
 
-	err = fdt_add_mem_rsv(fdt, initrd_start, initrd_end - initrd_start);
-	if (err < 0) {
-		printf("fdt_initrd: %s\n", fdt_strerror(err));
-		return err;
+	if (j == total) {
+		err = fdt_add_mem_rsv(fdt, initrd_start,
+				      initrd_end - initrd_start);
+		if (err < 0) {
+			printf("fdt_initrd: %s\n", fdt_strerror(err));
+			return err;
+		}
 	}
 
 	is_u64 = (fdt_address_cells(fdt, 0) == 2);
@@ -644,9 +664,9 @@ int fdt_shrink_to_minimum(void *blob, uint extrasize)
 {
 	int i;
 	uint64_t addr, size;
-	int total, ret;
+	int total;
 	uint actualsize;
-	int fdt_memrsv = 0;
+	int fdt_memrsv = -1;
 
 	if (!blob)
 		return 0;
@@ -655,8 +675,7 @@ int fdt_shrink_to_minimum(void *blob, uint extrasize)
 	for (i = 0; i < total; i++) {
 		fdt_get_mem_rsv(blob, i, &addr, &size);
 		if (addr == (uintptr_t)blob) {
-			fdt_del_mem_rsv(blob, i);
-			fdt_memrsv = 1;
+			fdt_memrsv = i;
 			break;
 		}
 	}
@@ -678,12 +697,10 @@ int fdt_shrink_to_minimum(void *blob, uint extrasize)
 	/* Change the fdt header to reflect the correct size */
 	fdt_set_totalsize(blob, actualsize);
 
-	if (fdt_memrsv) {
-		/* Add the new reservation */
-		ret = fdt_add_mem_rsv(blob, map_to_sysmem(blob), actualsize);
-		if (ret < 0)
-			return ret;
-	}
+	/* Update the reservation */
+	if (fdt_memrsv >= 0)
+		fdt_set_mem_rsv(blob, fdt_memrsv, map_to_sysmem(blob),
+				actualsize);
 
 	return actualsize;
 }
@@ -1821,6 +1838,268 @@ int fdt_overlay_apply_verbose(void *fdt, void *fdto)
 	}
 	return err;
 }
+
+/**
+ * struct fdt_symbol - Entry of the index of the base __symbols__ node
+ *
+ * @label: Name of the symbol
+ * @phandle: Phandle of the node the symbol points at, if @valid
+ * @valid: true if @phandle was looked up and is still correct
+ */
+struct fdt_symbol {
+	const char *label;
+	u32 phandle;
+	bool valid;
+};
+
+/**
+ * struct fdt_symbols - Index of the base __symbols__ node, sorted by label
+ *
+ * @sym: Entries
+ * @count: Number of entries
+ * @labels: Copy of the labels, which move in the device tree as it changes
+ */
+struct fdt_symbols {
+	struct fdt_symbol *sym;
+	int count;
+	char *labels;
+};
+
+static int fdt_symbol_cmp(const void *a, const void *b)
+{
+	const struct fdt_symbol *sa = a, *sb = b;
+
+	return strcmp(sa->label, sb->label);
+}
+
+static void fdt_symbols_build(const void *fdt, struct fdt_symbols *syms)
+{
+	int symbols, prop, size = 0, count = 0;
+	const char *label;
+	char *p;
+
+	memset(syms, '\0', sizeof(*syms));
+	symbols = fdt_path_offset(fdt, "/__symbols__");
+	if (symbols < 0)
+		return;
+
+	fdt_for_each_property_offset(prop, fdt, symbols) {
+		if (!fdt_getprop_by_offset(fdt, prop, &label, NULL))
+			return;
+		size += strlen(label) + 1;
+		count++;
+	}
+
+	syms->sym = calloc(count, sizeof(*syms->sym));
+	syms->labels = malloc(size);
+	if (!syms->sym || !syms->labels) {
+		free(syms->sym);
+		free(syms->labels);
+		syms->sym = NULL;
+		syms->labels = NULL;
+		return;
+	}
+
+	p = syms->labels;
+	fdt_for_each_property_offset(prop, fdt, symbols) {
+		fdt_getprop_by_offset(fdt, prop, &label, NULL);
+		strcpy(p, label);
+		syms->sym[syms->count++].label = p;
+		p += strlen(p) + 1;
+	}
+	qsort(syms->sym, syms->count, sizeof(*syms->sym), fdt_symbol_cmp);
+}
+
+static struct fdt_symbol *fdt_symbols_find(struct fdt_symbols *syms,
+					   const char *label)
+{
+	int lo = 0, hi = syms->count, mid, cmp;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		cmp = strcmp(label, syms->sym[mid].label);
+		if (!cmp)
+			return &syms->sym[mid];
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return NULL;
+}
+
+/* Get the phandle of a symbol, 0 if it cannot be found */
+static u32 fdt_symbols_phandle(const void *fdt, struct fdt_symbols *syms,
+			       const char *label)
+{
+	struct fdt_symbol *sym = fdt_symbols_find(syms, label);
+	const char *path;
+	int symbols, node;
+	u32 phandle = 0;
+
+	if (sym && sym->valid)
+		return sym->phandle;
+
+	/* Symbols added by earlier overlays are looked up in the tree */
+	symbols = fdt_path_offset(fdt, "/__symbols__");
+	path = symbols < 0 ? NULL : fdt_getprop(fdt, symbols, label, NULL);
+	node = path ? fdt_path_offset(fdt, path) : -FDT_ERR_NOTFOUND;
+	if (node >= 0)
+		phandle = fdt_get_phandle(fdt, node);
+	if (sym) {
+		sym->phandle = phandle;
+		sym->valid = true;
+	}
+
+	return phandle;
+}
+
+/*
+ * Symbols of an overlay replace base symbols with the same label when it is
+ * applied, so forget what the index knows about them
+ */
+static void fdt_symbols_drop(const void *fdto, struct fdt_symbols *syms)
+{
+	struct fdt_symbol *sym;
+	const char *label;
+	int symbols, prop;
+
+	symbols = fdt_subnode_offset(fdto, 0, "__symbols__");
+	if (symbols < 0)
+		return;
+
+	fdt_for_each_property_offset(prop, fdto, symbols) {
+		if (!fdt_getprop_by_offset(fdto, prop, &label, NULL))
+			return;
+		sym = fdt_symbols_find(syms, label);
+		if (sym)
+			sym->valid = false;
+	}
+}
+
+/**
+ * fdt_overlay_resolve() - Resolve the references of an overlay to the base
+ *
+ * This does what fdt_overlay_apply() does with the __fixups__ node of the
+ * overlay, but looks the symbols up in @syms instead of in the base device
+ * tree, then deletes the node. If anything goes wrong, the node is left for
+ * fdt_overlay_apply() to deal with and report.
+ *
+ * @fdt: Base device tree
+ * @fdto: Overlay
+ * @syms: Index of the symbols of @fdt
+ * @return 0 if OK, -ve FDT_ERR_... on error
+ */
+static int fdt_overlay_resolve(const void *fdt, void *fdto,
+			       struct fdt_symbols *syms)
+{
+	const char *value, *label, *path, *name, *sep, *end;
+	int fixups, prop, len, node, poffset, ret;
+	fdt32_t phandle;
+	char *endp;
+
+	fixups = fdt_path_offset(fdto, "/__fixups__");
+	if (fixups < 0)
+		return fixups == -FDT_ERR_NOTFOUND ? 0 : fixups;
+
+	fdt_for_each_property_offset(prop, fdto, fixups) {
+		value = fdt_getprop_by_offset(fdto, prop, &label, &len);
+		if (!value)
+			return len;
+		phandle = cpu_to_fdt32(fdt_symbols_phandle(fdt, syms, label));
+		if (!phandle)
+			return -FDT_ERR_NOTFOUND;
+
+		/* Each entry is "path:property:offset" */
+		for (; len > 0; len -= end - value + 1, value = end + 1) {
+			end = memchr(value, '\0', len);
+			if (!end)
+				return -FDT_ERR_BADOVERLAY;
+			path = value;
+			sep = memchr(path, ':', end - path);
+			if (!sep)
+				return -FDT_ERR_BADOVERLAY;
+			name = sep + 1;
+			sep = memchr(name, ':', end - name);
+			if (!sep || sep == name)
+				return -FDT_ERR_BADOVERLAY;
+			poffset = simple_strtoul(sep + 1, &endp, 10);
+			if (endp != end || endp == sep + 1)
+				return -FDT_ERR_BADOVERLAY;
+
+			node = fdt_path_offset_namelen(fdto, path,
+						       name - 1 - path);
+			if (node < 0)
+				return node;
+			ret = fdt_setprop_inplace_namelen_partial(fdto, node,
+					name, sep - name, poffset, &phandle,
+					sizeof(phandle));
+			if (ret)
+				return ret;
+		}
+	}
+
+	return fdt_del_node(fdto, fixups);
+}
+
+/**
+ * fdt_overlay_apply_list - Apply several overlays in one go
+ *
+ * @fdt: ptr to device tree
+ * @size: space available at @fdt, which is grown to that size once before
+ *	the overlays are applied. If it is not larger than the current size,
+ *	the device tree is used as it is
+ * @fdtos: ptrs to device tree overlays, in the order to apply them
+ * @count: number of overlays
+ *
+ * Growing the device tree once for all overlays avoids moving it for each
+ * of them. The __symbols__ node of the device tree is indexed once, and the
+ * references of each overlay are resolved with the index instead of looking
+ * every label up in the tree. libfdt still scans the device tree for its
+ * highest phandle once per overlay.
+ *
+ * As with fdt_overlay_apply(), the overlays are modified, and the device
+ * tree is left in an undefined state on error. The caller may pack the
+ * device tree afterwards.
+ *
+ * @return 0 if OK, -ve FDT_ERR_... on error
+ */
+int fdt_overlay_apply_list(void *fdt, int size, void * const fdtos[],
+			   int count)
+{
+	struct fdt_symbols syms;
+	int err = 0, i;
+
+	if (size > fdt_totalsize(fdt)) {
+		err = fdt_open_into(fdt, fdt, size);
+		if (err < 0) {
+			printf("failed on fdt_open_into(): %s\n",
+			       fdt_strerror(err));
+			return err;
+		}
+	}
+
+	fdt_symbols_build(fdt, &syms);
+	for (i = 0; i < count; i++) {
+		/* Failures are reported by fdt_overlay_apply_verbose() */
+		fdt_overlay_resolve(fdt, fdtos[i], &syms);
+		fdt_symbols_drop(fdtos[i], &syms);
+
+		/* the verbose method prints out messages on error */
+		err = fdt_overlay_apply_verbose(fdt, fdtos[i]);
+		if (err < 0) {
+			if (count > 1)
+				printf("overlay %d of %d not applied\n", i + 1,
+				       count);
+			break;
+		}
+	}
+	free(syms.sym);
+	free(syms.labels);
+
+	return err < 0 ? err : 0;
+}
 #endif
 
 /**
@@ -0,0 +1,309 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Streaming decompression of images
+ *
+ * image_decomp() needs the whole compressed image in memory. The functions
+ * here accept the compressed data in pieces of any size as they are read
+ * from storage, and write the result straight to its final place, so that
+ * no staging buffer as large as the compressed image is needed.
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <image.h>
+#include <lz4.h>
+#include <malloc.h>
+#include <u-boot/zlib.h>
+#include <linux/sizes.h>
+#include <linux/zstd.h>
+
+#if CONFIG_IS_ENABLED(GZIP)
+static int decomp_gzip_start(struct image_decomp_stream *st)
+{
+	z_stream *s;
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return -ENOMEM;
+	s->zalloc = gzalloc;
+	s->zfree = gzfree;
+	/* Let zlib parse the gzip header and check the trailer */
+	if (inflateInit2(s, 16 + MAX_WBITS) != Z_OK) {
+		free(s);
+		return -ENOMEM;
+	}
+	st->priv = s;
+
+	return 0;
+}
+
+static int decomp_gzip_feed(struct image_decomp_stream *st, const void *src,
+			    ulong len)
+{
+	z_stream *s = st->priv;
+	int r;
+
+	s->next_in = (void *)src;
+	s->avail_in = len;
+	do {
+		s->next_out = st->dst + st->out;
+		s->avail_out = min_t(ulong, st->dst_size - st->out, UINT_MAX);
+		r = inflate(s, Z_NO_FLUSH);
+		st->out = s->next_out - (unsigned char *)st->dst;
+		if (r == Z_STREAM_END) {
+			st->done = true;
+			return 0;
+		}
+	} while (r == Z_OK && s->avail_in);
+
+	if (r == Z_BUF_ERROR && !s->avail_out)
+		return -ENOSPC;
+	if (r != Z_OK && r != Z_BUF_ERROR)
+		return -EINVAL;
+
+	return 0;
+}
+
+static void decomp_gzip_end(struct image_decomp_stream *st)
+{
+	inflateEnd(st->priv);
+	free(st->priv);
+}
+#endif /* GZIP */
+
+#if CONFIG_IS_ENABLED(LZ4)
+static int decomp_lz4_start(struct image_decomp_stream *st)
+{
+	struct ulz4_stream *s;
+
+	s = malloc(sizeof(*s));
+	if (!s)
+		return -ENOMEM;
+	ulz4_stream_init(s, st->dst, st->dst_size);
+	st->priv = s;
+
+	return 0;
+}
+
+static int decomp_lz4_feed(struct image_decomp_stream *st, const void *src,
+			   ulong len)
+{
+	struct ulz4_stream *s = st->priv;
+	int ret;
+
+	ret = ulz4_stream_feed(s, src, len);
+	st->out = s->out;
+	if (ret < 0)
+		return ret == -ENOBUFS ? -ENOSPC : ret;
+	st->done = ret;
+
+	return 0;
+}
+
+static void decomp_lz4_end(struct image_decomp_stream *st)
+{
+	ulz4_stream_free(st->priv);
+	free(st->priv);
+}
+#endif /* LZ4 */
+
+#if CONFIG_IS_ENABLED(ZSTD)
+/* Largest window accepted, to bound the workspace */
+#define DECOMP_ZSTD_MAX_WINDOW	SZ_128M
+/* Smallest window the decoder works with, whatever the header says */
+#define DECOMP_ZSTD_MIN_WINDOW	SZ_1K
+
+/**
+ * struct decomp_zstd - State of a zstd decompression
+ *
+ * @ds:		Stream, NULL until the frame header is complete
+ * @workspace:	Memory for @ds
+ * @hdr:	Frame header collected so far
+ * @hdr_len:	Number of valid bytes in @hdr
+ */
+struct decomp_zstd {
+	ZSTD_DStream *ds;
+	void *workspace;
+	u8 hdr[ZSTD_FRAMEHEADERSIZE_MAX];
+	size_t hdr_len;
+};
+
+static int decomp_zstd_start(struct image_decomp_stream *st)
+{
+	struct decomp_zstd *z;
+
+	z = calloc(1, sizeof(*z));
+	if (!z)
+		return -ENOMEM;
+	st->priv = z;
+
+	return 0;
+}
+
+static int decomp_zstd_run(struct image_decomp_stream *st, const void *src,
+			   ulong len)
+{
+	struct decomp_zstd *z = st->priv;
+	ZSTD_inBuffer in = { .src = src, .size = len, .pos = 0 };
+	ZSTD_outBuffer out = { .dst = st->dst, .size = st->dst_size,
+			       .pos = st->out };
+	size_t ret;
+
+	while (in.pos < in.size) {
+		ret = ZSTD_decompressStream(z->ds, &out, &in);
+		st->out = out.pos;
+		if (ZSTD_isError(ret)) {
+			debug("%s: zstd error %d\n", __func__,
+			      ZSTD_getErrorCode(ret));
+			return -EINVAL;
+		}
+		if (!ret) {
+			st->done = true;
+			break;
+		}
+		if (out.pos == out.size)
+			return -ENOSPC;
+	}
+
+	return 0;
+}
+
+static int decomp_zstd_feed(struct image_decomp_stream *st, const void *src,
+			    ulong len)
+{
+	struct decomp_zstd *z = st->priv;
+	ZSTD_frameParams params;
+	size_t wsize, used, ret;
+	int err;
+
+	if (z->ds)
+		return decomp_zstd_run(st, src, len);
+
+	/* The window size, and so the workspace, is known from the header */
+	used = min_t(size_t, len, sizeof(z->hdr) - z->hdr_len);
+	memcpy(z->hdr + z->hdr_len, src, used);
+	z->hdr_len += used;
+	ret = ZSTD_getFrameParams(&params, z->hdr, z->hdr_len);
+	if (ZSTD_isError(ret) || (ret && z->hdr_len == sizeof(z->hdr)) ||
+	    (!ret && !params.windowSize))
+		return -EINVAL;
+	if (ret)
+		return 0;
+	if (params.windowSize > DECOMP_ZSTD_MAX_WINDOW)
+		return -E2BIG;
+	params.windowSize = max_t(u32, params.windowSize,
+				  DECOMP_ZSTD_MIN_WINDOW);
+
+	wsize = ZSTD_DStreamWorkspaceBound(params.windowSize);
+	z->workspace = malloc(wsize);
+	if (!z->workspace)
+		return -ENOMEM;
+	z->ds = ZSTD_initDStream(params.windowSize, z->workspace, wsize);
+	if (!z->ds)
+		return -EINVAL;
+
+	err = decomp_zstd_run(st, z->hdr, z->hdr_len);
+	if (err || st->done)
+		return err;
+
+	return decomp_zstd_run(st, src + used, len - used);
+}
+
+static void decomp_zstd_end(struct image_decomp_stream *st)
+{
+	struct decomp_zstd *z = st->priv;
+
+	free(z->workspace);
+	free(z);
+}
+#endif /* ZSTD */
+
+int image_decomp_stream_start(struct image_decomp_stream *st, int comp,
+			      void *dst, ulong dst_size)
+{
+	memset(st, '\0', sizeof(*st));
+	st->comp = comp;
+	st->dst = dst;
+	st->dst_size = dst_size;
+
+	switch (comp) {
+	case IH_COMP_NONE:
+		return 0;
+#if CONFIG_IS_ENABLED(GZIP)
+	case IH_COMP_GZIP:
+		return decomp_gzip_start(st);
+#endif
+#if CONFIG_IS_ENABLED(LZ4)
+	case IH_COMP_LZ4:
+		return decomp_lz4_start(st);
+#endif
+#if CONFIG_IS_ENABLED(ZSTD)
+	case IH_COMP_ZSTD:
+		return decomp_zstd_start(st);
+#endif
+	default:
+		return -ENOSYS;
+	}
+}
+
+int image_decomp_stream_feed(struct image_decomp_stream *st, const void *src,
+			     ulong len)
+{
+	/* Anything after the end of the compressed stream is ignored */
+	if (st->done || !len)
+		return 0;
+
+	switch (st->comp) {
+	case IH_COMP_NONE:
+		if (len > st->dst_size - st->out)
+			return -ENOSPC;
+		memcpy(st->dst + st->out, src, len);
+		st->out += len;
+		return 0;
+#if CONFIG_IS_ENABLED(GZIP)
+	case IH_COMP_GZIP:
+		return decomp_gzip_feed(st, src, len);
+#endif
+#if CONFIG_IS_ENABLED(LZ4)
+	case IH_COMP_LZ4:
+		return decomp_lz4_feed(st, src, len);
+#endif
+#if CONFIG_IS_ENABLED(ZSTD)
+	case IH_COMP_ZSTD:
+		return decomp_zstd_feed(st, src, len);
+#endif
+	default:
+		return -ENOSYS;
+	}
+}
+
+int image_decomp_stream_end(struct image_decomp_stream *st, ulong *out_len)
+{
+	if (st->priv) {
+		switch (st->comp) {
+#if CONFIG_IS_ENABLED(GZIP)
+		case IH_COMP_GZIP:
+			decomp_gzip_end(st);
+			break;
+#endif
+#if CONFIG_IS_ENABLED(LZ4)
+		case IH_COMP_LZ4:
+			decomp_lz4_end(st);
+			break;
+#endif
+#if CONFIG_IS_ENABLED(ZSTD)
+		case IH_COMP_ZSTD:
+			decomp_zstd_end(st);
+			break;
+#endif
+		}
+		st->priv = NULL;
+	}
+	*out_len = st->out;
+
+	if (st->comp == IH_COMP_NONE || st->done)
+		return 0;
+
+	/* The compressed data ended early or did not fit */
+	return st->out == st->dst_size ? -ENOSPC : -EINVAL;
+}
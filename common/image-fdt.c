@@ -133,6 +133,44 @@ void boot_fdt_add_mem_rsv_regions(struct lmb *lmb, void *fdt_blob)
 	}
 }
 
+/* Space taken by a new property with a value of @len bytes */
+static ulong boot_fdt_prop_space(const char *name, int len)
+{
+	return sizeof(struct fdt_property) + ALIGN(len, FDT_TAGSIZE) +
+		strlen(name) + 1;
+}
+
+/**
+ * boot_fdt_pad() - Get the space to leave for fixups in the device tree
+ *
+ * When the fixups run out of space, the blob is grown by small steps and
+ * moved each time. Leave room on top of CONFIG_SYS_FDT_PAD for the
+ * properties which are known to be added: the bootargs, the reg property
+ * of /memory with up to 64-bit addresses and sizes for each bank, and the
+ * initrd properties of /chosen along with their memory reservation.
+ *
+ * @return number of bytes to add to the size of the device tree
+ */
+static ulong boot_fdt_pad(void)
+{
+	const char *bootargs = env_get("bootargs");
+	ulong pad = CONFIG_SYS_FDT_PAD;
+
+	if (bootargs)
+		pad += boot_fdt_prop_space("bootargs", strlen(bootargs) + 1);
+
+	/* See fdt_fixup_memory_banks() */
+	pad += boot_fdt_prop_space("reg", CONFIG_NR_DRAM_BANKS * 2 *
+				   sizeof(u64));
+
+	/* See fdt_initrd() */
+	pad += boot_fdt_prop_space("linux,initrd-start", sizeof(u64));
+	pad += boot_fdt_prop_space("linux,initrd-end", sizeof(u64));
+	pad += sizeof(struct fdt_reserve_entry);
+
+	return pad;
+}
+
 /**
  * boot_relocate_fdt - relocate flat device tree
  * @lmb: pointer to lmb handle, will be used for memory mgmt
@@ -142,7 +180,7 @@ void boot_fdt_add_mem_rsv_regions(struct lmb *lmb, void *fdt_blob)
  * boot_relocate_fdt() allocates a region of memory within the bootmap and
  * relocates the of_flat_tree into that region, even if the fdt is already in
  * the bootmap.  It also expands the size of the fdt by CONFIG_SYS_FDT_PAD
- * bytes.
+ * bytes plus the space needed by the bootargs, memory and initrd fixups.
  *
  * of_flat_tree and of_size are set to final (after relocation) values
  *
@@ -170,7 +208,7 @@ int boot_relocate_fdt(struct lmb *lmb, char **of_flat_tree, ulong *of_size)
 
 	/* position on a 4K boundary before the alloc_current */
 	/* Pad the FDT by a specified amount */
-	of_len = *of_size + CONFIG_SYS_FDT_PAD;
+	of_len = *of_size + boot_fdt_pad();
 
 	/* If fdt_high is set use it to select the relocation address */
 	fdt_high = env_get("fdt_high");
@@ -380,6 +418,10 @@ int boot_get_fdt(int flag, int argc, char * const argv[], uint8_t arch,
 			debug("   Loading FDT from 0x%08lx to 0x%08lx\n",
 			      image_data, load);
 
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+			fit_digest_invalidate((void *)load,
+					      image_get_data_size(fdt_hdr));
+#endif
 			memmove((void *)load,
 				(void *)image_data,
 				image_get_data_size(fdt_hdr));
@@ -530,6 +572,7 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 	ulong *initrd_end = &images->initrd_end;
 	int ret = -EPERM;
 	int fdt_ret;
+	int used = fdt_off_dt_strings(blob) + fdt_size_dt_strings(blob);
 
 	if (fdt_root(blob) < 0) {
 		printf("ERROR: root node setup failed\n");
@@ -569,6 +612,9 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 		goto err;
 	}
 
+	debug("## fixups added %d bytes to the device tree\n",
+	      fdt_off_dt_strings(blob) + fdt_size_dt_strings(blob) - used);
+
 	/* Delete the old LMB reservation */
 	if (lmb)
 		lmb_free(lmb, (phys_addr_t)(u32)(uintptr_t)blob,
@@ -0,0 +1,406 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Parallel pre-computation of FIT component digests
+ *
+ * Verifying a signed multi-image FIT configuration is dominated by hashing
+ * the kernel, ramdisk, device trees and loadables one after another on the
+ * boot hart. fit_digest_prepare() collects every digest that the hash and
+ * signature nodes of a configuration will need, and computes them on all
+ * available harts at once. The regular (sequential) verification code then
+ * picks up the result through fit_digest_lookup(), so messages and errors
+ * are still reported in the usual, deterministic order.
+ *
+ * Digests are looked up by address, so they are only used inside a window
+ * opened by fit_digest_begin() and closed by fit_digest_release(), and any
+ * copy to memory made inside the window must call fit_digest_invalidate().
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <errno.h>
+#include <image.h>
+#include <asm/barrier.h>
+#include <asm/locks.h>
+#include <asm/smp.h>
+#include <u-boot/crc.h>
+#include <u-boot/md5.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define FIT_DIGEST_MAX		32
+#define FIT_DIGEST_ALGO_LEN	16
+
+enum {
+	FIT_DIGEST_FREE,	/* not yet claimed by any hart */
+	FIT_DIGEST_BUSY,	/* being hashed */
+	FIT_DIGEST_DONE,	/* value[] is valid */
+};
+
+/**
+ * struct fit_digest - One digest to compute
+ *
+ * @data:	Start of the image data
+ * @size:	Size of the image data in bytes
+ * @algo:	Hash algorithm name, e.g. "sha256"
+ * @value:	Resulting digest
+ * @value_len:	Length of @value in bytes, -1 if the algorithm is unknown
+ * @lock:	Taken by the hart which computes this digest
+ * @state:	FIT_DIGEST_...
+ */
+struct fit_digest {
+	const void *data;
+	size_t size;
+	char algo[FIT_DIGEST_ALGO_LEN];
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int value_len;
+	arch_spinlock_t lock;
+	volatile int state;
+};
+
+/**
+ * struct fit_digest_table - All digests needed for one configuration
+ *
+ * @window:	true between fit_digest_begin() and fit_digest_release()
+ * @lock:	Protects @generation and @active
+ * @generation:	Bumped whenever the table is cleared. Helper harts started for
+ *		an older generation leave without touching the table
+ * @active:	Number of helper harts still working on the table
+ * @fit:	FIT the digests belong to, NULL if the table is empty
+ * @cfg_noffset: Configuration node the table was built for
+ * @count:	Number of valid entries in @digest
+ * @digest:	Digests, sorted by decreasing size
+ */
+struct fit_digest_table {
+	bool window;
+	arch_spinlock_t lock;
+	ulong generation;
+	volatile int active;
+	const void *fit;
+	int cfg_noffset;
+	int count;
+	struct fit_digest digest[FIT_DIGEST_MAX];
+};
+
+static struct fit_digest_table fit_digests = {
+	.lock = SPIN_LOCK_INITIALIZER,
+	.generation = 1,
+};
+
+static const char *const fit_digest_props[] = {
+	FIT_KERNEL_PROP,
+	FIT_FDT_PROP,
+	FIT_RAMDISK_PROP,
+	FIT_LOADABLE_PROP,
+	FIT_FPGA_PROP,
+	FIT_SETUP_PROP,
+	FIT_STANDALONE_PROP,
+};
+
+/*
+ * Compute a digest without touching the console, the watchdog or malloc(),
+ * since this runs on secondary harts. The output format matches
+ * calculate_hash().
+ */
+static void fit_digest_calc(struct fit_digest *dg)
+{
+	const char *algo = dg->algo;
+
+	if (IMAGE_ENABLE_CRC32 && !strcmp(algo, "crc32")) {
+		*(uint32_t *)dg->value = cpu_to_uimage(crc32(0, dg->data,
+							     dg->size));
+		dg->value_len = 4;
+	} else if (IMAGE_ENABLE_SHA1 && !strcmp(algo, "sha1")) {
+		sha1_csum(dg->data, dg->size, dg->value);
+		dg->value_len = 20;
+	} else if (IMAGE_ENABLE_SHA256 && !strcmp(algo, "sha256")) {
+		sha256_context ctx;
+
+		sha256_starts(&ctx);
+		sha256_update(&ctx, dg->data, dg->size);
+		sha256_finish(&ctx, dg->value);
+		dg->value_len = SHA256_SUM_LEN;
+	} else if (IMAGE_ENABLE_MD5 && !strcmp(algo, "md5")) {
+		md5((unsigned char *)dg->data, dg->size, dg->value);
+		dg->value_len = 16;
+	} else {
+		dg->value_len = -1;
+	}
+}
+
+/*
+ * Claim and compute digests until none are left. Every hart, including the
+ * boot hart, runs this. Harts start at a different entry so that the largest
+ * images are picked up first.
+ *
+ * @arg1 is the generation of the table for helper harts, -1 for the boot hart
+ */
+static void fit_digest_worker(ulong hart, ulong arg0, ulong arg1)
+{
+	struct fit_digest_table *tab = (struct fit_digest_table *)arg0;
+	bool helper = arg1 != -1UL;
+	int first = 0;
+	int i;
+
+	if (helper) {
+		arch_spin_lock(&tab->lock);
+		if (arg1 != tab->generation) {
+			arch_spin_unlock(&tab->lock);
+			return;
+		}
+		tab->active++;
+		arch_spin_unlock(&tab->lock);
+		first = hart % tab->count;
+	}
+
+	for (i = 0; i < tab->count; i++) {
+		struct fit_digest *dg = &tab->digest[(first + i) % tab->count];
+
+		if (!spin_trylock(&dg->lock))
+			continue;
+		dg->state = FIT_DIGEST_BUSY;
+		fit_digest_calc(dg);
+		__smp_mb();
+		dg->state = FIT_DIGEST_DONE;
+	}
+
+	if (helper) {
+		arch_spin_lock(&tab->lock);
+		tab->active--;
+		arch_spin_unlock(&tab->lock);
+	}
+}
+
+/*
+ * Wait for the helper harts to leave the table, and make sure any which have
+ * not started yet leave it alone, so that it can be cleared
+ */
+static void fit_digest_quiesce(struct fit_digest_table *tab)
+{
+	arch_spin_lock(&tab->lock);
+	tab->generation++;
+	arch_spin_unlock(&tab->lock);
+	while (tab->active)
+		;
+	__smp_mb();
+}
+
+static int fit_digest_add(struct fit_digest_table *tab, const void *data,
+			  size_t size, const char *algo, int len)
+{
+	struct fit_digest *dg;
+	int i;
+
+	if (len <= 0 || len >= FIT_DIGEST_ALGO_LEN)
+		return -EINVAL;
+
+	for (i = 0; i < tab->count; i++) {
+		dg = &tab->digest[i];
+		if (dg->data == data && dg->size == size &&
+		    !strncmp(dg->algo, algo, len) && !dg->algo[len])
+			return 0;
+	}
+	if (tab->count == FIT_DIGEST_MAX)
+		return -ENOSPC;
+
+	/* Keep the table sorted by decreasing size */
+	for (i = tab->count; i > 0 && tab->digest[i - 1].size < size; i--)
+		tab->digest[i] = tab->digest[i - 1];
+
+	dg = &tab->digest[i];
+	memset(dg, '\0', sizeof(*dg));
+	dg->data = data;
+	dg->size = size;
+	memcpy(dg->algo, algo, len);
+	SPIN_LOCK_INIT(&dg->lock);
+	dg->state = FIT_DIGEST_FREE;
+	tab->count++;
+
+	return 0;
+}
+
+static int fit_digest_add_image(struct fit_digest_table *tab, const void *fit,
+				int image_noffset)
+{
+	const void *data;
+	size_t size;
+	int noffset;
+	int ret;
+
+	if (fit_image_get_data_and_size(fit, image_noffset, &data, &size))
+		return -ENOENT;
+#if CONFIG_IS_ENABLED(FIT_LAZY_LOAD)
+	/* Checked while reading, see fit_image_verify() */
+	if (fit_lazy_get_data(fit, image_noffset, &data, &size) > 0)
+		return 0;
+#endif
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+		const char *algo, *sep;
+
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)) &&
+		    strncmp(name, FIT_SIG_NODENAME,
+			    strlen(FIT_SIG_NODENAME)))
+			continue;
+
+		algo = fdt_getprop(fit, noffset, FIT_ALGO_PROP, NULL);
+		if (!algo)
+			continue;
+
+		/* Signature algorithms look like "sha256,rsa2048" */
+		sep = strchr(algo, ',');
+		ret = fit_digest_add(tab, data, size, algo,
+				     sep ? sep - algo : strlen(algo));
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Count the other harts able to take part, selecting them the same way
+ * smp_call_function() selects the harts it sends IPIs to.
+ */
+static int fit_digest_count_harts(void)
+{
+	ofnode node, cpus;
+	int count = 0;
+	u32 reg;
+
+	cpus = ofnode_path("/cpus");
+	if (!ofnode_valid(cpus))
+		return 0;
+
+	ofnode_for_each_subnode(node, cpus) {
+		if (!ofnode_is_available(node) ||
+		    ofnode_read_u32(node, "reg", &reg))
+			continue;
+		if (reg == gd->arch.boot_hart || reg >= CONFIG_NR_CPUS)
+			continue;
+		if (!(gd->arch.available_harts & (1 << reg)))
+			continue;
+		count++;
+	}
+
+	return count;
+}
+
+int fit_digest_prepare(const void *fit, int cfg_noffset)
+{
+	struct fit_digest_table *tab = &fit_digests;
+	int helpers = 0;
+	int noffset;
+	int i, j;
+	int ret;
+
+	if (!tab->window)
+		return 0;
+	if (tab->fit == fit && tab->cfg_noffset == cfg_noffset)
+		return 0;
+
+	fit_digest_quiesce(tab);
+	tab->fit = NULL;
+	tab->count = 0;
+	for (i = 0; i < ARRAY_SIZE(fit_digest_props); i++) {
+		int count = fit_conf_get_prop_node_count(fit, cfg_noffset,
+							 fit_digest_props[i]);
+
+		for (j = 0; j < count; j++) {
+			noffset = fit_conf_get_prop_node_index(fit,
+					cfg_noffset, fit_digest_props[i], j);
+			if (noffset < 0)
+				continue;
+			ret = fit_digest_add_image(tab, fit, noffset);
+			if (ret) {
+				debug("%s: cannot add image '%s' (err=%d)\n",
+				      __func__, fit_get_name(fit, noffset,
+							     NULL), ret);
+				tab->count = 0;
+				return ret;
+			}
+		}
+	}
+	if (!tab->count)
+		return 0;
+
+	if (tab->count > 1)
+		helpers = fit_digest_count_harts();
+	debug("%s: hashing %d digest(s) on %d hart(s)\n", __func__,
+	      tab->count, helpers + 1);
+	__smp_mb();
+	if (helpers) {
+		ret = smp_call_function((ulong)fit_digest_worker, (ulong)tab,
+					tab->generation, 0);
+		if (ret)
+			debug("%s: cannot start helper harts (err=%d)\n",
+			      __func__, ret);
+	}
+
+	/* Do our share, then take over whatever nobody has claimed yet */
+	fit_digest_worker(gd->arch.boot_hart, (ulong)tab, -1UL);
+	for (i = 0; i < tab->count; i++) {
+		while (tab->digest[i].state != FIT_DIGEST_DONE)
+			;
+	}
+	__smp_mb();
+
+	tab->fit = fit;
+	tab->cfg_noffset = cfg_noffset;
+
+	return 0;
+}
+
+int fit_digest_lookup(const void *data, size_t size, const char *algo,
+		      uint8_t *value, int *value_len)
+{
+	struct fit_digest_table *tab = &fit_digests;
+	int i;
+
+	if (!tab->window || !tab->fit)
+		return -ENOENT;
+
+	for (i = 0; i < tab->count; i++) {
+		struct fit_digest *dg = &tab->digest[i];
+
+		if (dg->data != data || dg->size != size ||
+		    strcmp(dg->algo, algo) || dg->value_len < 0)
+			continue;
+		memcpy(value, dg->value, dg->value_len);
+		*value_len = dg->value_len;
+
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+void fit_digest_begin(void)
+{
+	fit_digests.window = true;
+}
+
+void fit_digest_invalidate(const void *start, size_t size)
+{
+	struct fit_digest_table *tab = &fit_digests;
+	int i;
+
+	for (i = 0; i < tab->count; i++) {
+		struct fit_digest *dg = &tab->digest[i];
+
+		if ((const char *)start < (const char *)dg->data + dg->size &&
+		    (const char *)start + size > (const char *)dg->data)
+			dg->value_len = -1;
+	}
+}
+
+void fit_digest_release(void)
+{
+	fit_digest_quiesce(&fit_digests);
+	fit_digests.window = false;
+	fit_digests.fit = NULL;
+	fit_digests.count = 0;
+}
@@ -0,0 +1,605 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Lazy loading of FIT images with external data
+ *
+ * A FIT built with 'mkimage -E' keeps only the device-tree structure at the
+ * start of the file; the image data follows it and is referenced through
+ * data-offset/data-position properties. Rather than reading the whole file
+ * into memory and then copying each sub-image to its load address, this
+ * reads the structure first and then reads each sub-image used by the
+ * selected configuration straight to its final address, hashing it as soon
+ * as it is read. With CONFIG_IMAGE_DECOMP_STREAM, compressed sub-images are
+ * decompressed to their load address right after being read.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <errno.h>
+#include <fs.h>
+#include <hash.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <memalign.h>
+#include <part.h>
+#include <u-boot/crc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define FIT_LAZY_MAX_IMAGES	16
+#define FIT_LAZY_MAX_HASHES	4
+#define FIT_LAZY_CHUNK		SZ_1M
+
+/**
+ * struct fit_lazy_image - Where the data of a sub-image was read to
+ *
+ * @noffset:	Image node offset
+ * @data:	Start of the image data in memory
+ * @size:	Size of the image data
+ * @flags:	FIT_LAZY_...
+ */
+struct fit_lazy_image {
+	int noffset;
+	const void *data;
+	size_t size;
+	int flags;
+};
+
+/**
+ * struct fit_lazy_map - Sub-images loaded by the last fit_lazy_load()
+ *
+ * @fit:	FIT structure the map belongs to, NULL if none
+ * @size:	Size of the FIT structure
+ * @crc:	CRC32 of the FIT structure, to notice when it is replaced
+ * @checked:	@crc was checked since the last fit_lazy_recheck()
+ * @count:	Number of entries in @image
+ * @image:	Sub-images read to an address other than their natural one
+ */
+struct fit_lazy_map {
+	const void *fit;
+	ulong size;
+	u32 crc;
+	bool checked;
+	int count;
+	struct fit_lazy_image image[FIT_LAZY_MAX_IMAGES];
+};
+
+static struct fit_lazy_map fit_lazy_map;
+
+static const char *const fit_lazy_props[] = {
+	FIT_KERNEL_PROP,
+	FIT_FDT_PROP,
+	FIT_RAMDISK_PROP,
+	FIT_LOADABLE_PROP,
+	FIT_FPGA_PROP,
+	FIT_SETUP_PROP,
+	FIT_STANDALONE_PROP,
+};
+
+/**
+ * struct fit_lazy_hash - A hash being calculated while reading
+ *
+ * @algo:	Hash algorithm
+ * @ctx:	Progressive hash context
+ * @noffset:	Offset of the hash node
+ */
+struct fit_lazy_hash {
+	struct hash_algo *algo;
+	void *ctx;
+	int noffset;
+};
+
+int fit_lazy_get_data(const void *fit, int noffset, const void **data,
+		      size_t *size)
+{
+	struct fit_lazy_map *map = &fit_lazy_map;
+	int i;
+
+	if (map->fit != fit || fdt_totalsize(fit) != map->size)
+		return -ENOENT;
+	if (!map->checked) {
+		if (crc32(0, fit, map->size) != map->crc) {
+			/* Another FIT was loaded at this address since */
+			map->fit = NULL;
+			return -ENOENT;
+		}
+		map->checked = true;
+	}
+
+	for (i = 0; i < map->count; i++) {
+		if (map->image[i].noffset == noffset) {
+			*data = map->image[i].data;
+			*size = map->image[i].size;
+			return map->image[i].flags;
+		}
+	}
+
+	return -ENOENT;
+}
+
+void fit_lazy_recheck(void)
+{
+	fit_lazy_map.checked = false;
+}
+
+static int fit_lazy_read(struct fit_lazy_info *info, ulong offset,
+			 ulong size, void *buf)
+{
+	ulong actual;
+
+	actual = info->read(info, offset, size, buf);
+	if (actual != size) {
+		printf("Read error at offset %lx (%lx of %lx bytes)\n", offset,
+		       actual, size);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/*
+ * Decompressing while reading leaves nothing to check signatures against
+ * later, so only do it for images which are protected by hashes alone
+ */
+static bool fit_lazy_can_decomp(const void *fit, int image_noffset)
+{
+	const void *blob = gd_fdt_blob();
+	int noffset;
+
+	if (!CONFIG_IS_ENABLED(IMAGE_DECOMP_STREAM))
+		return false;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (!strncmp(name, FIT_SIG_NODENAME,
+			     strlen(FIT_SIG_NODENAME)))
+			return false;
+	}
+
+	if (IMAGE_ENABLE_VERIFY && blob) {
+		int sig_node = fdt_subnode_offset(blob, 0, FIT_SIG_NODENAME);
+
+		fdt_for_each_subnode(noffset, blob, sig_node) {
+			const char *required;
+
+			required = fdt_getprop(blob, noffset, "required",
+					       NULL);
+			if (required && !strcmp(required, "image"))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static int fit_lazy_hash_start(const void *fit, int image_noffset,
+			       struct fit_lazy_hash *hash)
+{
+	int count = 0;
+	int noffset;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+		char *algo;
+
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (count == FIT_LAZY_MAX_HASHES ||
+		    fit_image_hash_get_algo(fit, noffset, &algo))
+			break;
+		/* Anything else is left to the verification in bootm */
+		if (hash_progressive_lookup_algo(algo, &hash[count].algo))
+			continue;
+		if (hash[count].algo->hash_init(hash[count].algo,
+						&hash[count].ctx))
+			continue;
+		hash[count].noffset = noffset;
+		count++;
+	}
+
+	return count;
+}
+
+static int fit_lazy_hash_finish(const void *fit, int image_noffset,
+				struct fit_lazy_hash *hash, int count)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	uint8_t *fit_value;
+	int fit_value_len;
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		struct hash_algo *algo = hash[i].algo;
+
+		if (algo->hash_finish(algo, hash[i].ctx, value,
+				      sizeof(value))) {
+			ret = -EINVAL;
+			continue;
+		}
+		if (!strcmp(algo->name, "crc32"))
+			*(uint32_t *)value = cpu_to_uimage(*(uint32_t *)value);
+		if (ret)
+			continue;
+		if (fit_image_hash_get_value(fit, hash[i].noffset, &fit_value,
+					     &fit_value_len) ||
+		    fit_value_len != algo->digest_size ||
+		    memcmp(value, fit_value, fit_value_len)) {
+			printf("Bad %s hash for '%s' image node\n", algo->name,
+			       fit_get_name(fit, image_noffset, NULL));
+			ret = -EACCES;
+		}
+	}
+
+	return ret;
+}
+
+/* Get the end of the FIT file, including the external data, from its start */
+static ulong fit_lazy_file_size(const void *fit)
+{
+	ulong fdt_size = ALIGN(fdt_totalsize(fit), 4);
+	ulong end = fdt_size;
+	int images, noffset;
+	int offset, size;
+
+	images = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images < 0)
+		return end;
+
+	fdt_for_each_subnode(noffset, fit, images) {
+		if (fit_image_get_data_size(fit, noffset, &size))
+			continue;
+		if (!fit_image_get_data_position(fit, noffset, &offset))
+			end = max(end, (ulong)offset + size);
+		else if (!fit_image_get_data_offset(fit, noffset, &offset))
+			end = max(end, fdt_size + offset + size);
+	}
+
+	return end;
+}
+
+/*
+ * Get how many bytes, up to @len, can be written at @load without running
+ * into the FIT file or a sub-image read to its load address before. This is
+ * 0 if @load itself is taken.
+ */
+static ulong fit_lazy_room(ulong fit_start, ulong fit_end, ulong load,
+			   ulong len)
+{
+	struct fit_lazy_map *map = &fit_lazy_map;
+	ulong start = fit_start, end = fit_end;
+	int i;
+
+	for (i = -1; i < map->count; i++) {
+		if (i >= 0) {
+			start = map_to_sysmem(map->image[i].data);
+			end = start + map->image[i].size;
+		}
+		if (load >= start && load < end)
+			return 0;
+		if (load < start)
+			len = min(len, start - load);
+	}
+
+	return len;
+}
+
+/*
+ * Read the data of one sub-image. Images which are not decompressed later
+ * go straight to their load address, anything else to the place it would
+ * occupy if the whole FIT file had been read to memory. Compressed images
+ * may instead be decompressed to their load address.
+ *
+ * The data is read in order, one chunk at a time, and each chunk is hashed
+ * and fed to the decompressor as soon as it has been read. Compressed data
+ * only ever passes through a buffer of one chunk.
+ */
+static int fit_lazy_load_image(struct fit_lazy_info *info, void *fit,
+			       ulong fit_end, int noffset, int verify)
+{
+	struct fit_lazy_map *map = &fit_lazy_map;
+	struct fit_lazy_hash hash[FIT_LAZY_MAX_HASHES];
+	struct image_decomp_stream st;
+	ulong offset, load, fit_start, pos;
+	ulong unc_len = 0;
+	int hash_count = 0;
+	int data_offset;
+	int size;
+	uint8_t comp = IH_COMP_NONE;
+	bool direct = false;
+	bool decomp = false;
+	void *buf = NULL, *chunk = NULL;
+	int ret = 0;
+
+	if (!fit_image_get_data_position(fit, noffset, &data_offset)) {
+		offset = data_offset;
+	} else if (!fit_image_get_data_offset(fit, noffset, &data_offset)) {
+		offset = data_offset + ALIGN(fdt_totalsize(fit), 4);
+	} else {
+		/* Embedded data was read along with the structure */
+		return 0;
+	}
+	if (fit_image_get_data_size(fit, noffset, &size))
+		return -ENOENT;
+
+	fit_image_get_comp(fit, noffset, &comp);
+	fit_start = map_to_sysmem(fit);
+	if (!fit_image_get_load(fit, noffset, &load) &&
+	    !fit_image_check_type(fit, noffset, IH_TYPE_KERNEL_NOLOAD) &&
+	    (comp == IH_COMP_NONE ||
+	     (!fit_image_check_type(fit, noffset, IH_TYPE_RAMDISK) &&
+	      fit_lazy_can_decomp(fit, noffset)))) {
+		/* Allow the same expansion as fit_image_load() does */
+		ulong max_len = comp == IH_COMP_NONE ? size : size * 20;
+		ulong room;
+
+		room = fit_lazy_room(fit_start, fit_end, load, max_len);
+		if (!room || (comp == IH_COMP_NONE && room < size)) {
+			printf("Error: '%s' would overwrite the FIT or another image\n",
+			       fit_get_name(fit, noffset, NULL));
+			return -EXDEV;
+		}
+		if (map->count == FIT_LAZY_MAX_IMAGES)
+			return -ENOSPC;
+		if (CONFIG_IS_ENABLED(IMAGE_DECOMP_STREAM) &&
+		    comp != IH_COMP_NONE) {
+			/* The output may not grow into anything loaded */
+			buf = map_sysmem(load, room);
+			ret = image_decomp_stream_start(&st, comp, buf, room);
+			if (!ret) {
+				chunk = malloc_cache_aligned(min_t(ulong, size,
+							FIT_LAZY_CHUNK));
+				if (!chunk) {
+					image_decomp_stream_end(&st, &unc_len);
+					ret = -ENOMEM;
+				}
+			}
+			if (ret)
+				unmap_sysmem(buf);
+			/* Fall back to decompressing in bootm */
+			decomp = !ret;
+			direct = !ret;
+			ret = 0;
+		} else {
+			direct = true;
+		}
+	}
+	if (!direct)
+		load = fit_start + offset;
+
+	printf("   Reading '%s' (%d bytes) %s %08lx\n",
+	       fit_get_name(fit, noffset, NULL), size,
+	       decomp ? "and uncompressing to" : "to", load);
+	if (verify)
+		hash_count = fit_lazy_hash_start(fit, noffset, hash);
+
+	if (!decomp)
+		buf = map_sysmem(load, size);
+	for (pos = 0; pos < size; pos += FIT_LAZY_CHUNK) {
+		ulong len = min_t(ulong, size - pos, FIT_LAZY_CHUNK);
+		void *data = decomp ? chunk : buf + pos;
+		int i;
+
+		ret = fit_lazy_read(info, offset + pos, len, data);
+		if (ret)
+			break;
+		for (i = 0; i < hash_count; i++)
+			hash[i].algo->hash_update(hash[i].algo, hash[i].ctx,
+						  data, len,
+						  pos + len == size);
+		if (decomp) {
+			ret = image_decomp_stream_feed(&st, data, len);
+			if (ret)
+				break;
+		}
+	}
+	if (decomp) {
+		int dret = image_decomp_stream_end(&st, &unc_len);
+
+		if (!ret)
+			ret = dret;
+		if (ret)
+			printf("Error uncompressing '%s' (err=%d)\n",
+			       fit_get_name(fit, noffset, NULL), ret);
+		free(chunk);
+	}
+	unmap_sysmem(buf);
+
+	if (hash_count) {
+		int hret = fit_lazy_hash_finish(fit, noffset, hash, hash_count);
+
+		if (!ret)
+			ret = hret;
+	}
+	if (ret)
+		return ret;
+
+	if (direct) {
+		struct fit_lazy_image *img = &map->image[map->count];
+
+		img->noffset = noffset;
+		img->size = decomp ? unc_len : size;
+		img->data = map_sysmem(load, img->size);
+		img->flags = 0;
+		if (decomp) {
+			img->flags = FIT_LAZY_DECOMPRESSED;
+			if (hash_count)
+				img->flags |= FIT_LAZY_VERIFIED;
+		}
+		map->count++;
+	}
+
+	return 0;
+}
+
+int fit_lazy_load(struct fit_lazy_info *info, ulong addr,
+		  const char *conf_uname, int verify)
+{
+	struct fit_lazy_map *map = &fit_lazy_map;
+	void *fit = map_sysmem(addr, 0);
+	ulong fit_end;
+	int cfg_noffset;
+	int noffset;
+	ulong size;
+	int i, j;
+	int ret;
+
+	map->fit = NULL;
+	map->count = 0;
+
+	ret = fit_lazy_read(info, 0, sizeof(struct fdt_header), fit);
+	if (ret)
+		return ret;
+	if (fdt_magic(fit) != FDT_MAGIC) {
+		puts("Not a FIT image\n");
+		return -ENOEXEC;
+	}
+	size = fdt_totalsize(fit);
+	ret = fit_lazy_read(info, 0, size, fit);
+	if (ret)
+		return ret;
+	if (!fit_check_format(fit)) {
+		puts("Bad FIT image format\n");
+		return -ENOEXEC;
+	}
+
+	cfg_noffset = fit_conf_get_node(fit, conf_uname);
+	if (cfg_noffset < 0) {
+		puts("Could not find configuration node\n");
+		return -ENOENT;
+	}
+	printf("   Using '%s' configuration\n",
+	       fit_get_name(fit, cfg_noffset, NULL));
+	fit_end = addr + fit_lazy_file_size(fit);
+
+	for (i = 0; i < ARRAY_SIZE(fit_lazy_props); i++) {
+		int count = fit_conf_get_prop_node_count(fit, cfg_noffset,
+							 fit_lazy_props[i]);
+
+		for (j = 0; j < count; j++) {
+			noffset = fit_conf_get_prop_node_index(fit,
+					cfg_noffset, fit_lazy_props[i], j);
+			if (noffset < 0) {
+				printf("Could not find subimage for '%s'\n",
+				       fit_lazy_props[i]);
+				return -ENOENT;
+			}
+			ret = fit_lazy_load_image(info, fit, fit_end,
+						  noffset, verify);
+			if (ret)
+				return ret;
+		}
+	}
+
+	map->fit = fit;
+	map->size = size;
+	map->crc = crc32(0, fit, size);
+	map->checked = true;
+
+	return 0;
+}
+
+static ulong fit_lazy_file_read(struct fit_lazy_info *info, ulong offset,
+				ulong size, void *buf)
+{
+	loff_t actual;
+
+	if (fs_set_blk_dev(info->ifname, info->dev_part, FS_TYPE_ANY))
+		return 0;
+	if (fs_read(info->filename, map_to_sysmem(buf), offset, size,
+		    &actual))
+		return 0;
+
+	return actual;
+}
+
+static ulong fit_lazy_blk_read(struct fit_lazy_info *info, ulong offset,
+			       ulong size, void *buf)
+{
+	struct blk_desc *desc = info->desc;
+	ulong blksz = desc->blksz;
+	ulong start = info->start + offset / blksz;
+	ulong head = offset % blksz;
+	ulong done = 0;
+	void *bounce = NULL;
+	ulong len, count;
+
+	if (head || size < blksz) {
+		bounce = malloc_cache_aligned(blksz);
+		if (!bounce)
+			return 0;
+	}
+
+	/* Partial first block */
+	if (head) {
+		if (blk_dread(desc, start, 1, bounce) != 1)
+			goto out;
+		len = min(size, blksz - head);
+		memcpy(buf, bounce + head, len);
+		done += len;
+		start++;
+	}
+
+	/* Whole blocks go straight to the destination */
+	count = (size - done) / blksz;
+	if (count) {
+		if (blk_dread(desc, start, count, buf + done) != count)
+			goto out;
+		done += count * blksz;
+		start += count;
+	}
+
+	/* Partial last block */
+	if (done < size) {
+		if (!bounce) {
+			bounce = malloc_cache_aligned(blksz);
+			if (!bounce)
+				goto out;
+		}
+		if (blk_dread(desc, start, 1, bounce) != 1)
+			goto out;
+		memcpy(buf + done, bounce, size - done);
+		done = size;
+	}
+
+out:
+	free(bounce);
+
+	return done;
+}
+
+int fit_lazy_init_file(struct fit_lazy_info *info, const char *ifname,
+		       const char *dev_part, const char *filename)
+{
+	loff_t size;
+
+	if (fs_set_blk_dev(ifname, dev_part, FS_TYPE_ANY))
+		return -ENODEV;
+	if (fs_size(filename, &size))
+		return -ENOENT;
+
+	info->read = fit_lazy_file_read;
+	info->ifname = ifname;
+	info->dev_part = dev_part;
+	info->filename = filename;
+
+	return 0;
+}
+
+int fit_lazy_init_blk(struct fit_lazy_info *info, const char *ifname,
+		      const char *dev_part, ulong blk)
+{
+	disk_partition_t part;
+	int ret;
+
+	ret = blk_get_device_part_str(ifname, dev_part, &info->desc, &part, 1);
+	if (ret < 0)
+		return -ENODEV;
+
+	info->read = fit_lazy_blk_read;
+	info->start = part.start + blk;
+
+	return 0;
+}
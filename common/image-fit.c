@@ -772,6 +772,17 @@ int fit_image_get_comp(const void *fit, int noffset, uint8_t *comp)
 
 	/* Translate compression name to id */
 	*comp = genimg_get_comp_id(data);
+#ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(FIT_LAZY_LOAD)
+	{
+		size_t size;
+
+		/* Already decompressed while it was read */
+		if (fit_lazy_get_data(fit, noffset, &data, &size) > 0)
+			*comp = IH_COMP_NONE;
+	}
+#endif
+#endif
 	return 0;
 }
 
@@ -988,6 +999,11 @@ int fit_image_get_data_and_size(const void *fit, int noffset,
 		ret = fit_image_get_data_size(fit, noffset, &len);
 		*data = fit + offset;
 		*size = len;
+#ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(FIT_LAZY_LOAD)
+		fit_lazy_get_data(fit, noffset, data, size);
+#endif
+#endif
 	} else {
 		ret = fit_image_get_data(fit, noffset, data, size);
 	}
@@ -1137,6 +1153,12 @@ int fit_set_timestamp(void *fit, int noffset, time_t timestamp)
 int calculate_hash(const void *data, int data_len, const char *algo,
 			uint8_t *value, int *value_len)
 {
+#ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+	if (!fit_digest_lookup(data, data_len, algo, value, value_len))
+		return 0;
+#endif
+#endif
 	if (IMAGE_ENABLE_CRC32 && strcmp(algo, "crc32") == 0) {
 		*((uint32_t *)value) = crc32_wd(0, data, data_len,
 							CHUNKSZ_CRC32);
@@ -1292,6 +1314,25 @@ int fit_image_verify(const void *fit, int image_noffset)
 	int		noffset = 0;
 	char		*err_msg = "";
 
+#ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(FIT_LAZY_LOAD)
+	{
+		/* The compressed data which the hashes cover is gone */
+		int flags = fit_lazy_get_data(fit, image_noffset, &data,
+					      &size);
+
+		if (flags > 0 && (flags & FIT_LAZY_VERIFIED)) {
+			puts("(checked while reading) ");
+			return 1;
+		} else if (flags > 0) {
+			printf("error!\nData of '%s' image node was not checked while reading\n",
+			       fit_get_name(fit, image_noffset, NULL));
+			return 0;
+		}
+	}
+#endif
+#endif
+
 	/* Get image data and data length */
 	if (fit_image_get_data_and_size(fit, image_noffset, &data, &size)) {
 		err_msg = "Can't get image data/size";
@@ -1871,6 +1912,12 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		if (image_type == IH_TYPE_KERNEL)
 			images->fit_uname_cfg = fit_base_uname_config;
 
+#ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+		if (images->verify)
+			fit_digest_prepare(fit, cfg_noffset);
+#endif
+#endif
 		if (IMAGE_ENABLE_VERIFY && images->verify) {
 			puts("   Verifying Hash Integrity ... ");
 			if (fit_config_verify(fit, cfg_noffset)) {
@@ -2011,6 +2058,11 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		} else {
 			loadbuf = map_sysmem(load, max_decomp_len);
 		}
+#ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+		fit_digest_invalidate(loadbuf, max_decomp_len);
+#endif
+#endif
 		if (image_decomp(comp, load, data, image_type,
 				loadbuf, buf, len, max_decomp_len, &load_end)) {
 			printf("Error decompressing %s\n", prop_name);
@@ -2020,6 +2072,11 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		len = load_end - load;
 	} else if (load != data) {
 		loadbuf = map_sysmem(load, len);
+#ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+		fit_digest_invalidate(loadbuf, len);
+#endif
+#endif
 		memcpy(loadbuf, buf, len);
 	}
 
@@ -2067,6 +2124,38 @@ int boot_get_setup_fit(bootm_headers_t *images, uint8_t arch,
 }
 
 #ifndef USE_HOSTCC
+#ifdef CONFIG_OF_LIBFDT_OVERLAY
+/**
+ * fit_apply_overlays() - Apply overlays to an FDT loaded from a FIT
+ *
+ * @load: Address of the base FDT
+ * @lenp: Size of the base FDT, updated once the overlays are applied
+ * @ovs: Overlays to apply
+ * @count: Number of overlays
+ * @ovsize: Total size of the overlays, by which the base FDT may grow
+ * @return 0 if OK, -ve on error
+ */
+static int fit_apply_overlays(ulong load, ulong *lenp, void **ovs, int count,
+			      ulong ovsize)
+{
+	void *base;
+	int err;
+
+	if (!count)
+		return 0;
+
+	base = map_sysmem(load, *lenp + ovsize);
+	err = fdt_overlay_apply_list(base, *lenp + ovsize, ovs, count);
+	if (err < 0)
+		return err;
+
+	fdt_pack(base);
+	*lenp = fdt_totalsize(base);
+
+	return 0;
+}
+#endif
+
 int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 		   const char **fit_unamep, const char **fit_uname_configp,
 		   int arch, ulong *datap, ulong *lenp)
@@ -2080,11 +2169,11 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 	ulong load, len;
 #ifdef CONFIG_OF_LIBFDT_OVERLAY
 	ulong image_start, image_end;
-	ulong ovload, ovlen;
+	ulong ovload, ovlen, ovsize = 0;
 	const char *uconfig;
 	const char *uname;
-	void *base, *ov;
-	int i, err, noffset, ov_noffset;
+	void **ovs = NULL, **tmp;
+	int i, err, noffset, ov_noffset, nov = 0;
 #endif
 
 	fit_uname = fit_unamep ? *fit_unamep : NULL;
@@ -2136,8 +2225,6 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 		goto out;
 	}
 
-	base = map_sysmem(load, len);
-
 	/* apply extra configs in FIT first, followed by args */
 	for (i = 1; ; i++) {
 		if (i < count) {
@@ -2180,24 +2267,36 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 		}
 		debug("%s loaded at 0x%08lx len=0x%08lx\n",
 				uname, ovload, ovlen);
-		ov = map_sysmem(ovload, ovlen);
 
-		base = map_sysmem(load, len + ovlen);
-		err = fdt_open_into(base, base, len + ovlen);
-		if (err < 0) {
-			printf("failed on fdt_open_into\n");
-			fdt_noffset = err;
+		tmp = realloc(ovs, (nov + 1) * sizeof(*ovs));
+		if (!tmp) {
+			fdt_noffset = -ENOMEM;
 			goto out;
 		}
-		/* the verbose method prints out messages on error */
-		err = fdt_overlay_apply_verbose(base, ov);
-		if (err < 0) {
-			fdt_noffset = err;
-			goto out;
+		ovs = tmp;
+		ovs[nov++] = map_sysmem(ovload, ovlen);
+		ovsize += ovlen;
+
+		/*
+		 * Overlays used in place in the FIT are applied together, so
+		 * that the base is only grown and packed once. One loaded
+		 * elsewhere may be overwritten by the next load, so apply it
+		 * straight away.
+		 */
+		if (ovload < image_start || ovload >= image_end) {
+			err = fit_apply_overlays(load, &len, ovs, nov, ovsize);
+			nov = 0;
+			ovsize = 0;
+			if (err < 0) {
+				fdt_noffset = err;
+				goto out;
+			}
 		}
-		fdt_pack(base);
-		len = fdt_totalsize(base);
 	}
+
+	err = fit_apply_overlays(load, &len, ovs, nov, ovsize);
+	if (err < 0)
+		fdt_noffset = err;
 #else
 	printf("config with overlays but CONFIG_OF_LIBFDT_OVERLAY not set\n");
 	fdt_noffset = -EBADF;
@@ -2215,6 +2314,9 @@ out:
 
 	if (fit_uname_config_copy)
 		free(fit_uname_config_copy);
+#ifdef CONFIG_OF_LIBFDT_OVERLAY
+	free(ovs);
+#endif
 	return fdt_noffset;
 }
 #endif
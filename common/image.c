@@ -192,6 +192,7 @@ static const table_entry_t uimage_comp[] = {
 	{	IH_COMP_LZMA,	"lzma",		"lzma compressed",	},
 	{	IH_COMP_LZO,	"lzo",		"lzo compressed",	},
 	{	IH_COMP_LZ4,	"lz4",		"lz4 compressed",	},
+	{	IH_COMP_ZSTD,	"zstd",		"zstd compressed",	},
 	{	-1,		"",		"",			},
 };
 
@@ -479,6 +480,23 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		break;
 	}
 #endif /* CONFIG_LZ4 */
+#ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(IMAGE_DECOMP_STREAM) && CONFIG_IS_ENABLED(ZSTD)
+	case IH_COMP_ZSTD: {
+		struct image_decomp_stream st;
+		int err;
+
+		ret = image_decomp_stream_start(&st, comp, load_buf, unc_len);
+		if (ret)
+			break;
+		ret = image_decomp_stream_feed(&st, image_buf, image_len);
+		err = image_decomp_stream_end(&st, &image_len);
+		if (!ret)
+			ret = err;
+		break;
+	}
+#endif
+#endif
 	default:
 		printf("Unimplemented compression type %d\n", comp);
 		return -ENOSYS;
@@ -1609,7 +1627,7 @@ int image_setup_linux(bootm_headers_t *images)
 	ulong of_size = images->ft_len;
 	char **of_flat_tree = &images->ft_addr;
 	struct lmb *lmb = &images->lmb;
-	int ret;
+	int ret = 0;
 
 	if (IMAGE_ENABLE_OF_LIBFDT)
 		boot_fdt_add_mem_rsv_regions(lmb, *of_flat_tree);
@@ -1623,19 +1641,19 @@ int image_setup_linux(bootm_headers_t *images)
 		}
 	}
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FDT_FIXUP, "fdt_fixup");
 	if (IMAGE_ENABLE_OF_LIBFDT) {
 		ret = boot_relocate_fdt(lmb, of_flat_tree, &of_size);
 		if (ret)
-			return ret;
+			goto out;
 	}
 
-	if (IMAGE_ENABLE_OF_LIBFDT && of_size) {
+	if (IMAGE_ENABLE_OF_LIBFDT && of_size)
 		ret = image_setup_libfdt(images, *of_flat_tree, of_size, lmb);
-		if (ret)
-			return ret;
-	}
+out:
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FDT_FIXUP);
 
-	return 0;
+	return ret;
 }
 #endif /* CONFIG_LMB */
 #endif /* !USE_HOSTCC */
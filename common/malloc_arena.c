@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Arenas: allocations which are released together
+ *
+ * Commands such as bootm or a filesystem operation allocate many small
+ * buffers which are all freed again when they finish. Taking them from an
+ * arena instead of malloc() avoids both the per-allocation overhead and the
+ * fragmentation of the main pool, since the arena gives back whole blocks.
+ */
+
+#include <common.h>
+#include <malloc.h>
+
+#define ARENA_DEFAULT_BLOCK_SIZE	(16 << 10)
+#define ARENA_ALIGN			16
+
+/**
+ * struct malloc_arena_block - Header of a block of arena memory
+ *
+ * @next:	Next block, or NULL
+ * @size:	Usable size of the block after the header
+ * @used:	Bytes handed out from this block
+ */
+struct malloc_arena_block {
+	struct malloc_arena_block *next;
+	size_t size;
+	size_t used;
+};
+
+#define ARENA_HDR_SIZE	ALIGN(sizeof(struct malloc_arena_block), ARENA_ALIGN)
+
+void malloc_arena_init(struct malloc_arena *arena, size_t block_size)
+{
+	arena->blocks = NULL;
+	arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+	arena->used = 0;
+}
+
+static struct malloc_arena_block *arena_new_block(size_t size)
+{
+	struct malloc_arena_block *blk;
+
+	blk = malloc(ARENA_HDR_SIZE + size);
+	if (!blk)
+		return NULL;
+	blk->size = size;
+	blk->used = 0;
+
+	return blk;
+}
+
+void *malloc_arena_alloc(struct malloc_arena *arena, size_t size)
+{
+	struct malloc_arena_block *blk = arena->blocks;
+	void *ptr;
+
+	size = ALIGN(size, ARENA_ALIGN);
+	if (!blk || blk->size - blk->used < size) {
+		if (size > arena->block_size / 4) {
+			/*
+			 * Large requests get a block of their own, kept
+			 * behind the current one so that its free space is
+			 * not wasted
+			 */
+			blk = arena_new_block(size);
+			if (!blk)
+				return NULL;
+			if (arena->blocks) {
+				blk->next = arena->blocks->next;
+				arena->blocks->next = blk;
+			} else {
+				blk->next = NULL;
+				arena->blocks = blk;
+			}
+		} else {
+			blk = arena_new_block(arena->block_size);
+			if (!blk)
+				return NULL;
+			blk->next = arena->blocks;
+			arena->blocks = blk;
+		}
+	}
+
+	ptr = (void *)blk + ARENA_HDR_SIZE + blk->used;
+	blk->used += size;
+	arena->used += size;
+
+	return ptr;
+}
+
+void malloc_arena_free_all(struct malloc_arena *arena)
+{
+	struct malloc_arena_block *blk, *next;
+
+	for (blk = arena->blocks; blk; blk = next) {
+		next = blk->next;
+		free(blk);
+	}
+	arena->blocks = NULL;
+	arena->used = 0;
+}
@@ -723,9 +723,8 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 #endif
 	bootstage_mark_name(spl_phase() == PHASE_TPL ? BOOTSTAGE_ID_END_TPL :
 			    BOOTSTAGE_ID_END_SPL, "end " SPL_TPL_NAME);
-#ifdef CONFIG_BOOTSTAGE_STASH
-	ret = bootstage_stash((void *)CONFIG_BOOTSTAGE_STASH_ADDR,
-			      CONFIG_BOOTSTAGE_STASH_SIZE);
+#if defined(CONFIG_BOOTSTAGE_STASH) || CONFIG_IS_ENABLED(BLOBLIST)
+	ret = bootstage_stash_default();
 	if (ret)
 		debug("Failed to stash bootstage: err=%d\n", ret);
 #endif
@@ -246,6 +246,7 @@ ulong blk_write_devnum(enum if_type if_type, int devnum, lbaint_t start,
 	ret = get_desc(drv, devnum, &desc);
 	if (ret)
 		return ret;
+	blk_invalidate(if_type, devnum);
 	return desc->block_write(desc, start, blkcnt, buffer);
 }
 
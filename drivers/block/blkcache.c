@@ -133,7 +133,7 @@ void blkcache_invalidate(int iftype, int devnum)
 	list_for_each_safe(entry, n, &block_cache) {
 		node = (struct block_cache_node *)entry;
 		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
+		    (devnum < 0 || node->devnum == devnum)) {
 			list_del(entry);
 			free(node->cache);
 			free(node);
@@ -83,6 +83,7 @@ int device_unbind(struct udevice *dev)
 	ret = device_chld_unbind(dev, NULL);
 	if (ret)
 		return ret;
+	dm_lazy_forget(dev);
 
 	if (dev->flags & DM_FLAG_ALLOC_PDATA) {
 		free(dev->platdata);
@@ -9,6 +9,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <cpu_func.h>
 #include <asm/io.h>
 #include <clk.h>
@@ -311,19 +312,13 @@ static void *alloc_priv(int size, uint flags)
 	return priv;
 }
 
-int device_probe(struct udevice *dev)
+static int device_do_probe(struct udevice *dev)
 {
 	const struct driver *drv;
 	int size = 0;
 	int ret;
 	int seq;
 
-	if (!dev)
-		return -EINVAL;
-
-	if (dev->flags & DM_FLAG_ACTIVATED)
-		return 0;
-
 	drv = dev->driver;
 	assert(drv);
 
@@ -459,6 +454,24 @@ fail:
 	return ret;
 }
 
+int device_probe(struct udevice *dev)
+{
+	int span;
+	int ret;
+
+	if (!dev)
+		return -EINVAL;
+
+	if (dev->flags & DM_FLAG_ACTIVATED)
+		return 0;
+
+	span = bootstage_profile_start(dev->name);
+	ret = device_do_probe(dev);
+	bootstage_profile_end(span);
+
+	return ret;
+}
+
 void *dev_get_platdata(const struct udevice *dev)
 {
 	if (!dev) {
@@ -567,6 +580,7 @@ int device_get_child(struct udevice *parent, int index, struct udevice **devp)
 {
 	struct udevice *dev;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (!index--)
 			return device_get_device_tail(dev, 0, devp);
@@ -580,6 +594,7 @@ int device_get_child_count(struct udevice *parent)
 	struct udevice *dev;
 	int count = 0;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node)
 		count++;
 
@@ -595,6 +610,7 @@ int device_find_child_by_seq(struct udevice *parent, int seq_or_req_seq,
 	if (seq_or_req_seq == -1)
 		return -ENODEV;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if ((find_req_seq ? dev->req_seq : dev->seq) ==
 				seq_or_req_seq) {
@@ -631,6 +647,7 @@ int device_find_child_by_of_offset(struct udevice *parent, int of_offset,
 
 	*devp = NULL;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (dev_of_offset(dev) == of_offset) {
 			*devp = dev;
@@ -671,6 +688,7 @@ static struct udevice *_device_find_global_by_ofnode(struct udevice *parent,
 
 int device_find_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
+	dm_lazy_bind_ofnode(ofnode);
 	*devp = _device_find_global_by_ofnode(gd->dm_root, ofnode);
 
 	return *devp ? 0 : -ENOENT;
@@ -680,12 +698,14 @@ int device_get_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
 	struct udevice *dev;
 
+	dm_lazy_bind_ofnode(ofnode);
 	dev = _device_find_global_by_ofnode(gd->dm_root, ofnode);
 	return device_get_device_tail(dev, dev ? 0 : -ENOENT, devp);
 }
 
 int device_find_first_child(struct udevice *parent, struct udevice **devp)
 {
+	dm_lazy_bind_children(parent);
 	if (list_empty(&parent->child_head)) {
 		*devp = NULL;
 	} else {
@@ -718,6 +738,7 @@ int device_find_first_inactive_child(struct udevice *parent,
 	struct udevice *dev;
 
 	*devp = NULL;
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (!device_active(dev) &&
 		    device_get_uclass_id(dev) == uclass_id) {
@@ -736,6 +757,7 @@ int device_find_first_child_by_uclass(struct udevice *parent,
 	struct udevice *dev;
 
 	*devp = NULL;
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (device_get_uclass_id(dev) == uclass_id) {
 			*devp = dev;
@@ -753,6 +775,7 @@ int device_find_child_by_name(struct udevice *parent, const char *name,
 
 	*devp = NULL;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (!strcmp(dev->name, name)) {
 			*devp = dev;
@@ -803,9 +826,8 @@ bool device_has_active_children(struct udevice *dev)
 {
 	struct udevice *child;
 
-	for (device_find_first_child(dev, &child);
-	     child;
-	     device_find_next_child(&child)) {
+	/* This is used when removing, so do not bind deferred nodes */
+	list_for_each_entry(child, &dev->child_head, sibling_node) {
 		if (device_active(child))
 			return true;
 	}
@@ -0,0 +1,284 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Deferred binding of device tree nodes
+ *
+ * With CONFIG_DM_LAZY_BIND, the nodes found by the scan of the device tree
+ * after relocation are not bound straight away. Each one is recorded with
+ * the uclass of its driver and bound when that uclass is first used, so
+ * devices which are never looked up cost nothing.
+ */
+
+#define LOG_CATEGORY LOGC_DM
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <dm/device-internal.h>
+#include <dm/lists.h>
+#include <dm/root.h>
+#include <linux/bitops.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define DM_LAZY_GROW	32
+
+/**
+ * struct dm_lazy_node - Device tree node whose binding is deferred
+ *
+ * Binding a node may bind its subnodes too, so it must be bound as soon as
+ * any uclass with drivers for the node or its subnodes is used.
+ *
+ * @parent: Device to bind the node to
+ * @node: Node to bind
+ * @bound: true once the node has been bound or dropped
+ * @uclasses: Bitmap of the uclasses found in the subtree of @node
+ */
+struct dm_lazy_node {
+	struct udevice *parent;
+	ofnode node;
+	bool bound;
+	ulong uclasses[BITS_TO_LONGS(UCLASS_COUNT)];
+};
+
+/**
+ * struct dm_lazy - Nodes whose binding is deferred
+ *
+ * @nodes: Deferred nodes, in device tree order
+ * @count: Number of entries used in @nodes
+ * @size: Number of entries allocated in @nodes
+ * @pending: Bitmap of the uclasses which still have nodes to bind
+ */
+struct dm_lazy {
+	struct dm_lazy_node *nodes;
+	int count;
+	int size;
+	ulong pending[BITS_TO_LONGS(UCLASS_COUNT)];
+};
+
+static struct driver *dm_lazy_node_driver(ofnode node)
+{
+	const struct udevice_id *id;
+	struct driver *drv;
+	const char *compat;
+	int i;
+
+	for (i = 0;
+	     !ofnode_read_string_index(node, "compatible", i, &compat);
+	     i++) {
+		drv = lists_driver_lookup_compatible(compat, &id);
+		if (drv)
+			return drv;
+	}
+
+	return NULL;
+}
+
+/*
+ * Drivers with a bind() method, or in a uclass with a post_bind() method,
+ * may bind devices for subnodes without a compatible string, or devices
+ * without a node at all (regulators of a PMIC, the reset device of a clock
+ * controller). The uclasses of those cannot be found by scanning the
+ * subtree. Scanning the compatible subnodes is fine, and simple-bus nodes
+ * defer their own children.
+ */
+static bool dm_lazy_binds_more(struct driver *drv)
+{
+	struct uclass_driver *uc_drv;
+
+	if (drv->id == UCLASS_SIMPLE_BUS)
+		return false;
+	if (drv->bind && drv->bind != dm_scan_fdt_dev)
+		return true;
+	uc_drv = lists_uclass_lookup(drv->id);
+
+	return uc_drv && uc_drv->post_bind &&
+	       uc_drv->post_bind != dm_scan_fdt_dev;
+}
+
+/* Returns true if a node in the subtree must be bound straight away */
+static bool dm_lazy_scan_subnodes(ofnode parent, ulong *uclasses)
+{
+	struct driver *drv;
+	ofnode node;
+
+	ofnode_for_each_subnode(node, parent) {
+		drv = dm_lazy_node_driver(node);
+		if (drv) {
+			if (dm_lazy_binds_more(drv))
+				return true;
+			__set_bit(drv->id, uclasses);
+		}
+		if (dm_lazy_scan_subnodes(node, uclasses))
+			return true;
+	}
+
+	return false;
+}
+
+bool dm_lazy_defer(struct udevice *parent, ofnode node)
+{
+	ulong uclasses[BITS_TO_LONGS(UCLASS_COUNT)] = { 0 };
+	struct dm_lazy *lazy = gd->dm_lazy;
+	struct dm_lazy_node *nodes, *ln;
+	struct driver *drv;
+	int i;
+
+	if (!(gd->flags & GD_FLG_RELOC))
+		return false;
+	if (parent != gd->dm_root &&
+	    device_get_uclass_id(parent) != UCLASS_SIMPLE_BUS)
+		return false;
+
+	/* Buses are bound so that their own children can be deferred */
+	drv = dm_lazy_node_driver(node);
+	if (!drv || drv->id == UCLASS_SIMPLE_BUS || dm_lazy_binds_more(drv))
+		return false;
+	__set_bit(drv->id, uclasses);
+	if (dm_lazy_scan_subnodes(node, uclasses))
+		return false;
+
+	if (!lazy) {
+		lazy = calloc(1, sizeof(*lazy));
+		if (!lazy)
+			return false;
+		gd->dm_lazy = lazy;
+	}
+	if (lazy->count == lazy->size) {
+		nodes = realloc(lazy->nodes,
+				(lazy->size + DM_LAZY_GROW) * sizeof(*nodes));
+		if (!nodes)
+			return false;
+		lazy->nodes = nodes;
+		lazy->size += DM_LAZY_GROW;
+	}
+
+	ln = &lazy->nodes[lazy->count++];
+	ln->parent = parent;
+	ln->node = node;
+	ln->bound = false;
+	memcpy(ln->uclasses, uclasses, sizeof(uclasses));
+	for (i = 0; i < ARRAY_SIZE(lazy->pending); i++)
+		lazy->pending[i] |= ln->uclasses[i];
+	log_debug("deferred %s, uclass %d\n", ofnode_get_name(node), drv->id);
+
+	return true;
+}
+
+int dm_lazy_bind_uclass(enum uclass_id id)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+	struct dm_lazy_node *ln;
+	int i, ret = 0, err;
+
+	if (!lazy || id < 0 || id >= UCLASS_COUNT ||
+	    !test_bit(id, lazy->pending))
+		return 0;
+
+	/*
+	 * Binding calls uclass_get() for this uclass, so clear the bit first.
+	 * Binding a simple-bus node defers its children, which may move the
+	 * array, so look entries up by index each time.
+	 */
+	__clear_bit(id, lazy->pending);
+	for (i = 0; i < lazy->count; i++) {
+		ln = &lazy->nodes[i];
+		if (ln->bound || !test_bit(id, ln->uclasses))
+			continue;
+
+		ln->bound = true;
+		err = lists_bind_fdt(ln->parent, ln->node, NULL, false);
+		if (err && !ret)
+			ret = err;
+	}
+
+	return ret;
+}
+
+int dm_lazy_bind_ofnode(ofnode node)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+	struct dm_lazy_node *ln;
+	int i;
+
+	if (!lazy)
+		return 0;
+
+	/* Deferred nodes never nest, so at most one ancestor is deferred */
+	for (; ofnode_valid(node); node = ofnode_get_parent(node)) {
+		for (i = 0; i < lazy->count; i++) {
+			ln = &lazy->nodes[i];
+			if (ln->bound || !ofnode_equal(ln->node, node))
+				continue;
+
+			ln->bound = true;
+			return lists_bind_fdt(ln->parent, node, NULL, false);
+		}
+	}
+
+	return 0;
+}
+
+int dm_lazy_bind_children(struct udevice *parent)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+	struct dm_lazy_node *ln;
+	int i, ret = 0, err;
+
+	if (!lazy)
+		return 0;
+
+	for (i = 0; i < lazy->count; i++) {
+		ln = &lazy->nodes[i];
+		if (ln->bound || ln->parent != parent)
+			continue;
+
+		ln->bound = true;
+		err = lists_bind_fdt(parent, ln->node, NULL, false);
+		if (err && !ret)
+			ret = err;
+	}
+
+	return ret;
+}
+
+int dm_lazy_bind_all(void)
+{
+	int id, ret = 0, err;
+
+	if (!gd->dm_lazy)
+		return 0;
+
+	for (id = 0; id < UCLASS_COUNT; id++) {
+		err = dm_lazy_bind_uclass(id);
+		if (err && !ret)
+			ret = err;
+	}
+
+	return ret;
+}
+
+void dm_lazy_forget(struct udevice *parent)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+	int i;
+
+	if (!lazy)
+		return;
+
+	for (i = 0; i < lazy->count; i++) {
+		if (lazy->nodes[i].parent == parent)
+			lazy->nodes[i].bound = true;
+	}
+}
+
+void dm_lazy_uninit(void)
+{
+	struct dm_lazy *lazy = gd->dm_lazy;
+
+	if (!lazy)
+		return;
+
+	free(lazy->nodes);
+	free(lazy);
+	gd->dm_lazy = NULL;
+}
@@ -9,7 +9,10 @@
 #define LOG_CATEGORY LOGC_DM
 
 #include <common.h>
+#include <bootstage.h>
 #include <errno.h>
+#include <malloc.h>
+#include <sort.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -19,6 +22,8 @@
 #include <fdtdec.h>
 #include <linux/compiler.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 struct driver *lists_driver_lookup_name(const char *name)
 {
 	struct driver *drv =
@@ -124,11 +129,147 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   bool pre_reloc_only)
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+/**
+ * struct compat_entry - Entry of the compatible string index
+ *
+ * @hash:	Hash of the compatible string
+ * @drv:	Position of the driver in the driver linker list
+ * @match:	Position of the string in the of_match table of the driver
+ */
+struct compat_entry {
+	u32 hash;
+	u16 drv;
+	u16 match;
+};
+
+static struct compat_entry *compat_index;
+static int compat_index_count;
+static bool compat_index_tried;
+
+static u32 compat_hash(const char *str)
+{
+	u32 hash = 2166136261U;
+
+	while (*str)
+		hash = (hash ^ (u8)*str++) * 16777619;
+
+	return hash;
+}
+
+static int compat_entry_cmp(const void *a, const void *b)
+{
+	const struct compat_entry *ea = a, *eb = b;
+
+	if (ea->hash != eb->hash)
+		return ea->hash < eb->hash ? -1 : 1;
+	/* Keep the order of the linear search among equal strings */
+	if (ea->drv != eb->drv)
+		return ea->drv - eb->drv;
+
+	return ea->match - eb->match;
+}
+
+static int compat_index_build(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct compat_entry *e;
+	struct driver *entry;
+	int count = 0;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++)
+			count++;
+	}
+	if (n_ents > U16_MAX || !count)
+		return -EINVAL;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DM_INDEX, "dm_index");
+	e = malloc(count * sizeof(*e));
+	if (!e) {
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_INDEX);
+		return -ENOMEM;
+	}
+	compat_index = e;
+	compat_index_count = count;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			e->hash = compat_hash(id->compatible);
+			e->drv = entry - driver;
+			e->match = id - entry->of_match;
+			e++;
+		}
+	}
+	qsort(compat_index, count, sizeof(*e), compat_entry_cmp);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_INDEX);
+
+	return 0;
+}
+
+static struct driver *compat_index_lookup(const char *compat,
+					  const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const struct udevice_id *id;
+	struct compat_entry *e;
+	struct driver *entry;
+	u32 hash = compat_hash(compat);
+	int lo = 0, hi = compat_index_count, mid;
+
+	/* Find the first entry with this hash */
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (compat_index[mid].hash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (e = compat_index + lo;
+	     e != compat_index + compat_index_count && e->hash == hash; e++) {
+		entry = driver + e->drv;
+		id = entry->of_match + e->match;
+		if (!strcmp(id->compatible, compat)) {
+			*idp = id;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+#endif
+
+struct driver *lists_driver_lookup_compatible(const char *compat,
+					      const struct udevice_id **idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+	/* The early malloc() area is too small to hold the index */
+	if (!compat_index_tried && (gd->flags & GD_FLG_RELOC)) {
+		compat_index_tried = true;
+		compat_index_build();
+	}
+	if (compat_index)
+		return compat_index_lookup(compat, idp);
+#endif
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -165,14 +306,11 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		log_debug("   - attempt to match compatible string '%s'\n",
 			  compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		entry = lists_driver_lookup_compatible(compat, &id);
+		if (!entry) {
+			ret = -ENOENT;
 			continue;
+		}
 
 		if (pre_reloc_only) {
 			if (!dm_ofnode_pre_reloc(node) &&
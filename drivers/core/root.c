@@ -168,6 +168,7 @@ int dm_uninit(void)
 	device_remove(dm_root(), DM_REMOVE_NORMAL);
 	device_unbind(dm_root());
 	gd->dm_root = NULL;
+	dm_lazy_uninit();
 
 	return 0;
 }
@@ -217,6 +218,8 @@ static int dm_scan_fdt_live(struct udevice *parent,
 			pr_debug("   - ignoring disabled device\n");
 			continue;
 		}
+		if (!pre_reloc_only && dm_lazy_defer(parent, np_to_ofnode(np)))
+			continue;
 		err = lists_bind_fdt(parent, np_to_ofnode(np), NULL,
 				     pre_reloc_only);
 		if (err && !ret) {
@@ -275,6 +278,9 @@ static int dm_scan_fdt_node(struct udevice *parent, const void *blob,
 			pr_debug("   - ignoring disabled device\n");
 			continue;
 		}
+		if (!pre_reloc_only &&
+		    dm_lazy_defer(parent, offset_to_ofnode(offset)))
+			continue;
 		err = lists_bind_fdt(parent, offset_to_ofnode(offset), NULL,
 				     pre_reloc_only);
 		if (err && !ret) {
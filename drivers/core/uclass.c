@@ -141,6 +141,9 @@ int uclass_get(enum uclass_id id, struct uclass **ucp)
 {
 	struct uclass *uc;
 
+	/* Bind the devices of this uclass if that was put off */
+	dm_lazy_bind_uclass(id);
+
 	*ucp = NULL;
 	uc = uclass_find(id);
 	if (!uc)
@@ -337,6 +340,7 @@ int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 	*devp = NULL;
 	if (node < 0)
 		return -ENODEV;
+	dm_lazy_bind_ofnode(offset_to_ofnode(node));
 	ret = uclass_get(id, &uc);
 	if (ret)
 		return ret;
@@ -362,6 +366,7 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	*devp = NULL;
 	if (!ofnode_valid(node))
 		return -ENODEV;
+	dm_lazy_bind_ofnode(node);
 	ret = uclass_get(id, &uc);
 	if (ret)
 		return ret;
@@ -395,6 +400,7 @@ int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
 	find_phandle = dev_read_u32_default(parent, name, -1);
 	if (find_phandle <= 0)
 		return -ENOENT;
+	dm_lazy_bind_ofnode(ofnode_get_by_phandle(find_phandle));
 	ret = uclass_get(id, &uc);
 	if (ret)
 		return ret;
@@ -522,6 +528,7 @@ int uclass_get_device_by_phandle_id(enum uclass_id id, uint phandle_id,
 	int ret;
 
 	*devp = NULL;
+	dm_lazy_bind_ofnode(ofnode_get_by_phandle(phandle_id));
 	ret = uclass_get(id, &uc);
 	if (ret)
 		return ret;
@@ -384,7 +384,7 @@ static int mmc_select_hwpart(struct udevice *bdev, int hwpart)
 
 	ret = mmc_switch_part(mmc, hwpart);
 	if (!ret)
-		blkcache_invalidate(desc->if_type, desc->devnum);
+		blk_invalidate(desc->if_type, desc->devnum);
 
 	return ret;
 }
@@ -29,6 +29,25 @@ struct hsearch_data env_htab = {
 	.change_ok = env_flags_validate,
 };
 
+/* Value of env_htab.changes when the environment was last loaded or saved */
+static unsigned int env_stored_changes;
+static bool env_stored;
+
+void env_mark_stored(bool stored)
+{
+	/* Before relocation the environment is loaded again later anyway */
+	if (!(gd->flags & GD_FLG_RELOC))
+		return;
+
+	env_stored = stored;
+	env_stored_changes = env_htab.changes;
+}
+
+bool env_is_stored(void)
+{
+	return env_stored && env_stored_changes == env_htab.changes;
+}
+
 /*
  * Read an environment variable as a boolean
  * Return -1 if variable does not exist (default to true)
@@ -125,6 +144,7 @@ int env_import(const char *buf, int check)
 	if (himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0', 0, 0,
 			0, NULL)) {
 		gd->flags |= GD_FLG_ENV_READY;
+		env_mark_stored(true);
 		return 0;
 	}
 
@@ -243,12 +243,22 @@ int env_save(void)
 		if (!env_has_inited(drv->location))
 			return -ENODEV;
 
+		/* Boards may load the environment from elsewhere */
+		if (IS_ENABLED(CONFIG_ENV_SAVE_ONLY_CHANGED) &&
+		    env_is_stored() &&
+		    drv->location == env_get_location(ENVOP_LOAD,
+						      gd->env_load_prio)) {
+			printf("Environment in %s is up to date\n", drv->name);
+			return 0;
+		}
+
 		printf("Saving Environment to %s... ", drv->name);
 		ret = drv->save();
 		if (ret)
 			printf("Failed (%d)\n", ret);
 		else
 			printf("OK\n");
+		env_mark_stored(!ret);
 
 		if (!ret)
 			return 0;
@@ -273,6 +283,7 @@ int env_erase(void)
 
 		printf("Erasing Environment on %s... ", drv->name);
 		ret = drv->erase();
+		env_mark_stored(false);
 		if (ret)
 			printf("Failed (%d)\n", ret);
 		else
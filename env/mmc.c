@@ -10,6 +10,7 @@
 #include <command.h>
 #include <env.h>
 #include <env_internal.h>
+#include <env_log.h>
 #include <fdtdec.h>
 #include <linux/stddef.h>
 #include <malloc.h>
@@ -18,6 +19,7 @@
 #include <part.h>
 #include <search.h>
 #include <errno.h>
+#include <u-boot/crc.h>
 
 #define __STR(X) #X
 #define STR(X) __STR(X)
@@ -173,6 +175,157 @@ static void fini_mmc_for_env(struct mmc *mmc)
 #endif
 }
 
+#ifdef CONFIG_ENV_MMC_LOG
+/* The format of the journaled environment is described in env_log.h */
+#define ENV_LOG_HALF	(CONFIG_ENV_SIZE / 2)
+
+/**
+ * struct env_log - State of the journaled environment
+ *
+ * @half: Half holding the current records, -1 if there is none
+ * @gen: Generation of the records in @half
+ * @tail: Offset in @half at which the next record goes
+ * @base: Environment as last loaded or saved, as exported by hexport_r()
+ * @base_len: Length of @base, without the final '\0'
+ */
+struct env_log {
+	int half;
+	u32 gen;
+	u32 tail;
+	char *base;
+	size_t base_len;
+};
+
+static struct env_log env_log = {
+	.half = -1,
+};
+
+static u32 env_log_crc(const struct env_log_hdr *hdr)
+{
+	struct env_log_hdr tmp = *hdr;
+	u32 crc;
+
+	tmp.crc = 0;
+	crc = crc32(0, (const uchar *)&tmp, sizeof(tmp));
+
+	return crc32(crc, (const uchar *)(hdr + 1), le32_to_cpu(hdr->len));
+}
+
+static u32 env_log_rec_size(const struct env_log_hdr *hdr)
+{
+	return ALIGN(sizeof(*hdr) + le32_to_cpu(hdr->len), ENV_LOG_ALIGN);
+}
+
+/* Return the record at @offset in @half if it is complete, else NULL */
+static const struct env_log_hdr *env_log_record(const char *half, u32 offset)
+{
+	const struct env_log_hdr *hdr = (const void *)(half + offset);
+
+	if (offset + sizeof(*hdr) > ENV_LOG_HALF ||
+	    le32_to_cpu(hdr->magic) != ENV_LOG_MAGIC ||
+	    le32_to_cpu(hdr->len) > ENV_LOG_HALF - offset - sizeof(*hdr) ||
+	    env_log_crc(hdr) != le32_to_cpu(hdr->crc))
+		return NULL;
+
+	return hdr;
+}
+
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+static void env_log_set_base(char *base, size_t len)
+{
+	free(env_log.base);
+	env_log.base = base;
+	env_log.base_len = len;
+}
+
+static char *env_log_export(size_t *lenp)
+{
+	char *res = NULL;
+	ssize_t len;
+
+	len = hexport_r(&env_htab, '\0', 0, &res, 0, 0, NULL);
+	if (len < 0) {
+		pr_err("Cannot export environment: errno = %d\n", errno);
+		return NULL;
+	}
+	*lenp = len - 1;
+
+	return res;
+}
+
+static void env_log_update_base(void)
+{
+	size_t len = 0;
+	char *base;
+
+	base = env_log_export(&len);
+	env_log_set_base(base, len);
+}
+#endif
+
+/**
+ * env_log_load() - Import the journaled environment
+ *
+ * This falls back to an environment in the usual format, which is converted
+ * by the next save.
+ *
+ * @buf: Contents of the environment area
+ * @return 0 if OK, -ve on error
+ */
+static int env_log_load(const char *buf)
+{
+	const struct env_log_hdr *hdr, *first[2];
+	const char *half;
+	u32 gen, offset;
+	int i;
+
+	for (i = 0; i < 2; i++)
+		first[i] = env_log_record(buf + i * ENV_LOG_HALF, 0);
+	if (!first[0] && !first[1]) {
+		env_log.half = -1;
+		return env_import(buf, 1);
+	}
+
+	/* Use the half with the latest generation */
+	i = !first[0] || (first[1] && (s32)(le32_to_cpu(first[1]->gen) -
+					    le32_to_cpu(first[0]->gen)) > 0);
+	half = buf + i * ENV_LOG_HALF;
+	gen = le32_to_cpu(first[i]->gen);
+
+	if (!himport_r(&env_htab, (const char *)(first[i] + 1),
+		       le32_to_cpu(first[i]->len), '\0', 0, 0, 0, NULL)) {
+		pr_err("Cannot import environment: errno = %d\n", errno);
+		env_set_default("import failed", 0);
+		return -EIO;
+	}
+
+	/* Replay the changes up to the first incomplete record */
+	offset = env_log_rec_size(first[i]);
+	while ((hdr = env_log_record(half, offset)) &&
+	       le32_to_cpu(hdr->gen) == gen) {
+		if (!himport_r(&env_htab, (const char *)(hdr + 1),
+			       le32_to_cpu(hdr->len), '\0',
+			       H_NOCLEAR | H_FORCE, 0, 0, NULL))
+			pr_err("Cannot import environment record: errno = %d\n",
+			       errno);
+		offset += env_log_rec_size(hdr);
+	}
+	debug("env: generation %u in half %d, %u bytes used\n", gen, i,
+	      offset);
+
+	env_log.half = i;
+	env_log.gen = gen;
+	env_log.tail = offset;
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+	env_log_update_base();
+#endif
+	gd->flags |= GD_FLG_ENV_READY;
+	env_mark_stored(true);
+
+	return 0;
+}
+#endif /* CONFIG_ENV_MMC_LOG */
+
 #if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
 static inline int write_env(struct mmc *mmc, unsigned long size,
 			    unsigned long offset, const void *buffer)
@@ -188,6 +341,160 @@ static inline int write_env(struct mmc *mmc, unsigned long size,
 	return (n == blk_cnt) ? 0 : -1;
 }
 
+#ifdef CONFIG_ENV_MMC_LOG
+/* Compare the names of two "name=value" entries like hexport_r() sorts them */
+static int env_log_namecmp(const char *a, const char *b)
+{
+	while (*a == *b && *a != '=') {
+		a++;
+		b++;
+	}
+
+	return (*a == '=' ? 0 : (uchar)*a) - (*b == '=' ? 0 : (uchar)*b);
+}
+
+/**
+ * env_log_diff() - Build the record data which turns one environment into
+ * another
+ *
+ * @old: Environment as exported by hexport_r()
+ * @old_len: Length of @old
+ * @new: New environment as exported by hexport_r()
+ * @new_len: Length of @new
+ * @out: Buffer for the entries, at least @old_len + @new_len bytes long
+ * @return number of bytes written to @out
+ */
+static size_t env_log_diff(const char *old, size_t old_len, const char *new,
+			   size_t new_len, char *out)
+{
+	const char *old_end = old + old_len, *new_end = new + new_len;
+	char *p = out;
+	size_t n;
+	int cmp;
+
+	while (old < old_end || new < new_end) {
+		if (old == old_end)
+			cmp = 1;
+		else if (new == new_end)
+			cmp = -1;
+		else
+			cmp = env_log_namecmp(old, new);
+
+		if (cmp < 0) {
+			/* Deleted variable */
+			n = strchr(old, '=') - old;
+			memcpy(p, old, n);
+			p[n] = '\0';
+			p += n + 1;
+			old += strlen(old) + 1;
+			continue;
+		}
+
+		n = strlen(new) + 1;
+		if (cmp > 0 || strcmp(old, new)) {
+			memcpy(p, new, n);
+			p += n;
+		}
+		if (!cmp)
+			old += strlen(old) + 1;
+		new += n;
+	}
+
+	return p - out;
+}
+
+static int env_log_save(struct mmc *mmc, int dev, u32 offset)
+{
+	struct env_log_hdr *hdr;
+	size_t env_len, len, size;
+	char *env, *rec = NULL;
+	u32 half, gen, at;
+	int ret = 1;
+
+	env = env_log_export(&env_len);
+	if (!env)
+		return 1;
+
+	size = ALIGN(sizeof(*hdr) + env_len + env_log.base_len, ENV_LOG_ALIGN);
+	rec = malloc_cache_aligned(size);
+	if (!rec)
+		goto out;
+	memset(rec, '\0', size);
+	hdr = (struct env_log_hdr *)rec;
+
+	/* Append the changes if they fit, else start the other half */
+	half = env_log.half;
+	gen = env_log.gen;
+	at = env_log.tail;
+	len = 0;
+	if (env_log.half >= 0 && env_log.base) {
+		len = env_log_diff(env_log.base, env_log.base_len, env,
+				   env_len, (char *)(hdr + 1));
+		if (!len) {
+			ret = 0;
+			goto out;
+		}
+	}
+	if (env_log.half < 0 || !env_log.base ||
+	    at + sizeof(*hdr) + len > ENV_LOG_HALF) {
+		half = env_log.half == 1 ? 0 : 1;
+		gen++;
+		at = 0;
+		len = env_len;
+		if (sizeof(*hdr) + len > ENV_LOG_HALF) {
+			printf("Environment too large: %zu bytes\n", len);
+			goto out;
+		}
+		memcpy(hdr + 1, env, len);
+		memset((char *)(hdr + 1) + len, '\0',
+		       size - sizeof(*hdr) - len);
+	}
+
+	hdr->magic = cpu_to_le32(ENV_LOG_MAGIC);
+	hdr->gen = cpu_to_le32(gen);
+	hdr->len = cpu_to_le32(len);
+	hdr->crc = cpu_to_le32(env_log_crc(hdr));
+	size = env_log_rec_size(hdr);
+
+	printf("Writing to MMC(%d)... ", dev);
+	if (write_env(mmc, size, offset + half * ENV_LOG_HALF + at, rec)) {
+		puts("failed\n");
+		goto out;
+	}
+
+	env_log.half = half;
+	env_log.gen = gen;
+	env_log.tail = at + size;
+	env_log_set_base(env, env_len);
+	env = NULL;
+	ret = 0;
+out:
+	free(rec);
+	free(env);
+	return ret;
+}
+
+static int env_mmc_save(void)
+{
+	int dev = mmc_get_env_dev();
+	struct mmc *mmc = find_mmc_device(dev);
+	const char *errmsg;
+	u32 offset;
+	int ret = 1;
+
+	errmsg = init_mmc_for_env(mmc);
+	if (errmsg) {
+		printf("%s\n", errmsg);
+		return 1;
+	}
+
+	if (!mmc_get_env_addr(mmc, 0, &offset))
+		ret = env_log_save(mmc, dev, offset);
+
+	fini_mmc_for_env(mmc);
+	return ret;
+}
+#else
 static int env_mmc_save(void)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(env_t, env_new, 1);
@@ -234,6 +541,7 @@ fini:
 	fini_mmc_for_env(mmc);
 	return ret;
 }
+#endif /* CONFIG_ENV_MMC_LOG */
 
 #if defined(CONFIG_CMD_ERASEENV)
 static inline int erase_env(struct mmc *mmc, unsigned long size,
@@ -278,6 +586,10 @@ static int env_mmc_erase(void)
 
 	ret |= erase_env(mmc, CONFIG_ENV_SIZE, offset);
 #endif
+#ifdef CONFIG_ENV_MMC_LOG
+	env_log.half = -1;
+	env_log_set_base(NULL, 0);
+#endif
 
 	return ret;
 }
@@ -373,7 +685,11 @@ static int env_mmc_load(void)
 		goto fini;
 	}
 
+#ifdef CONFIG_ENV_MMC_LOG
+	ret = env_log_load(buf);
+#else
 	ret = env_import(buf, 1);
+#endif
 
 fini:
 	fini_mmc_for_env(mmc);
@@ -80,6 +80,8 @@ int btrfs_probe(struct blk_desc *fs_dev_desc, disk_partition_t *fs_partition)
 	btrfs_part_info = fs_partition;
 
 	memset(&btrfs_info, 0, sizeof(btrfs_info));
+	btrfs_node_cache_exit();
+	btrfs_extent_io_release();
 
 	btrfs_hash_init();
 	if (btrfs_read_superblock())
@@ -191,6 +193,11 @@ int btrfs_read(const char *file, void *buf, loff_t offset, loff_t len,
 		return -1;
 	}
 
+	if (offset >= inode.size) {
+		*actread = 0;
+		return 0;
+	}
+
 	if (!len)
 		len = inode.size;
 
@@ -207,9 +214,17 @@ int btrfs_read(const char *file, void *buf, loff_t offset, loff_t len,
 	return 0;
 }
 
+void btrfs_release(void)
+{
+	/* Keep the tree nodes and chunk map, drop the file data buffers */
+	btrfs_extent_io_release();
+}
+
 void btrfs_close(void)
 {
 	btrfs_chunk_map_exit();
+	btrfs_node_cache_exit();
+	btrfs_extent_io_release();
 }
 
 int btrfs_uuid(char *uuid_str)
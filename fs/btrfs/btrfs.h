@@ -83,5 +83,6 @@ u64 btrfs_read_extent_inline(struct btrfs_path *,
 			      char *);
 u64 btrfs_read_extent_reg(struct btrfs_path *, struct btrfs_file_extent_item *,
 			   u64, u64, char *);
+void btrfs_extent_io_release(void);
 
 #endif /* !__BTRFS_BTRFS_H__ */
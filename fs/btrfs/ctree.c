@@ -104,6 +104,83 @@ void btrfs_free_path(struct btrfs_path *p)
 	clear_path(p);
 }
 
+/*
+ * Every search walks down from the root of a tree, so the same few nodes are
+ * read over and over. Keep the most recently used ones. Callers convert the
+ * item data of leaves in place, so they always get a copy.
+ */
+#define BTRFS_NODE_CACHE_SLOTS	32
+
+struct btrfs_cached_node {
+	u64 physical;
+	unsigned long size;
+	u32 stamp;
+	union btrfs_tree_node *node;
+};
+
+static struct btrfs_cached_node node_cache[BTRFS_NODE_CACHE_SLOTS];
+static u32 node_cache_stamp;
+
+static union btrfs_tree_node *node_cache_get(u64 physical)
+{
+	struct btrfs_cached_node *c;
+	union btrfs_tree_node *res;
+	int i;
+
+	for (i = 0, c = node_cache; i < BTRFS_NODE_CACHE_SLOTS; i++, c++) {
+		if (!c->node || c->physical != physical)
+			continue;
+
+		res = malloc_cache_aligned(c->size);
+		if (!res)
+			return NULL;
+
+		memcpy(res, c->node, c->size);
+		c->stamp = ++node_cache_stamp;
+		return res;
+	}
+
+	return NULL;
+}
+
+static void node_cache_put(u64 physical, union btrfs_tree_node *node,
+			   unsigned long size)
+{
+	struct btrfs_cached_node *c, *victim = node_cache;
+	union btrfs_tree_node *copy;
+	int i;
+
+	for (i = 0, c = node_cache; i < BTRFS_NODE_CACHE_SLOTS; i++, c++) {
+		if (!c->node) {
+			victim = c;
+			break;
+		}
+		if (c->stamp < victim->stamp)
+			victim = c;
+	}
+
+	copy = malloc_cache_aligned(size);
+	if (!copy)
+		return;
+	memcpy(copy, node, size);
+
+	free(victim->node);
+	victim->physical = physical;
+	victim->size = size;
+	victim->stamp = ++node_cache_stamp;
+	victim->node = copy;
+}
+
+void btrfs_node_cache_exit(void)
+{
+	int i;
+
+	for (i = 0; i < BTRFS_NODE_CACHE_SLOTS; i++)
+		free(node_cache[i].node);
+	memset(node_cache, 0, sizeof(node_cache));
+	node_cache_stamp = 0;
+}
+
 static int read_tree_node(u64 physical, union btrfs_tree_node **buf)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(struct btrfs_header, hdr,
@@ -112,6 +189,12 @@ static int read_tree_node(u64 physical, union btrfs_tree_node **buf)
 	union btrfs_tree_node *res;
 	u32 i;
 
+	res = node_cache_get(physical);
+	if (res) {
+		*buf = res;
+		return 0;
+	}
+
 	if (!btrfs_devread(physical, sizeof(*hdr), hdr))
 		return -1;
 
@@ -143,6 +226,7 @@ static int read_tree_node(u64 physical, union btrfs_tree_node **buf)
 		for (i = 0; i < hdr->nritems; ++i)
 			btrfs_item_to_cpu(&res->leaf.items[i]);
 
+	node_cache_put(physical, res, size);
 	*buf = res;
 
 	return 0;
@@ -8,6 +8,77 @@
 #include "btrfs.h"
 #include <malloc.h>
 #include <memalign.h>
+#include <linux/sizes.h>
+
+/*
+ * The compressed extents of a file are usually stored one after the other,
+ * so they are read from the disk in large chunks. The last extent which was
+ * decompressed is kept, since a file extent item may refer to part of it
+ * only and the next one often refers to the rest.
+ */
+#define BTRFS_READAHEAD_SIZE	SZ_1M
+
+static struct {
+	u8 *buf;
+	u64 size;
+	u64 physical;
+	u64 len;
+} raw;
+
+static struct {
+	char *buf;
+	u64 size;
+	u64 bytenr;
+	u64 len;
+} ext;
+
+/**
+ * read_raw() - Read data from the disk through the read-ahead window
+ *
+ * @physical: Position of the data on the partition
+ * @len: Number of bytes needed
+ * @ahead: Number of bytes after them which will be needed next
+ * Return: pointer to the data, NULL on error
+ */
+static const u8 *read_raw(u64 physical, u64 len, u64 ahead)
+{
+	u64 dev_end = (u64)btrfs_part_info->size * btrfs_part_info->blksz;
+	u64 want;
+
+	if (raw.len && physical >= raw.physical &&
+	    physical + len <= raw.physical + raw.len)
+		return raw.buf + (physical - raw.physical);
+
+	want = len + min_t(u64, ahead, BTRFS_READAHEAD_SIZE);
+	if (physical + want > dev_end && physical + len <= dev_end)
+		want = dev_end - physical;
+
+	if (want > raw.size) {
+		free(raw.buf);
+		raw.size = 0;
+		raw.buf = malloc_cache_aligned(want);
+		if (!raw.buf)
+			return NULL;
+		raw.size = want;
+	}
+
+	raw.len = 0;
+	if (!btrfs_devread(physical, want, raw.buf))
+		return NULL;
+	raw.physical = physical;
+	raw.len = want;
+
+	return raw.buf;
+}
+
+void btrfs_extent_io_release(void)
+{
+	free(raw.buf);
+	memset(&raw, 0, sizeof(raw));
+	free(ext.buf);
+	memset(&ext, 0, sizeof(ext));
+}
+
 
 u64 btrfs_read_extent_inline(struct btrfs_path *path,
 			     struct btrfs_file_extent_item *extent, u64 offset,
@@ -65,18 +136,25 @@ u64 btrfs_read_extent_reg(struct btrfs_path *path,
 			  struct btrfs_file_extent_item *extent, u64 offset,
 			  u64 size, char *out)
 {
-	u64 physical, clen, dlen, orig_size = size;
+	u64 physical, clen, dlen, skip, ahead = 0;
+	const u8 *cbuf;
 	u32 res;
-	char *cbuf, *dbuf;
-
-	clen = extent->disk_num_bytes;
-	dlen = extent->num_bytes;
 
-	if (offset > dlen)
+	if (offset > extent->num_bytes)
 		return -1ULL;
 
-	if (size > dlen - offset)
-		size = dlen - offset;
+	/* What is left of the read is likely stored right after this */
+	if (size > extent->num_bytes - offset) {
+		ahead = size - (extent->num_bytes - offset);
+		size = extent->num_bytes - offset;
+	}
+
+	/* Holes and preallocated extents read as zeros */
+	if (!extent->disk_bytenr ||
+	    extent->type == BTRFS_FILE_EXTENT_PREALLOC) {
+		memset(out, 0, size);
+		return size;
+	}
 
 	physical = btrfs_map_logical_to_physical(extent->disk_bytenr);
 	if (physical == -1ULL)
@@ -90,31 +168,49 @@ u64 btrfs_read_extent_reg(struct btrfs_path *path,
 		return size;
 	}
 
-	cbuf = malloc_cache_aligned(dlen > size ? clen + dlen : clen);
+	/* The file extent item may refer to part of the compressed data */
+	clen = extent->disk_num_bytes;
+	dlen = extent->ram_bytes;
+	skip = extent->offset + offset;
+	if (skip + size > dlen)
+		return -1ULL;
+
+	if (ext.len && ext.bytenr == extent->disk_bytenr) {
+		memcpy(out, ext.buf + skip, size);
+		return size;
+	}
+
+	cbuf = read_raw(physical, clen, ahead);
 	if (!cbuf)
 		return -1ULL;
 
-	if (dlen > orig_size)
-		dbuf = cbuf + clen;
-	else
-		dbuf = out;
+	if (!skip && size == dlen) {
+		res = btrfs_decompress(extent->compression,
+				       (const char *)cbuf, clen, out, dlen);
+		if (res == -1 || res != dlen)
+			return -1ULL;
 
-	if (!btrfs_devread(physical, clen, cbuf))
-		goto err;
+		return size;
+	}
 
-	res = btrfs_decompress(extent->compression, cbuf, clen, dbuf, dlen);
-	if (res == -1)
-		goto err;
+	if (dlen > ext.size) {
+		free(ext.buf);
+		ext.size = 0;
+		ext.buf = malloc(dlen);
+		if (!ext.buf)
+			return -1ULL;
+		ext.size = dlen;
+	}
 
-	if (dlen > orig_size)
-		memcpy(out, dbuf + offset, size);
-	else
-		memmove(out, dbuf + offset, size);
+	ext.len = 0;
+	res = btrfs_decompress(extent->compression, (const char *)cbuf, clen,
+			       ext.buf, dlen);
+	if (res == -1 || res != dlen)
+		return -1ULL;
+	ext.bytenr = extent->disk_bytenr;
+	ext.len = dlen;
 
-	free(cbuf);
-	return res;
+	memcpy(out, ext.buf + skip, size);
 
-err:
-	free(cbuf);
-	return -1ULL;
+	return size;
 }
@@ -320,10 +320,10 @@ u64 btrfs_file_read(const struct btrfs_root *root, u64 inr, u64 offset,
 		    u64 size, char *buf)
 {
 	struct btrfs_path path;
-	struct btrfs_key key;
+	struct btrfs_key key, *found;
 	struct btrfs_file_extent_item *extent;
 	int res = 0;
-	u64 rd, rd_all = -1ULL;
+	u64 rd, pos = offset, end = offset + size, ext_off;
 
 	key.objectid = inr;
 	key.type = BTRFS_EXTENT_DATA_KEY;
@@ -332,52 +332,74 @@ u64 btrfs_file_read(const struct btrfs_root *root, u64 inr, u64 offset,
 	if (btrfs_search_tree(root, &key, &path))
 		return -1ULL;
 
-	if (btrfs_comp_keys(&key, btrfs_path_leaf_key(&path)) < 0) {
-		if (btrfs_prev_slot(&path))
-			goto out;
-
-		if (btrfs_comp_keys_type(&key, btrfs_path_leaf_key(&path)))
-			goto out;
+	/* Start from the extent holding @offset, unless it is in a hole */
+	if (path.slots[0] >= path.nodes[0]->header.nritems ||
+	    btrfs_comp_keys(&key, btrfs_path_leaf_key(&path)) < 0) {
+		res = btrfs_prev_slot(&path);
+		if (!res &&
+		    btrfs_comp_keys_type(&key, btrfs_path_leaf_key(&path)))
+			res = btrfs_next_slot(&path);
+		if (res < 0)
+			goto err;
+		res = 0;
 	}
 
-	rd_all = 0;
-
 	do {
-		if (btrfs_comp_keys_type(&key, btrfs_path_leaf_key(&path)))
+		if (path.slots[0] >= path.nodes[0]->header.nritems)
+			break;
+
+		found = btrfs_path_leaf_key(&path);
+		if (btrfs_comp_keys_type(&key, found) || found->offset >= end)
 			break;
 
+		/* With the no-holes feature, holes have no extent item */
+		if (found->offset > pos) {
+			memset(buf, 0, found->offset - pos);
+			buf += found->offset - pos;
+			pos = found->offset;
+		}
+		ext_off = pos - found->offset;
+
 		extent = btrfs_path_item_ptr(&path,
 					     struct btrfs_file_extent_item);
 
 		if (extent->type == BTRFS_FILE_EXTENT_INLINE) {
 			btrfs_file_extent_item_to_cpu_inl(extent);
-			rd = btrfs_read_extent_inline(&path, extent, offset,
-						      size, buf);
+			if (ext_off >= extent->ram_bytes)
+				continue;
+			rd = btrfs_read_extent_inline(&path, extent, ext_off,
+						      end - pos, buf);
 		} else {
 			btrfs_file_extent_item_to_cpu(extent);
-			rd = btrfs_read_extent_reg(&path, extent, offset, size,
-						   buf);
+			if (ext_off >= extent->num_bytes)
+				continue;
+			rd = btrfs_read_extent_reg(&path, extent, ext_off,
+						   end - pos, buf);
 		}
 
 		if (rd == -1ULL) {
 			printf("%s: Error reading extent\n", __func__);
-			rd_all = -1;
-			goto out;
+			goto err;
 		}
 
-		offset = 0;
 		buf += rd;
-		rd_all += rd;
-		size -= rd;
+		pos += rd;
 
-		if (!size)
+		if (pos == end)
 			break;
 	} while (!(res = btrfs_next_slot(&path)));
 
-	if (res)
-		return -1ULL;
+	if (res < 0)
+		goto err;
 
-out:
+	/* The file may end with a hole */
+	if (pos < end)
+		memset(buf, 0, end - pos);
+
+	btrfs_free_path(&path);
+	return size;
+
+err:
 	btrfs_free_path(&path);
-	return rd_all;
+	return -1ULL;
 }
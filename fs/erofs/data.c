@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * EROFS inodes and uncompressed data
+ */
+
+#include <common.h>
+#include "internal.h"
+
+int erofs_read_inode(u64 nid, struct erofs_inode *vi)
+{
+	union {
+		struct erofs_inode_compact c;
+		struct erofs_inode_extended e;
+	} di;
+	u16 ifmt, icount;
+	int ret;
+
+	memset(vi, '\0', sizeof(*vi));
+	vi->nid = nid;
+	ret = erofs_read_meta(&di.c, erofs_iloc(vi), sizeof(di.c));
+	if (ret)
+		return ret;
+
+	ifmt = le16_to_cpu(di.c.i_format);
+	vi->datalayout = (ifmt >> EROFS_I_DATALAYOUT_BIT) &
+			 EROFS_I_DATALAYOUT_MASK;
+	if (vi->datalayout >= EROFS_INODE_DATALAYOUT_MAX)
+		return -EOPNOTSUPP;
+
+	switch ((ifmt >> EROFS_I_VERSION_BIT) & EROFS_I_VERSION_MASK) {
+	case 0:
+		vi->inode_isize = sizeof(di.c);
+		vi->mode = le16_to_cpu(di.c.i_mode);
+		vi->size = le32_to_cpu(di.c.i_size);
+		break;
+	default:
+		/* Extended inodes may cross a block boundary */
+		ret = erofs_read_meta(&di.e, erofs_iloc(vi), sizeof(di.e));
+		if (ret)
+			return ret;
+		vi->inode_isize = sizeof(di.e);
+		vi->mode = le16_to_cpu(di.e.i_mode);
+		vi->size = le64_to_cpu(di.e.i_size);
+		break;
+	}
+
+	/* i_xattr_icount and i_u are at the same place in both forms */
+	icount = le16_to_cpu(di.c.i_xattr_icount);
+	if (icount)
+		vi->xattr_isize = EROFS_XATTR_IBODY_HEADER_SIZE +
+				  (icount - 1) * EROFS_XATTR_ENTRY_SIZE;
+
+	switch (vi->datalayout) {
+	case EROFS_INODE_FLAT_PLAIN:
+	case EROFS_INODE_FLAT_INLINE:
+		vi->raw_blkaddr = le32_to_cpu(di.c.i_u.raw_blkaddr);
+		break;
+	case EROFS_INODE_CHUNK_BASED:
+		vi->chunkformat = le16_to_cpu(di.c.i_u.chunk_format);
+		if (vi->chunkformat & ~(EROFS_CHUNK_FORMAT_BLKBITS_MASK |
+					EROFS_CHUNK_FORMAT_INDEXES))
+			return -EOPNOTSUPP;
+		vi->chunkbits = erofs_sbi.blkszbits +
+			(vi->chunkformat & EROFS_CHUNK_FORMAT_BLKBITS_MASK);
+		break;
+	}
+
+	return 0;
+}
+
+static int erofs_map_blocks_flat(struct erofs_inode *vi,
+				 struct erofs_map_blocks *map)
+{
+	bool tailendpacking = vi->datalayout == EROFS_INODE_FLAT_INLINE;
+	u64 lastblk = DIV_ROUND_UP(vi->size, erofs_blksiz()) - tailendpacking;
+	u64 offset = map->m_la;
+
+	map->m_flags = EROFS_MAP_MAPPED;
+	if (offset < erofs_pos(lastblk)) {
+		map->m_pa = erofs_pos(vi->raw_blkaddr) + offset;
+		map->m_plen = erofs_pos(lastblk) - offset;
+	} else if (tailendpacking) {
+		/* The tail follows the inode and must fit in its block */
+		map->m_pa = erofs_iend(vi) + erofs_blkoff(offset);
+		map->m_plen = vi->size - offset;
+		if (erofs_blkoff(map->m_pa) + map->m_plen > erofs_blksiz())
+			return -EFSCORRUPTED;
+		map->m_flags |= EROFS_MAP_META;
+	} else {
+		return -EFSCORRUPTED;
+	}
+	map->m_llen = map->m_plen;
+
+	return 0;
+}
+
+static int erofs_map_blocks_chunk(struct erofs_inode *vi,
+				  struct erofs_map_blocks *map)
+{
+	union {
+		struct erofs_inode_chunk_index idx;
+		__le32 blkaddr;
+	} ci;
+	unsigned int unit;
+	u64 chunknr, pos;
+	u32 blkaddr;
+	int ret;
+
+	if (vi->chunkformat & EROFS_CHUNK_FORMAT_INDEXES)
+		unit = sizeof(ci.idx);
+	else
+		unit = EROFS_BLOCK_MAP_ENTRY_SIZE;
+
+	chunknr = map->m_la >> vi->chunkbits;
+	pos = ALIGN(erofs_iend(vi), unit) + unit * chunknr;
+	ret = erofs_read_meta(&ci, pos, unit);
+	if (ret)
+		return ret;
+	if (unit == EROFS_BLOCK_MAP_ENTRY_SIZE)
+		blkaddr = le32_to_cpu(ci.blkaddr);
+	else
+		blkaddr = le32_to_cpu(ci.idx.blkaddr);
+
+	map->m_la = chunknr << vi->chunkbits;
+	map->m_plen = min_t(u64, 1ULL << vi->chunkbits,
+			    round_up(vi->size - map->m_la, erofs_blksiz()));
+	map->m_llen = map->m_plen;
+	if (blkaddr == (u32)EROFS_NULL_ADDR) {
+		/* A hole */
+		map->m_pa = 0;
+		map->m_flags = 0;
+	} else {
+		map->m_pa = erofs_pos(blkaddr);
+		map->m_flags = EROFS_MAP_MAPPED;
+	}
+
+	return 0;
+}
+
+static int erofs_map_blocks(struct erofs_inode *vi,
+			    struct erofs_map_blocks *map)
+{
+	if (map->m_la >= vi->size)
+		return -EFSCORRUPTED;
+	if (vi->datalayout == EROFS_INODE_CHUNK_BASED)
+		return erofs_map_blocks_chunk(vi, map);
+
+	return erofs_map_blocks_flat(vi, map);
+}
+
+int erofs_pread(struct erofs_inode *vi, void *buf, u64 len, u64 offset)
+{
+	struct erofs_map_blocks map;
+	void *run_buf = NULL;
+	u64 run_pa = 0, run_len = 0;
+	u64 pa, skip, now;
+	int ret;
+
+	if (erofs_inode_is_compressed(vi))
+		return z_erofs_read_data(vi, buf, len, offset);
+
+	/*
+	 * Pieces within a block (directories, inline tails, symlinks) come
+	 * from the metadata cache. Larger ones are read straight into @buf,
+	 * merging chunks which are next to each other on disk.
+	 */
+	while (len) {
+		map.m_la = offset;
+		ret = erofs_map_blocks(vi, &map);
+		if (ret)
+			return ret;
+		skip = offset - map.m_la;
+		now = min(len, map.m_llen - skip);
+		if (!now)
+			return -EFSCORRUPTED;
+		pa = map.m_pa + skip;
+
+		if (!(map.m_flags & EROFS_MAP_MAPPED)) {
+			memset(buf, '\0', now);
+		} else if ((map.m_flags & EROFS_MAP_META) ||
+			   erofs_blkoff(pa) + now <= erofs_blksiz()) {
+			ret = erofs_read_meta(buf, pa, now);
+			if (ret)
+				return ret;
+		} else if (run_len && run_pa + run_len == pa &&
+			   run_buf + run_len == buf) {
+			run_len += now;
+		} else {
+			if (run_len) {
+				ret = erofs_dev_read(run_buf, run_pa, run_len);
+				if (ret)
+					return ret;
+			}
+			run_buf = buf;
+			run_pa = pa;
+			run_len = now;
+		}
+		buf += now;
+		offset += now;
+		len -= now;
+	}
+
+	if (run_len)
+		return erofs_dev_read(run_buf, run_pa, run_len);
+
+	return 0;
+}
@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Reading EROFS compressed files
+ *
+ * Each compressed extent is decompressed as a whole, straight into the
+ * caller's buffer when the read covers it entirely. Extents needed only in
+ * part go through a buffer which is kept, so that reading a file in small
+ * pieces does not decompress the same extent again and again. Compressed
+ * data is read ahead, as consecutive extents are usually stored next to each
+ * other.
+ */
+
+#include <common.h>
+#include <lz4.h>
+#include <malloc.h>
+#include <memalign.h>
+#include "internal.h"
+
+static int z_erofs_decompress(const struct erofs_map_blocks *map,
+			      const u8 *in, u8 *out)
+{
+	unsigned int margin = 0, skip, right;
+	bool padded;
+	int ret;
+
+	switch (map->m_algorithmformat) {
+	case Z_EROFS_COMPRESSION_SHIFTED:
+		if (map->m_llen > map->m_plen)
+			return -EFSCORRUPTED;
+		memcpy(out, in, map->m_llen);
+		return 0;
+	case Z_EROFS_COMPRESSION_INTERLACED:
+		/* The data is rotated to start at the extent's block offset */
+		if (map->m_llen > erofs_blksiz())
+			return -EFSCORRUPTED;
+		skip = erofs_blkoff(map->m_la);
+		right = min_t(u64, erofs_blksiz() - skip, map->m_llen);
+		memcpy(out, in + skip, right);
+		memcpy(out + right, in, map->m_llen - right);
+		return 0;
+	case Z_EROFS_COMPRESSION_LZ4:
+		break;
+	default:
+		printf("EROFS: unsupported compression algorithm %u\n",
+		       map->m_algorithmformat);
+		return -EOPNOTSUPP;
+	}
+
+	/*
+	 * With 0padding the compressed data is aligned to the end of the
+	 * pcluster, so its exact size is known. Otherwise it is followed by
+	 * padding and decompression stops once the extent is complete.
+	 */
+	padded = !erofs_sb_has_lz4_0padding() ||
+		 (map->m_flags & EROFS_MAP_PARTIAL_REF);
+	if (erofs_sb_has_lz4_0padding()) {
+		while (margin < erofs_blksiz() && margin < map->m_plen &&
+		       !in[margin])
+			margin++;
+		if (margin >= map->m_plen)
+			return -EFSCORRUPTED;
+	}
+
+	ret = ulz4_decompress_block(in + margin, map->m_plen - margin, out,
+				    map->m_llen, padded);
+	if (ret != map->m_llen) {
+		debug("%s: extent at %llu: got %d of %llu bytes\n", __func__,
+		      map->m_la, ret, map->m_llen);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * z_erofs_read_raw() - Get the compressed data of an extent
+ *
+ * @pa: Physical address of the data
+ * @len: Length of the data
+ * @ahead: Number of bytes of the file still to be read after this extent,
+ *	used to limit the read-ahead
+ * Return: pointer to the data, or NULL on error
+ */
+static const u8 *z_erofs_read_raw(u64 pa, u64 len, u64 ahead)
+{
+	struct erofs_sb_info *sbi = &erofs_sbi;
+	u64 end = erofs_pos(sbi->blocks);
+	size_t want;
+
+	if (sbi->raw_len && pa >= sbi->raw_pos &&
+	    pa + len <= sbi->raw_pos + sbi->raw_len)
+		return sbi->raw + (pa - sbi->raw_pos);
+
+	/* Compressed data is never larger than the data it holds */
+	want = len + min_t(u64, round_up(ahead, erofs_blksiz()),
+			   EROFS_READAHEAD_SIZE);
+	if (pa + len <= end && pa + want > end)
+		want = end - pa;
+
+	if (want > sbi->raw_size) {
+		free(sbi->raw);
+		sbi->raw_len = 0;
+		sbi->raw_size = 0;
+		sbi->raw = malloc_cache_aligned(want);
+		if (!sbi->raw)
+			return NULL;
+		sbi->raw_size = want;
+	}
+
+	sbi->raw_len = 0;
+	if (erofs_dev_read(sbi->raw, pa, want))
+		return NULL;
+	sbi->raw_pos = pa;
+	sbi->raw_len = want;
+
+	return sbi->raw;
+}
+
+static int z_erofs_read_extent(const struct erofs_map_blocks *map, u8 *buf,
+			       u64 skip, u64 len, u64 ahead)
+{
+	struct erofs_sb_info *sbi = &erofs_sbi;
+	const u8 *in;
+	int ret;
+
+	if (sbi->ext_len && sbi->ext_pa == map->m_pa &&
+	    sbi->ext_la == map->m_la && sbi->ext_len == map->m_llen) {
+		memcpy(buf, sbi->ext + skip, len);
+		return 0;
+	}
+
+	in = z_erofs_read_raw(map->m_pa, map->m_plen, ahead);
+	if (!in)
+		return -EIO;
+
+	if (!skip && len == map->m_llen)
+		return z_erofs_decompress(map, in, buf);
+
+	sbi->ext_len = 0;
+	if (map->m_llen > sbi->ext_size) {
+		free(sbi->ext);
+		sbi->ext_size = 0;
+		sbi->ext = malloc(map->m_llen);
+		if (!sbi->ext)
+			return -ENOMEM;
+		sbi->ext_size = map->m_llen;
+	}
+	ret = z_erofs_decompress(map, in, sbi->ext);
+	if (ret)
+		return ret;
+	sbi->ext_pa = map->m_pa;
+	sbi->ext_la = map->m_la;
+	sbi->ext_len = map->m_llen;
+	memcpy(buf, sbi->ext + skip, len);
+
+	return 0;
+}
+
+int z_erofs_read_data(struct erofs_inode *vi, void *buf, u64 len, u64 offset)
+{
+	struct erofs_map_blocks map;
+	u64 end = offset + len;
+	u64 skip, now;
+	int ret;
+
+	while (offset < end) {
+		map.m_la = offset;
+		ret = z_erofs_map_blocks(vi, &map);
+		if (ret)
+			return ret;
+
+		skip = offset - map.m_la;
+		now = min(end - offset, map.m_llen - skip);
+		ret = z_erofs_read_extent(&map, buf, skip, now,
+					  end - offset - now);
+		if (ret)
+			return ret;
+		buf += now;
+		offset += now;
+	}
+
+	return 0;
+}
@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * EROFS filesystem implementation for U-Boot
+ */
+
+#include <common.h>
+#include <erofs.h>
+#include <fs.h>
+#include <malloc.h>
+#include <uuid.h>
+#include <linux/stat.h>
+#include "internal.h"
+
+/**
+ * struct erofs_dir_stream - State of a directory listing
+ *
+ * @parent:	Generic part, must come first
+ * @dirent:	Entry returned by erofs_readdir()
+ * @dir:	Directory being listed
+ * @buf:	Current directory block
+ * @blk:	Number of the block to read next
+ * @len:	Length of the block in @buf
+ * @ndirents:	Number of entries in @buf
+ * @idx:	Index of the next entry in @buf
+ */
+struct erofs_dir_stream {
+	struct fs_dir_stream parent;
+	struct fs_dirent dirent;
+	struct erofs_inode dir;
+	u8 *buf;
+	u64 blk;
+	int len;
+	unsigned int ndirents;
+	unsigned int idx;
+};
+
+int erofs_probe(struct blk_desc *fs_dev_desc, disk_partition_t *fs_partition)
+{
+	int ret;
+
+	erofs_put_super();
+	erofs_sbi.desc = fs_dev_desc;
+	erofs_sbi.part = fs_partition;
+
+	ret = erofs_read_superblock();
+	if (ret) {
+		erofs_put_super();
+		return ret;
+	}
+
+	return 0;
+}
+
+int erofs_opendir(const char *filename, struct fs_dir_stream **dirsp)
+{
+	struct erofs_dir_stream *dirs;
+	int ret;
+
+	dirs = calloc(1, sizeof(*dirs));
+	if (!dirs)
+		return -ENOMEM;
+
+	ret = erofs_lookup(filename, &dirs->dir);
+	if (!ret && !S_ISDIR(dirs->dir.mode))
+		ret = -ENOTDIR;
+	if (!ret) {
+		dirs->buf = malloc(erofs_blksiz());
+		if (!dirs->buf)
+			ret = -ENOMEM;
+	}
+	if (ret) {
+		free(dirs);
+		return ret;
+	}
+
+	*dirsp = &dirs->parent;
+
+	return 0;
+}
+
+int erofs_readdir(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp)
+{
+	struct erofs_dir_stream *dirs = (struct erofs_dir_stream *)fs_dirs;
+	struct fs_dirent *dent = &dirs->dirent;
+	const struct erofs_dirent *de;
+	struct erofs_inode vi;
+	const char *name;
+	int namelen, ret;
+
+	if (dirs->idx == dirs->ndirents) {
+		if (erofs_pos(dirs->blk) >= dirs->dir.size)
+			return -ENOENT;
+		ret = erofs_read_dirblock(&dirs->dir, dirs->blk, dirs->buf);
+		if (ret < 0)
+			return ret;
+		de = (const struct erofs_dirent *)dirs->buf;
+		dirs->len = ret;
+		dirs->ndirents = le16_to_cpu(de->nameoff) / sizeof(*de);
+		dirs->idx = 0;
+		dirs->blk++;
+	}
+
+	de = (const struct erofs_dirent *)dirs->buf + dirs->idx;
+	namelen = erofs_dirent_name(dirs->buf, dirs->len, dirs->idx, &name);
+	if (namelen < 0)
+		return namelen;
+	dirs->idx++;
+
+	memset(dent, '\0', sizeof(*dent));
+	memcpy(dent->name, name, min_t(int, namelen, sizeof(dent->name) - 1));
+	switch (de->file_type) {
+	case EROFS_FT_DIR:
+		dent->type = FS_DT_DIR;
+		break;
+	case EROFS_FT_SYMLINK:
+		dent->type = FS_DT_LNK;
+		break;
+	default:
+		dent->type = FS_DT_REG;
+		break;
+	}
+	if (dent->type != FS_DT_DIR &&
+	    !erofs_read_inode(le64_to_cpu(de->nid), &vi))
+		dent->size = vi.size;
+
+	*dentp = dent;
+
+	return 0;
+}
+
+void erofs_closedir(struct fs_dir_stream *fs_dirs)
+{
+	struct erofs_dir_stream *dirs = (struct erofs_dir_stream *)fs_dirs;
+
+	free(dirs->buf);
+	free(dirs);
+}
+
+int erofs_exists(const char *filename)
+{
+	struct erofs_inode vi;
+
+	return !erofs_lookup(filename, &vi);
+}
+
+int erofs_size(const char *filename, loff_t *size)
+{
+	struct erofs_inode vi;
+	int ret;
+
+	ret = erofs_lookup(filename, &vi);
+	if (ret)
+		return ret;
+
+	*size = vi.size;
+
+	return 0;
+}
+
+int erofs_read(const char *filename, void *buf, loff_t offset, loff_t len,
+	       loff_t *actread)
+{
+	struct erofs_inode vi;
+	int ret;
+
+	ret = erofs_lookup(filename, &vi);
+	if (ret) {
+		printf("** Unable to find file %s **\n", filename);
+		return ret;
+	}
+	if (!S_ISREG(vi.mode)) {
+		printf("** %s is not a regular file **\n", filename);
+		return -EISDIR;
+	}
+
+	if (offset >= vi.size) {
+		*actread = 0;
+		return 0;
+	}
+	if (!len || len > vi.size - offset)
+		len = vi.size - offset;
+
+	ret = erofs_pread(&vi, buf, len, offset);
+	if (ret) {
+		printf("** Unable to read file %s: %d **\n", filename, ret);
+		return ret;
+	}
+	*actread = len;
+
+	return 0;
+}
+
+void erofs_release(void)
+{
+	/* Keep the metadata, drop the large buffers used for file data */
+	free(erofs_sbi.raw);
+	erofs_sbi.raw = NULL;
+	erofs_sbi.raw_size = 0;
+	erofs_sbi.raw_len = 0;
+	free(erofs_sbi.ext);
+	erofs_sbi.ext = NULL;
+	erofs_sbi.ext_size = 0;
+	erofs_sbi.ext_len = 0;
+}
+
+void erofs_close(void)
+{
+	erofs_put_super();
+}
+
+int erofs_uuid(char *uuid_str)
+{
+#ifdef CONFIG_LIB_UUID
+	uuid_bin_to_str(erofs_sbi.uuid, uuid_str, UUID_STR_FORMAT_STD);
+	return 0;
+#endif
+	return -ENOSYS;
+}
@@ -0,0 +1,300 @@
+/* SPDX-License-Identifier: GPL-2.0+ OR Apache-2.0 */
+/*
+ * EROFS (Enhanced Read-Only File System) on-disk format
+ *
+ * Derived from the Linux kernel's fs/erofs/erofs_fs.h. Only what is needed
+ * to read an image is kept.
+ */
+
+#ifndef __EROFS_FS_H
+#define __EROFS_FS_H
+
+#include <linux/types.h>
+
+#define EROFS_SUPER_OFFSET	1024
+#define EROFS_SUPER_MAGIC_V1	0xe0f5e1e2
+
+#define EROFS_FEATURE_INCOMPAT_ZERO_PADDING	0x00000001
+#define EROFS_FEATURE_INCOMPAT_COMPR_CFGS	0x00000002
+#define EROFS_FEATURE_INCOMPAT_BIG_PCLUSTER	0x00000002
+#define EROFS_FEATURE_INCOMPAT_CHUNKED_FILE	0x00000004
+#define EROFS_FEATURE_INCOMPAT_DEVICE_TABLE	0x00000008
+#define EROFS_FEATURE_INCOMPAT_COMPR_HEAD2	0x00000008
+#define EROFS_FEATURE_INCOMPAT_ZTAILPACKING	0x00000010
+#define EROFS_FEATURE_INCOMPAT_FRAGMENTS	0x00000020
+#define EROFS_FEATURE_INCOMPAT_DEDUPE		0x00000020
+#define EROFS_FEATURE_INCOMPAT_XATTR_PREFIXES	0x00000040
+#define EROFS_ALL_FEATURE_INCOMPAT		\
+	(EROFS_FEATURE_INCOMPAT_ZERO_PADDING |	\
+	 EROFS_FEATURE_INCOMPAT_COMPR_CFGS |	\
+	 EROFS_FEATURE_INCOMPAT_BIG_PCLUSTER |	\
+	 EROFS_FEATURE_INCOMPAT_CHUNKED_FILE |	\
+	 EROFS_FEATURE_INCOMPAT_DEVICE_TABLE |	\
+	 EROFS_FEATURE_INCOMPAT_COMPR_HEAD2 |	\
+	 EROFS_FEATURE_INCOMPAT_ZTAILPACKING |	\
+	 EROFS_FEATURE_INCOMPAT_FRAGMENTS |	\
+	 EROFS_FEATURE_INCOMPAT_DEDUPE |	\
+	 EROFS_FEATURE_INCOMPAT_XATTR_PREFIXES)
+
+/* 128-byte erofs on-disk super block */
+struct erofs_super_block {
+	__le32 magic;		/* file system magic number */
+	__le32 checksum;	/* crc32c(super_block) */
+	__le32 feature_compat;
+	__u8 blkszbits;		/* filesystem block size in bit shift */
+	__u8 sb_extslots;	/* superblock size = 128 + sb_extslots * 16 */
+
+	__le16 root_nid;	/* nid of root directory */
+	__le64 inos;		/* total valid ino # (== f_files - f_favail) */
+
+	__le64 build_time;	/* compact inode time derivation */
+	__le32 build_time_nsec;	/* compact inode time derivation in ns scale */
+	__le32 blocks;		/* used for statfs */
+	__le32 meta_blkaddr;	/* start block address of metadata area */
+	__le32 xattr_blkaddr;	/* start block address of shared xattr area */
+	__u8 uuid[16];		/* 128-bit uuid for volume */
+	__u8 volume_name[16];	/* volume name */
+	__le32 feature_incompat;
+	__le16 available_compr_algs;
+	__le16 extra_devices;	/* # of devices besides the primary device */
+	__le16 devt_slotoff;	/* startoff = devt_slotoff * devt_slotsize */
+	__u8 dirblkbits;	/* directory block size in bit shift */
+	__u8 xattr_prefix_count;
+	__le32 xattr_prefix_start;
+	__le64 packed_nid;	/* nid of the special packed inode */
+	__u8 reserved2[24];
+} __packed;
+
+/*
+ * EROFS inode datalayout (i_format bits 1-3):
+ * 0 - uncompressed flat inode without tail-packing inline data;
+ * 1 - compressed inode with non-compact indexes;
+ * 2 - uncompressed flat inode with tail-packing inline data;
+ * 3 - compressed inode with compact indexes;
+ * 4 - chunk-based inode with (optional) multi-device support.
+ */
+enum {
+	EROFS_INODE_FLAT_PLAIN			= 0,
+	EROFS_INODE_COMPRESSED_FULL		= 1,
+	EROFS_INODE_FLAT_INLINE			= 2,
+	EROFS_INODE_COMPRESSED_COMPACT		= 3,
+	EROFS_INODE_CHUNK_BASED			= 4,
+	EROFS_INODE_DATALAYOUT_MAX
+};
+
+/* bit definitions of inode i_format */
+#define EROFS_I_VERSION_MASK		0x01
+#define EROFS_I_DATALAYOUT_MASK		0x07
+#define EROFS_I_VERSION_BIT		0
+#define EROFS_I_DATALAYOUT_BIT		1
+
+/* indicate chunk blkbits, thus 'chunksize = blocksize << chunk blkbits' */
+#define EROFS_CHUNK_FORMAT_BLKBITS_MASK		0x001f
+/* with chunk indexes or just a 4-byte blkaddr array */
+#define EROFS_CHUNK_FORMAT_INDEXES		0x0020
+
+#define EROFS_NULL_ADDR			-1
+
+/* 32-byte reduced form of an ondisk inode */
+struct erofs_inode_compact {
+	__le16 i_format;	/* inode format hints */
+	__le16 i_xattr_icount;
+	__le16 i_mode;
+	__le16 i_nlink;
+	__le32 i_size;
+	__le32 i_reserved;
+	union {
+		/* total compressed blocks for compressed inodes */
+		__le32 compressed_blocks;
+		/* block address for uncompressed flat inodes */
+		__le32 raw_blkaddr;
+		/* for device files, used to indicate old/new device # */
+		__le32 rdev;
+		/* for chunk-based files, it contains the summary info */
+		__le16 chunk_format;
+	} i_u;
+	__le32 i_ino;
+	__le16 i_uid;
+	__le16 i_gid;
+	__le32 i_reserved2;
+} __packed;
+
+/* 64-byte complete form of an ondisk inode */
+struct erofs_inode_extended {
+	__le16 i_format;	/* inode format hints */
+	__le16 i_xattr_icount;
+	__le16 i_mode;
+	__le16 i_reserved;
+	__le64 i_size;
+	union {
+		__le32 compressed_blocks;
+		__le32 raw_blkaddr;
+		__le32 rdev;
+		__le16 chunk_format;
+	} i_u;
+	__le32 i_ino;
+	__le32 i_uid;
+	__le32 i_gid;
+	__le64 i_mtime;
+	__le32 i_mtime_nsec;
+	__le32 i_nlink;
+	__u8   i_reserved2[16];
+} __packed;
+
+/* inline xattrs: a 12-byte header followed by 4-byte slots */
+#define EROFS_XATTR_IBODY_HEADER_SIZE	12
+#define EROFS_XATTR_ENTRY_SIZE		4
+
+/* 4-byte block address array */
+#define EROFS_BLOCK_MAP_ENTRY_SIZE	4
+
+/* 8-byte inode chunk indexes */
+struct erofs_inode_chunk_index {
+	__le16 advise;		/* always 0, don't care for now */
+	__le16 device_id;	/* back-end storage id (with bits masked) */
+	__le32 blkaddr;		/* start block address of this inode chunk */
+} __packed;
+
+/* erofs inodes are addressed in 32-byte slots within the metadata area */
+#define EROFS_ISLOTBITS		5
+
+/* erofs dirent file types */
+enum {
+	EROFS_FT_UNKNOWN,
+	EROFS_FT_REG_FILE,
+	EROFS_FT_DIR,
+	EROFS_FT_CHRDEV,
+	EROFS_FT_BLKDEV,
+	EROFS_FT_FIFO,
+	EROFS_FT_SOCK,
+	EROFS_FT_SYMLINK,
+	EROFS_FT_MAX
+};
+
+/*
+ * Directory blocks start with an array of dirents, followed by the names
+ * they point to. Names are not NUL-terminated unless they are the last in
+ * a block and followed by padding.
+ */
+struct erofs_dirent {
+	__le64 nid;	/* node number */
+	__le16 nameoff;	/* start offset of file name */
+	__u8 file_type;	/* file type */
+	__u8 reserved;	/* reserved */
+} __packed;
+
+#define EROFS_NAME_LEN	255
+
+/* available compression algorithm types (for h_algorithmtype) */
+enum {
+	Z_EROFS_COMPRESSION_LZ4		= 0,
+	Z_EROFS_COMPRESSION_LZMA	= 1,
+	Z_EROFS_COMPRESSION_DEFLATE	= 2,
+	Z_EROFS_COMPRESSION_ZSTD	= 3,
+	Z_EROFS_COMPRESSION_MAX
+};
+
+/* pseudo algorithms for uncompressed pclusters */
+#define Z_EROFS_COMPRESSION_SHIFTED	Z_EROFS_COMPRESSION_MAX
+#define Z_EROFS_COMPRESSION_INTERLACED	(Z_EROFS_COMPRESSION_MAX + 1)
+
+/*
+ * bit 0 : COMPACTED_2B indexes (0 - off; 1 - on)
+ *  e.g. for 4k logical cluster size,      4B        if compacted 2B is off;
+ *                                  (4B) + 2B + (4B) if compacted 2B is on.
+ * bit 1 : HEAD1 big pcluster (0 - off; 1 - on)
+ * bit 2 : HEAD2 big pcluster (0 - off; 1 - on)
+ * bit 3 : tailpacking inline pcluster (0 - off; 1 - on)
+ * bit 4 : interlaced plain pcluster (0 - off; 1 - on)
+ * bit 5 : fragment pcluster (0 - off; 1 - on)
+ */
+#define Z_EROFS_ADVISE_COMPACTED_2B		0x0001
+#define Z_EROFS_ADVISE_BIG_PCLUSTER_1		0x0002
+#define Z_EROFS_ADVISE_BIG_PCLUSTER_2		0x0004
+#define Z_EROFS_ADVISE_INLINE_PCLUSTER		0x0008
+#define Z_EROFS_ADVISE_INTERLACED_PCLUSTER	0x0010
+#define Z_EROFS_ADVISE_FRAGMENT_PCLUSTER	0x0020
+
+#define Z_EROFS_FRAGMENT_INODE_BIT		7
+
+struct z_erofs_map_header {
+	__le32	h_fragmentoff;
+	__le16	h_advise;
+	/*
+	 * bit 0-3 : algorithm type of head 1 (logical cluster type 01);
+	 * bit 4-7 : algorithm type of head 2 (logical cluster type 11).
+	 */
+	__u8	h_algorithmtype;
+	/*
+	 * bit 0-2 : logical cluster bits - 12, e.g. 0 for 4096;
+	 * bit 3-6 : reserved;
+	 * bit 7   : move the whole file into packed inode or not.
+	 */
+	__u8	h_clusterbits;
+} __packed;
+
+/*
+ * On-disk logical cluster type:
+ *    0   - literal (uncompressed) lcluster
+ *    1,3 - compressed lcluster (for HEAD lclusters)
+ *    2   - compressed lcluster (for NONHEAD lclusters)
+ *
+ * In detail,
+ *    0 - literal (uncompressed) lcluster,
+ *        di_advise = 0
+ *        di_clusterofs = the literal data offset of the lcluster
+ *        di_blkaddr = the blkaddr of the literal pcluster
+ *
+ *    1,3 - compressed lcluster (for HEAD lclusters)
+ *        di_advise = 1 or 3
+ *        di_clusterofs = the decompressed data offset of the lcluster
+ *        di_blkaddr = the blkaddr of the compressed pcluster
+ *
+ *    2 - compressed lcluster (for NONHEAD lclusters)
+ *        di_advise = 2
+ *        di_clusterofs =
+ *           the decompressed data offset in its own HEAD lcluster
+ *        di_u.delta[0] = distance to this HEAD lcluster
+ *        di_u.delta[1] = distance to the next HEAD lcluster
+ */
+enum {
+	Z_EROFS_LCLUSTER_TYPE_PLAIN	= 0,
+	Z_EROFS_LCLUSTER_TYPE_HEAD1	= 1,
+	Z_EROFS_LCLUSTER_TYPE_NONHEAD	= 2,
+	Z_EROFS_LCLUSTER_TYPE_HEAD2	= 3,
+	Z_EROFS_LCLUSTER_TYPE_MAX
+};
+
+#define Z_EROFS_LI_LCLUSTER_TYPE_MASK	(Z_EROFS_LCLUSTER_TYPE_MAX - 1)
+
+/* (noncompact only, HEAD) This pcluster refers to partial decompressed data */
+#define Z_EROFS_LI_PARTIAL_REF		(1 << 15)
+
+/*
+ * D0_CBLKCNT will be marked _only_ at the 1st non-head lcluster to store
+ * the compressed block count of a compressed extent (in logical clusters).
+ */
+#define Z_EROFS_LI_D0_CBLKCNT		(1 << 11)
+
+struct z_erofs_lcluster_index {
+	__le16 di_advise;
+	/* where to decompress in the head lcluster */
+	__le16 di_clusterofs;
+
+	union {
+		/* for the HEAD lclusters */
+		__le32 blkaddr;
+		/*
+		 * for the NONHEAD lclusters
+		 * [0] - distance to its HEAD lcluster
+		 * [1] - distance to the next HEAD lcluster
+		 */
+		__le16 delta[2];
+	} di_u;
+} __packed;
+
+/* full indexes follow the map header after 8 bytes of padding */
+#define Z_EROFS_FULL_INDEX_ALIGN(end)	\
+	(ALIGN(end, 8) + sizeof(struct z_erofs_map_header) + 8)
+
+#endif /* __EROFS_FS_H */
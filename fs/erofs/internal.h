@@ -0,0 +1,205 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * EROFS filesystem implementation for U-Boot
+ */
+
+#ifndef __EROFS_INTERNAL_H
+#define __EROFS_INTERNAL_H
+
+#include <common.h>
+#include <blk.h>
+#include <part.h>
+#include <linux/errno.h>
+#include <linux/sizes.h>
+#include "erofs_fs.h"
+
+#define EFSCORRUPTED	EUCLEAN
+
+/* Number of metadata blocks kept in memory */
+#define EROFS_META_CACHE_SLOTS	4
+/* Compressed data is read ahead in chunks of this size */
+#define EROFS_READAHEAD_SIZE	SZ_128K
+/* Maximum number of symlinks followed while resolving a path */
+#define EROFS_MAX_SYMLINK_NEST	8
+
+/**
+ * struct erofs_metabuf - A cached metadata block
+ *
+ * @blkaddr:	Block number, only meaningful if @data is not NULL
+ * @data:	Contents of the block
+ */
+struct erofs_metabuf {
+	u32 blkaddr;
+	void *data;
+};
+
+/**
+ * struct erofs_sb_info - State of the mounted file system
+ *
+ * @desc:		Device holding the file system
+ * @part:		Partition holding the file system
+ * @blkszbits:		log2 of the block size
+ * @root_nid:		Node number of the root directory
+ * @blocks:		Size of the file system in blocks
+ * @meta_blkaddr:	First block of the metadata area, where inodes live
+ * @feature_incompat:	EROFS_FEATURE_INCOMPAT_... flags
+ * @uuid:		UUID of the file system
+ * @meta:		Recently used metadata blocks
+ * @meta_next:		Slot of @meta to reuse next
+ * @raw:		Read-ahead window of raw (compressed) data
+ * @raw_size:		Size of @raw
+ * @raw_pos:		Byte address of @raw on the partition
+ * @raw_len:		Number of valid bytes in @raw
+ * @ext:		Last extent decompressed into a buffer
+ * @ext_size:		Size of @ext
+ * @ext_pa:		Physical address of the extent in @ext
+ * @ext_la:		Logical address of the extent in @ext
+ * @ext_len:		Length of the extent in @ext, 0 if none
+ */
+struct erofs_sb_info {
+	struct blk_desc *desc;
+	disk_partition_t *part;
+
+	u8 blkszbits;
+	u16 root_nid;
+	u32 blocks;
+	u32 meta_blkaddr;
+	u32 feature_incompat;
+	u8 uuid[16];
+
+	struct erofs_metabuf meta[EROFS_META_CACHE_SLOTS];
+	unsigned int meta_next;
+
+	u8 *raw;
+	size_t raw_size;
+	u64 raw_pos;
+	size_t raw_len;
+
+	u8 *ext;
+	size_t ext_size;
+	u64 ext_pa;
+	u64 ext_la;
+	size_t ext_len;
+};
+
+extern struct erofs_sb_info erofs_sbi;
+
+#define erofs_blksiz()		(1U << erofs_sbi.blkszbits)
+#define erofs_blknr(addr)	((u32)((addr) >> erofs_sbi.blkszbits))
+#define erofs_blkoff(addr)	((addr) & (erofs_blksiz() - 1))
+#define erofs_pos(blk)		((u64)(blk) << erofs_sbi.blkszbits)
+
+static inline bool erofs_sb_has_lz4_0padding(void)
+{
+	return erofs_sbi.feature_incompat & EROFS_FEATURE_INCOMPAT_ZERO_PADDING;
+}
+
+static inline bool erofs_sb_has_big_pcluster(void)
+{
+	return erofs_sbi.feature_incompat & EROFS_FEATURE_INCOMPAT_BIG_PCLUSTER;
+}
+
+/**
+ * struct erofs_inode - An inode read from disk
+ *
+ * @nid:		Node number
+ * @datalayout:		EROFS_INODE_... layout of the data
+ * @inode_isize:	Size of the on-disk inode
+ * @xattr_isize:	Size of the inline extended attributes
+ * @mode:		File type and permissions
+ * @size:		Size of the file in bytes
+ * @raw_blkaddr:	First data block of flat inodes
+ * @chunkformat:	EROFS_CHUNK_FORMAT_... flags of chunk-based inodes
+ * @chunkbits:		log2 of the chunk size of chunk-based inodes
+ * @z_inited:		The z_... fields below have been read
+ * @z_advise:		Z_EROFS_ADVISE_... flags of compressed inodes
+ * @z_algorithmtype:	Z_EROFS_COMPRESSION_... for HEAD1 and HEAD2 clusters
+ * @z_logical_clusterbits: log2 of the logical cluster size
+ */
+struct erofs_inode {
+	u64 nid;
+	u8 datalayout;
+	u8 inode_isize;
+	u16 xattr_isize;
+	u16 mode;
+	u64 size;
+
+	union {
+		u32 raw_blkaddr;
+		struct {
+			u16 chunkformat;
+			u8 chunkbits;
+		};
+	};
+
+	bool z_inited;
+	u16 z_advise;
+	u8 z_algorithmtype[2];
+	u8 z_logical_clusterbits;
+};
+
+static inline u64 erofs_iloc(const struct erofs_inode *vi)
+{
+	return erofs_pos(erofs_sbi.meta_blkaddr) + (vi->nid << EROFS_ISLOTBITS);
+}
+
+/* Address of the first byte after the inode and its inline xattrs */
+static inline u64 erofs_iend(const struct erofs_inode *vi)
+{
+	return erofs_iloc(vi) + vi->inode_isize + vi->xattr_isize;
+}
+
+static inline bool erofs_inode_is_compressed(const struct erofs_inode *vi)
+{
+	return vi->datalayout == EROFS_INODE_COMPRESSED_FULL ||
+	       vi->datalayout == EROFS_INODE_COMPRESSED_COMPACT;
+}
+
+#define EROFS_MAP_MAPPED	BIT(0)	/* the extent has data on disk */
+#define EROFS_MAP_META		BIT(1)	/* the data is inline in the inode */
+#define EROFS_MAP_ENCODED	BIT(2)	/* the data is compressed */
+#define EROFS_MAP_PARTIAL_REF	BIT(3)	/* uses part of a compressed extent */
+
+/**
+ * struct erofs_map_blocks - Where a part of a file is stored
+ *
+ * @m_la:	Logical (file) address of the extent
+ * @m_pa:	Physical (partition) address of the extent
+ * @m_llen:	Logical length of the extent
+ * @m_plen:	Physical length of the extent
+ * @m_flags:	EROFS_MAP_... flags
+ * @m_algorithmformat: Z_EROFS_COMPRESSION_... of compressed extents
+ */
+struct erofs_map_blocks {
+	u64 m_la;
+	u64 m_pa;
+	u64 m_llen;
+	u64 m_plen;
+	unsigned int m_flags;
+	u8 m_algorithmformat;
+};
+
+/* super.c */
+int erofs_dev_read(void *buf, u64 offset, size_t len);
+const void *erofs_read_metabuf(u32 blkaddr);
+int erofs_read_meta(void *buf, u64 pos, size_t len);
+int erofs_read_superblock(void);
+void erofs_put_super(void);
+
+/* data.c */
+int erofs_read_inode(u64 nid, struct erofs_inode *vi);
+int erofs_pread(struct erofs_inode *vi, void *buf, u64 len, u64 offset);
+
+/* zmap.c */
+int z_erofs_map_blocks(struct erofs_inode *vi, struct erofs_map_blocks *map);
+
+/* decompress.c */
+int z_erofs_read_data(struct erofs_inode *vi, void *buf, u64 len, u64 offset);
+
+/* namei.c */
+int erofs_read_dirblock(struct erofs_inode *dir, u64 blk, void *buf);
+int erofs_dirent_name(const void *buf, unsigned int len, unsigned int i,
+		      const char **name);
+int erofs_lookup(const char *path, struct erofs_inode *vi);
+
+#endif /* __EROFS_INTERNAL_H */
@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * EROFS directories and path lookup
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/stat.h>
+#include "internal.h"
+
+int erofs_read_dirblock(struct erofs_inode *dir, u64 blk, void *buf)
+{
+	const struct erofs_dirent *de = buf;
+	unsigned int nameoff;
+	u64 pos = erofs_pos(blk);
+	int len, ret;
+
+	if (pos >= dir->size)
+		return -EFSCORRUPTED;
+	len = min_t(u64, erofs_blksiz(), dir->size - pos);
+	ret = erofs_pread(dir, buf, len, pos);
+	if (ret)
+		return ret;
+
+	nameoff = le16_to_cpu(de->nameoff);
+	if (nameoff < sizeof(*de) || nameoff >= len ||
+	    nameoff % sizeof(*de))
+		return -EFSCORRUPTED;
+
+	return len;
+}
+
+int erofs_dirent_name(const void *buf, unsigned int len, unsigned int i,
+		      const char **name)
+{
+	const struct erofs_dirent *de = buf;
+	unsigned int ndirents = le16_to_cpu(de->nameoff) / sizeof(*de);
+	unsigned int nameoff, end;
+
+	nameoff = le16_to_cpu(de[i].nameoff);
+	/* Only the last name in a block may be NUL-terminated */
+	if (i + 1 < ndirents)
+		end = le16_to_cpu(de[i + 1].nameoff);
+	else
+		end = len;
+	if (nameoff >= end || end > len)
+		return -EFSCORRUPTED;
+
+	*name = buf + nameoff;
+	if (i + 1 < ndirents)
+		return end - nameoff;
+
+	return strnlen(*name, end - nameoff);
+}
+
+static int erofs_dirnamecmp(const char *name, unsigned int len,
+			    const char *dname, unsigned int dlen)
+{
+	int diff;
+
+	diff = memcmp(name, dname, min(len, dlen));
+	if (diff)
+		return diff;
+
+	return (int)len - (int)dlen;
+}
+
+/**
+ * erofs_find_dirent() - Binary search for a name in a directory block
+ *
+ * @buf: Directory block
+ * @len: Length of the block
+ * @name: Name to look for
+ * @namelen: Length of @name
+ * Return: index of the entry, -ENOENT if it is not there, or other -ve
+ *	value on error
+ */
+static int erofs_find_dirent(const void *buf, unsigned int len,
+			     const char *name, unsigned int namelen)
+{
+	const struct erofs_dirent *de = buf;
+	int head = 0, back = le16_to_cpu(de->nameoff) / sizeof(*de) - 1;
+	const char *dname;
+	int mid, dlen, diff;
+
+	while (head <= back) {
+		mid = head + (back - head) / 2;
+		dlen = erofs_dirent_name(buf, len, mid, &dname);
+		if (dlen < 0)
+			return dlen;
+		diff = erofs_dirnamecmp(name, namelen, dname, dlen);
+		if (!diff)
+			return mid;
+		if (diff < 0)
+			back = mid - 1;
+		else
+			head = mid + 1;
+	}
+
+	return -ENOENT;
+}
+
+/**
+ * erofs_namei() - Look up a name in a directory
+ *
+ * Names are sorted across the whole directory, so the block which may hold
+ * @name is found by a binary search on the first name of each block.
+ *
+ * @dir: Directory
+ * @name: Name to look for, need not be NUL-terminated
+ * @namelen: Length of @name
+ * @nid: Returns the node number of the entry
+ * Return: 0 if OK, -ENOENT if not found, other -ve value on error
+ */
+static int erofs_namei(struct erofs_inode *dir, const char *name,
+		       unsigned int namelen, u64 *nid)
+{
+	const struct erofs_dirent *de;
+	long head = 0, back, mid, found = -1;
+	const char *dname;
+	int len, dlen, diff, ret;
+	u8 *buf;
+
+	buf = malloc(erofs_blksiz());
+	if (!buf)
+		return -ENOMEM;
+	de = (const void *)buf;
+
+	back = DIV_ROUND_UP(dir->size, erofs_blksiz()) - 1;
+	while (head <= back) {
+		mid = head + (back - head) / 2;
+		len = erofs_read_dirblock(dir, mid, buf);
+		if (len < 0) {
+			ret = len;
+			goto out;
+		}
+		dlen = erofs_dirent_name(buf, len, 0, &dname);
+		if (dlen < 0) {
+			ret = dlen;
+			goto out;
+		}
+		diff = erofs_dirnamecmp(name, namelen, dname, dlen);
+		if (!diff) {
+			*nid = le64_to_cpu(de->nid);
+			ret = 0;
+			goto out;
+		}
+		if (diff < 0) {
+			back = mid - 1;
+		} else {
+			found = mid;
+			head = mid + 1;
+		}
+	}
+
+	ret = -ENOENT;
+	if (found < 0)
+		goto out;
+
+	/* The buffer may hold another block by now */
+	len = erofs_read_dirblock(dir, found, buf);
+	if (len < 0) {
+		ret = len;
+		goto out;
+	}
+	ret = erofs_find_dirent(buf, len, name, namelen);
+	if (ret >= 0) {
+		*nid = le64_to_cpu(de[ret].nid);
+		ret = 0;
+	}
+out:
+	free(buf);
+
+	return ret;
+}
+
+static int erofs_lookup_at(u64 dir_nid, const char *path,
+			   struct erofs_inode *vi, int nest)
+{
+	unsigned int len;
+	u64 parent, nid;
+	char *target;
+	int ret;
+
+	ret = erofs_read_inode(*path == '/' ? erofs_sbi.root_nid : dir_nid,
+			       vi);
+	if (ret)
+		return ret;
+
+	for (;;) {
+		while (*path == '/')
+			path++;
+		if (!*path)
+			return 0;
+
+		len = strcspn(path, "/");
+		if (len > EROFS_NAME_LEN)
+			return -ENAMETOOLONG;
+		if (!S_ISDIR(vi->mode))
+			return -ENOTDIR;
+
+		parent = vi->nid;
+		ret = erofs_namei(vi, path, len, &nid);
+		if (ret)
+			return ret;
+		ret = erofs_read_inode(nid, vi);
+		if (ret)
+			return ret;
+		path += len;
+
+		if (!S_ISLNK(vi->mode))
+			continue;
+
+		/* Symlinks are followed relative to their directory */
+		if (nest >= EROFS_MAX_SYMLINK_NEST)
+			return -ELOOP;
+		if (vi->size > SZ_4K)
+			return -ENAMETOOLONG;
+		target = malloc(vi->size + 1);
+		if (!target)
+			return -ENOMEM;
+		ret = erofs_pread(vi, target, vi->size, 0);
+		if (!ret) {
+			target[vi->size] = '\0';
+			ret = erofs_lookup_at(parent, target, vi, nest + 1);
+		}
+		free(target);
+		if (ret)
+			return ret;
+	}
+}
+
+int erofs_lookup(const char *path, struct erofs_inode *vi)
+{
+	return erofs_lookup_at(erofs_sbi.root_nid, path, vi, 0);
+}
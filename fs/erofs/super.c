@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * EROFS superblock and raw device access
+ */
+
+#include <common.h>
+#include <fs_internal.h>
+#include <malloc.h>
+#include <memalign.h>
+#include "internal.h"
+
+struct erofs_sb_info erofs_sbi;
+
+/* fs_devread() takes an int length */
+#define EROFS_MAX_DEVREAD	SZ_1G
+
+int erofs_dev_read(void *buf, u64 offset, size_t len)
+{
+	struct blk_desc *desc = erofs_sbi.desc;
+	size_t now;
+
+	while (len) {
+		now = min_t(size_t, len, EROFS_MAX_DEVREAD);
+		if (!fs_devread(desc, erofs_sbi.part, offset >> desc->log2blksz,
+				offset & (desc->blksz - 1), now, buf))
+			return -EIO;
+		buf += now;
+		offset += now;
+		len -= now;
+	}
+
+	return 0;
+}
+
+const void *erofs_read_metabuf(u32 blkaddr)
+{
+	struct erofs_metabuf *mb;
+	int i;
+
+	for (i = 0, mb = erofs_sbi.meta; i < EROFS_META_CACHE_SLOTS; i++, mb++) {
+		if (mb->data && mb->blkaddr == blkaddr)
+			return mb->data;
+	}
+
+	mb = &erofs_sbi.meta[erofs_sbi.meta_next];
+	if (!mb->data) {
+		mb->data = malloc_cache_aligned(erofs_blksiz());
+		if (!mb->data)
+			return NULL;
+	}
+	if (erofs_dev_read(mb->data, erofs_pos(blkaddr), erofs_blksiz())) {
+		free(mb->data);
+		mb->data = NULL;
+		return NULL;
+	}
+	mb->blkaddr = blkaddr;
+	erofs_sbi.meta_next = (erofs_sbi.meta_next + 1) % EROFS_META_CACHE_SLOTS;
+
+	return mb->data;
+}
+
+int erofs_read_meta(void *buf, u64 pos, size_t len)
+{
+	const void *data;
+	size_t now;
+
+	while (len) {
+		data = erofs_read_metabuf(erofs_blknr(pos));
+		if (!data)
+			return -EIO;
+		now = min_t(size_t, len, erofs_blksiz() - erofs_blkoff(pos));
+		memcpy(buf, data + erofs_blkoff(pos), now);
+		buf += now;
+		pos += now;
+		len -= now;
+	}
+
+	return 0;
+}
+
+int erofs_read_superblock(void)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct erofs_super_block, dsb, 1);
+	u32 incompat;
+
+	if (erofs_dev_read(dsb, EROFS_SUPER_OFFSET, sizeof(*dsb)))
+		return -EIO;
+
+	if (le32_to_cpu(dsb->magic) != EROFS_SUPER_MAGIC_V1)
+		return -EINVAL;
+
+	/* Larger blocks would need bigger index and directory handling */
+	if (dsb->blkszbits < 9 || dsb->blkszbits > 16) {
+		printf("EROFS: unsupported block size %u\n",
+		       1U << dsb->blkszbits);
+		return -EINVAL;
+	}
+
+	incompat = le32_to_cpu(dsb->feature_incompat);
+	if (incompat & ~EROFS_ALL_FEATURE_INCOMPAT) {
+		printf("EROFS: unsupported features %#x\n",
+		       incompat & ~EROFS_ALL_FEATURE_INCOMPAT);
+		return -EINVAL;
+	}
+	if (le16_to_cpu(dsb->extra_devices)) {
+		printf("EROFS: multiple devices are not supported\n");
+		return -EINVAL;
+	}
+
+	erofs_sbi.blkszbits = dsb->blkszbits;
+	erofs_sbi.root_nid = le16_to_cpu(dsb->root_nid);
+	erofs_sbi.blocks = le32_to_cpu(dsb->blocks);
+	erofs_sbi.meta_blkaddr = le32_to_cpu(dsb->meta_blkaddr);
+	erofs_sbi.feature_incompat = incompat;
+	memcpy(erofs_sbi.uuid, dsb->uuid, sizeof(erofs_sbi.uuid));
+
+	return 0;
+}
+
+void erofs_put_super(void)
+{
+	int i;
+
+	for (i = 0; i < EROFS_META_CACHE_SLOTS; i++)
+		free(erofs_sbi.meta[i].data);
+	free(erofs_sbi.raw);
+	free(erofs_sbi.ext);
+	memset(&erofs_sbi, '\0', sizeof(erofs_sbi));
+}
@@ -0,0 +1,537 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Mapping of EROFS compressed files
+ *
+ * Derived from the Linux kernel's fs/erofs/zmap.c. Compressed files are
+ * split into logical clusters, each described by an index entry which is
+ * either full (8 bytes) or compact (packs of 2 or 4 bytes per cluster). An
+ * extent starts at a HEAD cluster and covers the following NONHEAD ones.
+ */
+
+#include <common.h>
+#include <asm/unaligned.h>
+#include <linux/log2.h>
+#include "internal.h"
+
+/**
+ * struct z_erofs_maprecorder - State of a walk through the index
+ *
+ * @vi:		Inode being mapped
+ * @map:	Result of the mapping
+ * @kaddr:	Metadata block holding the current index entry
+ * @lcn:	Logical cluster number of the current entry
+ * @type:	Z_EROFS_LCLUSTER_TYPE_... of the current entry
+ * @headtype:	Z_EROFS_LCLUSTER_TYPE_... of the HEAD entry of the extent
+ * @clusterofs:	Offset of the extent start in the current cluster
+ * @delta:	Distances to the previous and next HEAD clusters
+ * @pblk:	Physical block of HEAD clusters
+ * @compressedblks: Number of compressed blocks, if known
+ * @partialref:	The extent uses part of the decompressed data
+ */
+struct z_erofs_maprecorder {
+	struct erofs_inode *vi;
+	struct erofs_map_blocks *map;
+	const u8 *kaddr;
+
+	unsigned long lcn;
+	u8 type, headtype;
+	u16 clusterofs;
+	u16 delta[2];
+	u32 pblk, compressedblks;
+	bool partialref;
+};
+
+static int z_erofs_fill_inode_lazy(struct erofs_inode *vi)
+{
+	struct z_erofs_map_header h;
+	int ret;
+
+	if (vi->z_inited)
+		return 0;
+
+	ret = erofs_read_meta(&h, ALIGN(erofs_iend(vi), 8), sizeof(h));
+	if (ret)
+		return ret;
+
+	/* The whole file is stored in the packed inode */
+	if (h.h_clusterbits >> Z_EROFS_FRAGMENT_INODE_BIT)
+		return -EOPNOTSUPP;
+
+	vi->z_advise = le16_to_cpu(h.h_advise);
+	vi->z_algorithmtype[0] = h.h_algorithmtype & 15;
+	vi->z_algorithmtype[1] = h.h_algorithmtype >> 4;
+	vi->z_logical_clusterbits = erofs_sbi.blkszbits + (h.h_clusterbits & 7);
+
+	if (vi->z_advise & (Z_EROFS_ADVISE_INLINE_PCLUSTER |
+			    Z_EROFS_ADVISE_FRAGMENT_PCLUSTER)) {
+		printf("EROFS: tail packing and fragments are not supported\n");
+		return -EOPNOTSUPP;
+	}
+	if (!erofs_sb_has_big_pcluster() &&
+	    vi->z_advise & (Z_EROFS_ADVISE_BIG_PCLUSTER_1 |
+			    Z_EROFS_ADVISE_BIG_PCLUSTER_2))
+		return -EFSCORRUPTED;
+	if (vi->datalayout == EROFS_INODE_COMPRESSED_COMPACT &&
+	    !(vi->z_advise & Z_EROFS_ADVISE_BIG_PCLUSTER_1) ^
+	    !(vi->z_advise & Z_EROFS_ADVISE_BIG_PCLUSTER_2))
+		return -EFSCORRUPTED;
+
+	vi->z_inited = true;
+
+	return 0;
+}
+
+static int z_erofs_reload_indexes(struct z_erofs_maprecorder *m, u64 pos)
+{
+	m->kaddr = erofs_read_metabuf(erofs_blknr(pos));
+	if (!m->kaddr)
+		return -EIO;
+
+	return 0;
+}
+
+static int legacy_load_cluster_from_disk(struct z_erofs_maprecorder *m,
+					 unsigned long lcn)
+{
+	struct erofs_inode *vi = m->vi;
+	const u64 pos = Z_EROFS_FULL_INDEX_ALIGN(erofs_iend(vi)) +
+			lcn * sizeof(struct z_erofs_lcluster_index);
+	const struct z_erofs_lcluster_index *di;
+	unsigned int advise;
+	int ret;
+
+	ret = z_erofs_reload_indexes(m, pos);
+	if (ret)
+		return ret;
+
+	m->lcn = lcn;
+	di = (const void *)(m->kaddr + erofs_blkoff(pos));
+	advise = le16_to_cpu(di->di_advise);
+	m->type = advise & Z_EROFS_LI_LCLUSTER_TYPE_MASK;
+	if (m->type == Z_EROFS_LCLUSTER_TYPE_NONHEAD) {
+		m->clusterofs = 1 << vi->z_logical_clusterbits;
+		m->delta[0] = le16_to_cpu(di->di_u.delta[0]);
+		if (m->delta[0] & Z_EROFS_LI_D0_CBLKCNT) {
+			if (!(vi->z_advise & (Z_EROFS_ADVISE_BIG_PCLUSTER_1 |
+					      Z_EROFS_ADVISE_BIG_PCLUSTER_2)))
+				return -EFSCORRUPTED;
+			m->compressedblks = m->delta[0] &
+					    ~Z_EROFS_LI_D0_CBLKCNT;
+			m->delta[0] = 1;
+		}
+		m->delta[1] = le16_to_cpu(di->di_u.delta[1]);
+	} else {
+		m->partialref = !!(advise & Z_EROFS_LI_PARTIAL_REF);
+		m->clusterofs = le16_to_cpu(di->di_clusterofs);
+		if (m->clusterofs >= 1 << vi->z_logical_clusterbits)
+			return -EFSCORRUPTED;
+		m->pblk = le32_to_cpu(di->di_u.blkaddr);
+	}
+
+	return 0;
+}
+
+static unsigned int decode_compactedbits(unsigned int lobits,
+					 const u8 *in, unsigned int pos,
+					 u8 *type)
+{
+	const unsigned int v = get_unaligned_le32(in + pos / 8) >> (pos & 7);
+	const unsigned int lo = v & ((1 << lobits) - 1);
+
+	*type = (v >> lobits) & 3;
+
+	return lo;
+}
+
+static int get_compacted_la_distance(unsigned int lobits,
+				     unsigned int encodebits,
+				     unsigned int vcnt, const u8 *in, int i)
+{
+	unsigned int lo, d1 = 0;
+	u8 type;
+
+	do {
+		lo = decode_compactedbits(lobits, in, encodebits * i, &type);
+		if (type != Z_EROFS_LCLUSTER_TYPE_NONHEAD)
+			return d1;
+		++d1;
+	} while (++i < vcnt);
+
+	/* vcnt - 1 (Z_EROFS_LCLUSTER_TYPE_NONHEAD) item */
+	if (!(lo & Z_EROFS_LI_D0_CBLKCNT))
+		d1 += lo - 1;
+
+	return d1;
+}
+
+static int unpack_compacted_index(struct z_erofs_maprecorder *m,
+				  unsigned int amortizedshift,
+				  u64 pos, bool lookahead)
+{
+	struct erofs_inode *vi = m->vi;
+	const unsigned int lclusterbits = vi->z_logical_clusterbits;
+	unsigned int vcnt, base, lo, lobits, encodebits, nblk, eofs;
+	bool big_pcluster;
+	const u8 *in;
+	u8 type;
+	int i;
+
+	if (1 << amortizedshift == 4 && lclusterbits <= 14)
+		vcnt = 2;
+	else if (1 << amortizedshift == 2 && lclusterbits == 12)
+		vcnt = 16;
+	else
+		return -EOPNOTSUPP;
+
+	/* Big pclusters need an extra bit in delta[0] for CBLKCNT */
+	big_pcluster = vi->z_advise & Z_EROFS_ADVISE_BIG_PCLUSTER_1;
+	lobits = max(lclusterbits, ilog2(Z_EROFS_LI_D0_CBLKCNT) + 1U);
+	encodebits = ((vcnt << amortizedshift) - sizeof(__le32)) * 8 / vcnt;
+	eofs = erofs_blkoff(pos);
+	base = round_down(eofs, vcnt << amortizedshift);
+	in = m->kaddr + base;
+
+	i = (eofs - base) >> amortizedshift;
+
+	lo = decode_compactedbits(lobits, in, encodebits * i, &type);
+	m->type = type;
+	if (type == Z_EROFS_LCLUSTER_TYPE_NONHEAD) {
+		m->clusterofs = 1 << lclusterbits;
+
+		/* Figure out lookahead_distance: delta[1] if needed */
+		if (lookahead)
+			m->delta[1] = get_compacted_la_distance(lobits,
+								encodebits,
+								vcnt, in, i);
+
+		if (lo & Z_EROFS_LI_D0_CBLKCNT) {
+			if (!big_pcluster)
+				return -EFSCORRUPTED;
+			m->compressedblks = lo & ~Z_EROFS_LI_D0_CBLKCNT;
+			m->delta[0] = 1;
+			return 0;
+		} else if (i + 1 != (int)vcnt) {
+			m->delta[0] = lo;
+			return 0;
+		}
+		/*
+		 * The last lcluster in the pack is special: its lo holds
+		 * delta[1] rather than delta[0], so get delta[0] from the
+		 * previous lcluster.
+		 */
+		lo = decode_compactedbits(lobits, in, encodebits * (i - 1),
+					  &type);
+		if (type != Z_EROFS_LCLUSTER_TYPE_NONHEAD)
+			lo = 0;
+		else if (lo & Z_EROFS_LI_D0_CBLKCNT)
+			lo = 1;
+		m->delta[0] = lo + 1;
+		return 0;
+	}
+	m->clusterofs = lo;
+	m->delta[0] = 0;
+
+	/* Figure out the block address of HEAD lclusters */
+	if (!big_pcluster) {
+		nblk = 1;
+		while (i > 0) {
+			--i;
+			lo = decode_compactedbits(lobits, in, encodebits * i,
+						  &type);
+			if (type == Z_EROFS_LCLUSTER_TYPE_NONHEAD)
+				i -= lo;
+
+			if (i >= 0)
+				++nblk;
+		}
+	} else {
+		nblk = 0;
+		while (i > 0) {
+			--i;
+			lo = decode_compactedbits(lobits, in, encodebits * i,
+						  &type);
+			if (type == Z_EROFS_LCLUSTER_TYPE_NONHEAD) {
+				if (lo & Z_EROFS_LI_D0_CBLKCNT) {
+					--i;
+					nblk += lo & ~Z_EROFS_LI_D0_CBLKCNT;
+					continue;
+				}
+				/* Big pclusters have no plain d0 == 1 */
+				if (lo <= 1)
+					return -EFSCORRUPTED;
+				i -= lo - 2;
+				continue;
+			}
+			++nblk;
+		}
+	}
+	in += (vcnt << amortizedshift) - sizeof(__le32);
+	m->pblk = get_unaligned_le32(in) + nblk;
+
+	return 0;
+}
+
+static int compacted_load_cluster_from_disk(struct z_erofs_maprecorder *m,
+					    unsigned long lcn, bool lookahead)
+{
+	struct erofs_inode *vi = m->vi;
+	const u64 ebase = sizeof(struct z_erofs_map_header) +
+			  ALIGN(erofs_iend(vi), 8);
+	const unsigned int totalidx = DIV_ROUND_UP(vi->size,
+						   erofs_blksiz());
+	unsigned int compacted_4b_initial, compacted_2b;
+	unsigned int amortizedshift;
+	u64 pos;
+	int ret;
+
+	if (lcn >= totalidx)
+		return -EINVAL;
+
+	m->lcn = lcn;
+	/* Used to align to 32-byte (compacted_2b) alignment */
+	compacted_4b_initial = (32 - ebase % 32) / 4;
+	if (compacted_4b_initial == 32 / 4)
+		compacted_4b_initial = 0;
+
+	if ((vi->z_advise & Z_EROFS_ADVISE_COMPACTED_2B) &&
+	    compacted_4b_initial < totalidx)
+		compacted_2b = rounddown(totalidx - compacted_4b_initial, 16);
+	else
+		compacted_2b = 0;
+
+	pos = ebase;
+	if (lcn < compacted_4b_initial) {
+		amortizedshift = 2;
+		goto out;
+	}
+	pos += compacted_4b_initial * 4;
+	lcn -= compacted_4b_initial;
+
+	if (lcn < compacted_2b) {
+		amortizedshift = 1;
+		goto out;
+	}
+	pos += compacted_2b * 2;
+	lcn -= compacted_2b;
+	amortizedshift = 2;
+out:
+	pos += lcn * (1 << amortizedshift);
+	ret = z_erofs_reload_indexes(m, pos);
+	if (ret)
+		return ret;
+
+	return unpack_compacted_index(m, amortizedshift, pos, lookahead);
+}
+
+static int z_erofs_load_cluster_from_disk(struct z_erofs_maprecorder *m,
+					  unsigned long lcn, bool lookahead)
+{
+	switch (m->vi->datalayout) {
+	case EROFS_INODE_COMPRESSED_FULL:
+		return legacy_load_cluster_from_disk(m, lcn);
+	case EROFS_INODE_COMPRESSED_COMPACT:
+		return compacted_load_cluster_from_disk(m, lcn, lookahead);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int z_erofs_extent_lookback(struct z_erofs_maprecorder *m,
+				   unsigned int lookback_distance)
+{
+	const unsigned int lclusterbits = m->vi->z_logical_clusterbits;
+	unsigned long lcn;
+	int ret;
+
+	while (m->lcn >= lookback_distance) {
+		lcn = m->lcn - lookback_distance;
+		ret = z_erofs_load_cluster_from_disk(m, lcn, false);
+		if (ret)
+			return ret;
+
+		switch (m->type) {
+		case Z_EROFS_LCLUSTER_TYPE_NONHEAD:
+			lookback_distance = m->delta[0];
+			if (!lookback_distance)
+				return -EFSCORRUPTED;
+			continue;
+		case Z_EROFS_LCLUSTER_TYPE_PLAIN:
+		case Z_EROFS_LCLUSTER_TYPE_HEAD1:
+		case Z_EROFS_LCLUSTER_TYPE_HEAD2:
+			m->headtype = m->type;
+			m->map->m_la = ((u64)lcn << lclusterbits) |
+				       m->clusterofs;
+			return 0;
+		default:
+			return -EOPNOTSUPP;
+		}
+	}
+
+	return -EFSCORRUPTED;
+}
+
+static int z_erofs_get_extent_compressedlen(struct z_erofs_maprecorder *m)
+{
+	struct erofs_inode *vi = m->vi;
+	const unsigned int lclusterbits = vi->z_logical_clusterbits;
+	int ret;
+
+	if ((m->headtype == Z_EROFS_LCLUSTER_TYPE_HEAD1 &&
+	     !(vi->z_advise & Z_EROFS_ADVISE_BIG_PCLUSTER_1)) ||
+	    ((m->headtype == Z_EROFS_LCLUSTER_TYPE_PLAIN ||
+	      m->headtype == Z_EROFS_LCLUSTER_TYPE_HEAD2) &&
+	     !(vi->z_advise & Z_EROFS_ADVISE_BIG_PCLUSTER_2))) {
+		m->map->m_plen = 1ULL << lclusterbits;
+		return 0;
+	}
+
+	if (!m->compressedblks) {
+		/* The size is kept in the first NONHEAD lcluster */
+		ret = z_erofs_load_cluster_from_disk(m, m->lcn + 1, false);
+		if (ret)
+			return ret;
+
+		switch (m->type) {
+		case Z_EROFS_LCLUSTER_TYPE_PLAIN:
+		case Z_EROFS_LCLUSTER_TYPE_HEAD1:
+		case Z_EROFS_LCLUSTER_TYPE_HEAD2:
+			/* A pcluster of one lcluster */
+			m->compressedblks = 1 << (lclusterbits -
+						  erofs_sbi.blkszbits);
+			break;
+		case Z_EROFS_LCLUSTER_TYPE_NONHEAD:
+			if (m->delta[0] != 1 || !m->compressedblks)
+				return -EFSCORRUPTED;
+			break;
+		default:
+			return -EFSCORRUPTED;
+		}
+	}
+	m->map->m_plen = erofs_pos(m->compressedblks);
+
+	return 0;
+}
+
+static int z_erofs_get_extent_decompressedlen(struct z_erofs_maprecorder *m)
+{
+	struct erofs_inode *vi = m->vi;
+	struct erofs_map_blocks *map = m->map;
+	const unsigned int lclusterbits = vi->z_logical_clusterbits;
+	u64 lcn = m->lcn, headlcn = map->m_la >> lclusterbits;
+	int ret;
+
+	do {
+		/* Handle the last EOF pcluster (no next HEAD lcluster) */
+		if ((lcn << lclusterbits) >= vi->size) {
+			map->m_llen = vi->size - map->m_la;
+			return 0;
+		}
+
+		ret = z_erofs_load_cluster_from_disk(m, lcn, true);
+		if (ret)
+			return ret;
+
+		if (m->type == Z_EROFS_LCLUSTER_TYPE_NONHEAD) {
+			if (!m->delta[1] && m->clusterofs != 1 << lclusterbits)
+				return -EFSCORRUPTED;
+		} else if (m->type == Z_EROFS_LCLUSTER_TYPE_PLAIN ||
+			   m->type == Z_EROFS_LCLUSTER_TYPE_HEAD1 ||
+			   m->type == Z_EROFS_LCLUSTER_TYPE_HEAD2) {
+			/* Ends at the next HEAD lcluster */
+			if (lcn != headlcn)
+				break;
+			m->delta[1] = 1;
+		} else {
+			return -EOPNOTSUPP;
+		}
+		lcn += m->delta[1];
+	} while (m->delta[1]);
+
+	map->m_llen = (lcn << lclusterbits) + m->clusterofs - map->m_la;
+
+	return 0;
+}
+
+/**
+ * z_erofs_map_blocks() - Find the compressed extent holding a file offset
+ *
+ * Unlike the kernel, which maps just enough to fill a page, this always
+ * returns the whole extent, so that it can be decompressed in one go.
+ *
+ * @vi: Compressed inode
+ * @map: On entry m_la is the offset in the file, on return the extent
+ * Return: 0 if OK, -ve on error
+ */
+int z_erofs_map_blocks(struct erofs_inode *vi, struct erofs_map_blocks *map)
+{
+	struct z_erofs_maprecorder m = { .vi = vi, .map = map };
+	unsigned int lclusterbits, endoff;
+	unsigned long initial_lcn;
+	u64 ofs = map->m_la;
+	int ret;
+
+	if (ofs >= vi->size)
+		return -EINVAL;
+
+	ret = z_erofs_fill_inode_lazy(vi);
+	if (ret)
+		return ret;
+
+	lclusterbits = vi->z_logical_clusterbits;
+	initial_lcn = ofs >> lclusterbits;
+	endoff = ofs & ((1 << lclusterbits) - 1);
+
+	ret = z_erofs_load_cluster_from_disk(&m, initial_lcn, false);
+	if (ret)
+		return ret;
+
+	map->m_flags = EROFS_MAP_MAPPED | EROFS_MAP_ENCODED;
+	switch (m.type) {
+	case Z_EROFS_LCLUSTER_TYPE_PLAIN:
+	case Z_EROFS_LCLUSTER_TYPE_HEAD1:
+	case Z_EROFS_LCLUSTER_TYPE_HEAD2:
+		if (endoff >= m.clusterofs) {
+			m.headtype = m.type;
+			map->m_la = ((u64)m.lcn << lclusterbits) | m.clusterofs;
+			break;
+		}
+		/* The offset is in the extent ending in this lcluster */
+		if (!m.lcn)
+			return -EFSCORRUPTED;
+		m.delta[0] = 1;
+		/* fall through */
+	case Z_EROFS_LCLUSTER_TYPE_NONHEAD:
+		ret = z_erofs_extent_lookback(&m, m.delta[0]);
+		if (ret)
+			return ret;
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+	if (m.partialref)
+		map->m_flags |= EROFS_MAP_PARTIAL_REF;
+
+	map->m_pa = erofs_pos(m.pblk);
+	ret = z_erofs_get_extent_compressedlen(&m);
+	if (ret)
+		return ret;
+
+	if (m.headtype == Z_EROFS_LCLUSTER_TYPE_PLAIN) {
+		if (vi->z_advise & Z_EROFS_ADVISE_INTERLACED_PCLUSTER)
+			map->m_algorithmformat = Z_EROFS_COMPRESSION_INTERLACED;
+		else
+			map->m_algorithmformat = Z_EROFS_COMPRESSION_SHIFTED;
+	} else if (m.headtype == Z_EROFS_LCLUSTER_TYPE_HEAD2) {
+		map->m_algorithmformat = vi->z_algorithmtype[1];
+	} else {
+		map->m_algorithmformat = vi->z_algorithmtype[0];
+	}
+
+	ret = z_erofs_get_extent_decompressedlen(&m);
+	if (ret)
+		return ret;
+	if (map->m_la + map->m_llen <= ofs)
+		return -EFSCORRUPTED;
+
+	return 0;
+}
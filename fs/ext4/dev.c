@@ -28,6 +28,7 @@
 #include <fs_internal.h>
 #include <ext4fs.h>
 #include <ext_common.h>
+#include <fs.h>
 #include "ext4_common.h"
 
 lbaint_t part_offset;
@@ -38,6 +39,8 @@ static disk_partition_t *part_info;
 void ext4fs_set_blk_dev(struct blk_desc *rbdd, disk_partition_t *info)
 {
 	assert(rbdd->blksz == (1 << rbdd->log2blksz));
+	/* A file system kept mounted by fs_close() still uses the old device */
+	fs_unmount();
 	ext4fs_blk_desc = rbdd;
 	get_fs()->dev_desc = rbdd;
 	part_info = info;
@@ -53,6 +56,11 @@ int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len,
 			  byte_len, buffer);
 }
 
+int ext4fs_devdiscard(lbaint_t sector, lbaint_t count)
+{
+	return fs_devdiscard(get_fs()->dev_desc, part_info, sector, count);
+}
+
 int ext4_read_superblock(char *buffer)
 {
 	struct ext_filesystem *fs = get_fs();
@@ -318,6 +318,7 @@ int ext4fs_set_block_bmap(long int blockno, unsigned char *buffer, int index)
 		if (status)
 			return -1;
 
+		get_fs()->bmap_dirty[index] |= EXT4_BMAP_BLK_DIRTY;
 		*ptr = *ptr | operand;
 		return 0;
 	} else {
@@ -332,6 +333,7 @@ int ext4fs_set_block_bmap(long int blockno, unsigned char *buffer, int index)
 		if (status)
 			return -1;
 
+		get_fs()->bmap_dirty[index] |= EXT4_BMAP_BLK_DIRTY;
 		*ptr = *ptr | operand;
 		return 0;
 	}
@@ -347,6 +349,7 @@ void ext4fs_reset_block_bmap(long int blockno, unsigned char *buffer, int index)
 	int blocksize = EXT2_BLOCK_SIZE(ext4fs_root);
 
 	i = i - (index * blocksize);
+	get_fs()->bmap_dirty[index] |= EXT4_BMAP_BLK_DIRTY;
 	if (blocksize != 1024) {
 		ptr = ptr + i;
 		operand = (1 << remainder);
@@ -367,6 +370,32 @@ void ext4fs_reset_block_bmap(long int blockno, unsigned char *buffer, int index)
 	}
 }
 
+int ext4fs_test_block_bmap(long blockno, unsigned char *buffer, int index)
+{
+	int i, remainder;
+	unsigned char *ptr = buffer;
+	unsigned char operand;
+	int blocksize = EXT2_BLOCK_SIZE(ext4fs_root);
+
+	i = blockno / 8;
+	remainder = blockno % 8;
+	i = i - (index * blocksize);
+	if (blocksize != 1024) {
+		ptr = ptr + i;
+		operand = (1 << remainder);
+	} else {
+		if (remainder == 0) {
+			ptr = ptr + i - 1;
+			operand = (1 << 7);
+		} else {
+			ptr = ptr + i;
+			operand = (1 << (remainder - 1));
+		}
+	}
+
+	return *ptr & operand;
+}
+
 int ext4fs_set_inode_bmap(int inode_no, unsigned char *buffer, int index)
 {
 	int i, remainder, status;
@@ -387,6 +416,7 @@ int ext4fs_set_inode_bmap(int inode_no, unsigned char *buffer, int index)
 	if (status)
 		return -1;
 
+	get_fs()->bmap_dirty[index] |= EXT4_BMAP_INODE_DIRTY;
 	*ptr = *ptr | operand;
 
 	return 0;
@@ -399,6 +429,7 @@ void ext4fs_reset_inode_bmap(int inode_no, unsigned char *buffer, int index)
 	unsigned char operand;
 
 	inode_no -= (index * le32_to_cpu(ext4fs_root->sblock.inodes_per_group));
+	get_fs()->bmap_dirty[index] |= EXT4_BMAP_INODE_DIRTY;
 	i = inode_no / 8;
 	remainder = inode_no % 8;
 	if (remainder == 0) {
@@ -413,6 +444,149 @@ void ext4fs_reset_inode_bmap(int inode_no, unsigned char *buffer, int index)
 		*ptr = *ptr & ~(operand);
 }
 
+/* Number of groups whose metadata is packed together, 1 without flex_bg */
+static unsigned int ext4fs_groups_per_flex(void)
+{
+	struct ext_filesystem *fs = get_fs();
+
+	if (!(le32_to_cpu(fs->sb->feature_incompat) &
+	      EXT4_FEATURE_INCOMPAT_FLEX_BG) ||
+	    fs->sb->log2_groups_per_flex > 31)
+		return 1;
+
+	return 1U << fs->sb->log2_groups_per_flex;
+}
+
+static uint64_t ext4fs_bmap_blk(int index, bool inode)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext2_block_group *bgd = ext4fs_get_group_descriptor(fs, index);
+
+	return inode ? ext4fs_bg_get_inode_id(bgd, fs) :
+		       ext4fs_bg_get_block_id(bgd, fs);
+}
+
+static bool ext4fs_bmap_uninit(int index, bool inode)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext2_block_group *bgd = ext4fs_get_group_descriptor(fs, index);
+
+	return ext4fs_bg_get_flags(bgd) &
+		(inode ? EXT4_BG_INODE_UNINIT : EXT4_BG_BLOCK_UNINIT);
+}
+
+/**
+ * ext4fs_load_bmaps() - Read the bitmap of a group
+ *
+ * With flex_bg the bitmaps of the groups in a flex group are stored next to
+ * each other, so the following ones which are not loaded yet are read by
+ * the same request: the allocators scan the groups in order.
+ *
+ * @bmaps:	fs->blk_bmaps or fs->inode_bmaps
+ * @index:	Group to read
+ * @inode:	true if @bmaps holds inode bitmaps
+ * @return 0 if OK, -ve on error
+ */
+static int ext4fs_load_bmaps(unsigned char **bmaps, int index, bool inode)
+{
+	struct ext_filesystem *fs = get_fs();
+	unsigned int per_flex = ext4fs_groups_per_flex();
+	unsigned int end, count, i;
+	uint64_t blk;
+	char *buf;
+
+	/* The bitmap of an uninitialised group is not valid on disk */
+	if (ext4fs_bmap_uninit(index, inode)) {
+		bmaps[index] = memalign(ARCH_DMA_MINALIGN, fs->blksz);
+		if (!bmaps[index])
+			return -ENOMEM;
+		memset(bmaps[index], '\0', fs->blksz);
+
+		return 0;
+	}
+
+	blk = ext4fs_bmap_blk(index, inode);
+	end = min(rounddown(index, per_flex) + per_flex, fs->no_blkgrp);
+	for (count = 1; index + count < end; count++) {
+		if (bmaps[index + count] ||
+		    ext4fs_bmap_uninit(index + count, inode) ||
+		    ext4fs_bmap_blk(index + count, inode) != blk + count)
+			break;
+	}
+
+	buf = NULL;
+	if (count > 1) {
+		buf = memalign(ARCH_DMA_MINALIGN, count * fs->blksz);
+		if (!buf)
+			count = 1;
+	}
+	for (i = 0; i < count; i++) {
+		bmaps[index + i] = memalign(ARCH_DMA_MINALIGN, fs->blksz);
+		if (!bmaps[index + i])
+			goto fail;
+	}
+
+	if (!ext4fs_devread(blk * fs->sect_perblk, 0, count * fs->blksz,
+			    buf ? buf : (char *)bmaps[index]))
+		goto fail;
+	if (buf) {
+		for (i = 0; i < count; i++)
+			memcpy(bmaps[index + i], buf + i * fs->blksz,
+			       fs->blksz);
+		free(buf);
+	}
+
+	return 0;
+fail:
+	for (i = 0; i < count; i++) {
+		free(bmaps[index + i]);
+		bmaps[index + i] = NULL;
+	}
+	free(buf);
+
+	return -EIO;
+}
+
+/**
+ * ext4fs_get_blk_bmap() - Get the block bitmap of a group
+ *
+ * The bitmap is read on the first call for the group. Changes made with
+ * ext4fs_set_block_bmap() or ext4fs_reset_block_bmap() are written back by
+ * ext4fs_update().
+ *
+ * @index:	Group number
+ * @return bitmap, or NULL if it cannot be read
+ */
+unsigned char *ext4fs_get_blk_bmap(int index)
+{
+	struct ext_filesystem *fs = get_fs();
+
+	if (!fs->blk_bmaps[index] &&
+	    ext4fs_load_bmaps(fs->blk_bmaps, index, false))
+		return NULL;
+
+	return fs->blk_bmaps[index];
+}
+
+/**
+ * ext4fs_get_inode_bmap() - Get the inode bitmap of a group
+ *
+ * Same as ext4fs_get_blk_bmap() for inode bitmaps
+ *
+ * @index:	Group number
+ * @return bitmap, or NULL if it cannot be read
+ */
+unsigned char *ext4fs_get_inode_bmap(int index)
+{
+	struct ext_filesystem *fs = get_fs();
+
+	if (!fs->inode_bmaps[index] &&
+	    ext4fs_load_bmaps(fs->inode_bmaps, index, true))
+		return NULL;
+
+	return fs->inode_bmaps[index];
+}
+
 uint16_t ext4fs_checksum_update(uint32_t i)
 {
 	struct ext2_block_group *desc;
@@ -955,41 +1129,68 @@ int ext4fs_filename_unlink(char *filename)
 	return -1;
 }
 
+/*
+ * Group to start looking for free blocks in: with flex_bg, the first group
+ * of the flex group holding the inode last allocated, so that the data is
+ * kept close to its inode and to the bitmaps already loaded
+ */
+static unsigned int ext4fs_blk_goal_group(void)
+{
+	struct ext_filesystem *fs = get_fs();
+	unsigned int inodes_per_grp =
+		le32_to_cpu(ext4fs_root->sblock.inodes_per_group);
+	unsigned int per_flex = ext4fs_groups_per_flex();
+	unsigned int group;
+
+	if (per_flex == 1 || fs->curr_inode_no <= 0)
+		return 0;
+	group = (fs->curr_inode_no - 1) / inodes_per_grp;
+	if (group >= fs->no_blkgrp)
+		return 0;
+
+	return rounddown(group, per_flex);
+}
+
 uint32_t ext4fs_get_new_blk_no(void)
 {
-	short i;
+	unsigned int i, n, goal;
 	short status;
 	int remainder;
 	unsigned int bg_idx;
+	unsigned char *bmap;
 	static int prev_bg_bitmap_index = -1;
 	unsigned int blk_per_grp = le32_to_cpu(ext4fs_root->sblock.blocks_per_group);
 	struct ext_filesystem *fs = get_fs();
 	char *journal_buffer = zalloc(fs->blksz);
-	char *zero_buffer = zalloc(fs->blksz);
-	if (!journal_buffer || !zero_buffer)
+	if (!journal_buffer)
 		goto fail;
 
 	if (fs->first_pass_bbmap == 0) {
-		for (i = 0; i < fs->no_blkgrp; i++) {
+		goal = ext4fs_blk_goal_group();
+first_pass:
+		for (n = 0; n < fs->no_blkgrp; n++) {
 			struct ext2_block_group *bgd = NULL;
+			i = (goal + n) % fs->no_blkgrp;
 			bgd = ext4fs_get_group_descriptor(fs, i);
 			if (ext4fs_bg_get_free_blocks(bgd, fs)) {
 				uint16_t bg_flags = ext4fs_bg_get_flags(bgd);
 				uint64_t b_bitmap_blk =
 					ext4fs_bg_get_block_id(bgd, fs);
+				bmap = ext4fs_get_blk_bmap(i);
+				if (!bmap)
+					goto fail;
 				if (bg_flags & EXT4_BG_BLOCK_UNINIT) {
-					memcpy(fs->blk_bmaps[i], zero_buffer,
-					       fs->blksz);
+					memset(bmap, '\0', fs->blksz);
 					put_ext4(b_bitmap_blk * fs->blksz,
-						 fs->blk_bmaps[i], fs->blksz);
+						 bmap, fs->blksz);
 					bg_flags &= ~EXT4_BG_BLOCK_UNINIT;
 					ext4fs_bg_set_flags(bgd, bg_flags);
 				}
-				fs->curr_blkno =
-				    _get_new_blk_no(fs->blk_bmaps[i]);
+				fs->curr_blkno = _get_new_blk_no(bmap);
 				if (fs->curr_blkno == -1)
 					/* block bitmap is completely filled */
 					continue;
+				fs->bmap_dirty[i] |= EXT4_BMAP_BLK_DIRTY;
 				fs->curr_blkno = fs->curr_blkno +
 						(i * fs->blksz * 8);
 				fs->first_pass_bbmap++;
@@ -1023,14 +1224,20 @@ restart:
 		}
 
 		/*
-		 * To skip completely filled block group bitmaps
-		 * Optimize the block allocation
+		 * The first pass may have started after the first group:
+		 * look again from the start once the end is reached
 		 */
-		if (bg_idx >= fs->no_blkgrp)
-			goto fail;
+		if (bg_idx >= fs->no_blkgrp) {
+			goal = 0;
+			goto first_pass;
+		}
 
 		struct ext2_block_group *bgd = NULL;
 		bgd = ext4fs_get_group_descriptor(fs, bg_idx);
+		/*
+		 * To skip completely filled block group bitmaps
+		 * Optimize the block allocation
+		 */
 		if (ext4fs_bg_get_free_blocks(bgd, fs) == 0) {
 			debug("block group %u is full. Skipping\n", bg_idx);
 			fs->curr_blkno = (bg_idx + 1) * blk_per_grp;
@@ -1041,16 +1248,17 @@ restart:
 
 		uint16_t bg_flags = ext4fs_bg_get_flags(bgd);
 		uint64_t b_bitmap_blk = ext4fs_bg_get_block_id(bgd, fs);
+		bmap = ext4fs_get_blk_bmap(bg_idx);
+		if (!bmap)
+			goto fail;
 		if (bg_flags & EXT4_BG_BLOCK_UNINIT) {
-			memcpy(fs->blk_bmaps[bg_idx], zero_buffer, fs->blksz);
-			put_ext4(b_bitmap_blk * fs->blksz,
-				 zero_buffer, fs->blksz);
+			memset(bmap, '\0', fs->blksz);
+			put_ext4(b_bitmap_blk * fs->blksz, bmap, fs->blksz);
 			bg_flags &= ~EXT4_BG_BLOCK_UNINIT;
 			ext4fs_bg_set_flags(bgd, bg_flags);
 		}
 
-		if (ext4fs_set_block_bmap(fs->curr_blkno, fs->blk_bmaps[bg_idx],
-				   bg_idx) != 0) {
+		if (ext4fs_set_block_bmap(fs->curr_blkno, bmap, bg_idx) != 0) {
 			debug("going for restart for the block no %ld %u\n",
 			      fs->curr_blkno, bg_idx);
 			fs->curr_blkno++;
@@ -1074,12 +1282,10 @@ restart:
 	}
 success:
 	free(journal_buffer);
-	free(zero_buffer);
 
 	return fs->curr_blkno;
 fail:
 	free(journal_buffer);
-	free(zero_buffer);
 
 	return -1;
 }
@@ -1089,6 +1295,7 @@ int ext4fs_get_new_inode_no(void)
 	short i;
 	short status;
 	unsigned int ibmap_idx;
+	unsigned char *bmap;
 	static int prev_inode_bitmap_index = -1;
 	unsigned int inodes_per_grp = le32_to_cpu(ext4fs_root->sblock.inodes_per_group);
 	struct ext_filesystem *fs = get_fs();
@@ -1109,6 +1316,9 @@ int ext4fs_get_new_inode_no(void)
 				uint16_t bg_flags = ext4fs_bg_get_flags(bgd);
 				uint64_t i_bitmap_blk =
 					ext4fs_bg_get_inode_id(bgd, fs);
+				bmap = ext4fs_get_inode_bmap(i);
+				if (!bmap)
+					goto fail;
 				if (has_gdt_chksum)
 					bgd->bg_itable_unused = free_inodes;
 				if (bg_flags & EXT4_BG_INODE_UNINIT) {
@@ -1116,14 +1326,13 @@ int ext4fs_get_new_inode_no(void)
 						 zero_buffer, fs->blksz);
 					bg_flags &= ~EXT4_BG_INODE_UNINIT;
 					ext4fs_bg_set_flags(bgd, bg_flags);
-					memcpy(fs->inode_bmaps[i],
-					       zero_buffer, fs->blksz);
+					memcpy(bmap, zero_buffer, fs->blksz);
 				}
-				fs->curr_inode_no =
-				    _get_new_inode_no(fs->inode_bmaps[i]);
+				fs->curr_inode_no = _get_new_inode_no(bmap);
 				if (fs->curr_inode_no == -1)
 					/* inode bitmap is completely filled */
 					continue;
+				fs->bmap_dirty[i] |= EXT4_BMAP_INODE_DIRTY;
 				fs->curr_inode_no = fs->curr_inode_no +
 							(i * inodes_per_grp);
 				fs->first_pass_ibmap++;
@@ -1155,17 +1364,18 @@ restart:
 		uint16_t bg_flags = ext4fs_bg_get_flags(bgd);
 		uint64_t i_bitmap_blk = ext4fs_bg_get_inode_id(bgd, fs);
 
+		bmap = ext4fs_get_inode_bmap(ibmap_idx);
+		if (!bmap)
+			goto fail;
 		if (bg_flags & EXT4_BG_INODE_UNINIT) {
 			put_ext4(i_bitmap_blk * fs->blksz,
 				 zero_buffer, fs->blksz);
 			bg_flags &= ~EXT4_BG_INODE_UNINIT;
 			ext4fs_bg_set_flags(bgd, bg_flags);
-			memcpy(fs->inode_bmaps[ibmap_idx], zero_buffer,
-				fs->blksz);
+			memcpy(bmap, zero_buffer, fs->blksz);
 		}
 
-		if (ext4fs_set_inode_bmap(fs->curr_inode_no,
-					  fs->inode_bmaps[ibmap_idx],
+		if (ext4fs_set_inode_bmap(fs->curr_inode_no, bmap,
 					  ibmap_idx) != 0) {
 			debug("going for restart for the block no %d %u\n",
 			      fs->curr_inode_no, ibmap_idx);
@@ -1204,6 +1414,31 @@ fail:
 }
 
 
+/* Data of the file whose blocks are being allocated, to find zero blocks */
+static const char *alloc_data;
+static uint64_t alloc_len;
+static uint32_t alloc_lblk;
+static uint32_t alloc_holes;
+
+/*
+ * Allocate the next block of the file, or return 0 to leave a hole if it
+ * only holds zeros and CONFIG_EXT4_WRITE_SPARSE is enabled.
+ */
+static long ext4fs_get_new_data_blk_no(void)
+{
+	uint64_t pos = (uint64_t)alloc_lblk++ * get_fs()->blksz;
+
+	if (CONFIG_IS_ENABLED(EXT4_WRITE_SPARSE) && alloc_data &&
+	    pos < alloc_len &&
+	    !memchr_inv(alloc_data + pos, 0,
+			min_t(uint64_t, get_fs()->blksz, alloc_len - pos))) {
+		alloc_holes++;
+		return 0;
+	}
+
+	return ext4fs_get_new_blk_no();
+}
+
 static void alloc_single_indirect_block(struct ext2_inode *file_inode,
 					unsigned int *total_remaining_blocks,
 					unsigned int *no_blks_reqd)
@@ -1239,7 +1474,7 @@ static void alloc_single_indirect_block(struct ext2_inode *file_inode,
 			goto fail;
 
 		for (i = 0; i < (fs->blksz / sizeof(int)); i++) {
-			actual_block_no = ext4fs_get_new_blk_no();
+			actual_block_no = ext4fs_get_new_data_blk_no();
 			if (actual_block_no == -1) {
 				printf("no block left to assign\n");
 				goto fail;
@@ -1339,7 +1574,7 @@ static void alloc_double_indirect_block(struct ext2_inode *file_inode,
 			memset(di_child_buff, '\0', fs->blksz);
 			/* filling of actual datablocks for each child */
 			for (j = 0; j < (fs->blksz / sizeof(int)); j++) {
-				actual_block_no = ext4fs_get_new_blk_no();
+				actual_block_no = ext4fs_get_new_data_blk_no();
 				if (actual_block_no == -1) {
 					printf("no block left to assign\n");
 					goto fail;
@@ -1445,7 +1680,7 @@ static void alloc_triple_indirect_block(struct ext2_inode *file_inode,
 				for (k = 0; k < (fs->blksz / sizeof(int));
 					k++) {
 					actual_block_no =
-					    ext4fs_get_new_blk_no();
+					    ext4fs_get_new_data_blk_no();
 					if (actual_block_no == -1) {
 						printf("no block left\n");
 						free(ti_cbuff_start_addr);
@@ -1492,15 +1727,21 @@ fail:
 
 void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 				unsigned int total_remaining_blocks,
-				unsigned int *total_no_of_block)
+				unsigned int *total_no_of_block,
+				const char *data, uint64_t len)
 {
 	short i;
 	long int direct_blockno;
 	unsigned int no_blks_reqd = 0;
 
+	alloc_data = data;
+	alloc_len = len;
+	alloc_lblk = 0;
+	alloc_holes = 0;
+
 	/* allocation of direct blocks */
 	for (i = 0; total_remaining_blocks && i < INDIRECT_BLOCKS; i++) {
-		direct_blockno = ext4fs_get_new_blk_no();
+		direct_blockno = ext4fs_get_new_data_blk_no();
 		if (direct_blockno == -1) {
 			printf("no block left to assign\n");
 			return;
@@ -1518,20 +1759,28 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 	alloc_triple_indirect_block(file_inode, &total_remaining_blocks,
 				    &no_blks_reqd);
 	*total_no_of_block += no_blks_reqd;
+	*total_no_of_block -= alloc_holes;
+	alloc_data = NULL;
 }
 
 #endif
 
+/*
+ * Find the leaf of the extent tree which maps fileblock. If end is not NULL
+ * it is set to the first file block which is not covered by that leaf.
+ */
 static struct ext4_extent_header *ext4fs_get_extent_block
 	(struct ext2_data *data, struct ext_block_cache *cache,
 		struct ext4_extent_header *ext_block,
-		uint32_t fileblock, int log2_blksz)
+		uint32_t fileblock, int log2_blksz, uint32_t *end)
 {
 	struct ext4_extent_idx *index;
 	unsigned long long block;
 	int blksz = EXT2_BLOCK_SIZE(data);
 	int i;
 
+	if (end)
+		*end = U32_MAX;
 	while (1) {
 		index = (struct ext4_extent_idx *)(ext_block + 1);
 
@@ -1553,6 +1802,8 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 		 */
 		if (i > 0)
 			i--;
+		if (end && i + 1 < le16_to_cpu(ext_block->eh_entries))
+			*end = min(*end, le32_to_cpu(index[i + 1].ei_block));
 
 		block = le16_to_cpu(index[i].ei_leaf_hi);
 		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
@@ -1599,6 +1850,9 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 	long int blkno;
 	unsigned int blkoff;
 
+	if (!ext4fs_icache_lookup(ino, inode))
+		return 1;
+
 	/* Allocate blkgrp based on gdsize (for 64-bit support). */
 	blkgrp = zalloc(get_fs()->gdsize);
 	if (!blkgrp)
@@ -1635,6 +1889,7 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 				sizeof(struct ext2_inode), (char *)inode);
 	if (status == 0)
 		return 0;
+	ext4fs_icache_add(ino + 1, inode);
 
 	return 1;
 }
@@ -1672,7 +1927,7 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			ext4fs_get_extent_block(ext4fs_root, c,
 						(struct ext4_extent_header *)
 						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
+						fileblock, log2_blksz, NULL);
 		if (!ext_block) {
 			printf("invalid extent block\n");
 			if (!cache)
@@ -1992,6 +2247,74 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	return blknr;
 }
 
+/**
+ * ext4fs_map_extent() - Map a run of blocks of a file using extents
+ *
+ * Unlike read_allocated_block(), which returns one block, this returns the
+ * whole part of the extent, or of the hole, which starts at @fileblock, so
+ * that it can be read with a single request.
+ *
+ * @inode:	Inode of the file, which must have EXT4_EXTENTS_FL set
+ * @cache:	Cache for the blocks of the extent tree
+ * @fileblock:	First block of the file to map
+ * @maxblocks:	Largest number of blocks to return
+ * @blknr:	Returns the first device block (in file system blocks) of the
+ *		run, or 0 if the run is a hole or an unwritten extent
+ * @return number of blocks in the run, at least 1, or -ve on error
+ */
+long ext4fs_map_extent(struct ext2_inode *inode, struct ext_block_cache *cache,
+		       uint32_t fileblock, uint32_t maxblocks, uint64_t *blknr)
+{
+	int log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+		get_fs()->dev_desc->log2blksz;
+	struct ext4_extent_header *ext_block;
+	struct ext4_extent *extent;
+	uint32_t start, len, end;
+	uint64_t phys;
+	int i;
+
+	ext_block = ext4fs_get_extent_block(ext4fs_root, cache,
+					    (struct ext4_extent_header *)
+					    inode->b.blocks.dir_blocks,
+					    fileblock, log2_blksz, &end);
+	if (!ext_block) {
+		printf("invalid extent block\n");
+		return -EINVAL;
+	}
+
+	*blknr = 0;
+	extent = (struct ext4_extent *)(ext_block + 1);
+	for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
+		start = le32_to_cpu(extent[i].ee_block);
+		len = le16_to_cpu(extent[i].ee_len);
+
+		if (start > fileblock) {
+			/* Sparse file */
+			end = min(end, start);
+			break;
+		}
+		/* Unwritten extents read as zeroes, like holes */
+		phys = 0;
+		if (len > EXT_INIT_MAX_LEN) {
+			len -= EXT_INIT_MAX_LEN;
+		} else {
+			phys = le16_to_cpu(extent[i].ee_start_hi);
+			phys = (phys << 32) + le32_to_cpu(extent[i].ee_start_lo);
+		}
+		if (fileblock < start + len) {
+			if (phys)
+				*blknr = phys + fileblock - start;
+			end = start + len;
+			break;
+		}
+	}
+
+	if (end <= fileblock)
+		return 1;
+
+	return min(end - fileblock, maxblocks);
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -2025,12 +2348,18 @@ void ext4fs_reinit_global(void)
 		ext4fs_indir3_blkno = -1;
 	}
 }
-void ext4fs_close(void)
+/* Close the file opened last but keep the file system mounted */
+void ext4fs_release(void)
 {
 	if ((ext4fs_file != NULL) && (ext4fs_root != NULL)) {
 		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
 		ext4fs_file = NULL;
 	}
+}
+
+void ext4fs_close(void)
+{
+	ext4fs_release();
 	if (ext4fs_root != NULL) {
 		free(ext4fs_root);
 		ext4fs_root = NULL;
@@ -2039,13 +2368,189 @@ void ext4fs_close(void)
 	ext4fs_reinit_global();
 }
 
+/*
+ * Create the node for a directory entry and work out its type, reading the
+ * inode if the entry does not record it
+ */
+static struct ext2fs_node *ext4fs_dirent_node(struct ext2fs_node *diro,
+					      u32 ino, int filetype,
+					      int *ftype)
+{
+	struct ext2fs_node *fdiro;
+	int type = FILETYPE_UNKNOWN;
+
+	fdiro = zalloc(sizeof(struct ext2fs_node));
+	if (!fdiro)
+		return NULL;
+
+	fdiro->data = diro->data;
+	fdiro->ino = ino;
+
+	if (filetype != FILETYPE_UNKNOWN) {
+		fdiro->inode_read = 0;
+
+		if (filetype == FILETYPE_DIRECTORY)
+			type = FILETYPE_DIRECTORY;
+		else if (filetype == FILETYPE_SYMLINK)
+			type = FILETYPE_SYMLINK;
+		else if (filetype == FILETYPE_REG)
+			type = FILETYPE_REG;
+	} else {
+		if (ext4fs_read_inode(diro->data, ino, &fdiro->inode) == 0) {
+			free(fdiro);
+			return NULL;
+		}
+		fdiro->inode_read = 1;
+
+		if ((le16_to_cpu(fdiro->inode.mode) &
+		     FILETYPE_INO_MASK) == FILETYPE_INO_DIRECTORY)
+			type = FILETYPE_DIRECTORY;
+		else if ((le16_to_cpu(fdiro->inode.mode) &
+			  FILETYPE_INO_MASK) == FILETYPE_INO_SYMLINK)
+			type = FILETYPE_SYMLINK;
+		else if ((le16_to_cpu(fdiro->inode.mode) &
+			  FILETYPE_INO_MASK) == FILETYPE_INO_REG)
+			type = FILETYPE_REG;
+	}
+	*ftype = type;
+
+	return fdiro;
+}
+
+static void ext4fs_print_dirent(struct ext2fs_node *fdiro, int type,
+				const char *filename)
+{
+	switch (type) {
+	case FILETYPE_DIRECTORY:
+		printf("<DIR> ");
+		break;
+	case FILETYPE_SYMLINK:
+		printf("<SYM> ");
+		break;
+	case FILETYPE_REG:
+		printf("      ");
+		break;
+	default:
+		printf("< ? > ");
+		break;
+	}
+	printf("%10u %s\n", le32_to_cpu(fdiro->inode.size), filename);
+}
+
+/**
+ * ext4fs_iterate_block() - Look for a name in, or list, a directory block
+ *
+ * @diro:	Directory
+ * @buf:	Contents of the block
+ * @len:	Number of bytes in @buf
+ * @name:	Name to look for, or NULL to list the entries
+ * @fnode:	Returns the node of the entry found
+ * @ftype:	Returns the type of the entry found
+ * @return 1 if found, 0 if not, -1 on error
+ */
+static int ext4fs_iterate_block(struct ext2fs_node *diro, char *buf, int len,
+				const char *name, struct ext2fs_node **fnode,
+				int *ftype)
+{
+	struct ext2fs_node *fdiro;
+	int namelen = name ? strlen(name) : 0;
+	int pos, direntlen, type;
+
+	for (pos = 0; pos < len; pos += direntlen) {
+		struct ext2_dirent *dirent = (void *)buf + pos;
+		char filename[256];
+
+		direntlen = le16_to_cpu(dirent->direntlen);
+		if (direntlen < sizeof(*dirent) || pos + direntlen > len ||
+		    sizeof(*dirent) + dirent->namelen > direntlen) {
+			printf("Failed to iterate over directory %s\n", name);
+			return -1;
+		}
+
+		if (dirent->namelen == 0 || !dirent->inode)
+			continue;
+		if (name) {
+			if (dirent->namelen != namelen ||
+			    memcmp(dirent + 1, name, namelen))
+				continue;
+		}
+
+		memcpy(filename, dirent + 1, dirent->namelen);
+		filename[dirent->namelen] = '\0';
+#ifdef DEBUG
+		printf("iterate >%s<\n", filename);
+#endif /* of DEBUG */
+		fdiro = ext4fs_dirent_node(diro, le32_to_cpu(dirent->inode),
+					   dirent->filetype, &type);
+		if (!fdiro)
+			return -1;
+
+		if (name) {
+			*ftype = type;
+			*fnode = fdiro;
+			return 1;
+		}
+
+		if (fdiro->inode_read == 0) {
+			if (ext4fs_read_inode(diro->data, fdiro->ino,
+					      &fdiro->inode) == 0) {
+				free(fdiro);
+				return -1;
+			}
+			fdiro->inode_read = 1;
+		}
+		ext4fs_print_dirent(fdiro, type, filename);
+		free(fdiro);
+	}
+
+	return 0;
+}
+
+/* Look a name up through the directory index, -ENOSYS if not indexed */
+static int ext4fs_iterate_htree(struct ext2fs_node *diro, char *buf,
+				const char *name, struct ext2fs_node **fnode,
+				int *ftype)
+{
+	int blksz = EXT2_BLOCK_SIZE(diro->data);
+	u32 leaves[8];
+	loff_t actread;
+	int count, i, status;
+
+	/* '.' and '..' are not hashed but come first in block 0 */
+	if (!(le32_to_cpu(diro->inode.flags) & EXT4_INDEX_FL) ||
+	    !(le32_to_cpu(diro->data->sblock.feature_compatibility) &
+	      EXT4_FEATURE_COMPAT_DIR_INDEX) ||
+	    !strcmp(name, ".") || !strcmp(name, ".."))
+		return -ENOSYS;
+
+	count = ext4fs_htree_leaves(diro, name, leaves, ARRAY_SIZE(leaves));
+	if (count < 0)
+		return count;
+
+	for (i = 0; i < count; i++) {
+		status = ext4fs_read_file(diro, (loff_t)leaves[i] * blksz,
+					  blksz, buf, &actread);
+		if (status < 0)
+			return -EIO;
+		status = ext4fs_iterate_block(diro, buf, actread, name, fnode,
+					      ftype);
+		if (status)
+			return status < 0 ? -EIO : 1;
+	}
+
+	return 0;
+}
+
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 				struct ext2fs_node **fnode, int *ftype)
 {
 	unsigned int fpos = 0;
-	int status;
+	int blksz = EXT2_BLOCK_SIZE(dir->data);
+	int status = 0, ret = 0;
 	loff_t actread;
 	struct ext2fs_node *diro = (struct ext2fs_node *) dir;
+	u32 ino;
+	char *buf;
 
 #ifdef DEBUG
 	if (name != NULL)
@@ -2056,122 +2561,52 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 		if (status == 0)
 			return 0;
 	}
-	/* Search the file.  */
-	while (fpos < le32_to_cpu(diro->inode.size)) {
-		struct ext2_dirent dirent;
+	if (!fnode || !ftype)
+		name = NULL;
 
-		status = ext4fs_read_file(diro, fpos,
-					   sizeof(struct ext2_dirent),
-					   (char *)&dirent, &actread);
-		if (status < 0)
-			return 0;
-
-		if (dirent.direntlen == 0) {
-			printf("Failed to iterate over directory %s\n", name);
+	if (name) {
+		status = ext4fs_dcache_lookup(diro->ino, name, &ino, ftype);
+		if (status == -ENOENT)
 			return 0;
+		if (!status) {
+			*fnode = ext4fs_dirent_node(diro, ino, *ftype, ftype);
+			return *fnode ? 1 : 0;
 		}
+	}
 
-		if (dirent.namelen != 0) {
-			char filename[dirent.namelen + 1];
-			struct ext2fs_node *fdiro;
-			int type = FILETYPE_UNKNOWN;
-
-			status = ext4fs_read_file(diro,
-						  fpos +
-						  sizeof(struct ext2_dirent),
-						  dirent.namelen, filename,
-						  &actread);
-			if (status < 0)
-				return 0;
-
-			fdiro = zalloc(sizeof(struct ext2fs_node));
-			if (!fdiro)
-				return 0;
-
-			fdiro->data = diro->data;
-			fdiro->ino = le32_to_cpu(dirent.inode);
+	buf = malloc(blksz);
+	if (!buf)
+		return 0;
 
-			filename[dirent.namelen] = '\0';
+	if (name) {
+		status = ext4fs_iterate_htree(diro, buf, name, fnode, ftype);
+		if (status != -ENOSYS) {
+			ret = status == 1;
+			goto done;
+		}
+	}
 
-			if (dirent.filetype != FILETYPE_UNKNOWN) {
-				fdiro->inode_read = 0;
+	/* Search the file.  */
+	while (fpos < le32_to_cpu(diro->inode.size)) {
+		status = ext4fs_read_file(diro, fpos, blksz, buf, &actread);
+		if (status < 0)
+			break;
 
-				if (dirent.filetype == FILETYPE_DIRECTORY)
-					type = FILETYPE_DIRECTORY;
-				else if (dirent.filetype == FILETYPE_SYMLINK)
-					type = FILETYPE_SYMLINK;
-				else if (dirent.filetype == FILETYPE_REG)
-					type = FILETYPE_REG;
-			} else {
-				status = ext4fs_read_inode(diro->data,
-							   le32_to_cpu
-							   (dirent.inode),
-							   &fdiro->inode);
-				if (status == 0) {
-					free(fdiro);
-					return 0;
-				}
-				fdiro->inode_read = 1;
-
-				if ((le16_to_cpu(fdiro->inode.mode) &
-				     FILETYPE_INO_MASK) ==
-				    FILETYPE_INO_DIRECTORY) {
-					type = FILETYPE_DIRECTORY;
-				} else if ((le16_to_cpu(fdiro->inode.mode)
-					    & FILETYPE_INO_MASK) ==
-					   FILETYPE_INO_SYMLINK) {
-					type = FILETYPE_SYMLINK;
-				} else if ((le16_to_cpu(fdiro->inode.mode)
-					    & FILETYPE_INO_MASK) ==
-					   FILETYPE_INO_REG) {
-					type = FILETYPE_REG;
-				}
-			}
-#ifdef DEBUG
-			printf("iterate >%s<\n", filename);
-#endif /* of DEBUG */
-			if ((name != NULL) && (fnode != NULL)
-			    && (ftype != NULL)) {
-				if (strcmp(filename, name) == 0) {
-					*ftype = type;
-					*fnode = fdiro;
-					return 1;
-				}
-			} else {
-				if (fdiro->inode_read == 0) {
-					status = ext4fs_read_inode(diro->data,
-								 le32_to_cpu(
-								 dirent.inode),
-								 &fdiro->inode);
-					if (status == 0) {
-						free(fdiro);
-						return 0;
-					}
-					fdiro->inode_read = 1;
-				}
-				switch (type) {
-				case FILETYPE_DIRECTORY:
-					printf("<DIR> ");
-					break;
-				case FILETYPE_SYMLINK:
-					printf("<SYM> ");
-					break;
-				case FILETYPE_REG:
-					printf("      ");
-					break;
-				default:
-					printf("< ? > ");
-					break;
-				}
-				printf("%10u %s\n",
-				       le32_to_cpu(fdiro->inode.size),
-					filename);
-			}
-			free(fdiro);
+		status = ext4fs_iterate_block(diro, buf, actread, name, fnode,
+					      ftype);
+		if (status) {
+			ret = status == 1;
+			break;
 		}
-		fpos += le16_to_cpu(dirent.direntlen);
+		fpos += blksz;
 	}
-	return 0;
+done:
+	free(buf);
+	if (name && status >= 0)
+		ext4fs_dcache_add(diro->ino, name, ret ? (*fnode)->ino : 0,
+				  ret ? *ftype : FILETYPE_UNKNOWN);
+
+	return ret;
 }
 
 static char *ext4fs_read_symlink(struct ext2fs_node *node)
@@ -2399,6 +2834,8 @@ int ext4fs_mount(unsigned part_length)
 	      le32_to_cpu(data->sblock.revision_level),
 	      fs->inodesz, fs->gdsize);
 
+	ext4fs_dcache_check(data);
+
 	data->diropen.data = data;
 	data->diropen.ino = 2;
 	data->diropen.inode_read = 1;
@@ -40,6 +40,10 @@
 #define SUPERBLOCK_SIZE	1024
 #define F_FILE			1
 
+/* Flags in ext_filesystem.bmap_dirty */
+#define EXT4_BMAP_BLK_DIRTY	BIT(0)
+#define EXT4_BMAP_INODE_DIRTY	BIT(1)
+
 static inline void *zalloc(size_t size)
 {
 	void *p = memalign(ARCH_DMA_MINALIGN, size);
@@ -55,6 +59,44 @@ int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 			struct ext2fs_node **foundnode, int expecttype);
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			struct ext2fs_node **fnode, int *ftype);
+long ext4fs_map_extent(struct ext2_inode *inode, struct ext_block_cache *cache,
+		       uint32_t fileblock, uint32_t maxblocks, uint64_t *blknr);
+
+#if CONFIG_IS_ENABLED(EXT4_DIR_INDEX)
+int ext4fs_htree_leaves(struct ext2fs_node *dir, const char *name,
+			u32 *leaves, int max);
+#else
+static inline int ext4fs_htree_leaves(struct ext2fs_node *dir,
+				      const char *name, u32 *leaves, int max)
+{
+	return -ENOSYS;
+}
+#endif
+
+#if CONFIG_IS_ENABLED(EXT4_DCACHE)
+void ext4fs_dcache_invalidate(void);
+void ext4fs_dcache_check(struct ext2_data *data);
+int ext4fs_dcache_lookup(u32 dir, const char *name, u32 *ino, int *type);
+void ext4fs_dcache_add(u32 dir, const char *name, u32 ino, int type);
+int ext4fs_icache_lookup(u32 ino, struct ext2_inode *inode);
+void ext4fs_icache_add(u32 ino, const struct ext2_inode *inode);
+#else
+static inline void ext4fs_dcache_invalidate(void) {}
+static inline void ext4fs_dcache_check(struct ext2_data *data) {}
+static inline int ext4fs_dcache_lookup(u32 dir, const char *name, u32 *ino,
+				       int *type)
+{
+	return -EAGAIN;
+}
+static inline void ext4fs_dcache_add(u32 dir, const char *name, u32 ino,
+				     int type) {}
+static inline int ext4fs_icache_lookup(u32 ino, struct ext2_inode *inode)
+{
+	return -ENOENT;
+}
+static inline void ext4fs_icache_add(u32 ino,
+				     const struct ext2_inode *inode) {}
+#endif
 
 #if defined(CONFIG_EXT4_WRITE)
 uint32_t ext4fs_div_roundup(uint32_t size, uint32_t n);
@@ -66,12 +108,16 @@ int ext4fs_get_new_inode_no(void);
 void ext4fs_reset_block_bmap(long int blockno, unsigned char *buffer,
 					int index);
 int ext4fs_set_block_bmap(long int blockno, unsigned char *buffer, int index);
+int ext4fs_test_block_bmap(long blockno, unsigned char *buffer, int index);
 int ext4fs_set_inode_bmap(int inode_no, unsigned char *buffer, int index);
 void ext4fs_reset_inode_bmap(int inode_no, unsigned char *buffer, int index);
+unsigned char *ext4fs_get_blk_bmap(int index);
+unsigned char *ext4fs_get_inode_bmap(int index);
 int ext4fs_iget(int inode_no, struct ext2_inode *inode);
 void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 				unsigned int total_remaining_blocks,
-				unsigned int *total_no_of_block);
+				unsigned int *total_no_of_block,
+				const char *data, uint64_t len);
 void put_ext4(uint64_t off, const void *buf, uint32_t size);
 struct ext2_block_group *ext4fs_get_group_descriptor
 	(const struct ext_filesystem *fs, uint32_t bg_idx);
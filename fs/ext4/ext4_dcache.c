@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cache of ext4 directory entries and inodes
+ *
+ * Every file system command mounts the partition again and resolves the
+ * whole path from the root directory. Scripts probing many paths therefore
+ * read the same directories and inodes over and over. The results are kept
+ * here across mounts for as long as the superblock is unchanged, and
+ * dropped whenever the file system is written.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <ext_common.h>
+#include <ext4fs.h>
+#include "ext4_common.h"
+
+#define EXT4_DCACHE_SIZE	32
+#define EXT4_ICACHE_SIZE	16
+#define EXT4_DCACHE_NAME_LEN	48
+
+/**
+ * struct ext4_dentry - A cached directory entry
+ *
+ * @dir:	Inode of the directory, 0 if the slot is free
+ * @ino:	Inode of the entry, 0 if the name is known not to exist
+ * @type:	FILETYPE_... of the entry
+ * @name:	Name in the directory
+ */
+struct ext4_dentry {
+	u32 dir;
+	u32 ino;
+	int type;
+	char name[EXT4_DCACHE_NAME_LEN];
+};
+
+/**
+ * struct ext4_cached_inode - A cached inode
+ *
+ * @ino:	Inode number, 0 if the slot is free
+ * @inode:	Contents of the inode
+ */
+struct ext4_cached_inode {
+	u32 ino;
+	struct ext2_inode inode;
+};
+
+/**
+ * struct ext4_dcache - State of the cache
+ *
+ * @dev_desc:	Device the cached entries belong to
+ * @part_start:	Start of the partition on @dev_desc
+ * @sblock:	Superblock of the partition when the entries were cached
+ * @dentries:	Directory entries
+ * @inodes:	Inodes
+ * @next_dentry: Slot to reuse next in @dentries
+ * @next_inode:	Slot to reuse next in @inodes
+ */
+struct ext4_dcache {
+	struct blk_desc *dev_desc;
+	lbaint_t part_start;
+	struct ext2_sblock sblock;
+	struct ext4_dentry dentries[EXT4_DCACHE_SIZE];
+	struct ext4_cached_inode inodes[EXT4_ICACHE_SIZE];
+	unsigned int next_dentry;
+	unsigned int next_inode;
+};
+
+static struct ext4_dcache dcache;
+
+void ext4fs_dcache_invalidate(void)
+{
+	memset(&dcache, '\0', sizeof(dcache));
+}
+
+void ext4fs_dcache_check(struct ext2_data *data)
+{
+	struct blk_desc *dev_desc = get_fs()->dev_desc;
+
+	/*
+	 * Any write to the file system, by U-Boot or by Linux, at least
+	 * updates the free counts or the mount and write times
+	 */
+	if (dcache.dev_desc == dev_desc && dcache.part_start == part_offset &&
+	    !memcmp(&dcache.sblock, &data->sblock, sizeof(dcache.sblock)))
+		return;
+
+	ext4fs_dcache_invalidate();
+	dcache.dev_desc = dev_desc;
+	dcache.part_start = part_offset;
+	memcpy(&dcache.sblock, &data->sblock, sizeof(dcache.sblock));
+}
+
+int ext4fs_dcache_lookup(u32 dir, const char *name, u32 *ino, int *type)
+{
+	struct ext4_dentry *de;
+	int i;
+
+	for (i = 0, de = dcache.dentries; i < EXT4_DCACHE_SIZE; i++, de++) {
+		if (de->dir == dir && !strcmp(de->name, name)) {
+			if (!de->ino)
+				return -ENOENT;
+			*ino = de->ino;
+			*type = de->type;
+			return 0;
+		}
+	}
+
+	return -EAGAIN;
+}
+
+void ext4fs_dcache_add(u32 dir, const char *name, u32 ino, int type)
+{
+	struct ext4_dentry *de;
+
+	if (!dcache.dev_desc || strlen(name) >= EXT4_DCACHE_NAME_LEN)
+		return;
+
+	de = &dcache.dentries[dcache.next_dentry];
+	dcache.next_dentry = (dcache.next_dentry + 1) % EXT4_DCACHE_SIZE;
+	de->dir = dir;
+	de->ino = ino;
+	de->type = type;
+	strcpy(de->name, name);
+}
+
+int ext4fs_icache_lookup(u32 ino, struct ext2_inode *inode)
+{
+	int i;
+
+	for (i = 0; i < EXT4_ICACHE_SIZE; i++) {
+		if (dcache.inodes[i].ino == ino) {
+			memcpy(inode, &dcache.inodes[i].inode, sizeof(*inode));
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+void ext4fs_icache_add(u32 ino, const struct ext2_inode *inode)
+{
+	struct ext4_cached_inode *ci;
+
+	if (!dcache.dev_desc)
+		return;
+
+	ci = &dcache.inodes[dcache.next_inode];
+	dcache.next_inode = (dcache.next_inode + 1) % EXT4_ICACHE_SIZE;
+	ci->ino = ino;
+	memcpy(&ci->inode, inode, sizeof(*inode));
+}
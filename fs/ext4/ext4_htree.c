@@ -0,0 +1,418 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Lookups in hashed (dir_index) ext4 directories
+ *
+ * Large directories carry a B-tree of name hashes (an htree) in blocks
+ * which old readers see as empty directory entries. Following it leads to
+ * the one leaf block which can hold a name, instead of scanning the whole
+ * directory.
+ *
+ * The hash functions are taken from Linux fs/ext4/hash.c:
+ * Copyright (C) 2002 by Theodore Ts'o
+ */
+
+#include <common.h>
+#include <ext_common.h>
+#include <ext4fs.h>
+#include <malloc.h>
+#include "ext4_common.h"
+
+#define DX_HASH_LEGACY		0
+#define DX_HASH_HALF_MD4	1
+#define DX_HASH_TEA		2
+#define DX_HASH_UNSIGNED	3	/* Added to the above if unsigned */
+
+#define EXT2_FLAGS_UNSIGNED_HASH	0x0002
+#define EXT4_HTREE_EOF_32BIT		0x7fffffff
+
+/* Deepest tree supported, as in Linux without large_dir */
+#define DX_MAX_LEVELS		2
+
+/**
+ * struct dx_root_info - Header of the tree, after the '.' and '..' entries
+ *
+ * @reserved_zero:	Always 0
+ * @hash_version:	DX_HASH_...
+ * @info_length:	Size of this structure, 8
+ * @indirect_levels:	Depth of the tree below the root
+ * @unused_flags:	Not used
+ */
+struct dx_root_info {
+	__le32 reserved_zero;
+	u8 hash_version;
+	u8 info_length;
+	u8 indirect_levels;
+	u8 unused_flags;
+};
+
+/*
+ * Entry of a tree node. In the first entry the hash is replaced by the
+ * limit and count of entries in the node.
+ */
+struct dx_entry {
+	__le32 hash;
+	__le32 block;
+};
+
+struct dx_countlimit {
+	__le16 limit;
+	__le16 count;
+};
+
+/**
+ * struct dx_frame - A node visited on the way down the tree
+ *
+ * @buf:	Contents of the node block
+ * @entries:	Entries in @buf
+ * @count:	Number of entries
+ * @at:		Entry followed
+ */
+struct dx_frame {
+	char *buf;
+	struct dx_entry *entries;
+	unsigned int count;
+	unsigned int at;
+};
+
+#define rol32(word, shift)	(((word) << (shift)) | ((word) >> (32 - (shift))))
+
+#define DELTA 0x9E3779B9
+
+static void tea_transform(u32 buf[4], u32 const in[])
+{
+	u32 sum = 0;
+	u32 b0 = buf[0], b1 = buf[1];
+	u32 a = in[0], b = in[1], c = in[2], d = in[3];
+	int n = 16;
+
+	do {
+		sum += DELTA;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	} while (--n);
+
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+/* F, G and H are basic MD4 functions: selection, majority, parity */
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define H(x, y, z) ((x) ^ (y) ^ (z))
+
+#define MD4_ROUND(f, a, b, c, d, x, s)	\
+	(a += f(b, c, d) + x, a = rol32(a, s))
+#define K1 0
+#define K2 013240474631UL
+#define K3 015666365641UL
+
+static void half_md4_transform(u32 buf[4], u32 const in[8])
+{
+	u32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	/* Round 1 */
+	MD4_ROUND(F, a, b, c, d, in[0] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[1] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[2] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[3] + K1, 19);
+	MD4_ROUND(F, a, b, c, d, in[4] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[5] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[6] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[7] + K1, 19);
+
+	/* Round 2 */
+	MD4_ROUND(G, a, b, c, d, in[1] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[3] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[5] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[7] + K2, 13);
+	MD4_ROUND(G, a, b, c, d, in[0] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[2] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[4] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[6] + K2, 13);
+
+	/* Round 3 */
+	MD4_ROUND(H, a, b, c, d, in[3] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[7] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[2] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[6] + K3, 15);
+	MD4_ROUND(H, a, b, c, d, in[1] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[5] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[0] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[4] + K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+/* The old legacy hash */
+static u32 dx_hack_hash(const char *name, int len, bool is_unsigned)
+{
+	u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+	int c;
+
+	while (len--) {
+		if (is_unsigned)
+			c = (unsigned char)*name++;
+		else
+			c = (signed char)*name++;
+		hash = hash1 + (hash0 ^ (c * 7152373));
+
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+
+	return hash0 << 1;
+}
+
+static void str2hashbuf(const char *msg, int len, u32 *buf, int num,
+			bool is_unsigned)
+{
+	u32 pad, val;
+	int i, c;
+
+	pad = (u32)len | ((u32)len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		if (is_unsigned)
+			c = (unsigned char)msg[i];
+		else
+			c = (signed char)msg[i];
+		val = c + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+/**
+ * ext4fs_dirhash() - Compute the hash of a file name
+ *
+ * @name:	File name
+ * @len:	Length of @name
+ * @version:	DX_HASH_..., including DX_HASH_UNSIGNED if needed
+ * @seed:	Hash seed from the superblock
+ * @hashp:	Returns the hash
+ * @return 0 if OK, -ENOSYS if the hash version is not supported
+ */
+static int ext4fs_dirhash(const char *name, int len, int version,
+			  const __le32 seed[4], u32 *hashp)
+{
+	bool is_unsigned = version >= DX_HASH_UNSIGNED;
+	u32 buf[4], in[8];
+	const char *p;
+	u32 hash;
+	int i;
+
+	/* Initialize the default seed for the hash checksum functions */
+	buf[0] = 0x67452301;
+	buf[1] = 0xefcdab89;
+	buf[2] = 0x98badcfe;
+	buf[3] = 0x10325476;
+
+	/* Check to see if the seed is all zero's */
+	for (i = 0; i < 4; i++) {
+		if (seed[i]) {
+			for (i = 0; i < 4; i++)
+				buf[i] = le32_to_cpu(seed[i]);
+			break;
+		}
+	}
+
+	switch (version % DX_HASH_UNSIGNED) {
+	case DX_HASH_LEGACY:
+		hash = dx_hack_hash(name, len, is_unsigned);
+		break;
+	case DX_HASH_HALF_MD4:
+		for (p = name; len > 0; len -= 32, p += 32) {
+			str2hashbuf(p, len, in, 8, is_unsigned);
+			half_md4_transform(buf, in);
+		}
+		hash = buf[1];
+		break;
+	case DX_HASH_TEA:
+		for (p = name; len > 0; len -= 16, p += 16) {
+			str2hashbuf(p, len, in, 4, is_unsigned);
+			tea_transform(buf, in);
+		}
+		hash = buf[0];
+		break;
+	default:
+		return -ENOSYS;
+	}
+
+	hash &= ~1;
+	if (hash == (EXT4_HTREE_EOF_32BIT << 1))
+		hash = (EXT4_HTREE_EOF_32BIT - 1) << 1;
+	*hashp = hash;
+
+	return 0;
+}
+
+static int dx_read_block(struct ext2fs_node *dir, u32 block, char *buf)
+{
+	int blksz = EXT2_BLOCK_SIZE(dir->data);
+	loff_t actread;
+
+	if (ext4fs_read_file(dir, (loff_t)block * blksz, blksz, buf,
+			     &actread) < 0 || actread != blksz)
+		return -EIO;
+
+	return 0;
+}
+
+/* Check the count and limit of a node and set up its frame */
+static int dx_init_frame(struct dx_frame *frame, int offset, int blksz)
+{
+	struct dx_countlimit *cl = (void *)frame->buf + offset;
+	unsigned int limit = le16_to_cpu(cl->limit);
+	unsigned int max = (blksz - offset) / sizeof(struct dx_entry);
+
+	frame->entries = (struct dx_entry *)cl;
+	frame->count = le16_to_cpu(cl->count);
+	/* With metadata_csum the last slot holds a checksum (dx_tail) */
+	if ((limit != max && limit != max - 1) ||
+	    !frame->count || frame->count > limit)
+		return -EINVAL;
+
+	return 0;
+}
+
+/* Find the last entry whose hash is not above @hash */
+static unsigned int dx_search(struct dx_frame *frame, u32 hash)
+{
+	unsigned int lo = 1, hi = frame->count;
+
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+
+		if (le32_to_cpu(frame->entries[mid].hash) > hash)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo - 1;
+}
+
+static u32 dx_get_block(struct dx_entry *entry)
+{
+	return le32_to_cpu(entry->block) & 0x0fffffff;
+}
+
+/**
+ * ext4fs_htree_leaves() - Find the directory blocks which can hold a name
+ *
+ * This is normally a single block. Names whose hash collides with names in
+ * the following blocks may be in those as well, which is marked in the tree
+ * by setting bit 0 of the hash of the following block.
+ *
+ * @dir:	Directory, with EXT4_INDEX_FL set
+ * @name:	Name to look for
+ * @leaves:	Returns the logical numbers of the blocks to search
+ * @max:	Size of @leaves
+ * @return number of blocks in @leaves, -ENOSYS if the directory must be
+ *	scanned instead, other -ve value on error
+ */
+int ext4fs_htree_leaves(struct ext2fs_node *dir, const char *name,
+			u32 *leaves, int max)
+{
+	struct ext2_sblock *sb = &dir->data->sblock;
+	int blksz = EXT2_BLOCK_SIZE(dir->data);
+	struct dx_frame frames[DX_MAX_LEVELS + 1];
+	struct dx_root_info *info;
+	int levels, level, version, count;
+	u32 hash, next;
+	char *buf;
+	int ret;
+
+	buf = malloc(blksz * (DX_MAX_LEVELS + 1));
+	if (!buf)
+		return -ENOMEM;
+	for (level = 0; level <= DX_MAX_LEVELS; level++)
+		frames[level].buf = buf + level * blksz;
+
+	/* The root follows the '.' and '..' entries of block 0 */
+	ret = dx_read_block(dir, 0, frames[0].buf);
+	if (ret)
+		goto out;
+	info = (void *)frames[0].buf + 24;
+	levels = info->indirect_levels;
+	if (info->reserved_zero || info->info_length != sizeof(*info) ||
+	    info->unused_flags & 1 || levels > DX_MAX_LEVELS) {
+		ret = -ENOSYS;
+		goto out;
+	}
+	version = info->hash_version;
+	if (version < DX_HASH_UNSIGNED &&
+	    le32_to_cpu(sb->flags) & EXT2_FLAGS_UNSIGNED_HASH)
+		version += DX_HASH_UNSIGNED;
+	ret = ext4fs_dirhash(name, strlen(name), version, sb->hash_seed,
+			     &hash);
+	if (ret)
+		goto out;
+
+	ret = -ENOSYS;
+	if (dx_init_frame(&frames[0], 24 + info->info_length, blksz))
+		goto out;
+	for (level = 0; ; level++) {
+		struct dx_frame *frame = &frames[level];
+
+		frame->at = dx_search(frame, hash);
+		if (level == levels)
+			break;
+		/* Nodes start with an empty directory entry */
+		if (dx_read_block(dir, dx_get_block(&frame->entries[frame->at]),
+				  frames[level + 1].buf) ||
+		    dx_init_frame(&frames[level + 1], 8, blksz))
+			goto out;
+	}
+	leaves[0] = dx_get_block(&frames[levels].entries[frames[levels].at]);
+
+	/* Add the following blocks as long as they continue the hash */
+	for (count = 1; ; count++) {
+		for (level = levels; level >= 0; level--) {
+			if (frames[level].at + 1 < frames[level].count)
+				break;
+		}
+		if (level < 0)
+			break;
+		next = le32_to_cpu(frames[level].entries[frames[level].at + 1].hash);
+		if (!(next & 1) || (next & ~1) != hash)
+			break;
+		if (count == max)
+			goto out;
+
+		frames[level].at++;
+		for (; level < levels; level++) {
+			struct dx_frame *frame = &frames[level];
+
+			if (dx_read_block(dir,
+					  dx_get_block(&frame->entries[frame->at]),
+					  frames[level + 1].buf) ||
+			    dx_init_frame(&frames[level + 1], 8, blksz))
+				goto out;
+			frames[level + 1].at = 0;
+		}
+		leaves[count] =
+			dx_get_block(&frames[levels].entries[frames[levels].at]);
+	}
+	ret = count;
+out:
+	free(buf);
+
+	return ret;
+}
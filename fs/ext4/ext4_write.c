@@ -25,6 +25,7 @@
 #include <memalign.h>
 #include <linux/stat.h>
 #include <div64.h>
+#include <fs_internal.h>
 #include "ext4_common.h"
 
 static inline void ext4fs_sb_free_inodes_inc(struct ext2_sblock *sb)
@@ -74,21 +75,17 @@ static void ext4fs_update(void)
 	put_ext4((uint64_t)(SUPERBLOCK_SIZE),
 		 (struct ext2_sblock *)fs->sb, (uint32_t)SUPERBLOCK_SIZE);
 
-	/* update block bitmaps */
+	/* update the bitmaps of the groups which were changed */
 	for (i = 0; i < fs->no_blkgrp; i++) {
 		bgd = ext4fs_get_group_descriptor(fs, i);
 		bgd->bg_checksum = cpu_to_le16(ext4fs_checksum_update(i));
-		uint64_t b_bitmap_blk = ext4fs_bg_get_block_id(bgd, fs);
-		put_ext4(b_bitmap_blk * fs->blksz,
-			 fs->blk_bmaps[i], fs->blksz);
-	}
-
-	/* update inode bitmaps */
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		bgd = ext4fs_get_group_descriptor(fs, i);
-		uint64_t i_bitmap_blk = ext4fs_bg_get_inode_id(bgd, fs);
-		put_ext4(i_bitmap_blk * fs->blksz,
-			 fs->inode_bmaps[i], fs->blksz);
+		if (fs->bmap_dirty[i] & EXT4_BMAP_BLK_DIRTY)
+			put_ext4(ext4fs_bg_get_block_id(bgd, fs) * fs->blksz,
+				 fs->blk_bmaps[i], fs->blksz);
+		if (fs->bmap_dirty[i] & EXT4_BMAP_INODE_DIRTY)
+			put_ext4(ext4fs_bg_get_inode_id(bgd, fs) * fs->blksz,
+				 fs->inode_bmaps[i], fs->blksz);
+		fs->bmap_dirty[i] = 0;
 	}
 
 	/* update the block group descriptor table */
@@ -140,6 +137,7 @@ static void delete_single_indirect_block(struct ext2_inode *inode)
 	int remainder;
 	int bg_idx;
 	int status;
+	unsigned char *bmap;
 	uint32_t blk_per_grp = le32_to_cpu(ext4fs_root->sblock.blocks_per_group);
 	struct ext_filesystem *fs = get_fs();
 	char *journal_buffer = zalloc(fs->blksz);
@@ -158,7 +156,10 @@ static void delete_single_indirect_block(struct ext2_inode *inode)
 			if (!remainder)
 				bg_idx--;
 		}
-		ext4fs_reset_block_bmap(blknr, fs->blk_bmaps[bg_idx], bg_idx);
+		bmap = ext4fs_get_blk_bmap(bg_idx);
+		if (!bmap)
+			goto fail;
+		ext4fs_reset_block_bmap(blknr, bmap, bg_idx);
 		/* get  block group descriptor table */
 		bgd = ext4fs_get_group_descriptor(fs, bg_idx);
 		ext4fs_bg_free_blocks_inc(bgd, fs);
@@ -188,6 +189,7 @@ static void delete_double_indirect_block(struct ext2_inode *inode)
 	uint32_t blknr;
 	int remainder;
 	int bg_idx;
+	unsigned char *bmap;
 	uint32_t blk_per_grp = le32_to_cpu(ext4fs_root->sblock.blocks_per_group);
 	__le32 *di_buffer = NULL;
 	void *dib_start_addr = NULL;
@@ -222,8 +224,11 @@ static void delete_double_indirect_block(struct ext2_inode *inode)
 			}
 			/* get  block group descriptor table */
 			bgd = ext4fs_get_group_descriptor(fs, bg_idx);
-			ext4fs_reset_block_bmap(le32_to_cpu(*di_buffer),
-					fs->blk_bmaps[bg_idx], bg_idx);
+			bmap = ext4fs_get_blk_bmap(bg_idx);
+			if (!bmap)
+				goto fail;
+			ext4fs_reset_block_bmap(le32_to_cpu(*di_buffer), bmap,
+						bg_idx);
 			di_buffer++;
 			ext4fs_bg_free_blocks_inc(bgd, fs);
 			ext4fs_sb_free_blocks_inc(fs->sb);
@@ -255,7 +260,10 @@ static void delete_double_indirect_block(struct ext2_inode *inode)
 		}
 		/* get  block group descriptor table */
 		bgd = ext4fs_get_group_descriptor(fs, bg_idx);
-		ext4fs_reset_block_bmap(blknr, fs->blk_bmaps[bg_idx], bg_idx);
+		bmap = ext4fs_get_blk_bmap(bg_idx);
+		if (!bmap)
+			goto fail;
+		ext4fs_reset_block_bmap(blknr, bmap, bg_idx);
 		ext4fs_bg_free_blocks_inc(bgd, fs);
 		ext4fs_sb_free_blocks_inc(fs->sb);
 		/* journal backup */
@@ -285,6 +293,7 @@ static void delete_triple_indirect_block(struct ext2_inode *inode)
 	uint32_t blknr;
 	int remainder;
 	int bg_idx;
+	unsigned char *bmap;
 	uint32_t blk_per_grp = le32_to_cpu(ext4fs_root->sblock.blocks_per_group);
 	__le32 *tigp_buffer = NULL;
 	void *tib_start_addr = NULL;
@@ -330,9 +339,11 @@ static void delete_triple_indirect_block(struct ext2_inode *inode)
 						bg_idx--;
 				}
 
+				bmap = ext4fs_get_blk_bmap(bg_idx);
+				if (!bmap)
+					goto fail;
 				ext4fs_reset_block_bmap(le32_to_cpu(*tip_buffer),
-							fs->blk_bmaps[bg_idx],
-							bg_idx);
+							bmap, bg_idx);
 
 				tip_buffer++;
 				/* get  block group descriptor table */
@@ -371,8 +382,11 @@ static void delete_triple_indirect_block(struct ext2_inode *inode)
 				if (!remainder)
 					bg_idx--;
 			}
+			bmap = ext4fs_get_blk_bmap(bg_idx);
+			if (!bmap)
+				goto fail;
 			ext4fs_reset_block_bmap(le32_to_cpu(*tigp_buffer),
-						fs->blk_bmaps[bg_idx], bg_idx);
+						bmap, bg_idx);
 
 			tigp_buffer++;
 			/* get  block group descriptor table */
@@ -406,7 +420,10 @@ static void delete_triple_indirect_block(struct ext2_inode *inode)
 			if (!remainder)
 				bg_idx--;
 		}
-		ext4fs_reset_block_bmap(blknr, fs->blk_bmaps[bg_idx], bg_idx);
+		bmap = ext4fs_get_blk_bmap(bg_idx);
+		if (!bmap)
+			goto fail;
+		ext4fs_reset_block_bmap(blknr, bmap, bg_idx);
 		/* get  block group descriptor table */
 		bgd = ext4fs_get_group_descriptor(fs, bg_idx);
 		ext4fs_bg_free_blocks_inc(bgd, fs);
@@ -431,6 +448,32 @@ fail:
 	free(journal_buffer);
 }
 
+/* Blocks freed by ext4fs_delete_file(), discarded after ext4fs_update() */
+static struct fs_discard_list ext4fs_discards;
+
+static bool ext4fs_block_is_free(void *priv, ulong blknr)
+{
+	uint32_t blk_per_grp;
+	unsigned char *bmap;
+	int bg_idx;
+
+	blk_per_grp = le32_to_cpu(ext4fs_root->sblock.blocks_per_group);
+	bg_idx = blknr / blk_per_grp;
+	if (get_fs()->blksz == 1024 && !(blknr % blk_per_grp))
+		bg_idx--;
+	bmap = ext4fs_get_blk_bmap(bg_idx);
+
+	return bmap && !ext4fs_test_block_bmap(blknr, bmap, bg_idx);
+}
+
+static int ext4fs_discard_blocks(void *priv, ulong start, ulong count)
+{
+	struct ext_filesystem *fs = get_fs();
+
+	return ext4fs_devdiscard((lbaint_t)start * fs->sect_perblk,
+				 (lbaint_t)count * fs->sect_perblk);
+}
+
 static int ext4fs_delete_file(int inodeno)
 {
 	struct ext2_inode inode;
@@ -440,6 +483,7 @@ static int ext4fs_delete_file(int inodeno)
 	long int blknr;
 	int bg_idx;
 	int ibmap_idx;
+	unsigned char *bmap;
 	char *read_buffer = NULL;
 	char *start_block_address = NULL;
 	uint32_t no_blocks;
@@ -499,10 +543,14 @@ static int ext4fs_delete_file(int inodeno)
 			if (!remainder)
 				bg_idx--;
 		}
-		ext4fs_reset_block_bmap(blknr, fs->blk_bmaps[bg_idx],
-					bg_idx);
+		bmap = ext4fs_get_blk_bmap(bg_idx);
+		if (!bmap)
+			goto fail;
+		ext4fs_reset_block_bmap(blknr, bmap, bg_idx);
 		debug("EXT4 Block releasing %ld: %d\n", blknr, bg_idx);
 
+		fs_discard_add(&ext4fs_discards, blknr);
+
 		/* get  block group descriptor table */
 		bgd = ext4fs_get_group_descriptor(fs, bg_idx);
 		ext4fs_bg_free_blocks_inc(bgd, fs);
@@ -559,7 +607,10 @@ static int ext4fs_delete_file(int inodeno)
 
 	/* update the respective inode bitmaps */
 	inodeno++;
-	ext4fs_reset_inode_bmap(inodeno, fs->inode_bmaps[ibmap_idx], ibmap_idx);
+	bmap = ext4fs_get_inode_bmap(ibmap_idx);
+	if (!bmap)
+		goto fail;
+	ext4fs_reset_inode_bmap(inodeno, bmap, ibmap_idx);
 	ext4fs_bg_free_inodes_inc(bgd, fs);
 	ext4fs_sb_free_inodes_inc(fs->sb);
 	/* journal backup */
@@ -593,11 +644,13 @@ fail:
 
 int ext4fs_init(void)
 {
-	short status;
 	int i;
 	uint32_t real_free_blocks = 0;
 	struct ext_filesystem *fs = get_fs();
 
+	/* cached lookups may be stale once anything is written */
+	ext4fs_dcache_invalidate();
+
 	/* populate fs */
 	fs->blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	fs->sect_perblk = fs->blksz >> fs->dev_desc->log2blksz;
@@ -626,46 +679,12 @@ int ext4fs_init(void)
 		goto fail;
 	}
 
-	/* load all the available bitmap block of the partition */
+	/* the bitmaps are only read when a group is used */
 	fs->blk_bmaps = zalloc(fs->no_blkgrp * sizeof(char *));
-	if (!fs->blk_bmaps)
-		goto fail;
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		fs->blk_bmaps[i] = zalloc(fs->blksz);
-		if (!fs->blk_bmaps[i])
-			goto fail;
-	}
-
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		struct ext2_block_group *bgd =
-			ext4fs_get_group_descriptor(fs, i);
-		status = ext4fs_devread(ext4fs_bg_get_block_id(bgd, fs) *
-				   fs->sect_perblk, 0,
-				   fs->blksz, (char *)fs->blk_bmaps[i]);
-		if (status == 0)
-			goto fail;
-	}
-
-	/* load all the available inode bitmap of the partition */
 	fs->inode_bmaps = zalloc(fs->no_blkgrp * sizeof(unsigned char *));
-	if (!fs->inode_bmaps)
+	fs->bmap_dirty = zalloc(fs->no_blkgrp);
+	if (!fs->blk_bmaps || !fs->inode_bmaps || !fs->bmap_dirty)
 		goto fail;
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		fs->inode_bmaps[i] = zalloc(fs->blksz);
-		if (!fs->inode_bmaps[i])
-			goto fail;
-	}
-
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		struct ext2_block_group *bgd =
-			ext4fs_get_group_descriptor(fs, i);
-		status = ext4fs_devread(ext4fs_bg_get_inode_id(bgd, fs) *
-					fs->sect_perblk,
-					0, fs->blksz,
-					(char *)fs->inode_bmaps[i]);
-		if (status == 0)
-			goto fail;
-	}
 
 	/*
 	 * check filesystem consistency with free blocks of file system
@@ -742,6 +761,8 @@ void ext4fs_deinit(void)
 		free(fs->inode_bmaps);
 		fs->inode_bmaps = NULL;
 	}
+	free(fs->bmap_dirty);
+	fs->bmap_dirty = NULL;
 
 
 	free(fs->gdtable);
@@ -754,6 +775,7 @@ void ext4fs_deinit(void)
 	fs->first_pass_bbmap = 0;
 	fs->curr_inode_no = 0;
 	fs->curr_blkno = 0;
+	ext4fs_dcache_invalidate();
 }
 
 /*
@@ -786,7 +808,7 @@ static int ext4fs_write_file(struct ext2_inode *file_inode,
 		int blockend = fs->blksz;
 		int skipfirst = 0;
 		blknr = read_allocated_block(file_inode, i, NULL);
-		if (blknr <= 0)
+		if (blknr < 0)
 			return -1;
 
 		blknr = blknr << log2_fs_blocksize;
@@ -953,9 +975,10 @@ int ext4fs_write(const char *fname, const char *buffer,
 	file_inode->ctime = cpu_to_le32(timestamp);
 	file_inode->nlinks = cpu_to_le16(1);
 
-	/* Allocate data blocks */
+	/* Allocate data blocks, zero blocks of regular files may be holes */
 	ext4fs_allocate_blocks(file_inode, blocks_remaining,
-			       &blks_reqd_for_file);
+			       &blks_reqd_for_file,
+			       type == FILETYPE_REG ? buffer : NULL, sizebytes);
 	file_inode->blockcnt = cpu_to_le32((blks_reqd_for_file * fs->blksz) >>
 					   LOG2_SECTOR_SIZE);
 
@@ -1011,6 +1034,9 @@ int ext4fs_write(const char *fname, const char *buffer,
 			goto fail;
 	}
 	ext4fs_update();
+	/* The blocks of the old file are only free once this is written */
+	fs_discard_flush(&ext4fs_discards, NULL, ext4fs_block_is_free,
+			 ext4fs_discard_blocks);
 	ext4fs_deinit();
 
 	fs->first_pass_bbmap = 0;
@@ -1024,6 +1050,7 @@ int ext4fs_write(const char *fname, const char *buffer,
 
 	return 0;
 fail:
+	fs_discard_free(&ext4fs_discards);
 	ext4fs_deinit();
 	free(inode_buffer);
 	free(g_parent_inode);
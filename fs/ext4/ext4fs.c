@@ -25,6 +25,11 @@
 #include <ext4fs.h>
 #include "ext4_common.h"
 #include <div64.h>
+#include <fs.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <sort.h>
+#include <linux/sizes.h>
 
 int ext4fs_symlinknest;
 struct ext_filesystem ext_fs;
@@ -40,6 +45,59 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 		free(node);
 }
 
+/*
+ * Read a file using extents: each extent is read with a single request,
+ * straight to the buffer, and holes are cleared without looking up every
+ * block.
+ */
+static int ext4fs_read_extents(struct ext2fs_node *node, loff_t pos,
+			       loff_t len, char *buf)
+{
+	struct ext_filesystem *fs = get_fs();
+	int log2_fs_blksz = LOG2_BLOCK_SIZE(node->data);
+	int log2_fs_blocksize = log2_fs_blksz - fs->dev_desc->log2blksz;
+	/* Keep each request below the int byte count of ext4fs_devread() */
+	uint32_t maxrun = SZ_1G >> log2_fs_blksz;
+	struct ext_block_cache cache;
+	uint32_t fileblock, nblocks;
+	int skip = pos & ((1 << log2_fs_blksz) - 1);
+	uint64_t blknr;
+	loff_t bytes;
+	long run;
+	int ret = 0;
+
+	ext_cache_init(&cache);
+	fileblock = pos >> log2_fs_blksz;
+	while (len > 0) {
+		nblocks = min_t(loff_t, (skip + len + (1 << log2_fs_blksz) - 1) >>
+				log2_fs_blksz, maxrun);
+		run = ext4fs_map_extent(&node->inode, &cache, fileblock,
+					nblocks, &blknr);
+		if (run < 0) {
+			ret = -1;
+			break;
+		}
+
+		bytes = min(((loff_t)run << log2_fs_blksz) - skip, len);
+		if (blknr) {
+			if (!ext4fs_devread((lbaint_t)blknr << log2_fs_blocksize,
+					    skip, bytes, buf)) {
+				ret = -1;
+				break;
+			}
+		} else {
+			memset(buf, '\0', bytes);
+		}
+		buf += bytes;
+		len -= bytes;
+		fileblock += run;
+		skip = 0;
+	}
+	ext_cache_fini(&cache);
+
+	return ret;
+}
+
 /*
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
@@ -76,6 +134,14 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		return -1;
 	}
 
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL) {
+		ext_cache_fini(&cache);
+		if (ext4fs_read_extents(node, pos, len, buf))
+			return -1;
+		*actread = len;
+		return 0;
+	}
+
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
 	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
@@ -255,6 +321,138 @@ int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	return ext4fs_read(buf, offset, len, len_read);
 }
 
+/* A run of contiguous blocks of one of the files read by ext4fs_read_files() */
+struct ext4_load_run {
+	uint64_t blknr;
+	char *buf;
+	loff_t len;
+};
+
+static int ext4_load_run_cmp(const void *a, const void *b)
+{
+	const struct ext4_load_run *ra = a, *rb = b;
+
+	if (ra->blknr == rb->blknr)
+		return 0;
+
+	return ra->blknr < rb->blknr ? -1 : 1;
+}
+
+/*
+ * Add the runs of blocks of a file to @runsp, to be read later, and clear
+ * its holes now. A file without extents is read straight away instead.
+ */
+static int ext4fs_add_runs(struct ext2fs_node *node, loff_t len, char *buf,
+			   struct ext4_load_run **runsp, int *countp,
+			   int *maxp)
+{
+	int log2_fs_blksz = LOG2_BLOCK_SIZE(node->data);
+	uint32_t maxrun = SZ_1G >> log2_fs_blksz;
+	struct ext_block_cache cache;
+	struct ext4_load_run *run;
+	uint32_t fileblock = 0;
+	uint64_t blknr;
+	loff_t bytes;
+	long nblocks;
+	int ret = 0;
+
+	if (!(le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL))
+		return ext4fs_read_file(node, 0, len, buf, &bytes);
+
+	ext_cache_init(&cache);
+	while (len > 0) {
+		nblocks = min_t(loff_t, (len + (1 << log2_fs_blksz) - 1) >>
+				log2_fs_blksz, maxrun);
+		nblocks = ext4fs_map_extent(&node->inode, &cache, fileblock,
+					    nblocks, &blknr);
+		if (nblocks < 0) {
+			ret = -1;
+			break;
+		}
+
+		bytes = min((loff_t)nblocks << log2_fs_blksz, len);
+		if (blknr) {
+			if (*countp == *maxp) {
+				run = realloc(*runsp, 2 * *maxp * sizeof(*run));
+				if (!run) {
+					ret = -ENOMEM;
+					break;
+				}
+				*runsp = run;
+				*maxp *= 2;
+			}
+			run = *runsp + (*countp)++;
+			run->blknr = blknr;
+			run->buf = buf;
+			run->len = bytes;
+		} else {
+			memset(buf, '\0', bytes);
+		}
+		buf += bytes;
+		len -= bytes;
+		fileblock += nblocks;
+	}
+	ext_cache_fini(&cache);
+
+	return ret;
+}
+
+/*
+ * Read several whole files together: the extents of all of them are
+ * collected first, then read in the order of their blocks on the device so
+ * that the device sees one forward sweep instead of a seek per extent.
+ * Runs which follow each other both on the device and in memory are read
+ * with a single request.
+ */
+int ext4fs_read_files(struct fs_load_file *files, int count)
+{
+	int log2_fs_blksz = LOG2_BLOCK_SIZE(ext4fs_root);
+	int log2_fs_blocksize = log2_fs_blksz - get_fs()->dev_desc->log2blksz;
+	struct ext4_load_run *runs, *run, *next, *end;
+	struct fs_load_file *f;
+	int i, nruns = 0, maxruns = 16;
+	loff_t len;
+	int ret = 0;
+
+	runs = malloc(maxruns * sizeof(*runs));
+	if (!runs)
+		return -ENOMEM;
+
+	for (i = 0, f = files; i < count && !ret; i++, f++) {
+		if (ext4fs_open(f->filename, &len) < 0) {
+			printf("** File not found %s **\n", f->filename);
+			ret = -1;
+			break;
+		}
+		f->size = len;
+		if (len)
+			ret = ext4fs_add_runs(ext4fs_file, len,
+					      map_sysmem(f->addr, len), &runs,
+					      &nruns, &maxruns);
+		ext4fs_release();
+	}
+
+	qsort(runs, nruns, sizeof(*runs), ext4_load_run_cmp);
+	end = runs + nruns;
+	for (run = runs; !ret && run < end; run = next) {
+		len = run->len;
+		for (next = run + 1; next < end; next++) {
+			if (len & ((1 << log2_fs_blksz) - 1) ||
+			    len + next->len > SZ_1G ||
+			    next->buf != run->buf + len ||
+			    next->blknr - run->blknr != len >> log2_fs_blksz)
+				break;
+			len += next->len;
+		}
+		if (!ext4fs_devread((lbaint_t)run->blknr << log2_fs_blocksize,
+				    0, len, run->buf))
+			ret = -1;
+	}
+	free(runs);
+
+	return ret;
+}
+
 int ext4fs_uuid(char *uuid_str)
 {
 	if (ext4fs_root == NULL)
@@ -37,6 +37,25 @@ static void downcase(char *str, size_t len)
 static struct blk_desc *cur_dev;
 static disk_partition_t cur_part_info;
 
+/*
+ * Where the cluster chain of a file was last entered by get_contents(), so
+ * that reading a file in pieces, in order, does not walk the chain from the
+ * start every time. This is dropped whenever the volume is mounted again
+ * or written to, so it only lasts while fs_close() keeps the volume mounted
+ * (CONFIG_FS_MOUNT_CACHE).
+ */
+static struct {
+	__u32 start;	/* First cluster of the file, 0 if unset */
+	loff_t size;	/* Size of the file */
+	loff_t pos;	/* Offset in the file of @clust */
+	__u32 clust;
+} fat_cursor;
+
+static void fat_cursor_reset(void)
+{
+	fat_cursor.start = 0;
+}
+
 #define DOS_BOOT_MAGIC_OFFSET	0x1fe
 #define DOS_FS_TYPE_OFFSET	0x36
 #define DOS_FS32_TYPE_OFFSET	0x52
@@ -60,6 +79,10 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, disk_partition_t *info)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, buffer, dev_desc->blksz);
 
+	/* A file system kept mounted by fs_close() still uses cur_dev */
+	fs_unmount();
+
+	fat_cursor_reset();
 	cur_dev = dev_desc;
 	cur_part_info = *info;
 
@@ -91,6 +114,7 @@ int fat_register_device(struct blk_desc *dev_desc, int part_no)
 
 	/* First close any currently found FAT filesystem */
 	cur_dev = NULL;
+	fat_cursor_reset();
 
 	/* Read the partition table, if present */
 	if (part_get_info(dev_desc, part_no, &info)) {
@@ -155,6 +179,63 @@ int flush_dirty_fat_buffer(fsdata *mydata)
 }
 #endif
 
+/* Number of FAT windows read at once when the whole FAT is cached */
+#define FAT_CACHE_READAHEAD	16
+
+/*
+ * Get a pointer to window 'bufnum' of the FAT, reading it if needed.
+ *
+ * If the whole FAT is cached, each window is read only once, together with
+ * any following windows not read yet. Otherwise the single window buffer is
+ * written back if needed and reused.
+ * Return NULL on failure.
+ */
+static __u8 *get_fatbuf(fsdata *mydata, __u32 bufnum)
+{
+	__u32 getsize = FATBUFBLOCKS;
+	__u8 *bufptr = mydata->fatbuf;
+	__u32 fatlength = mydata->fatlength;
+	__u32 startblock = bufnum * FATBUFBLOCKS;
+	__u32 nwin, end = bufnum + 1;
+
+	if (mydata->fatwin) {
+		bufptr += startblock * mydata->sect_size;
+		if (mydata->fatwin[bufnum] & FATWIN_LOADED)
+			return bufptr;
+
+		nwin = DIV_ROUND_UP(fatlength, FATBUFBLOCKS);
+		while (end < nwin && end - bufnum < FAT_CACHE_READAHEAD &&
+		       !(mydata->fatwin[end] & FATWIN_LOADED))
+			end++;
+		getsize = (end - bufnum) * FATBUFBLOCKS;
+	} else {
+		if (bufnum == mydata->fatbufnum)
+			return bufptr;
+
+		/* Write back the fatbuf to the disk */
+		if (flush_dirty_fat_buffer(mydata) < 0)
+			return NULL;
+	}
+
+	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+	if (startblock + getsize > fatlength)
+		getsize = fatlength - startblock;
+
+	startblock += mydata->fat_sect;	/* Offset from start of disk */
+
+	if (disk_read(startblock, getsize, bufptr) < 0) {
+		debug("Error reading FAT blocks\n");
+		return NULL;
+	}
+
+	if (mydata->fatwin)
+		memset(mydata->fatwin + bufnum, FATWIN_LOADED, end - bufnum);
+	else
+		mydata->fatbufnum = bufnum;
+
+	return bufptr;
+}
+
 /*
  * Get the entry at index 'entry' in a FAT (12/16/32) table.
  * On failure 0x00 is returned.
@@ -164,6 +245,7 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	__u32 bufnum;
 	__u32 offset, off8;
 	__u32 ret = 0x00;
+	__u8 *fatbuf;
 
 	if (CHECK_CLUST(entry, mydata->fatsize)) {
 		printf("Error: Invalid FAT entry: 0x%08x\n", entry);
@@ -193,41 +275,22 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	       mydata->fatsize, entry, entry, offset, offset);
 
 	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		startblock += mydata->fat_sect;	/* Offset from start of disk */
-
-		/* Write back the fatbuf to the disk */
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return ret;
-		}
-		mydata->fatbufnum = bufnum;
-	}
+	fatbuf = get_fatbuf(mydata, bufnum);
+	if (!fatbuf)
+		return ret;
 
 	/* Get the actual entry from the table */
 	switch (mydata->fatsize) {
 	case 32:
-		ret = FAT2CPU32(((__u32 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU32(((__u32 *)fatbuf)[offset]);
 		break;
 	case 16:
-		ret = FAT2CPU16(((__u16 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU16(((__u16 *)fatbuf)[offset]);
 		break;
 	case 12:
 		off8 = (offset * 3) / 2;
 		/* fatbut + off8 may be unaligned, read in byte granularity */
-		ret = mydata->fatbuf[off8] + (mydata->fatbuf[off8 + 1] << 8);
+		ret = fatbuf[off8] + (fatbuf[off8 + 1] << 8);
 
 		if (offset & 0x1)
 			ret >>= 4;
@@ -339,6 +402,12 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 	debug("%llu bytes\n", filesize);
 
 	actsize = bytesperclust;
+	if (fat_cursor.start == curclust &&
+	    fat_cursor.size == FAT2CPU32(dentptr->size) &&
+	    fat_cursor.pos <= pos) {
+		curclust = fat_cursor.clust;
+		actsize += fat_cursor.pos;
+	}
 
 	/* go to cluster at pos */
 	while (actsize <= pos) {
@@ -350,6 +419,10 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 		}
 		actsize += bytesperclust;
 	}
+	fat_cursor.start = START(dentptr);
+	fat_cursor.size = FAT2CPU32(dentptr->size);
+	fat_cursor.pos = actsize - bytesperclust;
+	fat_cursor.clust = curclust;
 
 	/* actsize > pos */
 	actsize -= bytesperclust;
@@ -623,7 +696,28 @@ static int get_fs_info(fsdata *mydata)
 
 	mydata->fatbufnum = -1;
 	mydata->fat_dirty = 0;
-	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
+	mydata->fatwin = NULL;
+	mydata->fatbuf = NULL;
+#if CONFIG_IS_ENABLED(FS_FAT_CACHE)
+	/*
+	 * Keep the whole FAT in memory, so that following a cluster chain
+	 * does not read the same sectors again and FAT updates are written
+	 * back together. The window flags follow the FAT in the same buffer.
+	 */
+	if ((ulong)mydata->fatlength * mydata->sect_size <=
+	    CONFIG_FS_FAT_CACHE_MAX_SIZE) {
+		ulong size = mydata->fatlength * mydata->sect_size;
+		ulong nwin = DIV_ROUND_UP(mydata->fatlength, FATBUFBLOCKS);
+
+		mydata->fatbuf = malloc_cache_aligned(size + nwin);
+		if (mydata->fatbuf) {
+			mydata->fatwin = mydata->fatbuf + size;
+			memset(mydata->fatwin, '\0', nwin);
+		}
+	}
+#endif
+	if (!mydata->fatbuf)
+		mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
 	if (mydata->fatbuf == NULL) {
 		debug("Error: allocating memory\n");
 		return -1;
@@ -9,6 +9,7 @@
 #include <command.h>
 #include <config.h>
 #include <fat.h>
+#include <fs_internal.h>
 #include <asm/byteorder.h>
 #include <part.h>
 #include <linux/ctype.h>
@@ -99,6 +100,63 @@ static void set_name(dir_entry *dirent, const char *filename)
 	debug("ext : %s\n", dirent->ext);
 }
 
+/*
+ * Write 'getsize' sectors from 'bufptr' to both copies of the FAT, starting
+ * at sector 'startblock' of the FAT
+ */
+static int write_fat_blocks(fsdata *mydata, __u32 startblock, __u32 getsize,
+			    __u8 *bufptr)
+{
+	startblock += mydata->fat_sect;
+
+	/* Write FAT buf */
+	if (disk_write(startblock, getsize, bufptr) < 0) {
+		debug("error: writing FAT blocks\n");
+		return -1;
+	}
+
+	if (mydata->fats == 2) {
+		/* Update corresponding second FAT blocks */
+		startblock += mydata->fatlength;
+		if (disk_write(startblock, getsize, bufptr) < 0) {
+			debug("error: writing second FAT blocks\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Write back the modified windows of a FAT cached as a whole, merging
+ * neighbouring windows into a single write
+ */
+static int flush_fat_cache(fsdata *mydata)
+{
+	__u32 nwin = DIV_ROUND_UP(mydata->fatlength, FATBUFBLOCKS);
+	__u32 start, end, startblock, getsize;
+
+	for (start = 0; start < nwin; start = end + 1) {
+		for (end = start; end < nwin; end++) {
+			if (!(mydata->fatwin[end] & FATWIN_DIRTY))
+				break;
+			mydata->fatwin[end] &= ~FATWIN_DIRTY;
+		}
+		if (end == start)
+			continue;
+
+		startblock = start * FATBUFBLOCKS;
+		getsize = min(end * FATBUFBLOCKS, mydata->fatlength) -
+			  startblock;
+		if (write_fat_blocks(mydata, startblock, getsize,
+				     mydata->fatbuf +
+				     startblock * mydata->sect_size) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
 /*
  * Write fat buffer into block device
  */
@@ -112,29 +170,25 @@ static int flush_dirty_fat_buffer(fsdata *mydata)
 	debug("debug: evicting %d, dirty: %d\n", mydata->fatbufnum,
 	      (int)mydata->fat_dirty);
 
-	if ((!mydata->fat_dirty) || (mydata->fatbufnum == -1))
+	if (!mydata->fat_dirty)
+		return 0;
+
+	if (mydata->fatwin) {
+		if (flush_fat_cache(mydata) < 0)
+			return -1;
+		mydata->fat_dirty = 0;
+		return 0;
+	}
+
+	if (mydata->fatbufnum == -1)
 		return 0;
 
 	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
 	if (startblock + getsize > fatlength)
 		getsize = fatlength - startblock;
 
-	startblock += mydata->fat_sect;
-
-	/* Write FAT buf */
-	if (disk_write(startblock, getsize, bufptr) < 0) {
-		debug("error: writing FAT blocks\n");
+	if (write_fat_blocks(mydata, startblock, getsize, bufptr) < 0)
 		return -1;
-	}
-
-	if (mydata->fats == 2) {
-		/* Update corresponding second FAT blocks */
-		startblock += mydata->fatlength;
-		if (disk_write(startblock, getsize, bufptr) < 0) {
-			debug("error: writing second FAT blocks\n");
-			return -1;
-		}
-	}
 	mydata->fat_dirty = 0;
 
 	return 0;
@@ -265,6 +319,7 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 {
 	__u32 bufnum, offset, off16;
 	__u16 val1, val2;
+	__u8 *fatbuf;
 
 	switch (mydata->fatsize) {
 	case 32:
@@ -285,38 +340,22 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 	}
 
 	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		startblock += mydata->fat_sect;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return -1;
-		}
-		mydata->fatbufnum = bufnum;
-	}
+	fatbuf = get_fatbuf(mydata, bufnum);
+	if (!fatbuf)
+		return -1;
 
 	/* Mark as dirty */
 	mydata->fat_dirty = 1;
+	if (mydata->fatwin)
+		mydata->fatwin[bufnum] |= FATWIN_DIRTY;
 
 	/* Set the actual entry */
 	switch (mydata->fatsize) {
 	case 32:
-		((__u32 *) mydata->fatbuf)[offset] = cpu_to_le32(entry_value);
+		((__u32 *)fatbuf)[offset] = cpu_to_le32(entry_value);
 		break;
 	case 16:
-		((__u16 *) mydata->fatbuf)[offset] = cpu_to_le16(entry_value);
+		((__u16 *)fatbuf)[offset] = cpu_to_le16(entry_value);
 		break;
 	case 12:
 		off16 = (offset * 3) / 4;
@@ -324,33 +363,33 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 		switch (offset & 0x3) {
 		case 0:
 			val1 = cpu_to_le16(entry_value) & 0xfff;
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xfff;
-			((__u16 *)mydata->fatbuf)[off16] |= val1;
+			((__u16 *)fatbuf)[off16] &= ~0xfff;
+			((__u16 *)fatbuf)[off16] |= val1;
 			break;
 		case 1:
 			val1 = cpu_to_le16(entry_value) & 0xf;
 			val2 = (cpu_to_le16(entry_value) >> 4) & 0xff;
 
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xf000;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 12);
+			((__u16 *)fatbuf)[off16] &= ~0xf000;
+			((__u16 *)fatbuf)[off16] |= (val1 << 12);
 
-			((__u16 *)mydata->fatbuf)[off16 + 1] &= ~0xff;
-			((__u16 *)mydata->fatbuf)[off16 + 1] |= val2;
+			((__u16 *)fatbuf)[off16 + 1] &= ~0xff;
+			((__u16 *)fatbuf)[off16 + 1] |= val2;
 			break;
 		case 2:
 			val1 = cpu_to_le16(entry_value) & 0xff;
 			val2 = (cpu_to_le16(entry_value) >> 8) & 0xf;
 
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xff00;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 8);
+			((__u16 *)fatbuf)[off16] &= ~0xff00;
+			((__u16 *)fatbuf)[off16] |= (val1 << 8);
 
-			((__u16 *)mydata->fatbuf)[off16 + 1] &= ~0xf;
-			((__u16 *)mydata->fatbuf)[off16 + 1] |= val2;
+			((__u16 *)fatbuf)[off16 + 1] &= ~0xf;
+			((__u16 *)fatbuf)[off16 + 1] |= val2;
 			break;
 		case 3:
 			val1 = cpu_to_le16(entry_value) & 0xfff;
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xfff0;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 4);
+			((__u16 *)fatbuf)[off16] &= ~0xfff0;
+			((__u16 *)fatbuf)[off16] |= (val1 << 4);
 			break;
 		default:
 			break;
@@ -653,6 +692,36 @@ static int new_dir_table(fat_itr *itr)
 	return 0;
 }
 
+/* Clusters freed by clear_fatent(), discarded once the directory is written */
+static struct fs_discard_list fat_discards;
+
+static bool fat_clust_is_free(void *priv, ulong clust)
+{
+	return !get_fatent(priv, clust);
+}
+
+static int fat_discard_clusters(void *priv, ulong start, ulong count)
+{
+	fsdata *mydata = priv;
+
+	return fs_devdiscard(cur_dev, &cur_part_info,
+			     clust_to_sect(mydata, start),
+			     count * mydata->clust_size);
+}
+
+/*
+ * Discard the clusters freed by an operation once it has written its
+ * metadata, or forget about them if it failed
+ */
+static void fat_discard_flush(fsdata *mydata, int ret)
+{
+	if (ret)
+		fs_discard_free(&fat_discards);
+	else
+		fs_discard_flush(&fat_discards, mydata, fat_clust_is_free,
+				 fat_discard_clusters);
+}
+
 /*
  * Set empty cluster from 'entry' to the end of a file
  */
@@ -667,6 +736,7 @@ static int clear_fatent(fsdata *mydata, __u32 entry)
 		else
 			break;
 
+		fs_discard_add(&fat_discards, entry);
 		entry = fat_val;
 	}
 
@@ -1082,6 +1152,7 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 
 	debug("writing %s\n", filename);
 
+	fat_cursor_reset();
 	filename_copy = strdup(filename);
 	if (!filename_copy)
 		return -ENOMEM;
@@ -1202,6 +1273,7 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 	}
 
 exit:
+	fat_discard_flush(mydata, ret);
 	free(filename_copy);
 	free(mydata->fatbuf);
 	free(itr);
@@ -1232,21 +1304,27 @@ static int fat_dir_entries(fat_itr *itr)
 	fat_itr_child(dirs, itr);
 	fsdata = *dirs->fsdata;
 
-	/* allocate local fat buffer */
-	fsdata.fatbuf = malloc_cache_aligned(FATBUFSIZE);
-	if (!fsdata.fatbuf) {
-		debug("Error: allocating memory\n");
-		count = -ENOMEM;
-		goto exit;
+	/*
+	 * allocate local fat buffer, unless the whole FAT is cached and can
+	 * be shared without evicting anything
+	 */
+	if (!fsdata.fatwin) {
+		fsdata.fatbuf = malloc_cache_aligned(FATBUFSIZE);
+		if (!fsdata.fatbuf) {
+			debug("Error: allocating memory\n");
+			count = -ENOMEM;
+			goto exit;
+		}
+		fsdata.fatbufnum = -1;
+		dirs->fsdata = &fsdata;
 	}
-	fsdata.fatbufnum = -1;
-	dirs->fsdata = &fsdata;
 
 	for (count = 0; fat_itr_next(dirs); count++)
 		;
 
 exit:
-	free(fsdata.fatbuf);
+	if (!fsdata.fatwin)
+		free(fsdata.fatbuf);
 	free(dirs);
 	return count;
 }
@@ -1287,6 +1365,7 @@ int fat_unlink(const char *filename)
 	int n_entries, ret;
 	char *filename_copy, *dirname, *basename;
 
+	fat_cursor_reset();
 	filename_copy = strdup(filename);
 	if (!filename_copy) {
 		printf("Error: allocating memory\n");
@@ -1344,6 +1423,7 @@ int fat_unlink(const char *filename)
 	ret = delete_dentry(itr);
 
 exit:
+	fat_discard_flush(&fsdata, ret);
 	free(fsdata.fatbuf);
 	free(itr);
 	free(filename_copy);
@@ -1364,6 +1444,7 @@ int fat_mkdir(const char *new_dirname)
 	unsigned int bytesperclust;
 	dir_entry *dotdent = NULL;
 
+	fat_cursor_reset();
 	dirname_copy = strdup(new_dirname);
 	if (!dirname_copy)
 		goto exit;
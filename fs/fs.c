@@ -6,7 +6,9 @@
 #include <config.h>
 #include <errno.h>
 #include <common.h>
+#include <bootstage.h>
 #include <env.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <part.h>
 #include <ext4fs.h>
@@ -15,6 +17,8 @@
 #include <sandboxfs.h>
 #include <ubifs_uboot.h>
 #include <btrfs.h>
+#include <erofs.h>
+#include <squashfs.h>
 #include <asm/io.h>
 #include <div64.h>
 #include <linux/math64.h>
@@ -144,6 +148,17 @@ struct fstype_info {
 	int (*write)(const char *filename, void *buf, loff_t offset,
 		     loff_t len, loff_t *actwrite);
 	void (*close)(void);
+	/*
+	 * Drop the state of the last operation but stay mounted, so that
+	 * the next command on the same partition does not need to probe
+	 * again. NULL if the file system must be closed after each command.
+	 */
+	void (*release)(void);
+	/*
+	 * Read whole files, already checked to exist and not to overlap,
+	 * together. See fs_read_files(). NULL to read them one at a time.
+	 */
+	int (*read_files)(struct fs_load_file *files, int count);
 	int (*uuid)(char *uuid_str);
 	/*
 	 * Open a directory stream.  On success return 0 and directory
@@ -172,6 +187,7 @@ static struct fstype_info fstypes[] = {
 		.null_dev_desc_ok = false,
 		.probe = fat_set_blk_dev,
 		.close = fat_close,
+		.release = fat_close,
 		.ls = fs_ls_generic,
 		.exists = fat_exists,
 		.size = fat_size,
@@ -200,10 +216,12 @@ static struct fstype_info fstypes[] = {
 		.null_dev_desc_ok = false,
 		.probe = ext4fs_probe,
 		.close = ext4fs_close,
+		.release = ext4fs_release,
 		.ls = ext4fs_ls,
 		.exists = ext4fs_exists,
 		.size = ext4fs_size,
 		.read = ext4_read_file,
+		.read_files = ext4fs_read_files,
 #ifdef CONFIG_CMD_EXT4_WRITE
 		.write = ext4_write_file,
 		.ln = ext4fs_create_link,
@@ -262,6 +280,7 @@ static struct fstype_info fstypes[] = {
 		.null_dev_desc_ok = false,
 		.probe = btrfs_probe,
 		.close = btrfs_close,
+		.release = btrfs_release,
 		.ls = btrfs_ls,
 		.exists = btrfs_exists,
 		.size = btrfs_size,
@@ -273,6 +292,50 @@ static struct fstype_info fstypes[] = {
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
 	},
+#endif
+#ifdef CONFIG_FS_EROFS
+	{
+		.fstype = FS_TYPE_EROFS,
+		.name = "erofs",
+		.null_dev_desc_ok = false,
+		.probe = erofs_probe,
+		.close = erofs_close,
+		.release = erofs_release,
+		.ls = fs_ls_generic,
+		.exists = erofs_exists,
+		.size = erofs_size,
+		.read = erofs_read,
+		.write = fs_write_unsupported,
+		.uuid = erofs_uuid,
+		.opendir = erofs_opendir,
+		.readdir = erofs_readdir,
+		.closedir = erofs_closedir,
+		.unlink = fs_unlink_unsupported,
+		.mkdir = fs_mkdir_unsupported,
+		.ln = fs_ln_unsupported,
+	},
+#endif
+#ifdef CONFIG_FS_SQUASHFS
+	{
+		.fstype = FS_TYPE_SQUASHFS,
+		.name = "squashfs",
+		.null_dev_desc_ok = false,
+		.probe = sqfs_probe,
+		.close = sqfs_close,
+		.release = sqfs_release,
+		.ls = fs_ls_generic,
+		.exists = sqfs_exists,
+		.size = sqfs_size,
+		.read = sqfs_read,
+		.write = fs_write_unsupported,
+		.uuid = fs_uuid_unsupported,
+		.opendir = sqfs_opendir,
+		.readdir = sqfs_readdir,
+		.closedir = sqfs_closedir,
+		.unlink = fs_unlink_unsupported,
+		.mkdir = fs_mkdir_unsupported,
+		.ln = fs_ln_unsupported,
+	},
 #endif
 	{
 		.fstype = FS_TYPE_ANY,
@@ -307,6 +370,104 @@ static struct fstype_info *fs_get_info(int fstype)
 	return info;
 }
 
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/**
+ * struct fs_mount - File system kept mounted between commands
+ *
+ * @desc:	Device, NULL if nothing is mounted
+ * @iftype:	IF_TYPE_x of @desc
+ * @devnum:	Device number of @desc
+ * @start:	First block of the partition
+ * @size:	Number of blocks in the partition
+ * @fstype:	FS_TYPE_x of the file system
+ * @stale:	The device has changed since the file system was mounted
+ */
+struct fs_mount {
+	struct blk_desc *desc;
+	int iftype;
+	int devnum;
+	lbaint_t start;
+	lbaint_t size;
+	int fstype;
+	bool stale;
+};
+
+static struct fs_mount fs_mount;
+
+/* Use the mounted file system if it is on the partition just selected */
+static bool fs_mount_reuse(int fstype)
+{
+	if (!fs_mount.desc || fs_mount.stale || fs_mount.desc != fs_dev_desc ||
+	    fs_mount.start != fs_partition.start ||
+	    fs_mount.size != fs_partition.size)
+		return false;
+	if (fstype != FS_TYPE_ANY && fstype != fs_mount.fstype)
+		return false;
+
+	fs_type = fs_mount.fstype;
+
+	return true;
+}
+
+static void fs_mount_keep(struct fstype_info *info)
+{
+	if (!info->release || !fs_dev_desc)
+		return;
+
+	fs_mount.desc = fs_dev_desc;
+	fs_mount.iftype = fs_dev_desc->if_type;
+	fs_mount.devnum = fs_dev_desc->devnum;
+	fs_mount.start = fs_partition.start;
+	fs_mount.size = fs_partition.size;
+	fs_mount.fstype = info->fstype;
+	fs_mount.stale = false;
+}
+
+/* Check whether @info stays mounted when the current command finishes */
+static bool fs_mount_kept(struct fstype_info *info)
+{
+	if (!fs_mount.desc || fs_mount.fstype != info->fstype)
+		return false;
+	if (!fs_mount.stale)
+		return true;
+
+	memset(&fs_mount, '\0', sizeof(fs_mount));
+
+	return false;
+}
+
+void fs_unmount(void)
+{
+	struct fstype_info *info;
+
+	if (!fs_mount.desc)
+		return;
+
+	info = fs_get_info(fs_mount.fstype);
+	memset(&fs_mount, '\0', sizeof(fs_mount));
+	info->close();
+}
+
+void fs_invalidate(int iftype, int dev)
+{
+	if (fs_mount.desc && fs_mount.iftype == iftype &&
+	    (dev < 0 || fs_mount.devnum == dev))
+		fs_mount.stale = true;
+}
+#else
+static inline bool fs_mount_reuse(int fstype)
+{
+	return false;
+}
+
+static inline void fs_mount_keep(struct fstype_info *info) {}
+
+static inline bool fs_mount_kept(struct fstype_info *info)
+{
+	return false;
+}
+#endif
+
 /**
  * fs_get_type() - Get type of current filesystem
  *
@@ -346,6 +507,10 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 			info->name += gd->reloc_off;
 			info->probe += gd->reloc_off;
 			info->close += gd->reloc_off;
+			if (info->release)
+				info->release += gd->reloc_off;
+			if (info->read_files)
+				info->read_files += gd->reloc_off;
 			info->ls += gd->reloc_off;
 			info->read += gd->reloc_off;
 			info->write += gd->reloc_off;
@@ -359,6 +524,12 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	if (part < 0)
 		return -1;
 
+	if (fs_mount_reuse(fstype)) {
+		fs_dev_part = part;
+		return 0;
+	}
+	fs_unmount();
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
 				fstype != info->fstype)
@@ -370,6 +541,7 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_mount_keep(info);
 			return 0;
 		}
 	}
@@ -391,10 +563,17 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 		return ret;
 	fs_dev_desc = desc;
 
+	if (fs_mount_reuse(FS_TYPE_ANY)) {
+		fs_dev_part = part;
+		return 0;
+	}
+	fs_unmount();
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_mount_keep(info);
 			return 0;
 		}
 	}
@@ -406,7 +585,10 @@ void fs_close(void)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	info->close();
+	if (fs_mount_kept(info))
+		info->release();
+	else
+		info->close();
 
 	fs_type = FS_TYPE_ANY;
 }
@@ -484,11 +666,12 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 	lmb_dump_all(&lmb);
 
-	if (lmb_alloc_addr(&lmb, addr, read_len) == addr)
-		return 0;
+	ret = lmb_alloc_addr(&lmb, addr, read_len) == addr ? 0 : -ENOSPC;
+	lmb_release(&lmb);
+	if (ret)
+		printf("** Reading file would overwrite reserved memory **\n");
 
-	printf("** Reading file would overwrite reserved memory **\n");
-	return -ENOSPC;
+	return ret;
 }
 #endif
 
@@ -497,6 +680,7 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 	void *buf;
+	int span;
 	int ret;
 
 #ifdef CONFIG_LMB
@@ -512,7 +696,9 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	 * means read the whole file.
 	 */
 	buf = map_sysmem(addr, len);
+	span = bootstage_profile_start("fs_read");
 	ret = info->read(filename, buf, offset, len, actread);
+	bootstage_profile_end(span);
 	unmap_sysmem(buf);
 
 	/* If we requested a specific number of bytes, check we got it */
@@ -529,6 +715,67 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	return _fs_read(filename, addr, offset, len, 0, actread);
 }
 
+int fs_read_files(struct fs_load_file *files, int count)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+	struct fs_load_file *f, *g;
+	loff_t actread;
+	void *buf;
+	int i, j, span, ret = 0;
+
+	/* Find every file before loading any, so a set is never half loaded */
+	for (i = 0, f = files; i < count; i++, f++) {
+		ret = info->size(f->filename, &f->size);
+		if (ret) {
+			printf("** Unable to find file %s **\n", f->filename);
+			goto out;
+		}
+#ifdef CONFIG_LMB
+		ret = fs_read_lmb_check(f->filename, f->addr, 0, 0, info);
+		if (ret)
+			goto out;
+#endif
+	}
+
+	for (i = 0, f = files; i < count; i++, f++) {
+		for (j = i + 1, g = f + 1; j < count; j++, g++) {
+			if (f->addr < g->addr + g->size &&
+			    g->addr < f->addr + f->size) {
+				printf("** %s and %s overlap in memory **\n",
+				       f->filename, g->filename);
+				ret = -EINVAL;
+				goto out;
+			}
+		}
+	}
+
+	if (info->read_files) {
+		span = bootstage_profile_start("fs_read");
+		ret = info->read_files(files, count);
+		bootstage_profile_end(span);
+		goto out;
+	}
+
+	for (i = 0, f = files; i < count; i++, f++) {
+		if (!f->size)
+			continue;
+
+		buf = map_sysmem(f->addr, f->size);
+		span = bootstage_profile_start("fs_read");
+		ret = info->read(f->filename, buf, 0, f->size, &actread);
+		bootstage_profile_end(span);
+		unmap_sysmem(buf);
+		if (ret)
+			goto out;
+		f->size = actread;
+	}
+
+out:
+	fs_close();
+
+	return ret;
+}
+
 int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	     loff_t *actwrite)
 {
@@ -736,6 +983,67 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	return 0;
 }
 
+int do_load_files(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
+		  int fstype)
+{
+	struct fs_load_file *files, *f;
+	loff_t total = 0;
+	unsigned long time;
+	int i, count, ret;
+	char *ep;
+
+	if (argc < 5 || (argc - 3) % 2)
+		return CMD_RET_USAGE;
+
+	count = (argc - 3) / 2;
+	files = calloc(count, sizeof(*files));
+	if (!files)
+		return CMD_RET_FAILURE;
+
+	for (i = 0, f = files; i < count; i++, f++) {
+		f->addr = simple_strtoul(argv[3 + 2 * i], &ep, 16);
+		if (ep == argv[3 + 2 * i] || *ep != '\0') {
+			free(files);
+			return CMD_RET_USAGE;
+		}
+		f->filename = argv[4 + 2 * i];
+	}
+
+	if (fs_set_blk_dev(argv[1], argv[2], fstype)) {
+		free(files);
+		return CMD_RET_FAILURE;
+	}
+
+	time = get_timer(0);
+	ret = fs_read_files(files, count);
+	time = get_timer(time);
+	if (ret) {
+		free(files);
+		return CMD_RET_FAILURE;
+	}
+
+	for (i = 0, f = files; i < count; i++, f++) {
+		printf("%llu bytes read to 0x%lx: %s\n", f->size, f->addr,
+		       f->filename);
+		total += f->size;
+	}
+
+	printf("%llu bytes read in %lu ms", total, time);
+	if (time > 0) {
+		puts(" (");
+		print_size(div_u64(total, time) * 1000, "/s");
+		puts(")");
+	}
+	puts("\n");
+
+	/* Like 'load', for the last file */
+	env_set_hex("fileaddr", files[count - 1].addr);
+	env_set_hex("filesize", files[count - 1].size);
+	free(files);
+
+	return 0;
+}
+
 int do_ls(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	int fstype)
 {
@@ -7,6 +7,9 @@
 
 #include <common.h>
 #include <compiler.h>
+#include <fs_internal.h>
+#include <malloc.h>
+#include <mmc.h>
 #include <part.h>
 #include <memalign.h>
 
@@ -90,3 +93,90 @@ int fs_devread(struct blk_desc *blk, disk_partition_t *partition,
 	}
 	return 1;
 }
+
+int fs_devdiscard(struct blk_desc *blk, disk_partition_t *partition,
+		  lbaint_t sector, lbaint_t count)
+{
+	lbaint_t start, end, grp;
+	struct mmc *mmc;
+
+	if (!CONFIG_IS_ENABLED(FS_DISCARD) || !CONFIG_IS_ENABLED(MMC) ||
+	    !blk || blk->if_type != IF_TYPE_MMC)
+		return 0;
+
+	mmc = find_mmc_device(blk->devnum);
+	if (!mmc || !mmc->erase_grp_size)
+		return 0;
+
+	/* Erasing part of a group would erase the data around the range */
+	grp = mmc->erase_grp_size;
+	start = roundup(partition->start + sector, grp);
+	end = rounddown(partition->start + sector + count, grp);
+	if (end <= start)
+		return 0;
+
+	debug("%s: erasing " LBAFU " blocks at " LBAFU "\n", __func__,
+	      end - start, start);
+	if (blk_derase(blk, start, end - start) != end - start)
+		return -EIO;
+
+	return 0;
+}
+
+int fs_discard_add(struct fs_discard_list *list, ulong unit)
+{
+	struct fs_discard_run *run;
+
+	if (!CONFIG_IS_ENABLED(FS_DISCARD))
+		return 0;
+
+	if (list->count) {
+		run = &list->run[list->count - 1];
+		if (unit == run->start + run->count) {
+			run->count++;
+			return 0;
+		}
+	}
+
+	if (list->count == list->max) {
+		run = realloc(list->run, (list->max + 16) * sizeof(*run));
+		if (!run)
+			return -ENOMEM;
+		list->run = run;
+		list->max += 16;
+	}
+	run = &list->run[list->count++];
+	run->start = unit;
+	run->count = 1;
+
+	return 0;
+}
+
+void fs_discard_flush(struct fs_discard_list *list, void *priv,
+		      bool (*is_free)(void *priv, ulong unit),
+		      int (*discard)(void *priv, ulong start, ulong count))
+{
+	ulong unit, end, start;
+	int i;
+
+	for (i = 0; i < list->count; i++) {
+		end = list->run[i].start + list->run[i].count;
+		for (unit = list->run[i].start; unit < end; unit++) {
+			if (!is_free(priv, unit))
+				continue;
+			start = unit;
+			while (unit < end && is_free(priv, unit))
+				unit++;
+			discard(priv, start, unit - start);
+		}
+	}
+	fs_discard_free(list);
+}
+
+void fs_discard_free(struct fs_discard_list *list)
+{
+	free(list->run);
+	list->run = NULL;
+	list->count = 0;
+	list->max = 0;
+}
@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Reading SquashFS files
+ *
+ * Files are stored as a run of data blocks followed by an optional tail
+ * packed with the tails of other files into a fragment block. Data blocks
+ * which a read covers entirely are decompressed straight into the caller's
+ * buffer. A block needed only in part goes through a buffer which is kept,
+ * and so is the last fragment block, since small files in one directory
+ * usually share it.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include "internal.h"
+
+static int sqfs_cache_alloc(struct sqfs_cache_block *cb)
+{
+	cb->len = 0;
+	if (!cb->data) {
+		cb->data = malloc(sqfs_sbi.block_size);
+		if (!cb->data)
+			return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/**
+ * sqfs_read_block() - Read from a data block
+ *
+ * @pos: Position of the block on the partition
+ * @entry: Entry of the block list, giving its size and whether it is
+ *	compressed
+ * @out: Number of bytes of the file the block holds
+ * @buf: Destination buffer
+ * @skip: Offset of the data to read within the block
+ * @len: Number of bytes to read
+ * @ahead: Number of bytes stored after the block which will be read next
+ * Return: 0 if OK, -ve on error
+ */
+static int sqfs_read_block(u64 pos, u32 entry, u32 out, void *buf, u32 skip,
+			   u32 len, size_t ahead)
+{
+	struct sqfs_sb_info *sbi = &sqfs_sbi;
+	u32 csize = SQUASHFS_COMPRESSED_SIZE_BLOCK(entry);
+	const u8 *in;
+	int ret;
+
+	/* Holes in sparse files are not stored */
+	if (!csize) {
+		memset(buf, '\0', len);
+		return 0;
+	}
+
+	if (!SQUASHFS_COMPRESSED_BLOCK(entry)) {
+		if (csize != out)
+			return -EFSCORRUPTED;
+		if (sbi->raw_len && pos >= sbi->raw_pos &&
+		    pos + csize <= sbi->raw_pos + sbi->raw_len) {
+			memcpy(buf, sbi->raw + (pos - sbi->raw_pos) + skip,
+			       len);
+			return 0;
+		}
+		return sqfs_dev_read(buf, pos + skip, len);
+	}
+
+	if (sbi->blk.len && sbi->blk.pos == pos) {
+		memcpy(buf, sbi->blk.data + skip, len);
+		return 0;
+	}
+
+	in = sqfs_read_raw(pos, csize, ahead);
+	if (!in)
+		return -EIO;
+
+	if (!skip && len == out) {
+		ret = sqfs_decompress(buf, out, in, csize);
+		if (ret < 0)
+			return ret;
+		return ret == out ? 0 : -EFSCORRUPTED;
+	}
+
+	ret = sqfs_cache_alloc(&sbi->blk);
+	if (ret)
+		return ret;
+	ret = sqfs_decompress(sbi->blk.data, sbi->block_size, in, csize);
+	if (ret < 0)
+		return ret;
+	if (ret != out)
+		return -EFSCORRUPTED;
+	sbi->blk.pos = pos;
+	sbi->blk.len = ret;
+	memcpy(buf, sbi->blk.data + skip, len);
+
+	return 0;
+}
+
+static int sqfs_read_fragment(struct sqfs_inode *vi, void *buf, u32 skip,
+			      u32 len)
+{
+	struct sqfs_sb_info *sbi = &sqfs_sbi;
+	struct squashfs_fragment_entry fe;
+	u64 blk, pos;
+	u32 off, size, csize;
+	const u8 *in;
+	int ret;
+
+	blk = sbi->frag_index[SQUASHFS_FRAGMENT_INDEX(vi->frag)];
+	off = SQUASHFS_FRAGMENT_INDEX_OFFSET(vi->frag);
+	ret = sqfs_read_meta(&fe, &blk, &off, sizeof(fe));
+	if (ret)
+		return ret;
+	pos = le64_to_cpu(fe.start_block);
+	size = le32_to_cpu(fe.size);
+	csize = SQUASHFS_COMPRESSED_SIZE_BLOCK(size);
+
+	if (!sbi->frag.len || sbi->frag.pos != pos) {
+		if (!csize || csize > sbi->block_size)
+			return -EFSCORRUPTED;
+		ret = sqfs_cache_alloc(&sbi->frag);
+		if (ret)
+			return ret;
+		in = sqfs_read_raw(pos, csize, 0);
+		if (!in)
+			return -EIO;
+		if (SQUASHFS_COMPRESSED_BLOCK(size)) {
+			ret = sqfs_decompress(sbi->frag.data, sbi->block_size,
+					      in, csize);
+			if (ret <= 0)
+				return ret ? ret : -EFSCORRUPTED;
+		} else {
+			memcpy(sbi->frag.data, in, csize);
+			ret = csize;
+		}
+		sbi->frag.pos = pos;
+		sbi->frag.len = ret;
+	}
+
+	if (vi->frag_off + skip + len > sbi->frag.len)
+		return -EFSCORRUPTED;
+	memcpy(buf, sbi->frag.data + vi->frag_off + skip, len);
+
+	return 0;
+}
+
+int sqfs_pread(struct sqfs_inode *vi, void *buf, u64 len, u64 offset)
+{
+	struct sqfs_sb_info *sbi = &sqfs_sbi;
+	u64 end = offset + len;
+	u64 blocks_end = (u64)vi->nblocks << sbi->block_log;
+	u64 blk = vi->next_blk;
+	u32 off = vi->next_off;
+	u64 pos, bpos, ahead;
+	u32 first, last, i, csize, out, skip, now;
+	u32 *list;
+	int ret = 0;
+
+	if (offset < blocks_end) {
+		first = offset >> sbi->block_log;
+		last = min_t(u64, DIV_ROUND_UP(end, sbi->block_size),
+			     vi->nblocks);
+
+		/* Blocks are stored one after the other */
+		list = malloc(last * sizeof(*list));
+		if (!list)
+			return -ENOMEM;
+		ret = sqfs_read_meta(list, &blk, &off, last * sizeof(*list));
+		if (ret)
+			goto out;
+
+		pos = vi->start;
+		ahead = 0;
+		for (i = 0; i < last; i++) {
+			le32_to_cpus(&list[i]);
+			csize = SQUASHFS_COMPRESSED_SIZE_BLOCK(list[i]);
+			if (i < first)
+				pos += csize;
+			else
+				ahead += csize;
+		}
+
+		for (i = first; i < last; i++) {
+			csize = SQUASHFS_COMPRESSED_SIZE_BLOCK(list[i]);
+			bpos = (u64)i << sbi->block_log;
+			out = min_t(u64, sbi->block_size, vi->size - bpos);
+			skip = offset - bpos;
+			now = min_t(u64, end - offset, out - skip);
+			ahead -= csize;
+
+			ret = sqfs_read_block(pos, list[i], out, buf, skip, now,
+					      ahead);
+			if (ret)
+				goto out;
+			pos += csize;
+			buf += now;
+			offset += now;
+		}
+out:
+		free(list);
+		if (ret)
+			return ret;
+	}
+
+	if (offset < end) {
+		if (vi->frag == SQUASHFS_INVALID_FRAG)
+			return -EFSCORRUPTED;
+		ret = sqfs_read_fragment(vi, buf, offset - blocks_end,
+					 end - offset);
+	}
+
+	return ret;
+}
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS decompressors
+ *
+ * Every metadata, data and fragment block is compressed on its own, so
+ * each one is decompressed in a single call straight into its destination.
+ */
+
+#include <common.h>
+#include <gzip.h>
+#include <lz4.h>
+#include <malloc.h>
+#include <linux/zstd.h>
+#include <u-boot/zlib.h>
+#include "internal.h"
+
+/* from zutil.h */
+#define PRESET_DICT 0x20
+
+static int sqfs_zlib_decompress(void *dst, size_t dstlen, const u8 *src,
+				size_t srclen)
+{
+	unsigned long len = srclen;
+
+	/* zunzip() takes raw deflate data, so skip the zlib header */
+	if (srclen < 2 || (src[0] & 0x0f) != Z_DEFLATED ||
+	    (src[1] & PRESET_DICT) || ((src[0] << 8) | src[1]) % 31)
+		return -EFSCORRUPTED;
+
+	if (zunzip(dst, dstlen, (unsigned char *)src, &len, 1, 2))
+		return -EIO;
+
+	return len;
+}
+
+static int sqfs_zstd_init(void)
+{
+	size_t wsize = ZSTD_DCtxWorkspaceBound();
+
+	sqfs_sbi.zstd_wksp = malloc(wsize);
+	if (!sqfs_sbi.zstd_wksp)
+		return -ENOMEM;
+	sqfs_sbi.zstd = ZSTD_initDCtx(sqfs_sbi.zstd_wksp, wsize);
+	if (!sqfs_sbi.zstd)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int sqfs_zstd_decompress(void *dst, size_t dstlen, const void *src,
+				size_t srclen)
+{
+	size_t ret;
+
+	ret = ZSTD_decompressDCtx(sqfs_sbi.zstd, dst, dstlen, src, srclen);
+	if (ZSTD_isError(ret)) {
+		debug("%s: zstd error %d\n", __func__, ZSTD_getErrorCode(ret));
+		return -EIO;
+	}
+
+	return ret;
+}
+
+int sqfs_decompressor_init(void)
+{
+	switch (sqfs_sbi.compression) {
+	case ZLIB_COMPRESSION:
+		if (!CONFIG_IS_ENABLED(GZIP))
+			break;
+		return 0;
+	case LZ4_COMPRESSION:
+		if (!CONFIG_IS_ENABLED(LZ4))
+			break;
+		return 0;
+	case ZSTD_COMPRESSION:
+		if (!CONFIG_IS_ENABLED(ZSTD))
+			break;
+		return sqfs_zstd_init();
+	}
+
+	printf("SquashFS: unsupported compression %u\n", sqfs_sbi.compression);
+
+	return -EOPNOTSUPP;
+}
+
+/**
+ * sqfs_decompress() - Decompress a block
+ *
+ * @dst: Destination buffer
+ * @dstlen: Size of @dst
+ * @src: Compressed block
+ * @srclen: Length of @src
+ * Return: number of bytes written to @dst, or -ve on error
+ */
+int sqfs_decompress(void *dst, size_t dstlen, const void *src, size_t srclen)
+{
+	switch (sqfs_sbi.compression) {
+	case ZLIB_COMPRESSION:
+		if (CONFIG_IS_ENABLED(GZIP))
+			return sqfs_zlib_decompress(dst, dstlen, src, srclen);
+		break;
+	case LZ4_COMPRESSION:
+		if (CONFIG_IS_ENABLED(LZ4))
+			return ulz4_decompress_block(src, srclen, dst, dstlen,
+						     false);
+		break;
+	case ZSTD_COMPRESSION:
+		if (CONFIG_IS_ENABLED(ZSTD))
+			return sqfs_zstd_decompress(dst, dstlen, src, srclen);
+		break;
+	}
+
+	return -EOPNOTSUPP;
+}
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS inodes
+ */
+
+#include <common.h>
+#include <linux/stat.h>
+#include "internal.h"
+
+static int sqfs_read_rest(void *di, size_t base, size_t len, u64 *blk,
+			  u32 *off)
+{
+	return sqfs_read_meta(di + base, blk, off, len - base);
+}
+
+int sqfs_read_inode(u64 ref, struct sqfs_inode *vi)
+{
+	struct sqfs_sb_info *sbi = &sqfs_sbi;
+	union {
+		struct squashfs_base_inode base;
+		struct squashfs_reg_inode reg;
+		struct squashfs_lreg_inode lreg;
+		struct squashfs_dir_inode dir;
+		struct squashfs_ldir_inode ldir;
+		struct squashfs_symlink_inode symlink;
+	} di;
+	const size_t bsize = sizeof(di.base);
+	u64 blk = sbi->inode_table + SQUASHFS_INODE_BLK(ref);
+	u32 off = SQUASHFS_INODE_OFFSET(ref);
+	u64 nblocks;
+	u32 dir_size;
+	int ret;
+
+	memset(vi, '\0', sizeof(*vi));
+	vi->ref = ref;
+	ret = sqfs_read_meta(&di.base, &blk, &off, bsize);
+	if (ret)
+		return ret;
+
+	vi->ino = le32_to_cpu(di.base.inode_number);
+	vi->type = le16_to_cpu(di.base.inode_type);
+	vi->mode = le16_to_cpu(di.base.mode) & ~S_IFMT;
+
+	switch (vi->type) {
+	case SQUASHFS_REG_TYPE:
+		ret = sqfs_read_rest(&di, bsize, sizeof(di.reg), &blk, &off);
+		if (ret)
+			return ret;
+		vi->mode |= S_IFREG;
+		vi->size = le32_to_cpu(di.reg.file_size);
+		vi->start = le32_to_cpu(di.reg.start_block);
+		vi->frag = le32_to_cpu(di.reg.fragment);
+		vi->frag_off = le32_to_cpu(di.reg.offset);
+		break;
+	case SQUASHFS_LREG_TYPE:
+		ret = sqfs_read_rest(&di, bsize, sizeof(di.lreg), &blk, &off);
+		if (ret)
+			return ret;
+		vi->mode |= S_IFREG;
+		vi->size = le64_to_cpu(di.lreg.file_size);
+		vi->start = le64_to_cpu(di.lreg.start_block);
+		vi->frag = le32_to_cpu(di.lreg.fragment);
+		vi->frag_off = le32_to_cpu(di.lreg.offset);
+		break;
+	case SQUASHFS_DIR_TYPE:
+		ret = sqfs_read_rest(&di, bsize, sizeof(di.dir), &blk, &off);
+		if (ret)
+			return ret;
+		vi->mode |= S_IFDIR;
+		vi->size = le16_to_cpu(di.dir.file_size);
+		vi->dir_blk = sbi->dir_table + le32_to_cpu(di.dir.start_block);
+		vi->dir_off = le16_to_cpu(di.dir.offset);
+		break;
+	case SQUASHFS_LDIR_TYPE:
+		ret = sqfs_read_rest(&di, bsize, sizeof(di.ldir), &blk, &off);
+		if (ret)
+			return ret;
+		vi->mode |= S_IFDIR;
+		vi->size = le32_to_cpu(di.ldir.file_size);
+		vi->dir_blk = sbi->dir_table + le32_to_cpu(di.ldir.start_block);
+		vi->dir_off = le16_to_cpu(di.ldir.offset);
+		vi->i_count = le16_to_cpu(di.ldir.i_count);
+		break;
+	case SQUASHFS_SYMLINK_TYPE:
+	case SQUASHFS_LSYMLINK_TYPE:
+		ret = sqfs_read_rest(&di, bsize, sizeof(di.symlink), &blk,
+				     &off);
+		if (ret)
+			return ret;
+		vi->mode |= S_IFLNK;
+		vi->size = le32_to_cpu(di.symlink.symlink_size);
+		break;
+	case SQUASHFS_BLKDEV_TYPE:
+	case SQUASHFS_LBLKDEV_TYPE:
+		vi->mode |= S_IFBLK;
+		break;
+	case SQUASHFS_CHRDEV_TYPE:
+	case SQUASHFS_LCHRDEV_TYPE:
+		vi->mode |= S_IFCHR;
+		break;
+	case SQUASHFS_FIFO_TYPE:
+	case SQUASHFS_LFIFO_TYPE:
+		vi->mode |= S_IFIFO;
+		break;
+	case SQUASHFS_SOCKET_TYPE:
+	case SQUASHFS_LSOCKET_TYPE:
+		vi->mode |= S_IFSOCK;
+		break;
+	default:
+		return -EFSCORRUPTED;
+	}
+	vi->next_blk = blk;
+	vi->next_off = off;
+
+	if (S_ISREG(vi->mode)) {
+		/* The tail of the file may be packed into a fragment */
+		if (vi->frag == SQUASHFS_INVALID_FRAG) {
+			nblocks = DIV_ROUND_UP(vi->size, sbi->block_size);
+		} else {
+			nblocks = vi->size >> sbi->block_log;
+			if (vi->frag >= sbi->fragments ||
+			    vi->frag_off >= sbi->block_size ||
+			    (vi->size & (sbi->block_size - 1)) >
+			    sbi->block_size - vi->frag_off)
+				return -EFSCORRUPTED;
+		}
+		if (nblocks > U32_MAX ||
+		    (nblocks && vi->start >= sbi->bytes_used))
+			return -EFSCORRUPTED;
+		vi->nblocks = nblocks;
+	} else if (S_ISDIR(vi->mode)) {
+		/* The size of directories counts "." and ".." as 3 bytes */
+		dir_size = vi->size > 3 ? vi->size - 3 : 0;
+		if (vi->dir_off >= SQUASHFS_METADATA_SIZE ||
+		    vi->dir_blk >= sbi->bytes_used ||
+		    dir_size > sbi->bytes_used)
+			return -EFSCORRUPTED;
+	}
+
+	return 0;
+}
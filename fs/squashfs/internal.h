@@ -0,0 +1,221 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * SquashFS filesystem implementation for U-Boot
+ */
+
+#ifndef __SQUASHFS_INTERNAL_H
+#define __SQUASHFS_INTERNAL_H
+
+#include <common.h>
+#include <blk.h>
+#include <part.h>
+#include <linux/errno.h>
+#include <linux/sizes.h>
+#include "squashfs_fs.h"
+
+#define EFSCORRUPTED	EUCLEAN
+
+/* Number of uncompressed metadata blocks kept in memory */
+#define SQFS_META_CACHE_SLOTS	8
+/* Data blocks are read ahead by up to this many bytes */
+#define SQFS_READAHEAD_SIZE	SZ_1M
+/* Metadata tables are read ahead by up to this many bytes */
+#define SQFS_META_READAHEAD	SZ_32K
+/* Maximum number of symlinks followed while resolving a path */
+#define SQFS_MAX_SYMLINK_NEST	8
+/* Maximum directory depth of a path */
+#define SQFS_MAX_PATH_DEPTH	64
+
+/**
+ * struct sqfs_metablock - A cached metadata block
+ *
+ * @pos:	Position of the block on the partition, only meaningful if
+ *		@len is not 0
+ * @next:	Position of the following block
+ * @len:	Length of the uncompressed data
+ * @data:	Uncompressed data
+ */
+struct sqfs_metablock {
+	u64 pos;
+	u64 next;
+	u32 len;
+	u8 *data;
+};
+
+/**
+ * struct sqfs_cache_block - A cached data or fragment block
+ *
+ * @pos:	Position of the block on the partition, only meaningful if
+ *		@len is not 0
+ * @len:	Length of the uncompressed data
+ * @data:	Uncompressed data, one block in size
+ */
+struct sqfs_cache_block {
+	u64 pos;
+	u32 len;
+	u8 *data;
+};
+
+/**
+ * struct sqfs_sb_info - State of the mounted file system
+ *
+ * @desc:		Device holding the file system
+ * @part:		Partition holding the file system
+ * @block_size:		Size of data blocks
+ * @block_log:		log2 of @block_size
+ * @compression:	..._COMPRESSION algorithm
+ * @flags:		SQUASHFS_... superblock flags
+ * @fragments:		Number of fragment blocks
+ * @root_inode:		Reference to the root directory inode
+ * @bytes_used:		Size of the file system in bytes
+ * @inode_table:	Position of the inode table
+ * @dir_table:		Position of the directory table
+ * @frag_index:		Positions of the metadata blocks holding the
+ *			fragment table
+ * @meta:		Recently used metadata blocks
+ * @meta_next:		Slot of @meta to reuse next
+ * @raw:		Read-ahead window of raw (compressed) data
+ * @raw_size:		Size of @raw
+ * @raw_pos:		Position of @raw on the partition
+ * @raw_len:		Number of valid bytes in @raw
+ * @blk:		Last data block decompressed into a buffer
+ * @frag:		Last fragment block
+ * @zstd_wksp:		Workspace of the zstd decompressor
+ * @zstd:		zstd decompression context
+ */
+struct sqfs_sb_info {
+	struct blk_desc *desc;
+	disk_partition_t *part;
+
+	u32 block_size;
+	u16 block_log;
+	u16 compression;
+	u16 flags;
+	u32 fragments;
+	u64 root_inode;
+	u64 bytes_used;
+	u64 inode_table;
+	u64 dir_table;
+	u64 *frag_index;
+
+	struct sqfs_metablock meta[SQFS_META_CACHE_SLOTS];
+	unsigned int meta_next;
+
+	u8 *raw;
+	size_t raw_size;
+	u64 raw_pos;
+	size_t raw_len;
+
+	struct sqfs_cache_block blk;
+	struct sqfs_cache_block frag;
+
+	void *zstd_wksp;
+	void *zstd;
+};
+
+extern struct sqfs_sb_info sqfs_sbi;
+
+/**
+ * struct sqfs_inode - An inode read from disk
+ *
+ * @ref:	Reference to the inode
+ * @ino:	Inode number
+ * @type:	SQUASHFS_..._TYPE
+ * @mode:	File type and permissions
+ * @size:	Size of the file in bytes
+ * @next_blk:	Metadata block holding the data following the inode:
+ *		the block list of files, the index of directories or the
+ *		target of symlinks
+ * @next_off:	Offset of that data within @next_blk
+ * @start:	Position of the first data block of files
+ * @frag:	Fragment holding the tail of files, or SQUASHFS_INVALID_FRAG
+ * @frag_off:	Offset of the tail within the fragment block
+ * @nblocks:	Number of data blocks of files
+ * @dir_blk:	Metadata block holding the listing of directories
+ * @dir_off:	Offset of the listing within @dir_blk
+ * @i_count:	Number of index entries of directories
+ */
+struct sqfs_inode {
+	u64 ref;
+	u32 ino;
+	u16 type;
+	u16 mode;
+	u64 size;
+	u64 next_blk;
+	u32 next_off;
+
+	union {
+		struct {
+			u64 start;
+			u32 frag;
+			u32 frag_off;
+			u32 nblocks;
+		};
+		struct {
+			u64 dir_blk;
+			u32 dir_off;
+			u32 i_count;
+		};
+	};
+};
+
+/* super.c */
+int sqfs_dev_read(void *buf, u64 offset, size_t len);
+const u8 *sqfs_read_raw(u64 pos, size_t len, size_t ahead);
+int sqfs_read_meta(void *buf, u64 *blk, u32 *off, size_t len);
+int sqfs_read_superblock(void);
+void sqfs_put_super(void);
+
+/* decompress.c */
+int sqfs_decompressor_init(void);
+int sqfs_decompress(void *dst, size_t dstlen, const void *src, size_t srclen);
+
+/* inode.c */
+int sqfs_read_inode(u64 ref, struct sqfs_inode *vi);
+
+/* data.c */
+int sqfs_pread(struct sqfs_inode *vi, void *buf, u64 len, u64 offset);
+
+/**
+ * struct sqfs_dir_iter - Position in a directory listing
+ *
+ * @blk:	Metadata block of the next entry
+ * @off:	Offset of the next entry within @blk
+ * @left:	Number of bytes of the listing still to be read
+ * @count:	Number of entries left under the current header
+ * @start_block: Inode table block of the entries under the current header
+ * @ino_base:	Inode number the entries under the current header are
+ *		relative to
+ */
+struct sqfs_dir_iter {
+	u64 blk;
+	u32 off;
+	u32 left;
+	u32 count;
+	u32 start_block;
+	u32 ino_base;
+};
+
+/**
+ * struct sqfs_dirent - A directory entry
+ *
+ * @ref:	Reference to the inode
+ * @ino:	Inode number
+ * @type:	SQUASHFS_..._TYPE of the inode
+ * @name:	Name, NUL-terminated
+ * @namelen:	Length of @name
+ */
+struct sqfs_dirent {
+	u64 ref;
+	u32 ino;
+	u16 type;
+	char name[SQUASHFS_NAME_LEN + 1];
+	unsigned int namelen;
+};
+
+/* namei.c */
+void sqfs_dir_begin(const struct sqfs_inode *dir, struct sqfs_dir_iter *it);
+int sqfs_dir_next(struct sqfs_dir_iter *it, struct sqfs_dirent *de);
+int sqfs_lookup(const char *path, struct sqfs_inode *vi);
+
+#endif /* __SQUASHFS_INTERNAL_H */
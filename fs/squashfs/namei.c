@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS directories and path lookup
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/stat.h>
+#include "internal.h"
+
+/**
+ * struct sqfs_path - Directories a path lookup went through
+ *
+ * Directories do not store "." and "..", so ".." is resolved by going back
+ * to where the lookup came from.
+ *
+ * @refs:	Inode references, from the root to the current inode
+ * @depth:	Number of entries in @refs
+ * @arena:	Memory used by the lookup, all freed when it is done
+ */
+struct sqfs_path {
+	u64 refs[SQFS_MAX_PATH_DEPTH];
+	unsigned int depth;
+	struct malloc_arena *arena;
+};
+
+void sqfs_dir_begin(const struct sqfs_inode *dir, struct sqfs_dir_iter *it)
+{
+	it->blk = dir->dir_blk;
+	it->off = dir->dir_off;
+	it->left = dir->size > 3 ? dir->size - 3 : 0;
+	it->count = 0;
+}
+
+int sqfs_dir_next(struct sqfs_dir_iter *it, struct sqfs_dirent *de)
+{
+	struct squashfs_dir_header dh;
+	struct squashfs_dir_entry dent;
+	int ret;
+
+	if (!it->count) {
+		if (!it->left)
+			return -ENOENT;
+		if (it->left < sizeof(dh))
+			return -EFSCORRUPTED;
+		ret = sqfs_read_meta(&dh, &it->blk, &it->off, sizeof(dh));
+		if (ret)
+			return ret;
+		it->left -= sizeof(dh);
+		it->count = le32_to_cpu(dh.count) + 1;
+		if (it->count > SQUASHFS_DIR_COUNT)
+			return -EFSCORRUPTED;
+		it->start_block = le32_to_cpu(dh.start_block);
+		it->ino_base = le32_to_cpu(dh.inode_number);
+	}
+
+	if (it->left < sizeof(dent))
+		return -EFSCORRUPTED;
+	ret = sqfs_read_meta(&dent, &it->blk, &it->off, sizeof(dent));
+	if (ret)
+		return ret;
+	it->left -= sizeof(dent);
+
+	de->namelen = le16_to_cpu(dent.size) + 1;
+	if (de->namelen > SQUASHFS_NAME_LEN || de->namelen > it->left)
+		return -EFSCORRUPTED;
+	ret = sqfs_read_meta(de->name, &it->blk, &it->off, de->namelen);
+	if (ret)
+		return ret;
+	it->left -= de->namelen;
+	it->count--;
+
+	de->name[de->namelen] = '\0';
+	de->ref = SQUASHFS_MKINODE(it->start_block, le16_to_cpu(dent.offset));
+	de->ino = it->ino_base + (s16)le16_to_cpu(dent.inode_number);
+	de->type = le16_to_cpu(dent.type);
+
+	return 0;
+}
+
+static int sqfs_namecmp(const char *name, unsigned int len, const char *dname,
+			unsigned int dlen)
+{
+	int diff;
+
+	diff = memcmp(name, dname, min(len, dlen));
+	if (diff)
+		return diff;
+
+	return (int)len - (int)dlen;
+}
+
+/**
+ * sqfs_dir_seek() - Skip to the part of a large directory holding a name
+ *
+ * Large directories have an index giving the first name stored in each
+ * metadata block of their listing, so only one block needs to be searched.
+ *
+ * @dir: Directory
+ * @it: Iterator set to the start of the listing, moved to where @name may
+ *	be found
+ * @name: Name to look for
+ * @namelen: Length of @name
+ * Return: 0 if OK, -ve on error
+ */
+static int sqfs_dir_seek(const struct sqfs_inode *dir, struct sqfs_dir_iter *it,
+			 const char *name, unsigned int namelen)
+{
+	struct squashfs_dir_index idx;
+	char iname[SQUASHFS_NAME_LEN];
+	u64 blk = dir->next_blk;
+	u32 off = dir->next_off;
+	u32 i, size, index, dir_size = it->left;
+	int ret;
+
+	for (i = 0; i < dir->i_count; i++) {
+		ret = sqfs_read_meta(&idx, &blk, &off, sizeof(idx));
+		if (ret)
+			return ret;
+		size = le32_to_cpu(idx.size) + 1;
+		if (size > SQUASHFS_NAME_LEN)
+			return -EFSCORRUPTED;
+		ret = sqfs_read_meta(iname, &blk, &off, size);
+		if (ret)
+			return ret;
+
+		/* Names are sorted, so stop at the first one past @name */
+		if (sqfs_namecmp(name, namelen, iname, size) < 0)
+			break;
+
+		index = le32_to_cpu(idx.index);
+		if (index >= dir_size)
+			return -EFSCORRUPTED;
+		it->blk = sqfs_sbi.dir_table + le32_to_cpu(idx.start_block);
+		it->off = (dir->dir_off + index) % SQUASHFS_METADATA_SIZE;
+		it->left = dir_size - index;
+		it->count = 0;
+	}
+
+	return 0;
+}
+
+static int sqfs_namei(const struct sqfs_inode *dir, const char *name,
+		      unsigned int namelen, struct sqfs_dirent *de)
+{
+	struct sqfs_dir_iter it;
+	int ret, diff;
+
+	sqfs_dir_begin(dir, &it);
+	if (dir->i_count) {
+		ret = sqfs_dir_seek(dir, &it, name, namelen);
+		if (ret)
+			return ret;
+	}
+
+	while (!(ret = sqfs_dir_next(&it, de))) {
+		diff = sqfs_namecmp(name, namelen, de->name, de->namelen);
+		if (!diff)
+			return 0;
+		if (diff < 0)
+			return -ENOENT;
+	}
+
+	return ret;
+}
+
+static int sqfs_lookup_at(struct sqfs_path *p, const char *path,
+			  struct sqfs_inode *vi, int nest)
+{
+	struct sqfs_dirent *de;
+	unsigned int len;
+	const char *name;
+	char *target;
+	u64 blk;
+	u32 off;
+	int ret;
+
+	if (*path == '/') {
+		p->depth = 1;
+		ret = sqfs_read_inode(p->refs[0], vi);
+		if (ret)
+			return ret;
+	}
+
+	for (;;) {
+		while (*path == '/')
+			path++;
+		if (!*path)
+			return 0;
+
+		name = path;
+		len = strcspn(path, "/");
+		path += len;
+		if (len > SQUASHFS_NAME_LEN)
+			return -ENAMETOOLONG;
+		if (!S_ISDIR(vi->mode))
+			return -ENOTDIR;
+
+		if (len == 1 && name[0] == '.')
+			continue;
+		if (len == 2 && name[0] == '.' && name[1] == '.') {
+			if (p->depth > 1)
+				p->depth--;
+			ret = sqfs_read_inode(p->refs[p->depth - 1], vi);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		de = malloc_arena_alloc(p->arena, sizeof(*de));
+		if (!de)
+			return -ENOMEM;
+		ret = sqfs_namei(vi, name, len, de);
+		if (!ret)
+			ret = sqfs_read_inode(de->ref, vi);
+		if (ret)
+			return ret;
+
+		if (!S_ISLNK(vi->mode)) {
+			if (p->depth == SQFS_MAX_PATH_DEPTH)
+				return -ENAMETOOLONG;
+			p->refs[p->depth++] = vi->ref;
+			continue;
+		}
+
+		/* Symlinks are followed relative to their directory */
+		if (nest >= SQFS_MAX_SYMLINK_NEST)
+			return -ELOOP;
+		if (vi->size > SZ_4K)
+			return -ENAMETOOLONG;
+		target = malloc_arena_alloc(p->arena, vi->size + 1);
+		if (!target)
+			return -ENOMEM;
+		blk = vi->next_blk;
+		off = vi->next_off;
+		ret = sqfs_read_meta(target, &blk, &off, vi->size);
+		if (!ret) {
+			target[vi->size] = '\0';
+			ret = sqfs_read_inode(p->refs[p->depth - 1], vi);
+		}
+		if (!ret)
+			ret = sqfs_lookup_at(p, target, vi, nest + 1);
+		if (ret)
+			return ret;
+	}
+}
+
+int sqfs_lookup(const char *path, struct sqfs_inode *vi)
+{
+	struct malloc_arena arena;
+	struct sqfs_path *p;
+	int ret;
+
+	malloc_arena_init(&arena, 0);
+	p = malloc_arena_alloc(&arena, sizeof(*p));
+	if (!p)
+		return -ENOMEM;
+	p->refs[0] = sqfs_sbi.root_inode;
+	p->depth = 1;
+	p->arena = &arena;
+
+	ret = sqfs_read_inode(p->refs[0], vi);
+	if (!ret)
+		ret = sqfs_lookup_at(p, path, vi, 0);
+	malloc_arena_free_all(&arena);
+
+	return ret;
+}
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS filesystem implementation for U-Boot
+ */
+
+#include <common.h>
+#include <fs.h>
+#include <malloc.h>
+#include <squashfs.h>
+#include <linux/stat.h>
+#include "internal.h"
+
+/**
+ * struct sqfs_dir_stream - State of a directory listing
+ *
+ * @parent:	Generic part, must come first
+ * @dirent:	Entry returned by sqfs_readdir()
+ * @it:		Position in the directory listing
+ * @de:		Directory entry being returned
+ */
+struct sqfs_dir_stream {
+	struct fs_dir_stream parent;
+	struct fs_dirent dirent;
+	struct sqfs_dir_iter it;
+	struct sqfs_dirent de;
+};
+
+int sqfs_probe(struct blk_desc *fs_dev_desc, disk_partition_t *fs_partition)
+{
+	int ret;
+
+	sqfs_put_super();
+	sqfs_sbi.desc = fs_dev_desc;
+	sqfs_sbi.part = fs_partition;
+
+	ret = sqfs_read_superblock();
+	if (ret) {
+		sqfs_put_super();
+		return ret;
+	}
+
+	return 0;
+}
+
+int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
+{
+	struct sqfs_dir_stream *dirs;
+	struct sqfs_inode dir;
+	int ret;
+
+	ret = sqfs_lookup(filename, &dir);
+	if (ret)
+		return ret;
+	if (!S_ISDIR(dir.mode))
+		return -ENOTDIR;
+
+	dirs = calloc(1, sizeof(*dirs));
+	if (!dirs)
+		return -ENOMEM;
+	sqfs_dir_begin(&dir, &dirs->it);
+
+	*dirsp = &dirs->parent;
+
+	return 0;
+}
+
+int sqfs_readdir(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp)
+{
+	struct sqfs_dir_stream *dirs = (struct sqfs_dir_stream *)fs_dirs;
+	struct fs_dirent *dent = &dirs->dirent;
+	struct sqfs_dirent *de = &dirs->de;
+	struct sqfs_inode vi;
+	int ret;
+
+	ret = sqfs_dir_next(&dirs->it, de);
+	if (ret)
+		return ret;
+
+	memset(dent, '\0', sizeof(*dent));
+	strlcpy(dent->name, de->name, sizeof(dent->name));
+	switch (de->type) {
+	case SQUASHFS_DIR_TYPE:
+	case SQUASHFS_LDIR_TYPE:
+		dent->type = FS_DT_DIR;
+		break;
+	case SQUASHFS_SYMLINK_TYPE:
+	case SQUASHFS_LSYMLINK_TYPE:
+		dent->type = FS_DT_LNK;
+		break;
+	default:
+		dent->type = FS_DT_REG;
+		break;
+	}
+	if (dent->type != FS_DT_DIR && !sqfs_read_inode(de->ref, &vi))
+		dent->size = vi.size;
+
+	*dentp = dent;
+
+	return 0;
+}
+
+void sqfs_closedir(struct fs_dir_stream *fs_dirs)
+{
+	free(fs_dirs);
+}
+
+int sqfs_exists(const char *filename)
+{
+	struct sqfs_inode vi;
+
+	return !sqfs_lookup(filename, &vi);
+}
+
+int sqfs_size(const char *filename, loff_t *size)
+{
+	struct sqfs_inode vi;
+	int ret;
+
+	ret = sqfs_lookup(filename, &vi);
+	if (ret)
+		return ret;
+
+	*size = vi.size;
+
+	return 0;
+}
+
+int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
+	      loff_t *actread)
+{
+	struct sqfs_inode vi;
+	int ret;
+
+	ret = sqfs_lookup(filename, &vi);
+	if (ret) {
+		printf("** Unable to find file %s **\n", filename);
+		return ret;
+	}
+	if (!S_ISREG(vi.mode)) {
+		printf("** %s is not a regular file **\n", filename);
+		return -EISDIR;
+	}
+
+	if (offset >= vi.size) {
+		*actread = 0;
+		return 0;
+	}
+	if (!len || len > vi.size - offset)
+		len = vi.size - offset;
+
+	ret = sqfs_pread(&vi, buf, len, offset);
+	if (ret) {
+		printf("** Unable to read file %s: %d **\n", filename, ret);
+		return ret;
+	}
+	*actread = len;
+
+	return 0;
+}
+
+void sqfs_release(void)
+{
+	/* Keep the metadata, drop the large buffers used for file data */
+	free(sqfs_sbi.raw);
+	sqfs_sbi.raw = NULL;
+	sqfs_sbi.raw_size = 0;
+	sqfs_sbi.raw_len = 0;
+	free(sqfs_sbi.blk.data);
+	sqfs_sbi.blk.data = NULL;
+	sqfs_sbi.blk.len = 0;
+	free(sqfs_sbi.frag.data);
+	sqfs_sbi.frag.data = NULL;
+	sqfs_sbi.frag.len = 0;
+}
+
+void sqfs_close(void)
+{
+	sqfs_put_super();
+}
@@ -0,0 +1,205 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * SquashFS 4.0 on-disk format
+ *
+ * Derived from the Linux kernel's fs/squashfs/squashfs_fs.h. Only what is
+ * needed to read an image is kept.
+ */
+
+#ifndef __SQUASHFS_FS_H
+#define __SQUASHFS_FS_H
+
+#include <linux/types.h>
+
+#define SQUASHFS_MAGIC			0x73717368
+#define SQUASHFS_MAJOR			4
+#define SQUASHFS_MINOR			0
+
+#define SQUASHFS_METADATA_SIZE		8192
+#define SQUASHFS_FILE_MIN_LOG		12
+#define SQUASHFS_FILE_MAX_LOG		20
+#define SQUASHFS_NAME_LEN		256
+#define SQUASHFS_DIR_COUNT		256
+#define SQUASHFS_INVALID_FRAG		0xffffffffU
+#define SQUASHFS_INVALID_BLK		((u64)-1)
+
+/* Superblock flags */
+#define SQUASHFS_NOI			0x0001
+#define SQUASHFS_NOD			0x0002
+#define SQUASHFS_NOF			0x0008
+#define SQUASHFS_NO_FRAG		0x0010
+#define SQUASHFS_ALWAYS_FRAG		0x0020
+#define SQUASHFS_DUPLICATE		0x0040
+#define SQUASHFS_EXPORT			0x0080
+#define SQUASHFS_NOX			0x0100
+#define SQUASHFS_NO_XATTR		0x0200
+#define SQUASHFS_COMP_OPT		0x0400
+#define SQUASHFS_NOID			0x0800
+
+/* Compression algorithms */
+#define ZLIB_COMPRESSION		1
+#define LZMA_COMPRESSION		2
+#define LZO_COMPRESSION			3
+#define XZ_COMPRESSION			4
+#define LZ4_COMPRESSION			5
+#define ZSTD_COMPRESSION		6
+
+/* Metadata blocks have a 16-bit header, data blocks a 32-bit size */
+#define SQUASHFS_COMPRESSED_BIT		(1 << 15)
+#define SQUASHFS_COMPRESSED_SIZE(B)	((B) & ~SQUASHFS_COMPRESSED_BIT)
+#define SQUASHFS_COMPRESSED(B)		(!((B) & SQUASHFS_COMPRESSED_BIT))
+
+#define SQUASHFS_COMPRESSED_BIT_BLOCK	(1 << 24)
+#define SQUASHFS_COMPRESSED_SIZE_BLOCK(B) \
+	((B) & ~SQUASHFS_COMPRESSED_BIT_BLOCK)
+#define SQUASHFS_COMPRESSED_BLOCK(B)	(!((B) & SQUASHFS_COMPRESSED_BIT_BLOCK))
+
+/*
+ * Inodes are referred to by the position of their metadata block relative
+ * to the start of the inode table and their offset within the uncompressed
+ * block
+ */
+#define SQUASHFS_INODE_BLK(A)		((u32)((A) >> 16))
+#define SQUASHFS_INODE_OFFSET(A)	((u32)((A) & 0xffff))
+#define SQUASHFS_MKINODE(A, B)		(((u64)(A) << 16) + (B))
+
+/* Fragment table entries and their index */
+#define SQUASHFS_FRAGMENT_BYTES(A)	\
+	((A) * sizeof(struct squashfs_fragment_entry))
+#define SQUASHFS_FRAGMENT_INDEX(A)	\
+	(SQUASHFS_FRAGMENT_BYTES(A) / SQUASHFS_METADATA_SIZE)
+#define SQUASHFS_FRAGMENT_INDEX_OFFSET(A)	\
+	(SQUASHFS_FRAGMENT_BYTES(A) % SQUASHFS_METADATA_SIZE)
+#define SQUASHFS_FRAGMENT_INDEXES(A)	\
+	DIV_ROUND_UP(SQUASHFS_FRAGMENT_BYTES(A), SQUASHFS_METADATA_SIZE)
+
+/* Inode types */
+#define SQUASHFS_DIR_TYPE		1
+#define SQUASHFS_REG_TYPE		2
+#define SQUASHFS_SYMLINK_TYPE		3
+#define SQUASHFS_BLKDEV_TYPE		4
+#define SQUASHFS_CHRDEV_TYPE		5
+#define SQUASHFS_FIFO_TYPE		6
+#define SQUASHFS_SOCKET_TYPE		7
+#define SQUASHFS_LDIR_TYPE		8
+#define SQUASHFS_LREG_TYPE		9
+#define SQUASHFS_LSYMLINK_TYPE		10
+#define SQUASHFS_LBLKDEV_TYPE		11
+#define SQUASHFS_LCHRDEV_TYPE		12
+#define SQUASHFS_LFIFO_TYPE		13
+#define SQUASHFS_LSOCKET_TYPE		14
+
+struct squashfs_super_block {
+	__le32 s_magic;
+	__le32 inodes;
+	__le32 mkfs_time;
+	__le32 block_size;
+	__le32 fragments;
+	__le16 compression;
+	__le16 block_log;
+	__le16 flags;
+	__le16 no_ids;
+	__le16 s_major;
+	__le16 s_minor;
+	__le64 root_inode;
+	__le64 bytes_used;
+	__le64 id_table_start;
+	__le64 xattr_id_table_start;
+	__le64 inode_table_start;
+	__le64 directory_table_start;
+	__le64 fragment_table_start;
+	__le64 lookup_table_start;
+};
+
+struct squashfs_base_inode {
+	__le16 inode_type;
+	__le16 mode;
+	__le16 uid;
+	__le16 guid;
+	__le32 mtime;
+	__le32 inode_number;
+};
+
+struct squashfs_reg_inode {
+	struct squashfs_base_inode base;
+	__le32 start_block;
+	__le32 fragment;
+	__le32 offset;
+	__le32 file_size;
+	/* followed by __le32 block_list[] */
+};
+
+struct squashfs_lreg_inode {
+	struct squashfs_base_inode base;
+	__le64 start_block;
+	__le64 file_size;
+	__le64 sparse;
+	__le32 nlink;
+	__le32 fragment;
+	__le32 offset;
+	__le32 xattr;
+	/* followed by __le32 block_list[] */
+};
+
+struct squashfs_symlink_inode {
+	struct squashfs_base_inode base;
+	__le32 nlink;
+	__le32 symlink_size;
+	/* followed by char symlink[symlink_size] */
+};
+
+struct squashfs_dir_inode {
+	struct squashfs_base_inode base;
+	__le32 start_block;
+	__le32 nlink;
+	__le16 file_size;
+	__le16 offset;
+	__le32 parent_inode;
+};
+
+struct squashfs_ldir_inode {
+	struct squashfs_base_inode base;
+	__le32 nlink;
+	__le32 file_size;
+	__le32 start_block;
+	__le32 parent_inode;
+	__le16 i_count;
+	__le16 offset;
+	__le32 xattr;
+	/* followed by struct squashfs_dir_index index[i_count] */
+};
+
+/*
+ * Index of a large directory: @index is the position in the listing of a
+ * directory header starting in the metadata block at @start_block, and
+ * @name is the first name after that header
+ */
+struct squashfs_dir_index {
+	__le32 index;
+	__le32 start_block;
+	__le32 size;
+	/* followed by char name[size + 1] */
+};
+
+/* A run of directory entries whose inodes share a metadata block */
+struct squashfs_dir_header {
+	__le32 count;
+	__le32 start_block;
+	__le32 inode_number;
+};
+
+struct squashfs_dir_entry {
+	__le16 offset;
+	__le16 inode_number;
+	__le16 type;
+	__le16 size;
+	/* followed by char name[size + 1] */
+};
+
+struct squashfs_fragment_entry {
+	__le64 start_block;
+	__le32 size;
+	__le32 unused;
+};
+
+#endif /* __SQUASHFS_FS_H */
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS superblock, raw device access and metadata blocks
+ */
+
+#include <common.h>
+#include <fs_internal.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <asm/unaligned.h>
+#include "internal.h"
+
+struct sqfs_sb_info sqfs_sbi;
+
+/* fs_devread() takes an int length */
+#define SQFS_MAX_DEVREAD	SZ_1G
+
+int sqfs_dev_read(void *buf, u64 offset, size_t len)
+{
+	struct blk_desc *desc = sqfs_sbi.desc;
+	size_t now;
+
+	while (len) {
+		now = min_t(size_t, len, SQFS_MAX_DEVREAD);
+		if (!fs_devread(desc, sqfs_sbi.part, offset >> desc->log2blksz,
+				offset & (desc->blksz - 1), now, buf))
+			return -EIO;
+		buf += now;
+		offset += now;
+		len -= now;
+	}
+
+	return 0;
+}
+
+/**
+ * sqfs_read_raw() - Get raw data from the partition
+ *
+ * Data and metadata are mostly read in the order they are stored, so a
+ * window beyond the requested data is read as well and kept for the next
+ * call.
+ *
+ * @pos: Position of the data on the partition
+ * @len: Length of the data
+ * @ahead: Number of bytes after the data which are likely to be needed next
+ * Return: pointer to the data, valid until the next call, or NULL on error
+ */
+const u8 *sqfs_read_raw(u64 pos, size_t len, size_t ahead)
+{
+	struct sqfs_sb_info *sbi = &sqfs_sbi;
+	size_t want;
+
+	if (pos > sbi->bytes_used || len > sbi->bytes_used - pos) {
+		debug("%s: %zu bytes at %llu are past the end\n", __func__,
+		      len, pos);
+		return NULL;
+	}
+
+	if (sbi->raw_len && pos >= sbi->raw_pos &&
+	    pos + len <= sbi->raw_pos + sbi->raw_len)
+		return sbi->raw + (pos - sbi->raw_pos);
+
+	want = len + min_t(size_t, ahead, SQFS_READAHEAD_SIZE);
+	want = min_t(u64, want, sbi->bytes_used - pos);
+
+	if (want > sbi->raw_size) {
+		free(sbi->raw);
+		sbi->raw_len = 0;
+		sbi->raw_size = 0;
+		sbi->raw = malloc_cache_aligned(want);
+		if (!sbi->raw)
+			return NULL;
+		sbi->raw_size = want;
+	}
+
+	sbi->raw_len = 0;
+	if (sqfs_dev_read(sbi->raw, pos, want))
+		return NULL;
+	sbi->raw_pos = pos;
+	sbi->raw_len = want;
+
+	return sbi->raw;
+}
+
+static const struct sqfs_metablock *sqfs_get_metablock(u64 pos)
+{
+	struct sqfs_metablock *mb;
+	const u8 *in;
+	u16 hdr;
+	u32 len;
+	int i, ret;
+
+	for (i = 0, mb = sqfs_sbi.meta; i < SQFS_META_CACHE_SLOTS; i++, mb++) {
+		if (mb->len && mb->pos == pos)
+			return mb;
+	}
+
+	in = sqfs_read_raw(pos, sizeof(hdr), SQFS_META_READAHEAD);
+	if (!in)
+		return NULL;
+	hdr = get_unaligned_le16(in);
+	len = SQUASHFS_COMPRESSED_SIZE(hdr);
+	if (!len || len > SQUASHFS_METADATA_SIZE)
+		return NULL;
+	in = sqfs_read_raw(pos + sizeof(hdr), len, SQFS_META_READAHEAD);
+	if (!in)
+		return NULL;
+
+	mb = &sqfs_sbi.meta[sqfs_sbi.meta_next];
+	mb->len = 0;
+	if (!mb->data) {
+		mb->data = malloc(SQUASHFS_METADATA_SIZE);
+		if (!mb->data)
+			return NULL;
+	}
+	if (SQUASHFS_COMPRESSED(hdr)) {
+		ret = sqfs_decompress(mb->data, SQUASHFS_METADATA_SIZE, in,
+				      len);
+		if (ret <= 0)
+			return NULL;
+		mb->len = ret;
+	} else {
+		memcpy(mb->data, in, len);
+		mb->len = len;
+	}
+	mb->pos = pos;
+	mb->next = pos + sizeof(hdr) + len;
+	sqfs_sbi.meta_next = (sqfs_sbi.meta_next + 1) % SQFS_META_CACHE_SLOTS;
+
+	return mb;
+}
+
+/**
+ * sqfs_read_meta() - Read from a metadata table
+ *
+ * @buf: Destination buffer, or NULL to skip @len bytes
+ * @blk: Position of the metadata block to read from, updated to that of the
+ *	next byte to read
+ * @off: Offset of the data within the uncompressed block, updated likewise
+ * @len: Number of bytes to read
+ * Return: 0 if OK, -ve on error
+ */
+int sqfs_read_meta(void *buf, u64 *blk, u32 *off, size_t len)
+{
+	const struct sqfs_metablock *mb;
+	size_t now;
+
+	while (len) {
+		mb = sqfs_get_metablock(*blk);
+		if (!mb)
+			return -EIO;
+		if (*off > mb->len)
+			return -EFSCORRUPTED;
+		now = min_t(size_t, len, mb->len - *off);
+		if (buf) {
+			memcpy(buf, mb->data + *off, now);
+			buf += now;
+		}
+		len -= now;
+		*off += now;
+		if (*off == mb->len) {
+			*blk = mb->next;
+			*off = 0;
+		}
+	}
+
+	return 0;
+}
+
+int sqfs_read_superblock(void)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct squashfs_super_block, sb, 1);
+	struct sqfs_sb_info *sbi = &sqfs_sbi;
+	u64 frag_table, end;
+	unsigned int i, n;
+	int ret;
+
+	if (sqfs_dev_read(sb, 0, sizeof(*sb)))
+		return -EIO;
+
+	if (le32_to_cpu(sb->s_magic) != SQUASHFS_MAGIC)
+		return -EINVAL;
+
+	if (le16_to_cpu(sb->s_major) != SQUASHFS_MAJOR ||
+	    le16_to_cpu(sb->s_minor) != SQUASHFS_MINOR) {
+		printf("SquashFS: unsupported version %u.%u\n",
+		       le16_to_cpu(sb->s_major), le16_to_cpu(sb->s_minor));
+		return -EINVAL;
+	}
+
+	sbi->block_size = le32_to_cpu(sb->block_size);
+	sbi->block_log = le16_to_cpu(sb->block_log);
+	if (sbi->block_log < SQUASHFS_FILE_MIN_LOG ||
+	    sbi->block_log > SQUASHFS_FILE_MAX_LOG ||
+	    sbi->block_size != 1U << sbi->block_log) {
+		printf("SquashFS: invalid block size %u\n", sbi->block_size);
+		return -EINVAL;
+	}
+
+	sbi->compression = le16_to_cpu(sb->compression);
+	sbi->flags = le16_to_cpu(sb->flags);
+	sbi->fragments = le32_to_cpu(sb->fragments);
+	sbi->root_inode = le64_to_cpu(sb->root_inode);
+	sbi->bytes_used = le64_to_cpu(sb->bytes_used);
+	sbi->inode_table = le64_to_cpu(sb->inode_table_start);
+	sbi->dir_table = le64_to_cpu(sb->directory_table_start);
+	frag_table = le64_to_cpu(sb->fragment_table_start);
+
+	end = sbi->bytes_used;
+	if (end < sizeof(*sb) || sbi->inode_table >= end ||
+	    sbi->dir_table >= end || sbi->inode_table >= sbi->dir_table) {
+		printf("SquashFS: corrupt superblock\n");
+		return -EFSCORRUPTED;
+	}
+
+	ret = sqfs_decompressor_init();
+	if (ret)
+		return ret;
+
+	/* The fragment table is found through an array of block positions */
+	if (sbi->fragments) {
+		n = SQUASHFS_FRAGMENT_INDEXES(sbi->fragments);
+		if (frag_table >= end || n * sizeof(u64) > end - frag_table)
+			return -EFSCORRUPTED;
+		sbi->frag_index = malloc_cache_aligned(n * sizeof(u64));
+		if (!sbi->frag_index)
+			return -ENOMEM;
+		if (sqfs_dev_read(sbi->frag_index, frag_table, n * sizeof(u64)))
+			return -EIO;
+		for (i = 0; i < n; i++) {
+			sbi->frag_index[i] = le64_to_cpu(sbi->frag_index[i]);
+			if (sbi->frag_index[i] >= end)
+				return -EFSCORRUPTED;
+		}
+	}
+
+	return 0;
+}
+
+void sqfs_put_super(void)
+{
+	int i;
+
+	for (i = 0; i < SQFS_META_CACHE_SLOTS; i++)
+		free(sqfs_sbi.meta[i].data);
+	free(sqfs_sbi.raw);
+	free(sqfs_sbi.blk.data);
+	free(sqfs_sbi.frag.data);
+	free(sqfs_sbi.frag_index);
+	free(sqfs_sbi.zstd_wksp);
+	memset(&sqfs_sbi, '\0', sizeof(sqfs_sbi));
+}
@@ -197,6 +197,38 @@ static inline void blkcache_invalidate(int iftype, int dev) {}
 
 #endif
 
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/**
+ * fs_invalidate() - forget a file system kept mounted on a device
+ *
+ * The file system is unmounted at the latest when the next file system
+ * command is run.
+ *
+ * @iftype:	IF_TYPE_x for type of device
+ * @dev:	device index of particular type, -1 for all of them
+ */
+void fs_invalidate(int iftype, int dev);
+#else
+static inline void fs_invalidate(int iftype, int dev) {}
+#endif
+
+/**
+ * blk_invalidate() - drop everything cached about the contents of a device
+ *
+ * This must be called when the device is written or erased, and when it is
+ * (re)initialized or switched to another hardware partition, since it may
+ * then hold different contents.
+ *
+ * @iftype:	IF_TYPE_x for type of device
+ * @dev:	device index of particular type, -1 for all of them, e.g. when
+ *		a bus is rescanned
+ */
+static inline void blk_invalidate(int iftype, int dev)
+{
+	blkcache_invalidate(iftype, dev);
+	fs_invalidate(iftype, dev);
+}
+
 #if CONFIG_IS_ENABLED(BLK)
 struct udevice;
 
@@ -449,14 +481,14 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_invalidate(block_dev->if_type, block_dev->devnum);
 	return block_dev->block_write(block_dev, start, blkcnt, buffer);
 }
 
 static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_invalidate(block_dev->if_type, block_dev->devnum);
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
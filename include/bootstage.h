@@ -15,6 +15,7 @@
 enum bootstage_flags {
 	BOOTSTAGEF_ERROR	= 1 << 0,	/* Error record */
 	BOOTSTAGEF_ALLOC	= 1 << 1,	/* Allocate an id */
+	BOOTSTAGEF_SPAN		= 1 << 2,	/* Nested span, see below */
 };
 
 /* bootstate sub-IDs used for kernel and ramdisk ranges */
@@ -202,6 +203,9 @@ enum bootstage_id {
 	BOOTSTATE_ID_ACCUM_DM_SPL,
 	BOOTSTATE_ID_ACCUM_DM_F,
 	BOOTSTATE_ID_ACCUM_DM_R,
+	BOOTSTAGE_ID_ACCUM_DM_INDEX,
+	BOOTSTAGE_ID_ACCUM_FDT_FIXUP,
+	BOOTSTAGE_ID_ACCUM_BLK_READ,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
@@ -307,9 +311,42 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name);
  */
 uint32_t bootstage_accum(enum bootstage_id id);
 
+/**
+ * bootstage_span_start() - Start timing a nested span of the boot
+ *
+ * Spans record when an activity started and how long it took. A span started
+ * before the previous one has ended is nested in it. This gives the call
+ * tree of the boot, which bootstage_report_folded() can print.
+ *
+ * Spans may only use three quarters of the records, so that the marks of the
+ * boot stages are still recorded when there are many spans.
+ *
+ * @name: Name of the span, e.g. a device name. This is copied once the full
+ *	malloc() is available, so it need not outlive the device
+ * @return id to pass to bootstage_span_end(), or -ve if there is no space
+ *	left for the record
+ */
+int bootstage_span_start(const char *name);
+
+/**
+ * bootstage_span_end() - Mark the end of a span
+ *
+ * @id: Id returned by bootstage_span_start(); -ve values are ignored
+ */
+void bootstage_span_end(int id);
+
 /* Print a report about boot time */
 void bootstage_report(void);
 
+/**
+ * bootstage_report_folded() - Print the spans as folded stacks
+ *
+ * Each line has the names of the nested spans separated by ';' and the time
+ * spent in the innermost one, excluding its own nested spans, in
+ * microseconds. This is the input format of flame graph tools.
+ */
+void bootstage_report_folded(void);
+
 /**
  * Add bootstage information to the device tree
  *
@@ -340,6 +377,23 @@ int bootstage_stash(void *base, int size);
  */
 int bootstage_unstash(const void *base, int size);
 
+/**
+ * bootstage_stash_default() - Stash bootstage data for the next phase
+ *
+ * This uses the bloblist if there is one, else the region given by
+ * CONFIG_BOOTSTAGE_STASH_ADDR and CONFIG_BOOTSTAGE_STASH_SIZE.
+ *
+ * @return 0 if OK, -ve on error
+ */
+int bootstage_stash_default(void);
+
+/**
+ * bootstage_unstash_default() - Read bootstage data from the previous phase
+ *
+ * @return 0 if OK, -ENOENT if none was found, other -ve on error
+ */
+int bootstage_unstash_default(void);
+
 /**
  * bootstage_get_size() - Get the size of the bootstage data
  *
@@ -406,6 +460,15 @@ static inline uint32_t bootstage_accum(enum bootstage_id id)
 	return 0;
 }
 
+static inline int bootstage_span_start(const char *name)
+{
+	return -ENOSYS;
+}
+
+static inline void bootstage_span_end(int id)
+{
+}
+
 static inline int bootstage_stash(void *base, int size)
 {
 	return 0;	/* Pretend to succeed */
@@ -416,6 +479,16 @@ static inline int bootstage_unstash(const void *base, int size)
 	return 0;	/* Pretend to succeed */
 }
 
+static inline int bootstage_stash_default(void)
+{
+	return 0;	/* Pretend to succeed */
+}
+
+static inline int bootstage_unstash_default(void)
+{
+	return 0;	/* Pretend to succeed */
+}
+
 static inline int bootstage_get_size(void)
 {
 	return 0;
@@ -428,6 +501,26 @@ static inline int bootstage_init(bool first)
 
 #endif /* ENABLE_BOOTSTAGE */
 
+#if !defined(USE_HOSTCC)
+/*
+ * With CONFIG_BOOTSTAGE_PROFILE, device probes, commands and file reads are
+ * timed as spans. These compile to nothing otherwise.
+ */
+static inline int bootstage_profile_start(const char *name)
+{
+	if (!IS_ENABLED(CONFIG_BOOTSTAGE_PROFILE))
+		return -ENOSYS;
+
+	return bootstage_span_start(name);
+}
+
+static inline void bootstage_profile_end(int id)
+{
+	if (IS_ENABLED(CONFIG_BOOTSTAGE_PROFILE))
+		bootstage_span_end(id);
+}
+#endif
+
 /* Helper macro for adding a bootstage to a line of code */
 #define BOOTSTAGE_MARKER()	\
 		bootstage_mark_code(__FILE__, __func__, __LINE__)
@@ -13,6 +13,7 @@ int btrfs_ls(const char *);
 int btrfs_exists(const char *);
 int btrfs_size(const char *, loff_t *);
 int btrfs_read(const char *, void *, loff_t, loff_t, loff_t *);
+void btrfs_release(void);
 void btrfs_close(void);
 int btrfs_uuid(char *);
 void btrfs_list_subvols(void);
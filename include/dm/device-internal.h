@@ -11,6 +11,7 @@
 #define _DM_DEVICE_INTERNAL_H
 
 #include <dm/ofnode.h>
+#include <dm/uclass-id.h>
 
 struct device_node;
 struct udevice;
@@ -180,6 +181,93 @@ static inline int device_chld_remove(struct udevice *dev, struct driver *drv,
  */
 fdt_addr_t simple_bus_translate(struct udevice *dev, fdt_addr_t addr);
 
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+/**
+ * dm_lazy_defer() - Put off binding a device tree node
+ *
+ * This is called by the device tree scan after relocation. Nodes whose
+ * parent is the root or a simple-bus device are recorded with the uclass
+ * of their driver instead of being bound. Other nodes, simple-bus nodes and
+ * nodes without a driver are left to the caller, as are nodes whose subtree
+ * has a driver which may bind more devices from its bind() or post_bind()
+ * method.
+ *
+ * @parent:	Device the node would be bound to
+ * @node:	Node to bind
+ * @return true if binding was put off, false if the caller must bind @node
+ */
+bool dm_lazy_defer(struct udevice *parent, ofnode node);
+
+/**
+ * dm_lazy_bind_uclass() - Bind the deferred nodes of a uclass
+ *
+ * The nodes are bound in device tree order. This is called by uclass_get()
+ * so that any lookup in the uclass sees all its devices.
+ *
+ * @id:		Uclass whose nodes are bound
+ * @return 0 if OK, -ve on error (the first error seen)
+ */
+int dm_lazy_bind_uclass(enum uclass_id id);
+
+/**
+ * dm_lazy_bind_ofnode() - Bind the deferred node holding a node
+ *
+ * Drivers may bind devices for subnodes which have no compatible string,
+ * so lookups by node bind the deferred node which @node is part of.
+ *
+ * @node:	Node which is about to be looked up
+ * @return 0 if OK, -ve on error
+ */
+int dm_lazy_bind_ofnode(ofnode node);
+
+/**
+ * dm_lazy_bind_children() - Bind the deferred nodes of a parent
+ *
+ * This is called before walking the children of a device, so that the walk
+ * sees the nodes deferred below the root or a simple-bus device.
+ *
+ * @parent:	Device whose children are about to be looked at
+ * @return 0 if OK, -ve on error (the first error seen)
+ */
+int dm_lazy_bind_children(struct udevice *parent);
+
+/**
+ * dm_lazy_bind_all() - Bind all deferred nodes
+ *
+ * @return 0 if OK, -ve on error (the first error seen)
+ */
+int dm_lazy_bind_all(void);
+
+/**
+ * dm_lazy_forget() - Drop the deferred nodes of a device being unbound
+ *
+ * @parent:	Device being unbound
+ */
+void dm_lazy_forget(struct udevice *parent);
+
+/**
+ * dm_lazy_uninit() - Drop all deferred nodes
+ */
+void dm_lazy_uninit(void);
+#else
+static inline bool dm_lazy_defer(struct udevice *parent, ofnode node)
+{
+	return false;
+}
+
+static inline int dm_lazy_bind_uclass(enum uclass_id id) { return 0; }
+static inline int dm_lazy_bind_ofnode(ofnode node) { return 0; }
+
+static inline int dm_lazy_bind_children(struct udevice *parent)
+{
+	return 0;
+}
+
+static inline int dm_lazy_bind_all(void) { return 0; }
+static inline void dm_lazy_forget(struct udevice *parent) {}
+static inline void dm_lazy_uninit(void) {}
+#endif
+
 /* Cast away any volatile pointer */
 #define DM_ROOT_NON_CONST		(((gd_t *)gd)->dm_root)
 #define DM_UCLASS_ROOT_NON_CONST	(((gd_t *)gd)->uclass_root)
@@ -44,6 +44,20 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id);
  */
 int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 
+/**
+ * lists_driver_lookup_compatible() - Find the driver for a compatible string
+ *
+ * If several drivers match, the first one in the driver list is returned,
+ * as with the order of the U_BOOT_DRIVER() entries. After relocation this
+ * uses an index of all compatible strings, built on first use.
+ *
+ * @compat: Compatible string to look for
+ * @idp: Returns the matching entry of the of_match table of the driver
+ * @return driver, or NULL if none matches
+ */
+struct driver *lists_driver_lookup_compatible(const char *compat,
+					      const struct udevice_id **idp);
+
 /**
  * lists_bind_fdt() - bind a device tree node
  *
@@ -209,6 +209,25 @@ struct env_driver {
 
 extern struct hsearch_data env_htab;
 
+/**
+ * env_mark_stored() - Note whether the environment matches its storage
+ *
+ * This is called after the environment has been loaded, saved or erased.
+ * With CONFIG_ENV_SAVE_ONLY_CHANGED, env_save() skips writing an environment
+ * which has not changed since it was loaded or saved.
+ *
+ * @stored: true if the environment in storage is the current one
+ */
+void env_mark_stored(bool stored);
+
+/**
+ * env_is_stored() - Check whether the environment matches its storage
+ *
+ * @return true if no variable changed since the environment was loaded or
+ * saved
+ */
+bool env_is_stored(void);
+
 #endif /* DO_DEPS_ONLY */
 
 #endif /* _ENV_INTERNAL_H_ */
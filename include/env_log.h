@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Format of the journaled environment in MMC (CONFIG_ENV_MMC_LOG)
+ *
+ * The environment area is split into two halves. Each save appends a record
+ * with the variables changed since the last save to the current half. When
+ * it is full, the whole environment is written as the first record of the
+ * other half, with the next generation number. Records are aligned to
+ * ENV_LOG_ALIGN bytes and have their own CRC, so an interrupted save leaves
+ * the previous environment intact.
+ *
+ * This is shared with fw_printenv and fw_setenv.
+ */
+
+#ifndef __ENV_LOG_H
+#define __ENV_LOG_H
+
+#include <linux/types.h>
+
+#define ENV_LOG_MAGIC	0x474f4c45	/* "ELOG" */
+#define ENV_LOG_ALIGN	512
+
+/**
+ * struct env_log_hdr - Header of a record in the journaled environment
+ *
+ * The data is a list of '\0' terminated entries as in env_t. In the first
+ * record of a half it holds the whole environment. In the other records a
+ * "name=value" entry sets a variable and a "name" entry deletes it.
+ *
+ * All fields are little-endian.
+ *
+ * @magic: ENV_LOG_MAGIC
+ * @gen: Generation, the same for all records in a half
+ * @len: Number of bytes of data after the header
+ * @crc: CRC32 of the header, with @crc set to 0, and of the data
+ */
+struct env_log_hdr {
+	__le32 magic;
+	__le32 gen;
+	__le32 len;
+	__le32 crc;
+};
+
+#endif /* __ENV_LOG_H */
@@ -31,10 +31,13 @@
 #define EXT4_INDEX_FL		0x00001000 /* Inode uses hash tree index */
 #define EXT4_EXTENTS_FL		0x00080000 /* Inode uses extents */
 #define EXT4_EXT_MAGIC			0xf30a
+#define EXT_INIT_MAX_LEN		(1 << 15) /* Longer extents are unwritten */
+#define EXT4_FEATURE_COMPAT_DIR_INDEX	0x0020
 #define EXT4_FEATURE_RO_COMPAT_GDT_CSUM	0x0010
 #define EXT4_FEATURE_RO_COMPAT_METADATA_CSUM 0x0400
 #define EXT4_FEATURE_INCOMPAT_EXTENTS	0x0040
 #define EXT4_FEATURE_INCOMPAT_64BIT	0x0080
+#define EXT4_FEATURE_INCOMPAT_FLEX_BG	0x0200
 #define EXT4_INDIRECT_BLOCKS		12
 
 #define EXT4_BG_INODE_UNINIT		0x0001
@@ -101,6 +104,12 @@ struct ext_filesystem {
 	/* Block group descritpor table */
 	char *gdtable;
 
+	/*
+	 * Bitmaps of each group, NULL until the group is first used. Only
+	 * the groups marked in bmap_dirty are written back.
+	 */
+	unsigned char *bmap_dirty;
+
 	/* Block Bitmap Related */
 	unsigned char **blk_bmaps;
 	long int curr_blkno;
@@ -141,17 +150,21 @@ int ext4_write_file(const char *filename, void *buf, loff_t offset, loff_t len,
 int ext4fs_create_link(const char *target, const char *fname);
 #endif
 
+struct fs_load_file;
+
 struct ext_filesystem *get_fs(void);
 int ext4fs_open(const char *filename, loff_t *len);
 int ext4fs_read(char *buf, loff_t offset, loff_t len, loff_t *actread);
 int ext4fs_mount(unsigned part_length);
 void ext4fs_close(void);
+void ext4fs_release(void);
 void ext4fs_reinit_global(void);
 int ext4fs_ls(const char *dirname);
 int ext4fs_exists(const char *filename);
 int ext4fs_size(const char *filename, loff_t *size);
 void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot);
 int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf);
+int ext4fs_devdiscard(lbaint_t sector, lbaint_t count);
 void ext4fs_set_blk_dev(struct blk_desc *rbdd, disk_partition_t *info);
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache);
@@ -159,6 +172,7 @@ int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 disk_partition_t *fs_partition);
 int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 		   loff_t *actread);
+int ext4fs_read_files(struct fs_load_file *files, int count);
 int ext4_read_superblock(char *buffer);
 int ext4fs_uuid(char *uuid_str);
 void ext_cache_init(struct ext_block_cache *cache);
@@ -325,6 +325,8 @@ int fdt_setup_simplefb_node(void *fdt, int node, u64 base_address, u32 width,
 			    u32 height, u32 stride, const char *format);
 
 int fdt_overlay_apply_verbose(void *fdt, void *fdto);
+int fdt_overlay_apply_list(void *fdt, int size, void * const fdtos[],
+			   int count);
 
 int fdt_valid(struct fdt_header **blobp);
 
@@ -658,6 +658,33 @@ const char *fdtdec_get_compatible(enum fdt_compat_id id);
  */
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name);
 
+/**
+ * fdtdec_node_offset_by_phandle() - Find the node with a given phandle
+ *
+ * This works like fdt_node_offset_by_phandle(). With CONFIG_OF_CONTROL_INDEX,
+ * lookups in the control device tree after relocation use a table built on
+ * first use instead of walking the tree.
+ *
+ * @blob:	FDT blob
+ * @phandle:	Phandle to look for
+ * @return node offset if found, -ve FDT_ERR_... code on error
+ */
+int fdtdec_node_offset_by_phandle(const void *blob, uint phandle);
+
+#if CONFIG_IS_ENABLED(OF_CONTROL_INDEX)
+/**
+ * fdtdec_index_invalidate() - Drop the phandle and alias tables
+ *
+ * The tables are rebuilt when nodes or properties are added to or deleted
+ * from the control device tree. This must be called after changing a
+ * phandle or an alias in place, i.e. without changing the size of the
+ * property.
+ */
+void fdtdec_index_invalidate(void);
+#else
+static inline void fdtdec_index_invalidate(void) {}
+#endif
+
 /**
  * Look up a property in a node and return its contents in an integer
  * array of given length. The property must have at least enough data for
@@ -1014,6 +1041,8 @@ int fdtdec_set_ethernet_mac_address(void *fdt, const u8 *mac, size_t size);
  */
 static inline int fdtdec_set_phandle(void *blob, int node, uint32_t phandle)
 {
+	fdtdec_index_invalidate();
+
 	return fdt_setprop_u32(blob, node, "phandle", phandle);
 }
 
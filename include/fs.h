@@ -13,6 +13,8 @@
 #define FS_TYPE_SANDBOX	3
 #define FS_TYPE_UBIFS	4
 #define FS_TYPE_BTRFS	5
+#define FS_TYPE_EROFS	6
+#define FS_TYPE_SQUASHFS	7
 
 /*
  * Tell the fs layer which block device an partition to use for future
@@ -49,6 +51,20 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part);
  */
 void fs_close(void);
 
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/**
+ * fs_unmount() - Unmount the file system kept mounted by fs_close()
+ *
+ * With CONFIG_FS_MOUNT_CACHE fs_close() leaves the file system mounted, so
+ * that the next command on the same partition need not probe it again. This
+ * closes it for good. It is needed before a file system driver is pointed at
+ * another partition directly, bypassing fs_set_blk_dev().
+ */
+void fs_unmount(void);
+#else
+static inline void fs_unmount(void) {}
+#endif
+
 /**
  * fs_get_type() - Get type of current filesystem
  *
@@ -109,6 +125,36 @@ int fs_size(const char *filename, loff_t *size);
 int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	    loff_t *actread);
 
+/**
+ * struct fs_load_file - File to load with fs_read_files()
+ *
+ * @filename:	full path of the file
+ * @addr:	address to load the file to
+ * @size:	returns the number of bytes read
+ */
+struct fs_load_file {
+	const char *filename;
+	ulong addr;
+	loff_t size;
+};
+
+/**
+ * fs_read_files() - read whole files from the partition previously set by
+ *		     fs_set_blk_dev()
+ *
+ * The partition is mounted once for all the files. They are all looked up,
+ * and checked not to overlap each other in memory, before any is read.
+ *
+ * On ext4 the extents of all the files are then read together, sorted by
+ * their position on the device. Other file systems read the files one
+ * after the other.
+ *
+ * @files:	files to read
+ * @count:	number of entries in @files
+ * Return:	0 if OK with valid sizes in @files, -ve on error
+ */
+int fs_read_files(struct fs_load_file *files, int count);
+
 /**
  * fs_write() - write file to the partition previously set by fs_set_blk_dev()
  *
@@ -206,6 +252,8 @@ int do_size(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype);
 int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype);
+int do_load_files(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
+		  int fstype);
 int do_ls(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype);
 int file_exists(const char *dev_type, const char *dev_part, const char *file,
@@ -13,4 +13,82 @@
 int fs_devread(struct blk_desc *, disk_partition_t *, lbaint_t, int, int,
 	       char *);
 
+/**
+ * fs_devdiscard() - Tell the device that blocks of a partition are unused
+ *
+ * Only MMC devices are supported, on which the erase groups lying entirely
+ * within the range are erased. Nothing is done unless CONFIG_FS_DISCARD is
+ * enabled.
+ *
+ * @blk:	Device
+ * @partition:	Partition on @blk
+ * @sector:	First block of the range, relative to the partition
+ * @count:	Number of blocks in the range
+ * Return:	0 if OK, -ve on error
+ */
+int fs_devdiscard(struct blk_desc *blk, disk_partition_t *partition,
+		  lbaint_t sector, lbaint_t count);
+
+/**
+ * struct fs_discard_run - Range of freed filesystem units
+ *
+ * @start:	First unit (block or cluster) of the range
+ * @count:	Number of units in the range
+ */
+struct fs_discard_run {
+	ulong start;
+	ulong count;
+};
+
+/**
+ * struct fs_discard_list - Units freed since the metadata was last written
+ *
+ * Freed units must not be discarded before the metadata freeing them is on
+ * the device, otherwise a failed write leaves files pointing at erased
+ * blocks. They are collected here and discarded by fs_discard_flush().
+ *
+ * @run:	Ranges, merged when contiguous
+ * @count:	Number of ranges in @run
+ * @max:	Number of ranges allocated
+ */
+struct fs_discard_list {
+	struct fs_discard_run *run;
+	int count;
+	int max;
+};
+
+/**
+ * fs_discard_add() - Record a freed unit
+ *
+ * Nothing is recorded unless CONFIG_FS_DISCARD is enabled. A unit which
+ * cannot be recorded is simply not discarded.
+ *
+ * @list:	List to add to
+ * @unit:	Unit which was freed
+ * Return:	0 if OK, -ENOMEM if out of memory
+ */
+int fs_discard_add(struct fs_discard_list *list, ulong unit);
+
+/**
+ * fs_discard_flush() - Discard the recorded units and empty the list
+ *
+ * This must be called once the metadata freeing the units is written. Units
+ * which were allocated again in the meantime are left alone.
+ *
+ * @list:	List to flush
+ * @priv:	Filesystem data passed to @is_free and @discard
+ * @is_free:	Returns true if a unit is still free
+ * @discard:	Discards a range of units, returns 0 if OK
+ */
+void fs_discard_flush(struct fs_discard_list *list, void *priv,
+		      bool (*is_free)(void *priv, ulong unit),
+		      int (*discard)(void *priv, ulong start, ulong count));
+
+/**
+ * fs_discard_free() - Empty the list without discarding anything
+ *
+ * @list:	List to empty
+ */
+void fs_discard_free(struct fs_discard_list *list);
+
 #endif /* __U_BOOT_FS_INTERNAL_H__ */
@@ -304,6 +304,7 @@ enum {
 	IH_COMP_LZMA,			/* lzma  Compression Used	*/
 	IH_COMP_LZO,			/* lzo   Compression Used	*/
 	IH_COMP_LZ4,			/* lz4   Compression Used	*/
+	IH_COMP_ZSTD,			/* zstd  Compression Used	*/
 
 	IH_COMP_COUNT,
 };
@@ -869,6 +870,67 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end);
 
+/**
+ * struct image_decomp_stream - State of a streaming decompression
+ *
+ * @comp:	Compression algorithm (IH_COMP_...)
+ * @dst:	Place to decompress to
+ * @dst_size:	Space available at @dst
+ * @out:	Number of bytes written to @dst so far
+ * @done:	The end of the compressed data has been seen
+ * @priv:	Algorithm-specific state
+ */
+struct image_decomp_stream {
+	int comp;
+	void *dst;
+	ulong dst_size;
+	ulong out;
+	bool done;
+	void *priv;
+};
+
+/**
+ * image_decomp_stream_start() - Start decompressing data piece by piece
+ *
+ * This is an alternative to image_decomp() for data that is still being
+ * read, e.g. from a file. Supported are IH_COMP_NONE, and IH_COMP_GZIP,
+ * IH_COMP_LZ4 and IH_COMP_ZSTD if enabled.
+ *
+ * @st:		Stream state to set up
+ * @comp:	Compression algorithm (IH_COMP_...)
+ * @dst:	Place to decompress to
+ * @dst_size:	Space available at @dst
+ * @return 0 if OK, -ENOSYS if @comp is not supported, -ENOMEM if out of
+ *	memory
+ */
+int image_decomp_stream_start(struct image_decomp_stream *st, int comp,
+			      void *dst, ulong dst_size);
+
+/**
+ * image_decomp_stream_feed() - Decompress the next piece of data
+ *
+ * @st:		Stream state
+ * @src:	Next part of the compressed data, of any length
+ * @len:	Length of @src
+ * @return 0 if OK, -ENOSPC if the output does not fit, other -ve value if
+ *	the data is corrupt
+ */
+int image_decomp_stream_feed(struct image_decomp_stream *st, const void *src,
+			     ulong len);
+
+/**
+ * image_decomp_stream_end() - Finish a streaming decompression
+ *
+ * This frees the state of the decompressor. It must be called even if
+ * image_decomp_stream_feed() failed.
+ *
+ * @st:		Stream state
+ * @out_len:	Returns the number of bytes decompressed
+ * @return 0 if OK, -EINVAL if the compressed data was incomplete, -ENOSPC
+ *	if the output did not fit
+ */
+int image_decomp_stream_end(struct image_decomp_stream *st, ulong *out_len);
+
 /**
  * Set up properties in the FDT
  *
@@ -1091,6 +1153,163 @@ int fit_check_ramdisk(const void *fit, int os_noffset,
 int calculate_hash(const void *data, int data_len, const char *algo,
 			uint8_t *value, int *value_len);
 
+/**
+ * fit_digest_begin() - Open a window in which digests may be pre-computed
+ *
+ * Until fit_digest_release() is called, fit_digest_prepare() hashes the
+ * images of a configuration ahead of time. Outside the window it does
+ * nothing. Calling this with the window already open has no effect.
+ */
+void fit_digest_begin(void);
+
+/**
+ * fit_digest_prepare() - Pre-compute the digests needed by a configuration
+ *
+ * Hashes the data of every image referenced by the configuration, for each
+ * algorithm used by its hash and signature nodes, using all available harts.
+ * The results are picked up by calculate_hash() and hash_calculate() until
+ * fit_digest_release() is called. This does nothing unless fit_digest_begin()
+ * was called.
+ *
+ * @fit:	FIT to check
+ * @cfg_noffset: Offset of the configuration node
+ * @return 0 if OK, -ve on error, in which case images are hashed inline
+ */
+int fit_digest_prepare(const void *fit, int cfg_noffset);
+
+/**
+ * fit_digest_lookup() - Look up a digest computed by fit_digest_prepare()
+ *
+ * @data:	Start of the data
+ * @size:	Size of the data in bytes
+ * @algo:	Hash algorithm name, e.g. "sha256"
+ * @value:	Returns the digest
+ * @value_len:	Returns the length of the digest in bytes
+ * @return 0 if found, -ENOENT if the digest must be calculated
+ */
+int fit_digest_lookup(const void *data, size_t size, const char *algo,
+		      uint8_t *value, int *value_len);
+
+/**
+ * fit_digest_invalidate() - Drop the digests of data about to be overwritten
+ *
+ * This must be called before writing to memory which may hold image data
+ * while the window is open, e.g. when an image is copied to its load
+ * address.
+ *
+ * @start:	Start of the memory written
+ * @size:	Size of the memory written in bytes
+ */
+void fit_digest_invalidate(const void *start, size_t size);
+
+/**
+ * fit_digest_release() - Drop all digests and close the window
+ *
+ * This must be called on every path leaving the code which verifies the
+ * images, since the digests are only valid for as long as the image data is
+ * not changed.
+ */
+void fit_digest_release(void);
+
+struct blk_desc;
+
+/**
+ * struct fit_lazy_info - Source of a FIT loaded by fit_lazy_load()
+ *
+ * @read:	Read @size bytes at byte @offset of the FIT to @buf, returning
+ *		the number of bytes read
+ * @ifname:	Interface name, for files
+ * @dev_part:	Device and partition, for files
+ * @filename:	Name of the FIT file
+ * @desc:	Block device, for raw FITs
+ * @start:	First block of the FIT on @desc
+ */
+struct fit_lazy_info {
+	ulong (*read)(struct fit_lazy_info *info, ulong offset, ulong size,
+		      void *buf);
+	const char *ifname;
+	const char *dev_part;
+	const char *filename;
+	struct blk_desc *desc;
+	ulong start;
+};
+
+/**
+ * fit_lazy_init_file() - Set up to read a FIT from a file
+ *
+ * @info:	Returns the source information
+ * @ifname:	Interface name, e.g. "mmc"
+ * @dev_part:	Device and partition, e.g. "0:2"
+ * @filename:	Path of the FIT file
+ * @return 0 if OK, -ve on error
+ */
+int fit_lazy_init_file(struct fit_lazy_info *info, const char *ifname,
+		       const char *dev_part, const char *filename);
+
+/**
+ * fit_lazy_init_blk() - Set up to read a FIT stored raw on a block device
+ *
+ * @info:	Returns the source information
+ * @ifname:	Interface name, e.g. "mmc"
+ * @dev_part:	Device and (optional) partition, e.g. "0:2"
+ * @blk:	First block of the FIT, relative to the partition
+ * @return 0 if OK, -ve on error
+ */
+int fit_lazy_init_blk(struct fit_lazy_info *info, const char *ifname,
+		      const char *dev_part, ulong blk);
+
+/**
+ * fit_lazy_load() - Load a FIT with external data, one sub-image at a time
+ *
+ * Reads the FIT structure to @addr, then the data of each sub-image used by
+ * the configuration. Uncompressed sub-images with a load address are read
+ * straight to it, all others to their place after the structure. With
+ * CONFIG_IMAGE_DECOMP_STREAM, compressed sub-images which are protected by
+ * hashes only are instead decompressed to their load address while they are
+ * read, one chunk at a time. Hashes are updated as each chunk is read if
+ * @verify is set. Load addresses which overlap the FIT file or each other are
+ * refused.
+ *
+ * @info:	Source of the FIT
+ * @addr:	Address to read the FIT structure to
+ * @conf_uname:	Configuration to load, NULL for the default one
+ * @verify:	Check the hashes of each sub-image
+ * @return 0 if OK, -ve on error
+ */
+int fit_lazy_load(struct fit_lazy_info *info, ulong addr,
+		  const char *conf_uname, int verify);
+
+/* The image was decompressed by fit_lazy_load() */
+#define FIT_LAZY_DECOMPRESSED	BIT(0)
+/* ...and its hashes were checked before decompression */
+#define FIT_LAZY_VERIFIED	BIT(1)
+
+/**
+ * fit_lazy_get_data() - Find data read to its load address by fit_lazy_load()
+ *
+ * The FIT structure is compared with the one read by fit_lazy_load() once
+ * after each fit_lazy_recheck(). Other calls only check its address and
+ * size.
+ *
+ * @fit:	FIT structure
+ * @noffset:	Image node offset
+ * @data:	Returns the address of the image data
+ * @size:	Returns the size of the image data, which differs from the
+ *		data-size property if the image was decompressed
+ * @return FIT_LAZY_... flags if found, -ENOENT if the data is at its usual
+ *	place
+ */
+int fit_lazy_get_data(const void *fit, int noffset, const void **data,
+		      size_t *size);
+
+/**
+ * fit_lazy_recheck() - Check the FIT structure again at the next lookup
+ *
+ * bootm calls this when it starts, since the FIT loaded by fit_lazy_load()
+ * may have been replaced by then.
+ */
+void fit_lazy_recheck(void);
+
 /*
  * At present we only support signing on the host, and verification on the
  * device
@@ -12,6 +12,7 @@
  * Copyright (C) 2001 Peter Bergner, IBM Corp.
  */
 
+/* Number of regions held in struct lmb_region before allocating more */
 #define MAX_LMB_REGIONS 8
 
 struct lmb_property {
@@ -19,18 +20,33 @@ struct lmb_property {
 	phys_size_t size;
 };
 
+/*
+ * Regions are kept sorted by base address and do not overlap, so that
+ * lookups can use a binary search. The table starts out in @initial and is
+ * moved to @heap, allocated with malloc(), once that is full; see
+ * lmb_release(). Use lmb_regions() to get at the table, so that a copy of
+ * the struct does not refer to the @initial table of the original.
+ */
 struct lmb_region {
 	unsigned long cnt;
+	unsigned long max;
 	phys_size_t size;
-	struct lmb_property region[MAX_LMB_REGIONS+1];
+	struct lmb_property *heap;
+	struct lmb_property initial[MAX_LMB_REGIONS+1];
 };
 
+static inline struct lmb_property *lmb_regions(struct lmb_region *rgn)
+{
+	return rgn->heap ? rgn->heap : rgn->initial;
+}
+
 struct lmb {
 	struct lmb_region memory;
 	struct lmb_region reserved;
 };
 
 extern void lmb_init(struct lmb *lmb);
+extern void lmb_release(struct lmb *lmb);
 extern void lmb_init_and_reserve(struct lmb *lmb, bd_t *bd, void *fdt_blob);
 extern void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 				       phys_size_t size, void *fdt_blob);
@@ -52,7 +68,7 @@ extern void lmb_dump_all(struct lmb *lmb);
 static inline phys_size_t
 lmb_size_bytes(struct lmb_region *type, unsigned long region_nr)
 {
-	return type->region[region_nr].size;
+	return lmb_regions(type)[region_nr].size;
 }
 
 void board_lmb_reserve(struct lmb *lmb);
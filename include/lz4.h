@@ -6,6 +6,8 @@
 #ifndef __LZ4_H
 #define __LZ4_H
 
+#include <linux/types.h>
+
 /**
  * ulz4fn() - Decompress LZ4 data
  *
@@ -21,4 +23,85 @@
  */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
 
+/**
+ * ulz4_decompress_block() - Decompress a raw LZ4 block
+ *
+ * Unlike ulz4fn() this takes a single block without any frame around it, as
+ * used by file systems which compress their data in fixed-size clusters.
+ *
+ * @src: Compressed block
+ * @srcn: Length of @src
+ * @dst: Destination for uncompressed data
+ * @dstn: Size of @dst
+ * @padded: @src may be followed by padding, so stop decompressing once @dst
+ *	is full rather than requiring all of @src to be used
+ * @return number of bytes written to @dst, or -EPROTO if the compressed data
+ *	is corrupt or does not fit in @dst
+ */
+int ulz4_decompress_block(const void *src, size_t srcn, void *dst,
+			  size_t dstn, bool padded);
+
+/**
+ * struct ulz4_stream - State of an LZ4 frame decompressed piece by piece
+ *
+ * @dst:	Destination for uncompressed data
+ * @dstn:	Size of @dst
+ * @out:	Number of bytes written to @dst so far
+ * @state:	Part of the frame expected next
+ * @hdr:	Frame or block header collected so far
+ * @hdr_len:	Number of valid bytes in @hdr
+ * @hdr_need:	Number of bytes needed in @hdr
+ * @block_checksum: Blocks are followed by a checksum
+ * @block:	Header of the current block
+ * @block_len:	Length of the current block, including its checksum
+ * @buf:	Holds a block which arrives in several pieces
+ * @buf_size:	Size of @buf
+ * @buf_len:	Number of valid bytes in @buf
+ */
+struct ulz4_stream {
+	void *dst;
+	size_t dstn;
+	size_t out;
+	int state;
+	u8 hdr[15];
+	size_t hdr_len;
+	size_t hdr_need;
+	bool block_checksum;
+	u32 block;
+	size_t block_len;
+	u8 *buf;
+	size_t buf_size;
+	size_t buf_len;
+};
+
+/**
+ * ulz4_stream_init() - Start decompressing an LZ4 frame piece by piece
+ *
+ * @s: Stream state to set up
+ * @dst: Destination for uncompressed data
+ * @dstn: Size of @dst
+ */
+void ulz4_stream_init(struct ulz4_stream *s, void *dst, size_t dstn);
+
+/**
+ * ulz4_stream_feed() - Decompress the next piece of an LZ4 frame
+ *
+ * The pieces may be split at any byte. Blocks lying entirely within one
+ * piece are decompressed in place, others are collected in a buffer first.
+ *
+ * @s: Stream state
+ * @src: Next part of the compressed data
+ * @srcn: Length of @src
+ * @return 1 if the end of the frame was reached, 0 if more data is needed,
+ *	or the same errors as ulz4fn(), or -ENOMEM
+ */
+int ulz4_stream_feed(struct ulz4_stream *s, const void *src, size_t srcn);
+
+/**
+ * ulz4_stream_free() - Free the memory used by an LZ4 stream
+ *
+ * @s: Stream state
+ */
+void ulz4_stream_free(struct ulz4_stream *s);
+
 #endif
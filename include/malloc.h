@@ -958,6 +958,122 @@ extern ulong mem_malloc_brk;
 
 void mem_malloc_init(ulong start, ulong size);
 
+#define MALLOC_HIST_BUCKETS	20
+#define MALLOC_SLAB_CLASSES	5
+
+/**
+ * struct malloc_statistics - malloc() usage, see CONFIG_SYS_MALLOC_STATS
+ *
+ * @pool_start:	Start of the malloc() pool
+ * @pool_size:	Size of the pool available to dlmalloc
+ * @brk_used:	Bytes of the pool handed to dlmalloc so far
+ * @brk_peak:	Highest value of @brk_used, i.e. the pool size actually needed
+ * @in_use:	Bytes currently allocated, including per-chunk overhead
+ * @peak_in_use: Highest value of @in_use
+ * @free_bytes:	Bytes free in the top chunk and the bins
+ * @free_chunks: Number of free chunks in the bins
+ * @largest_free: Largest free chunk; much smaller than @free_bytes means
+ *		the pool is fragmented
+ * @mallocs:	Number of malloc() calls
+ * @callocs:	Number of calloc() calls
+ * @reallocs:	Number of realloc() calls
+ * @memaligns:	Number of memalign() calls needing more than the default
+ *		alignment
+ * @frees:	Number of free() calls
+ * @failures:	Number of allocations which failed
+ * @largest_failure: Largest request which failed
+ * @hist:	Number of requests by size: bucket 0 counts up to 16 bytes,
+ *		bucket n up to 16 << n bytes, the last one everything larger
+ * @slab_start:	Start of the slab area, see CONFIG_SYS_MALLOC_SLAB
+ * @slab_size:	Size of the slab area
+ * @slab:	Object size, pages, objects allocated and peak for each slab
+ */
+struct malloc_statistics {
+	ulong pool_start;
+	ulong pool_size;
+	ulong brk_used;
+	ulong brk_peak;
+	ulong in_use;
+	ulong peak_in_use;
+	ulong free_bytes;
+	ulong free_chunks;
+	ulong largest_free;
+	ulong mallocs;
+	ulong callocs;
+	ulong reallocs;
+	ulong memaligns;
+	ulong frees;
+	ulong failures;
+	ulong largest_failure;
+	ulong hist[MALLOC_HIST_BUCKETS];
+	ulong slab_start;
+	ulong slab_size;
+	struct {
+		ulong size;
+		ulong pages;
+		ulong in_use;
+		ulong peak;
+	} slab[MALLOC_SLAB_CLASSES];
+};
+
+/**
+ * malloc_get_statistics() - Get the current malloc() statistics
+ *
+ * @st:		Returns the statistics
+ */
+void malloc_get_statistics(struct malloc_statistics *st);
+
+/**
+ * malloc_reset_statistics() - Reset the malloc() call counters
+ *
+ * The peak usage restarts from the current usage.
+ */
+void malloc_reset_statistics(void);
+
+/**
+ * struct malloc_arena - A group of allocations freed all at once
+ *
+ * @blocks:	List of memory blocks obtained from malloc()
+ * @block_size:	Size of each block
+ * @used:	Bytes handed out from the arena
+ */
+struct malloc_arena {
+	struct malloc_arena_block *blocks;
+	size_t block_size;
+	size_t used;
+};
+
+/**
+ * malloc_arena_init() - Set up an empty arena
+ *
+ * @arena:	Arena to set up
+ * @block_size:	Amount of memory to obtain from malloc() at a time, 0 for
+ *		the default
+ */
+void malloc_arena_init(struct malloc_arena *arena, size_t block_size);
+
+/**
+ * malloc_arena_alloc() - Allocate memory from an arena
+ *
+ * The memory cannot be freed individually, only with the whole arena. This
+ * is much cheaper than malloc() for many short-lived objects, and cannot
+ * fragment the main pool since each block is released as a whole.
+ *
+ * @arena:	Arena to allocate from
+ * @size:	Number of bytes needed
+ * @return pointer to the memory, or NULL if out of memory
+ */
+void *malloc_arena_alloc(struct malloc_arena *arena, size_t size);
+
+/**
+ * malloc_arena_free_all() - Free all memory allocated from an arena
+ *
+ * The arena is left empty and can be used again.
+ *
+ * @arena:	Arena to free
+ */
+void malloc_arena_free_all(struct malloc_arena *arena);
+
 #ifdef __cplusplus
 };  /* end of extern "C" */
 #endif
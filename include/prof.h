@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Statistical profiler, sampling the PC from a periodic timer interrupt
+ */
+
+#ifndef __PROF_H
+#define __PROF_H
+
+/**
+ * prof_start() - Start sampling the PC
+ *
+ * Samples are added to those already taken, see prof_reset().
+ *
+ * @period_us:	Time between two samples in microseconds
+ * @return 0 if OK, -EALREADY if already running, -ENOMEM if the sample table
+ *	cannot be allocated, other -ve value on error from the timer
+ */
+int prof_start(uint period_us);
+
+/**
+ * prof_stop() - Stop sampling the PC
+ */
+void prof_stop(void);
+
+/**
+ * prof_running() - Check whether the profiler is sampling
+ *
+ * @return true if sampling, false if not
+ */
+bool prof_running(void);
+
+/**
+ * prof_reset() - Throw away all the samples taken so far
+ */
+void prof_reset(void);
+
+/**
+ * prof_sample() - Record one sample
+ *
+ * This is called from the timer interrupt.
+ *
+ * @pc:	Address of the instruction which was interrupted
+ */
+void prof_sample(ulong pc);
+
+/**
+ * prof_report() - Print the functions where most samples were taken
+ *
+ * Samples are grouped by function when U-Boot is built with CONFIG_KALLSYMS,
+ * otherwise by address.
+ *
+ * @count:	Maximum number of functions to print, 0 for all
+ */
+void prof_report(int count);
+
+/**
+ * prof_export() - Write the samples to a buffer as text
+ *
+ * Each line holds the number of samples, the address of the function as
+ * given in System.map and its name, if known, in the same order as
+ * prof_report().
+ *
+ * @buf:	Buffer to write to
+ * @size:	Size of buffer
+ * @needed:	Returns number of bytes of text, not counting the nul
+ *		terminator which also has to fit in @buf
+ * @return 0 if OK, -ENOSPC if the buffer is too small, -ENOMEM if out of
+ *	memory
+ */
+int prof_export(char *buf, size_t size, size_t *needed);
+
+/**
+ * arch_prof_start() - Start the periodic timer interrupt
+ *
+ * The architecture calls prof_sample() from the interrupt and arms the timer
+ * again.
+ *
+ * @period_us:	Time between two interrupts in microseconds
+ * @return 0 if OK, -ve on error
+ */
+int arch_prof_start(uint period_us);
+
+/**
+ * arch_prof_stop() - Stop the periodic timer interrupt
+ *
+ * Interrupts are left enabled only if they were before arch_prof_start().
+ */
+void arch_prof_stop(void);
+
+#endif
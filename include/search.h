@@ -45,6 +45,14 @@ struct hsearch_data {
 	struct env_entry_node *table;
 	unsigned int size;
 	unsigned int filled;
+/*
+ * Buffer kept by himport_r() when it builds a new table; the keys and
+ * values of the imported entries point into it instead of being copied.
+ */
+	char *import_data;
+	size_t import_size;
+/* Incremented on every change of the table contents */
+	unsigned int changes;
 /*
  * Callback function which will check whether the given change for variable
  * "item" to "newval" may be applied or not, and possibly apply such change.
@@ -110,5 +118,6 @@ int hwalk_r(struct hsearch_data *htab,
 #define H_MATCH_METHOD	(H_MATCH_IDENT | H_MATCH_SUBSTR | H_MATCH_REGEX)
 #define H_PROGRAMMATIC	(1 << 9) /* indicate that an import is from env_set() */
 #define H_ORIGIN_FLAGS	(H_INTERACTIVE | H_PROGRAMMATIC)
+#define H_NOCOPY	(1 << 10) /* key and data point into import_data */
 
 #endif /* _SEARCH_H_ */
@@ -448,6 +448,217 @@ int fdtdec_add_aliases_for_id(const void *blob, const char *name,
 	return num_found;
 }
 
+#if CONFIG_IS_ENABLED(OF_CONTROL_INDEX)
+/**
+ * struct fdtdec_alias - Entry of the alias index
+ *
+ * @name:	Name of the alias, e.g. "serial0"
+ * @path:	Path the alias points to
+ * @leaf:	Last component of @path
+ * @len:	Length of @path, including the terminator
+ * @id:		Number at the end of @name, -1 if none
+ */
+struct fdtdec_alias {
+	const char *name;
+	const char *path;
+	const char *leaf;
+	int len;
+	int id;
+};
+
+/**
+ * struct fdtdec_index - Lookup tables for the control device tree
+ *
+ * The tables are built on first use after relocation and rebuilt whenever
+ * the device tree moves or its structure changes size, which is the case
+ * for any added or deleted node or property.
+ *
+ * @blob:	Device tree the tables were built for
+ * @struct_size: Size of the structure block of @blob at that time
+ * @strings_size: Size of the strings block of @blob at that time
+ * @ok:		true if the tables could be built
+ * @phandles:	Node offset for each phandle, -1 if none. NULL if phandles
+ *		are too sparse for a table
+ * @max_phandle: Highest phandle in @phandles
+ * @aliases:	Properties of the /aliases node
+ * @alias_count: Number of entries in @aliases
+ */
+struct fdtdec_index {
+	const void *blob;
+	int struct_size;
+	int strings_size;
+	bool ok;
+	int *phandles;
+	uint max_phandle;
+	struct fdtdec_alias *aliases;
+	int alias_count;
+};
+
+static struct fdtdec_index fdt_index;
+
+void fdtdec_index_invalidate(void)
+{
+	if (gd->flags & GD_FLG_RELOC)
+		fdt_index.blob = NULL;
+}
+
+static int fdtdec_index_phandles(struct fdtdec_index *idx, const void *blob)
+{
+	uint phandle, max = 0;
+	int offset, count = 0;
+
+	for (offset = 0; offset >= 0; offset = fdt_next_node(blob, offset,
+							      NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (phandle > max && phandle != (uint)-1)
+			max = phandle;
+		count++;
+	}
+	if (offset != -FDT_ERR_NOTFOUND)
+		return offset;
+
+	/* dtc numbers phandles from 1, so a table is normally dense */
+	if (max > 4 * count + 64)
+		return 0;
+
+	idx->phandles = malloc((max + 1) * sizeof(*idx->phandles));
+	if (!idx->phandles)
+		return -ENOMEM;
+	memset(idx->phandles, 0xff, (max + 1) * sizeof(*idx->phandles));
+	idx->max_phandle = max;
+
+	for (offset = 0; offset >= 0; offset = fdt_next_node(blob, offset,
+							      NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		/* libfdt returns the first node with a phandle */
+		if (phandle && phandle <= max && idx->phandles[phandle] < 0)
+			idx->phandles[phandle] = offset;
+	}
+
+	return 0;
+}
+
+static int fdtdec_index_aliases(struct fdtdec_index *idx, const void *blob)
+{
+	struct fdtdec_alias *alias;
+	int aliases, offset, count = 0;
+
+	aliases = fdt_path_offset(blob, "/aliases");
+	if (aliases < 0)
+		return 0;
+
+	fdt_for_each_property_offset(offset, blob, aliases)
+		count++;
+	if (!count)
+		return 0;
+
+	idx->aliases = calloc(count, sizeof(*idx->aliases));
+	if (!idx->aliases)
+		return -ENOMEM;
+
+	alias = idx->aliases;
+	fdt_for_each_property_offset(offset, blob, aliases) {
+		alias->path = fdt_getprop_by_offset(blob, offset, &alias->name,
+						    &alias->len);
+		if (!alias->path || alias->len < 1)
+			continue;
+		alias->leaf = strrchr(alias->path, '/');
+		alias->leaf = alias->leaf ? alias->leaf + 1 : alias->path;
+		alias->id = trailing_strtol(alias->name);
+		alias++;
+	}
+	idx->alias_count = alias - idx->aliases;
+
+	return 0;
+}
+
+static struct fdtdec_index *fdtdec_index_get(const void *blob)
+{
+	struct fdtdec_index *idx = &fdt_index;
+
+	/* Static data is only usable after relocation */
+	if (!blob || blob != gd->fdt_blob || !(gd->flags & GD_FLG_RELOC))
+		return NULL;
+	if (idx->blob == blob &&
+	    idx->struct_size == fdt_size_dt_struct(blob) &&
+	    idx->strings_size == fdt_size_dt_strings(blob))
+		return idx->ok ? idx : NULL;
+
+	free(idx->phandles);
+	free(idx->aliases);
+	memset(idx, '\0', sizeof(*idx));
+	idx->blob = blob;
+	idx->struct_size = fdt_size_dt_struct(blob);
+	idx->strings_size = fdt_size_dt_strings(blob);
+	if (fdtdec_index_phandles(idx, blob) ||
+	    fdtdec_index_aliases(idx, blob)) {
+		debug("%s: cannot index device tree\n", __func__);
+		return NULL;
+	}
+	idx->ok = true;
+
+	return idx;
+}
+
+int fdtdec_node_offset_by_phandle(const void *blob, uint phandle)
+{
+	struct fdtdec_index *idx = fdtdec_index_get(blob);
+
+	if (!idx || !idx->phandles)
+		return fdt_node_offset_by_phandle(blob, phandle);
+	if (!phandle || phandle == (uint)-1)
+		return -FDT_ERR_BADPHANDLE;
+	if (phandle > idx->max_phandle || idx->phandles[phandle] < 0)
+		return -FDT_ERR_NOTFOUND;
+
+	return idx->phandles[phandle];
+}
+
+static int fdtdec_index_alias_seq(struct fdtdec_index *idx, const char *base,
+				  const char *find_name, int find_namelen)
+{
+	int base_len = strlen(base);
+	struct fdtdec_alias *alias;
+	int i;
+
+	for (i = 0, alias = idx->aliases; i < idx->alias_count; i++, alias++) {
+		if (alias->len < find_namelen || *alias->path != '/' ||
+		    alias->path[alias->len - 1] ||
+		    strncmp(alias->name, base, base_len))
+			continue;
+		if (strcmp(alias->leaf, find_name))
+			continue;
+		if (alias->id != -1)
+			return alias->id;
+	}
+
+	return -ENOENT;
+}
+
+static int fdtdec_index_alias_highest_id(struct fdtdec_index *idx,
+					 const char *base)
+{
+	int base_len = strlen(base);
+	struct fdtdec_alias *alias;
+	int i, max = -1;
+
+	for (i = 0, alias = idx->aliases; i < idx->alias_count; i++, alias++) {
+		if (*alias->path != '/' || alias->path[alias->len - 1] ||
+		    strncmp(alias->name, base, base_len))
+			continue;
+		if (alias->id > max)
+			max = alias->id;
+	}
+
+	return max;
+}
+#else
+int fdtdec_node_offset_by_phandle(const void *blob, uint phandle)
+{
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+#endif
+
 int fdtdec_get_alias_seq(const void *blob, const char *base, int offset,
 			 int *seqp)
 {
@@ -460,6 +671,18 @@ int fdtdec_get_alias_seq(const void *blob, const char *base, int offset,
 	find_name = fdt_get_name(blob, offset, &find_namelen);
 	debug("Looking for '%s' at %d, name %s\n", base, offset, find_name);
 
+#if CONFIG_IS_ENABLED(OF_CONTROL_INDEX)
+	if (fdtdec_index_get(blob)) {
+		int seq = fdtdec_index_alias_seq(&fdt_index, base, find_name,
+						 find_namelen);
+
+		if (seq < 0)
+			return seq;
+		*seqp = seq;
+		return 0;
+	}
+#endif
+
 	aliases = fdt_path_offset(blob, "/aliases");
 	for (prop_offset = fdt_first_property_offset(blob, aliases);
 	     prop_offset > 0;
@@ -499,6 +722,11 @@ int fdtdec_get_alias_highest_id(const void *blob, const char *base)
 
 	debug("Looking for highest alias id for '%s'\n", base);
 
+#if CONFIG_IS_ENABLED(OF_CONTROL_INDEX)
+	if (fdtdec_index_get(blob))
+		return fdtdec_index_alias_highest_id(&fdt_index, base);
+#endif
+
 	aliases = fdt_path_offset(blob, "/aliases");
 	for (prop_offset = fdt_first_property_offset(blob, aliases);
 	     prop_offset > 0;
@@ -591,7 +819,7 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = fdtdec_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -722,8 +950,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = fdtdec_node_offset_by_phandle(blob,
+								     phandle);
 				if (!node) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -1406,7 +1634,7 @@ int fdtdec_get_carveout(const void *blob, const char *node, const char *name,
 
 	phandle = fdt32_to_cpu(prop[index]);
 
-	offset = fdt_node_offset_by_phandle(blob, phandle);
+	offset = fdtdec_node_offset_by_phandle(blob, phandle);
 	if (offset < 0) {
 		debug("failed to find node for phandle %u\n", phandle);
 		return offset;
@@ -69,6 +69,21 @@ struct env_entry_node {
 static void _hdelete(const char *key, struct hsearch_data *htab,
 		     struct env_entry *ep, int idx);
 
+/*
+ * Free a key or value of an entry, unless it points into the buffer kept
+ * from a bulk import by himport_r().
+ */
+static void _hfree(struct hsearch_data *htab, const void *ptr)
+{
+	const char *p = ptr;
+
+	if (htab->import_data && p >= htab->import_data &&
+	    p < htab->import_data + htab->import_size)
+		return;
+
+	free((void *)ptr);
+}
+
 /*
  * hcreate()
  */
@@ -119,6 +134,7 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 
 	htab->size = nel;
 	htab->filled = 0;
+	htab->changes++;
 
 	/* allocate memory and zero out */
 	htab->table = (struct env_entry_node *)calloc(htab->size + 1,
@@ -155,11 +171,15 @@ void hdestroy_r(struct hsearch_data *htab)
 		if (htab->table[i].used > 0) {
 			struct env_entry *ep = &htab->table[i].entry;
 
-			free((void *)ep->key);
-			free(ep->data);
+			_hfree(htab, ep->key);
+			_hfree(htab, ep->data);
 		}
 	}
 	free(htab->table);
+	free(htab->import_data);
+	htab->import_data = NULL;
+	htab->import_size = 0;
+	htab->changes++;
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
@@ -257,13 +277,17 @@ static inline int _compare_and_overwrite_entry(struct env_entry item,
 				return 0;
 			}
 
-			free(htab->table[idx].entry.data);
-			htab->table[idx].entry.data = strdup(item.data);
+			_hfree(htab, htab->table[idx].entry.data);
+			if (flag & H_NOCOPY)
+				htab->table[idx].entry.data = item.data;
+			else
+				htab->table[idx].entry.data = strdup(item.data);
 			if (!htab->table[idx].entry.data) {
 				__set_errno(ENOMEM);
 				*retval = NULL;
 				return 0;
 			}
+			htab->changes++;
 		}
 		/* return found entry */
 		*retval = &htab->table[idx].entry;
@@ -368,14 +392,20 @@ int hsearch_r(struct env_entry item, enum env_action action,
 
 		/*
 		 * Create new entry;
-		 * create copies of item.key and item.data
+		 * create copies of item.key and item.data, unless they point
+		 * into the buffer of a bulk import
 		 */
 		if (first_deleted)
 			idx = first_deleted;
 
 		htab->table[idx].used = hval;
-		htab->table[idx].entry.key = strdup(item.key);
-		htab->table[idx].entry.data = strdup(item.data);
+		if (flag & H_NOCOPY) {
+			htab->table[idx].entry.key = item.key;
+			htab->table[idx].entry.data = item.data;
+		} else {
+			htab->table[idx].entry.key = strdup(item.key);
+			htab->table[idx].entry.data = strdup(item.data);
+		}
 		if (!htab->table[idx].entry.key ||
 		    !htab->table[idx].entry.data) {
 			__set_errno(ENOMEM);
@@ -413,6 +443,8 @@ int hsearch_r(struct env_entry item, enum env_action action,
 			return 0;
 		}
 
+		htab->changes++;
+
 		/* return new entry */
 		*retval = &htab->table[idx].entry;
 		return 1;
@@ -439,13 +471,14 @@ static void _hdelete(const char *key, struct hsearch_data *htab,
 {
 	/* free used entry */
 	debug("hdelete: DELETING key \"%s\"\n", key);
-	free((void *)ep->key);
-	free(ep->data);
+	_hfree(htab, ep->key);
+	_hfree(htab, ep->data);
 	ep->callback = NULL;
 	ep->flags = 0;
 	htab->table[idx].used = USED_DELETED;
 
 	--htab->filled;
+	htab->changes++;
 }
 
 int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
@@ -622,6 +655,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		if (htab->table[i].used > 0) {
 			struct env_entry *ep = &htab->table[i].entry;
 			int found = match_entry(ep, flag, argc, argv);
+			const char *s;
 
 			if ((argc > 0) && (found == 0))
 				continue;
@@ -633,18 +667,14 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 
 			totlen += strlen(ep->key);
 
-			if (sep == '\0') {
-				totlen += strlen(ep->data);
-			} else {	/* check if escapes are needed */
-				char *s = ep->data;
-
-				while (*s) {
+			/* '\\' is escaped with any separator */
+			s = ep->data;
+			while (*s) {
+				++totlen;
+				/* add room for needed escape chars */
+				if ((*s == sep) || (*s == '\\'))
 					++totlen;
-					/* add room for needed escape chars */
-					if ((*s == sep) || (*s == '\\'))
-						++totlen;
-					++s;
-				}
+				++s;
 			}
 			totlen += 2;	/* for '=' and 'sep' char */
 		}
@@ -783,6 +813,10 @@ static int drop_var_from_set(const char *name, int nvars, char * vars[])
  *
  * In theory, arbitrary separator characters can be used, but only
  * '\0' and '\n' have really been tested.
+ *
+ * When a new hash table is built, the copy of the imported data is kept
+ * with the table and the entries point into it, so importing costs a
+ * single allocation instead of two for every variable.
  */
 
 int himport_r(struct hsearch_data *htab,
@@ -791,6 +825,8 @@ int himport_r(struct hsearch_data *htab,
 {
 	char *data, *sp, *dp, *name, *value;
 	char *localvars[nvars];
+	size_t pos, used;
+	int entries, keep;
 	int i;
 
 	/* Test for correct arguments.  */
@@ -799,14 +835,31 @@ int himport_r(struct hsearch_data *htab,
 		return 0;
 	}
 
+	/*
+	 * Count the entries. A '\0' separated environment ends with an empty
+	 * entry, usually well before the end of the buffer (CONFIG_ENV_SIZE),
+	 * so there is no need to copy the rest.
+	 */
+	used = size;
+	for (pos = 0, entries = 0; pos < size; pos++) {
+		if (env[pos] != sep)
+			continue;
+		entries++;
+		if (!sep && (pos + 1 == size || !env[pos + 1])) {
+			used = pos + 1;
+			break;
+		}
+	}
+
 	/* we allocate new space to make sure we can write to the array */
-	if ((data = malloc(size + 1)) == NULL) {
-		debug("himport_r: can't malloc %lu bytes\n", (ulong)size + 1);
+	data = malloc(used + 1);
+	if (!data) {
+		debug("himport_r: can't malloc %lu bytes\n", (ulong)used + 1);
 		__set_errno(ENOMEM);
 		return 0;
 	}
-	memcpy(data, env, size);
-	data[size] = '\0';
+	memcpy(data, env, used);
+	data[used] = '\0';
 	dp = data;
 
 	/* make a local copy of the list of variables */
@@ -844,6 +897,9 @@ int himport_r(struct hsearch_data *htab,
 
 		if (nent > CONFIG_ENV_MAX_ENTRIES)
 			nent = CONFIG_ENV_MAX_ENTRIES;
+		/* but always leave room for what is imported now */
+		if (nent < entries + CONFIG_ENV_MIN_ENTRIES)
+			nent = entries + CONFIG_ENV_MIN_ENTRIES;
 
 		debug("Create Hash Table: N=%d\n", nent);
 
@@ -853,21 +909,30 @@ int himport_r(struct hsearch_data *htab,
 		}
 	}
 
-	if (!size) {
+	if (!used) {
 		free(data);
 		return 1;		/* everything OK */
 	}
+
+	/* A new table takes over the data instead of copying each entry */
+	keep = (flag & H_NOCLEAR) == 0 && !nvars;
+	if (keep) {
+		htab->import_data = data;
+		htab->import_size = used + 1;
+		flag |= H_NOCOPY;
+	}
+
 	if(crlf_is_lf) {
 		/* Remove Carriage Returns in front of Line Feeds */
 		unsigned ignored_crs = 0;
-		for(;dp < data + size && *dp; ++dp) {
+		for (; dp < data + used && *dp; ++dp) {
 			if(*dp == '\r' &&
-			   dp < data + size - 1 && *(dp+1) == '\n')
+			   dp < data + used - 1 && *(dp+1) == '\n')
 				++ignored_crs;
 			else
 				*(dp-ignored_crs) = *dp;
 		}
-		size -= ignored_crs;
+		used -= ignored_crs;
 		dp = data;
 	}
 	/* Parse environment; allow for '\0' and 'sep' as separators */
@@ -920,7 +985,8 @@ int himport_r(struct hsearch_data *htab,
 		if (*name == 0) {
 			debug("INSERT: unable to use an empty key\n");
 			__set_errno(EINVAL);
-			free(data);
+			if (!keep)
+				free(data);
 			return 0;
 		}
 
@@ -940,10 +1006,12 @@ int himport_r(struct hsearch_data *htab,
 		debug("INSERT: table %p, filled %d/%d rv %p ==> name=\"%s\" value=\"%s\"\n",
 			htab, htab->filled, htab->size,
 			rv, name, value);
-	} while ((dp < data + size) && *dp);	/* size check needed for text */
+	} while ((dp < data + used) && *dp);	/* size check needed for text */
 						/* without '\0' termination */
-	debug("INSERT: free(data = %p)\n", data);
-	free(data);
+	if (!keep) {
+		debug("INSERT: free(data = %p)\n", data);
+		free(data);
+	}
 
 	if (flag & H_NOCLEAR)
 		goto end;
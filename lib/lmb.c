@@ -8,13 +8,80 @@
 
 #include <common.h>
 #include <lmb.h>
+#include <malloc.h>
 
 #define LMB_ALLOC_ANYWHERE	0
 
+/*
+ * Return the index of the first region whose last byte is at or above @addr,
+ * or rgn->cnt if there is none
+ */
+static unsigned long lmb_find(struct lmb_region *rgn, phys_addr_t addr)
+{
+	unsigned long lo = 0, hi = rgn->cnt;
+
+	while (lo < hi) {
+		unsigned long mid = lo + (hi - lo) / 2;
+		struct lmb_property *r = &lmb_regions(rgn)[mid];
+
+		if (r->base + r->size - 1 < addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+#ifdef DEBUG
+/* Count the unreserved ranges within the memory regions */
+static void lmb_free_stats(struct lmb *lmb, unsigned long *count,
+			   phys_size_t *total, phys_size_t *largest)
+{
+	struct lmb_region *res = &lmb->reserved;
+	unsigned long i, j;
+
+	*count = 0;
+	*total = 0;
+	*largest = 0;
+	for (i = 0; i < lmb->memory.cnt; i++) {
+		phys_addr_t cur = lmb_regions(&lmb->memory)[i].base;
+		phys_addr_t last = cur + lmb_regions(&lmb->memory)[i].size - 1;
+		phys_size_t gap;
+		bool done = false;
+
+		for (j = lmb_find(res, cur);
+		     j < res->cnt && lmb_regions(res)[j].base <= last; j++) {
+			phys_addr_t res_last = lmb_regions(res)[j].base +
+					       lmb_regions(res)[j].size - 1;
+
+			if (lmb_regions(res)[j].base > cur) {
+				gap = lmb_regions(res)[j].base - cur;
+				(*count)++;
+				*total += gap;
+				*largest = max(*largest, gap);
+			}
+			if (res_last >= last) {
+				done = true;
+				break;
+			}
+			cur = max(cur, res_last + 1);
+		}
+		if (!done) {
+			gap = last - cur + 1;
+			(*count)++;
+			*total += gap;
+			*largest = max(*largest, gap);
+		}
+	}
+}
+#endif
+
 void lmb_dump_all(struct lmb *lmb)
 {
 #ifdef DEBUG
-	unsigned long i;
+	unsigned long i, free_cnt;
+	phys_size_t free_total, free_largest;
 
 	debug("lmb_dump_all:\n");
 	debug("    memory.cnt		   = 0x%lx\n", lmb->memory.cnt);
@@ -22,9 +89,9 @@ void lmb_dump_all(struct lmb *lmb)
 	      (unsigned long long)lmb->memory.size);
 	for (i = 0; i < lmb->memory.cnt; i++) {
 		debug("    memory.reg[0x%lx].base   = 0x%llx\n", i,
-		      (unsigned long long)lmb->memory.region[i].base);
+		      (unsigned long long)lmb_regions(&lmb->memory)[i].base);
 		debug("		   .size   = 0x%llx\n",
-		      (unsigned long long)lmb->memory.region[i].size);
+		      (unsigned long long)lmb_regions(&lmb->memory)[i].size);
 	}
 
 	debug("\n    reserved.cnt	   = 0x%lx\n",
@@ -33,10 +100,17 @@ void lmb_dump_all(struct lmb *lmb)
 		(unsigned long long)lmb->reserved.size);
 	for (i = 0; i < lmb->reserved.cnt; i++) {
 		debug("    reserved.reg[0x%lx].base = 0x%llx\n", i,
-		      (unsigned long long)lmb->reserved.region[i].base);
+		      (unsigned long long)lmb_regions(&lmb->reserved)[i].base);
 		debug("		     .size = 0x%llx\n",
-		      (unsigned long long)lmb->reserved.region[i].size);
+		      (unsigned long long)lmb_regions(&lmb->reserved)[i].size);
 	}
+
+	lmb_free_stats(lmb, &free_cnt, &free_total, &free_largest);
+	debug("\n    free ranges	   = 0x%lx\n", free_cnt);
+	debug("    free.size		   = 0x%llx\n",
+	      (unsigned long long)free_total);
+	debug("    free.largest	   = 0x%llx\n",
+	      (unsigned long long)free_largest);
 #endif /* DEBUG */
 }
 
@@ -63,39 +137,68 @@ static long lmb_addrs_adjacent(phys_addr_t base1, phys_size_t size1,
 static long lmb_regions_adjacent(struct lmb_region *rgn, unsigned long r1,
 				 unsigned long r2)
 {
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
+	phys_addr_t base1 = lmb_regions(rgn)[r1].base;
+	phys_size_t size1 = lmb_regions(rgn)[r1].size;
+	phys_addr_t base2 = lmb_regions(rgn)[r2].base;
+	phys_size_t size2 = lmb_regions(rgn)[r2].size;
 
 	return lmb_addrs_adjacent(base1, size1, base2, size2);
 }
 
 static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
 {
-	unsigned long i;
+	struct lmb_property *region = lmb_regions(rgn);
 
-	for (i = r; i < rgn->cnt - 1; i++) {
-		rgn->region[i].base = rgn->region[i + 1].base;
-		rgn->region[i].size = rgn->region[i + 1].size;
-	}
+	memmove(&region[r], &region[r + 1],
+		(rgn->cnt - r - 1) * sizeof(region[0]));
 	rgn->cnt--;
 }
 
+/* Make room for at least one more region */
+static int lmb_grow_region(struct lmb_region *rgn)
+{
+	struct lmb_property *region;
+	unsigned long max = rgn->max * 2;
+
+	region = malloc(max * sizeof(*region));
+	if (!region)
+		return -ENOMEM;
+	memcpy(region, lmb_regions(rgn), rgn->cnt * sizeof(*region));
+	free(rgn->heap);
+	rgn->heap = region;
+	rgn->max = max;
+
+	return 0;
+}
+
 /* Assumption: base addr of region 1 < base addr of region 2 */
 static void lmb_coalesce_regions(struct lmb_region *rgn, unsigned long r1,
 				 unsigned long r2)
 {
-	rgn->region[r1].size += rgn->region[r2].size;
+	lmb_regions(rgn)[r1].size += lmb_regions(rgn)[r2].size;
 	lmb_remove_region(rgn, r2);
 }
 
+static void lmb_init_region(struct lmb_region *rgn)
+{
+	rgn->cnt = 0;
+	rgn->size = 0;
+	rgn->heap = NULL;
+	rgn->max = ARRAY_SIZE(rgn->initial);
+}
+
 void lmb_init(struct lmb *lmb)
 {
-	lmb->memory.cnt = 0;
-	lmb->memory.size = 0;
-	lmb->reserved.cnt = 0;
-	lmb->reserved.size = 0;
+	lmb_init_region(&lmb->memory);
+	lmb_init_region(&lmb->reserved);
+}
+
+/* Free any region tables which outgrew the struct; the lmb is left empty */
+void lmb_release(struct lmb *lmb)
+{
+	free(lmb->memory.heap);
+	free(lmb->reserved.heap);
+	lmb_init(lmb);
 }
 
 static void lmb_reserve_common(struct lmb *lmb, void *fdt_blob)
@@ -142,32 +245,38 @@ void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 static long lmb_add_region(struct lmb_region *rgn, phys_addr_t base, phys_size_t size)
 {
 	unsigned long coalesced = 0;
+	unsigned long lo, hi;
 	long adjacent, i;
 
 	if (rgn->cnt == 0) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
+		lmb_regions(rgn)[0].base = base;
+		lmb_regions(rgn)[0].size = size;
 		rgn->cnt = 1;
 		return 0;
 	}
 
-	/* First try and coalesce this LMB with another. */
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
+	/*
+	 * First try and coalesce this LMB with another. Regions ending before
+	 * base - 1 can neither touch nor overlap it, so skip them.
+	 */
+	for (i = base ? lmb_find(rgn, base - 1) : 0; i < rgn->cnt; i++) {
+		phys_addr_t rgnbase = lmb_regions(rgn)[i].base;
+		phys_size_t rgnsize = lmb_regions(rgn)[i].size;
 
+		if (rgnbase > base && rgnbase - base > size)
+			break;
 		if ((rgnbase == base) && (rgnsize == size))
 			/* Already have this region, so we're done */
 			return 0;
 
 		adjacent = lmb_addrs_adjacent(base, size, rgnbase, rgnsize);
 		if (adjacent > 0) {
-			rgn->region[i].base -= size;
-			rgn->region[i].size += size;
+			lmb_regions(rgn)[i].base -= size;
+			lmb_regions(rgn)[i].size += size;
 			coalesced++;
 			break;
 		} else if (adjacent < 0) {
-			rgn->region[i].size += size;
+			lmb_regions(rgn)[i].size += size;
 			coalesced++;
 			break;
 		} else if (lmb_addrs_overlap(base, size, rgnbase, rgnsize)) {
@@ -176,33 +285,32 @@ static long lmb_add_region(struct lmb_region *rgn, phys_addr_t base, phys_size_t
 		}
 	}
 
-	if ((i < rgn->cnt - 1) && lmb_regions_adjacent(rgn, i, i + 1)) {
+	if (coalesced && (i < rgn->cnt - 1) &&
+	    lmb_regions_adjacent(rgn, i, i + 1)) {
 		lmb_coalesce_regions(rgn, i, i + 1);
 		coalesced++;
 	}
 
 	if (coalesced)
 		return coalesced;
-	if (rgn->cnt >= MAX_LMB_REGIONS)
+	if (rgn->cnt >= rgn->max && lmb_grow_region(rgn))
 		return -1;
 
 	/* Couldn't coalesce the LMB, so add it to the sorted table. */
-	for (i = rgn->cnt-1; i >= 0; i--) {
-		if (base < rgn->region[i].base) {
-			rgn->region[i + 1].base = rgn->region[i].base;
-			rgn->region[i + 1].size = rgn->region[i].size;
-		} else {
-			rgn->region[i + 1].base = base;
-			rgn->region[i + 1].size = size;
-			break;
-		}
-	}
-
-	if (base < rgn->region[0].base) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
+	lo = 0;
+	hi = rgn->cnt;
+	while (lo < hi) {
+		unsigned long mid = lo + (hi - lo) / 2;
+
+		if (base < lmb_regions(rgn)[mid].base)
+			hi = mid;
+		else
+			lo = mid + 1;
 	}
-
+	memmove(&lmb_regions(rgn)[lo + 1], &lmb_regions(rgn)[lo],
+		(rgn->cnt - lo) * sizeof(lmb_regions(rgn)[0]));
+	lmb_regions(rgn)[lo].base = base;
+	lmb_regions(rgn)[lo].size = size;
 	rgn->cnt++;
 
 	return 0;
@@ -223,19 +331,15 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	phys_addr_t end = base + size - 1;
 	int i;
 
-	rgnbegin = rgnend = 0; /* supress gcc warnings */
-
 	/* Find the region where (base, size) belongs to */
-	for (i = 0; i < rgn->cnt; i++) {
-		rgnbegin = rgn->region[i].base;
-		rgnend = rgnbegin + rgn->region[i].size - 1;
-
-		if ((rgnbegin <= base) && (end <= rgnend))
-			break;
-	}
+	i = lmb_find(rgn, base);
+	if (i == rgn->cnt)
+		return -1;
+	rgnbegin = lmb_regions(rgn)[i].base;
+	rgnend = rgnbegin + lmb_regions(rgn)[i].size - 1;
 
 	/* Didn't find the region */
-	if (i == rgn->cnt)
+	if (rgnbegin > base || end > rgnend)
 		return -1;
 
 	/* Check to see if we are removing entire region */
@@ -246,14 +350,14 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 
 	/* Check to see if region is matching at the front */
 	if (rgnbegin == base) {
-		rgn->region[i].base = end + 1;
-		rgn->region[i].size -= size;
+		lmb_regions(rgn)[i].base = end + 1;
+		lmb_regions(rgn)[i].size -= size;
 		return 0;
 	}
 
 	/* Check to see if the region is matching at the end */
 	if (rgnend == end) {
-		rgn->region[i].size -= size;
+		lmb_regions(rgn)[i].size -= size;
 		return 0;
 	}
 
@@ -261,7 +365,7 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	 * We need to split the entry -  adjust the current one to the
 	 * beginging of the hole and add the region after hole.
 	 */
-	rgn->region[i].size = base - rgn->region[i].base;
+	lmb_regions(rgn)[i].size = base - lmb_regions(rgn)[i].base;
 	return lmb_add_region(rgn, end + 1, rgnend - end);
 }
 
@@ -275,16 +379,13 @@ long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 static long lmb_overlaps_region(struct lmb_region *rgn, phys_addr_t base,
 				phys_size_t size)
 {
-	unsigned long i;
+	unsigned long i = lmb_find(rgn, base);
+	struct lmb_property *r = &lmb_regions(rgn)[i];
 
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		if (lmb_addrs_overlap(base, size, rgnbase, rgnsize))
-			break;
-	}
+	if (i < rgn->cnt && lmb_addrs_overlap(base, size, r->base, r->size))
+		return i;
 
-	return (i < rgn->cnt) ? i : -1;
+	return -1;
 }
 
 phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align)
@@ -317,8 +418,8 @@ phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phy
 	phys_addr_t res_base;
 
 	for (i = lmb->memory.cnt - 1; i >= 0; i--) {
-		phys_addr_t lmbbase = lmb->memory.region[i].base;
-		phys_size_t lmbsize = lmb->memory.region[i].size;
+		phys_addr_t lmbbase = lmb_regions(&lmb->memory)[i].base;
+		phys_size_t lmbsize = lmb_regions(&lmb->memory)[i].size;
 
 		if (lmbsize < size)
 			continue;
@@ -342,7 +443,7 @@ phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phy
 					return 0;
 				return base;
 			}
-			res_base = lmb->reserved.region[rgn].base;
+			res_base = lmb_regions(&lmb->reserved)[rgn].base;
 			if (res_base < size)
 				break;
 			base = lmb_align_down(res_base - size, align);
@@ -366,8 +467,8 @@ phys_addr_t lmb_alloc_addr(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 		 * Check if the requested end address is in the same memory
 		 * region we found.
 		 */
-		if (lmb_addrs_overlap(lmb->memory.region[rgn].base,
-				      lmb->memory.region[rgn].size,
+		if (lmb_addrs_overlap(lmb_regions(&lmb->memory)[rgn].base,
+				      lmb_regions(&lmb->memory)[rgn].size,
 				      base + size - 1, 1)) {
 			/* ok, reserve the memory */
 			if (lmb_reserve(lmb, base, size) >= 0)
@@ -380,41 +481,34 @@ phys_addr_t lmb_alloc_addr(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 /* Return number of bytes from a given address that are free */
 phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr)
 {
-	int i;
+	struct lmb_property *last;
+	unsigned long i;
 	long rgn;
 
 	/* check if the requested address is in the memory regions */
 	rgn = lmb_overlaps_region(&lmb->memory, addr, 1);
 	if (rgn >= 0) {
-		for (i = 0; i < lmb->reserved.cnt; i++) {
-			if (addr < lmb->reserved.region[i].base) {
+		i = lmb_find(&lmb->reserved, addr);
+		if (i < lmb->reserved.cnt) {
+			phys_addr_t base = lmb_regions(&lmb->reserved)[i].base;
+
+			if (addr < base) {
 				/* first reserved range > requested address */
-				return lmb->reserved.region[i].base - addr;
-			}
-			if (lmb->reserved.region[i].base +
-			    lmb->reserved.region[i].size > addr) {
-				/* requested addr is in this reserved range */
-				return 0;
+				return base - addr;
 			}
+			/* requested addr is in this reserved range */
+			return 0;
 		}
 		/* if we come here: no reserved ranges above requested addr */
-		return lmb->memory.region[lmb->memory.cnt - 1].base +
-		       lmb->memory.region[lmb->memory.cnt - 1].size - addr;
+		last = &lmb_regions(&lmb->memory)[lmb->memory.cnt - 1];
+		return last->base + last->size - addr;
 	}
 	return 0;
 }
 
 int lmb_is_reserved(struct lmb *lmb, phys_addr_t addr)
 {
-	int i;
-
-	for (i = 0; i < lmb->reserved.cnt; i++) {
-		phys_addr_t upper = lmb->reserved.region[i].base +
-			lmb->reserved.region[i].size - 1;
-		if ((addr >= lmb->reserved.region[i].base) && (addr <= upper))
-			return 1;
-	}
-	return 0;
+	return lmb_overlaps_region(&lmb->reserved, addr, 1) >= 0;
 }
 
 __weak void board_lmb_reserve(struct lmb *lmb)
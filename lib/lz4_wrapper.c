@@ -7,6 +7,7 @@
 #include <compiler.h>
 #include <image.h>
 #include <lz4.h>
+#include <malloc.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
 
@@ -136,3 +137,170 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	*dstn = out - dst;
 	return ret;
 }
+
+int ulz4_decompress_block(const void *src, size_t srcn, void *dst,
+			  size_t dstn, bool padded)
+{
+	int ret;
+
+	if (padded)
+		ret = LZ4_decompress_generic(src, dst, srcn, dstn,
+					     endOnInputSize, partial, dstn,
+					     noDict, dst, NULL, 0);
+	else
+		ret = LZ4_decompress_generic(src, dst, srcn, dstn,
+					     endOnInputSize, full, 0, noDict,
+					     dst, NULL, 0);
+
+	return ret < 0 ? -EPROTO : ret;
+}
+
+enum {
+	ULZ4_FRAME_HEADER,
+	ULZ4_BLOCK_HEADER,
+	ULZ4_BLOCK,
+	ULZ4_DONE,
+};
+
+/* Frame header without the optional content size */
+#define ULZ4_FRAME_HEADER_MIN	(sizeof(struct lz4_frame_header) + sizeof(u8))
+
+void ulz4_stream_init(struct ulz4_stream *s, void *dst, size_t dstn)
+{
+	memset(s, '\0', sizeof(*s));
+	s->dst = dst;
+	s->dstn = dstn;
+	s->state = ULZ4_FRAME_HEADER;
+	s->hdr_need = ULZ4_FRAME_HEADER_MIN;
+}
+
+void ulz4_stream_free(struct ulz4_stream *s)
+{
+	free(s->buf);
+	s->buf = NULL;
+}
+
+static int ulz4_stream_frame_header(struct ulz4_stream *s)
+{
+	const struct lz4_frame_header *h = (void *)s->hdr;
+
+	if (le32_to_cpu(h->magic) != LZ4F_MAGIC || h->version != 1)
+		return -EPROTONOSUPPORT;
+	if (h->reserved0 || h->reserved1 || h->reserved2)
+		return -EINVAL;
+	if (!h->independent_blocks)
+		return -EPROTONOSUPPORT;
+	if (h->has_content_size && s->hdr_need == ULZ4_FRAME_HEADER_MIN) {
+		s->hdr_need += sizeof(u64);
+		return 0;
+	}
+	/* Block size codes 4 to 7 stand for 64KiB to 4MiB */
+	if (h->max_block_size < 4)
+		return -EINVAL;
+
+	s->block_checksum = h->has_block_checksum;
+	s->buf_size = 1 << (8 + 2 * h->max_block_size);
+	s->state = ULZ4_BLOCK_HEADER;
+	s->hdr_len = 0;
+	s->hdr_need = sizeof(struct lz4_block_header);
+
+	return 0;
+}
+
+static int ulz4_stream_block_header(struct ulz4_stream *s)
+{
+	struct lz4_block_header b;
+
+	b.raw = le32_to_cpu(*(u32 *)s->hdr);
+	s->hdr_len = 0;
+	if (!b.size) {
+		s->state = ULZ4_DONE;
+		return 0;
+	}
+	if (b.size > s->buf_size)
+		return -EINVAL;
+
+	s->block = b.raw;
+	s->block_len = b.size + (s->block_checksum ? sizeof(u32) : 0);
+	s->buf_len = 0;
+	s->state = ULZ4_BLOCK;
+
+	return 0;
+}
+
+static int ulz4_stream_block(struct ulz4_stream *s, const void *in)
+{
+	struct lz4_block_header b = { .raw = s->block };
+	void *out = s->dst + s->out;
+	int ret;
+
+	if (b.not_compressed) {
+		if (b.size > s->dstn - s->out)
+			return -ENOBUFS;
+		memcpy(out, in, b.size);
+		ret = b.size;
+	} else {
+		/* constant folding essential, do not touch params! */
+		ret = LZ4_decompress_generic(in, out, b.size,
+				s->dstn - s->out, endOnInputSize,
+				full, 0, noDict, out, NULL, 0);
+		if (ret < 0)
+			return -EPROTO;
+	}
+	s->out += ret;
+	s->state = ULZ4_BLOCK_HEADER;
+	s->hdr_need = sizeof(struct lz4_block_header);
+
+	return 0;
+}
+
+int ulz4_stream_feed(struct ulz4_stream *s, const void *src, size_t srcn)
+{
+	const void *in = src;
+	const void *end = src + srcn;
+	size_t len;
+	int ret = 0;
+
+	while (in < end && !ret && s->state != ULZ4_DONE) {
+		switch (s->state) {
+		case ULZ4_FRAME_HEADER:
+		case ULZ4_BLOCK_HEADER:
+			len = min_t(size_t, end - in, s->hdr_need - s->hdr_len);
+			memcpy(s->hdr + s->hdr_len, in, len);
+			s->hdr_len += len;
+			in += len;
+			if (s->hdr_len < s->hdr_need)
+				break;
+			if (s->state == ULZ4_FRAME_HEADER)
+				ret = ulz4_stream_frame_header(s);
+			else
+				ret = ulz4_stream_block_header(s);
+			break;
+		case ULZ4_BLOCK:
+			/* Avoid the copy if the whole block is here */
+			if (!s->buf_len &&
+			    (size_t)(end - in) >= s->block_len) {
+				ret = ulz4_stream_block(s, in);
+				in += s->block_len;
+				break;
+			}
+			if (!s->buf) {
+				s->buf = malloc(s->buf_size + sizeof(u32));
+				if (!s->buf)
+					return -ENOMEM;
+			}
+			len = min_t(size_t, end - in,
+				    s->block_len - s->buf_len);
+			memcpy(s->buf + s->buf_len, in, len);
+			s->buf_len += len;
+			in += len;
+			if (s->buf_len == s->block_len)
+				ret = ulz4_stream_block(s, s->buf);
+			break;
+		}
+	}
+	if (ret)
+		return ret;
+
+	return s->state == ULZ4_DONE;
+}
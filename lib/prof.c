@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Statistical profiler
+ *
+ * A periodic timer interrupt records the PC it interrupted. Unlike function
+ * tracing this needs no instrumentation, so it hardly changes the timing of
+ * the code being measured. The samples are counted per address in a small
+ * hash table; they are only grouped by function when a report is printed,
+ * since looking up a symbol is far too slow for the interrupt handler.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <prof.h>
+#include <sort.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Number of slots tried before a sample is dropped */
+#define PROF_PROBES	16
+
+/**
+ * struct prof_slot - Number of samples taken at one address
+ *
+ * @pc: Address, 0 if the slot is free
+ * @count: Number of samples
+ */
+struct prof_slot {
+	ulong pc;
+	uint count;
+};
+
+/**
+ * struct prof_func - Number of samples taken in one function
+ *
+ * @addr: Address of the function in System.map, or the sampled address if
+ *	the function is not known
+ * @name: Name of the function, NULL if not known
+ * @count: Number of samples
+ */
+struct prof_func {
+	ulong addr;
+	const char *name;
+	uint count;
+};
+
+/**
+ * struct prof_data - State of the profiler
+ *
+ * @slots: Hash table of sampled addresses, CONFIG_PROF_SLOTS entries
+ * @samples: Number of samples taken
+ * @dropped: Number of samples which did not fit in @slots
+ * @running: true if sampling
+ */
+static struct prof_data {
+	struct prof_slot *slots;
+	ulong samples;
+	ulong dropped;
+	bool running;
+} prof;
+
+void prof_sample(ulong pc)
+{
+	struct prof_slot *slot;
+	uint i, idx;
+
+	prof.samples++;
+	idx = (pc >> 1) * 0x9e3779b1U;
+	for (i = 0; i < PROF_PROBES; i++, idx++) {
+		slot = &prof.slots[idx % CONFIG_PROF_SLOTS];
+		if (slot->pc == pc || !slot->pc) {
+			slot->pc = pc;
+			slot->count++;
+			return;
+		}
+	}
+	prof.dropped++;
+}
+
+int prof_start(uint period_us)
+{
+	int ret;
+
+	if (prof.running)
+		return -EALREADY;
+	if (!prof.slots) {
+		prof.slots = calloc(CONFIG_PROF_SLOTS, sizeof(*prof.slots));
+		if (!prof.slots)
+			return -ENOMEM;
+	}
+
+	prof.running = true;
+	ret = arch_prof_start(period_us);
+	if (ret)
+		prof.running = false;
+
+	return ret;
+}
+
+void prof_stop(void)
+{
+	if (!prof.running)
+		return;
+
+	arch_prof_stop();
+	prof.running = false;
+}
+
+bool prof_running(void)
+{
+	return prof.running;
+}
+
+void prof_reset(void)
+{
+	if (prof.slots)
+		memset(prof.slots, '\0',
+		       CONFIG_PROF_SLOTS * sizeof(*prof.slots));
+	prof.samples = 0;
+	prof.dropped = 0;
+}
+
+/* Get the address of a sample as given in System.map */
+static ulong prof_link_addr(ulong pc)
+{
+	if ((gd->flags & GD_FLG_RELOC) && pc >= gd->relocaddr &&
+	    pc < gd->relocaddr + gd->mon_len)
+		return pc - gd->reloc_off;
+
+	return pc;
+}
+
+static int prof_cmp_addr(const void *a, const void *b)
+{
+	const struct prof_func *fa = a, *fb = b;
+
+	if (fa->addr == fb->addr)
+		return 0;
+
+	return fa->addr < fb->addr ? -1 : 1;
+}
+
+static int prof_cmp_count(const void *a, const void *b)
+{
+	const struct prof_func *fa = a, *fb = b;
+
+	if (fa->count != fb->count)
+		return fa->count < fb->count ? 1 : -1;
+
+	return prof_cmp_addr(a, b);
+}
+
+/**
+ * prof_collect() - Group the samples by function
+ *
+ * @funcsp: Returns an allocated list of functions, busiest first
+ * @return number of functions, -ENOMEM if out of memory
+ */
+static int prof_collect(struct prof_func **funcsp)
+{
+	struct prof_func *funcs, *func;
+	const char *name;
+	ulong base;
+	int i, count;
+
+	funcs = malloc(CONFIG_PROF_SLOTS * sizeof(*funcs));
+	if (!funcs)
+		return -ENOMEM;
+
+	for (i = 0, count = 0; prof.slots && i < CONFIG_PROF_SLOTS; i++) {
+		if (!prof.slots[i].count)
+			continue;
+		func = &funcs[count++];
+		func->addr = prof_link_addr(prof.slots[i].pc);
+		func->name = NULL;
+		func->count = prof.slots[i].count;
+	}
+
+	/* Samples in the same function end up next to each other */
+	qsort(funcs, count, sizeof(*funcs), prof_cmp_addr);
+	if (IS_ENABLED(CONFIG_KALLSYMS)) {
+		for (i = 0, func = funcs; i < count; i++) {
+			/* Do not blame U-Boot for code it has loaded */
+			name = NULL;
+			if (funcs[i].addr - CONFIG_SYS_TEXT_BASE < gd->mon_len)
+				name = symbol_lookup(funcs[i].addr, &base);
+			if (name && func != funcs && func[-1].name == name) {
+				func[-1].count += funcs[i].count;
+				continue;
+			}
+			func->addr = name ? base : funcs[i].addr;
+			func->name = name;
+			func->count = funcs[i].count;
+			func++;
+		}
+		count = func - funcs;
+	}
+	qsort(funcs, count, sizeof(*funcs), prof_cmp_count);
+	*funcsp = funcs;
+
+	return count;
+}
+
+void prof_report(int max)
+{
+	struct prof_func *funcs, *func;
+	int i, count;
+
+	if (prof.running)
+		printf("Profiler is running, results are still changing\n");
+	printf("%lu samples", prof.samples);
+	if (prof.dropped)
+		printf(", %lu dropped (table full)", prof.dropped);
+	printf("\n");
+	if (!prof.samples)
+		return;
+
+	count = prof_collect(&funcs);
+	if (count < 0) {
+		printf("Out of memory\n");
+		return;
+	}
+	if (max > 0 && max < count)
+		count = max;
+
+	printf("%10s %6s  %-16s %s\n", "Samples", "%", "Address", "Function");
+	for (i = 0, func = funcs; i < count; i++, func++) {
+		uint permille = (u64)func->count * 1000 / prof.samples;
+
+		printf("%10u %3u.%u%%  %016lx %s\n", func->count,
+		       permille / 10, permille % 10, func->addr,
+		       func->name ? func->name : "?");
+	}
+	free(funcs);
+}
+
+int prof_export(char *buf, size_t size, size_t *needed)
+{
+	struct prof_func *funcs, *func;
+	size_t used = 0;
+	int i, count, len;
+
+	count = prof_collect(&funcs);
+	if (count < 0)
+		return count;
+
+	for (i = 0, func = funcs; i < count; i++, func++) {
+		len = snprintf(buf + min(used, size), size - min(used, size),
+			       "%u %016lx %s\n", func->count, func->addr,
+			       func->name ? func->name : "?");
+		used += len;
+	}
+	free(funcs);
+	*needed = used;
+
+	return used >= size ? -ENOSPC : 0;
+}
@@ -29,6 +29,18 @@ int hash_calculate(const char *name,
 	if (ret)
 		return ret;
 
+#ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+	if (region_count == 1) {
+		int len;
+
+		if (!fit_digest_lookup(region[0].data, region[0].size, name,
+				       checksum, &len))
+			return 0;
+	}
+#endif
+#endif
+
 	ret = algo->hash_init(algo, &ctx);
 	if (ret)
 		return ret;
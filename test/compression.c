@@ -7,6 +7,7 @@
 #include <bootm.h>
 #include <command.h>
 #include <gzip.h>
+#include <hexdump.h>
 #include <lz4.h>
 #include <malloc.h>
 #include <mapmem.h>
@@ -534,6 +535,123 @@ static int compression_test_bootm_none(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+#if CONFIG_IS_ENABLED(IMAGE_DECOMP_STREAM)
+#if CONFIG_IS_ENABLED(ZSTD)
+/* zstd -c /tmp/plain.txt > /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xc5\x05\x00\x92\x0d\x25\x1a\x90\x17"
+	"\x36\x07\x84\x8d\x9a\xd8\x30\x5a\x8a\x8c\x88\xb5\x7c\x52\x5a\x07"
+	"\x34\xeb\x5b\xc6\x5d\x6f\xc7\x12\x65\xd0\x1b\xa9\xfc\x5c\x43\x6c"
+	"\xad\xc3\x2f\x38\xbc\xf1\x5a\x2b\xbb\x1f\xc7\x19\x4f\x62\x52\x84"
+	"\x76\x49\x53\x67\x61\x1d\x20\xe3\x66\xe2\xd5\x3b\xf2\x06\x78\xf8"
+	"\x39\x74\x78\x95\x65\xe1\x64\x43\x65\x51\xe9\xab\xba\x1a\x0f\x92"
+	"\x7c\xe3\x05\x50\x03\x08\x59\xc9\x5a\x60\x5f\xb6\x50\xdd\x54\x62"
+	"\xc2\x05\x51\x86\xab\x4c\xd6\xf4\xd5\xb2\x26\xae\x17\x31\x16\x9e"
+	"\x7c\x82\x44\x6e\xea\x92\xcf\xce\x67\x47\x81\x32\xac\xc1\xd7\xc5"
+	"\xf2\xa6\xf1\x91\x39\xd5\xb3\x23\xad\xe3\x86\xd0\x48\xf4\x39\x9d"
+	"\x89\x0b\x00\x45\x1b\x08\xb3\x17\x18\x6b\xa0\xb2\x6b\x8e\x28\xa8"
+	"\x55\x65\xb6\xc6\x6a\xa5\x4f\x23\x12\xee\x53\x55\x2d\x44\x2f\x54"
+	"\x95\x01\xe4\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 198;
+
+static int compress_using_zstd(struct unit_test_state *uts,
+			       void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	ut_asserteq(in_size, strlen(plain));
+	ut_asserteq(0, memcmp(plain, in, in_size));
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+#endif
+
+/**
+ * run_stream_test() - Run tests on the streaming decompressor
+ *
+ * The compressed data is fed in pieces of various sizes, which split any
+ * headers and blocks at arbitrary places.
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_stream_test(struct unit_test_state *uts, int comp_type,
+			   mutate_func compress)
+{
+	static const ulong piece_sizes[] = { 1, 3, 64, TEST_BUFFER_SIZE };
+	struct image_decomp_stream st;
+	ulong compress_size = TEST_BUFFER_SIZE;
+	char compressed[TEST_BUFFER_SIZE];
+	char out[TEST_BUFFER_SIZE];
+	ulong unc_len = strlen(plain);
+	ulong out_len, pos, len;
+	int i;
+
+	printf("Testing stream: %s\n", genimg_get_comp_name(comp_type));
+	ut_assertok(compress(uts, (void *)plain, unc_len, compressed,
+			     compress_size, &compress_size));
+
+	for (i = 0; i < ARRAY_SIZE(piece_sizes); i++) {
+		memset(out, '\0', sizeof(out));
+		ut_assertok(image_decomp_stream_start(&st, comp_type, out,
+						      sizeof(out)));
+		for (pos = 0; pos < compress_size; pos += len) {
+			len = min(piece_sizes[i], compress_size - pos);
+			ut_assertok(image_decomp_stream_feed(&st,
+							     compressed + pos,
+							     len));
+		}
+		ut_assertok(image_decomp_stream_end(&st, &out_len));
+		ut_asserteq(unc_len, out_len);
+		ut_asserteq_mem(plain, out, unc_len);
+	}
+
+	/* Not enough space */
+	ut_assertok(image_decomp_stream_start(&st, comp_type, out,
+					      unc_len - 1));
+	image_decomp_stream_feed(&st, compressed, compress_size);
+	ut_assert(image_decomp_stream_end(&st, &out_len));
+
+	/* Truncated input */
+	ut_assertok(image_decomp_stream_start(&st, comp_type, out,
+					      sizeof(out)));
+	ut_assertok(image_decomp_stream_feed(&st, compressed,
+					     compress_size / 2));
+	ut_assert(image_decomp_stream_end(&st, &out_len));
+
+	return 0;
+}
+
+static int compression_test_stream_gzip(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_GZIP, compress_using_gzip);
+}
+COMPRESSION_TEST(compression_test_stream_gzip, 0);
+
+static int compression_test_stream_lz4(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_LZ4, compress_using_lz4);
+}
+COMPRESSION_TEST(compression_test_stream_lz4, 0);
+
+#if CONFIG_IS_ENABLED(ZSTD)
+static int compression_test_stream_zstd(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_stream_zstd, 0);
+#endif
+#endif
+
 int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	struct unit_test *tests = ll_entry_start(struct unit_test,
@@ -219,6 +219,69 @@ static int dm_test_fdt(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_fdt, 0);
 
+/* Count the enabled subnodes of @parent which UCLASS_TEST_FDT drivers bind */
+static int dm_test_count_fdt_nodes(ofnode parent)
+{
+	const struct udevice_id *const ids[] = { testfdt_ids, testfdt1_ids };
+	const struct udevice_id *id;
+	ofnode node;
+	int count = 0, i;
+
+	ofnode_for_each_subnode(node, parent) {
+		if (!ofnode_is_available(node))
+			continue;
+		for (i = 0; i < ARRAY_SIZE(ids); i++) {
+			for (id = ids[i]; id->compatible; id++) {
+				if (ofnode_device_is_compatible(node,
+								id->compatible))
+					count++;
+			}
+		}
+	}
+
+	return count;
+}
+
+/* Test that device tree nodes are bound when their uclass is first used */
+static int dm_test_fdt_lazy_bind(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+	int count;
+
+	if (!CONFIG_IS_ENABLED(DM_LAZY_BIND))
+		return 0;
+
+	ut_assertok(dm_scan_fdt(gd->fdt_blob, false));
+	uc = uclass_find(UCLASS_TEST_FDT);
+	ut_assert(!uc || list_empty(&uc->dev_head));
+
+	/* All the nodes of the uclass are bound, in device tree order */
+	count = dm_test_count_fdt_nodes(ofnode_path("/")) +
+		dm_test_count_fdt_nodes(ofnode_path("/chosen"));
+	ut_assertok(uclass_get(UCLASS_TEST_FDT, &uc));
+	ut_asserteq(count, list_count_items(&uc->dev_head));
+	ut_assertok(uclass_find_device(UCLASS_TEST_FDT, 0, &dev));
+	ut_asserteq_str("a-test", dev->name);
+	ut_assertok(uclass_find_device(UCLASS_TEST_FDT, 1, &dev));
+	ut_asserteq_str("b-test", dev->name);
+
+	/* Aliases still give the sequence numbers */
+	ut_assertok(uclass_get_device_by_seq(UCLASS_TEST_FDT, 3, &dev));
+	ut_asserteq_str("b-test", dev->name);
+
+	/* Looking a device up by its node binds the rest */
+	ut_assertok(device_find_global_by_ofnode(ofnode_path("/some-bus"),
+						 &dev));
+	ut_asserteq_str("some-bus", dev->name);
+
+	/* Walking the children of the root binds the rest */
+	ut_assertok(device_find_child_by_name(gd->dm_root, "misc-test", &dev));
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_lazy_bind, 0);
+
 static int dm_test_alias_highest_id(struct unit_test_state *uts)
 {
 	int ret;
@@ -814,3 +877,39 @@ static int dm_test_read_int(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_read_int, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that drivers are found by compatible string like a linear search */
+static int dm_test_lookup_compatible(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id, *found_id, *match = NULL;
+	struct driver *entry, *found, *first;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			/* The first driver listing the string must win */
+			for (first = driver; first <= entry; first++) {
+				for (match = first->of_match;
+				     match && match->compatible; match++) {
+					if (!strcmp(match->compatible,
+						    id->compatible))
+						break;
+				}
+				if (match && match->compatible)
+					break;
+			}
+
+			found = lists_driver_lookup_compatible(id->compatible,
+							       &found_id);
+			ut_asserteq_ptr(first, found);
+			ut_asserteq_ptr(match, found_id);
+		}
+	}
+
+	ut_assertnull(lists_driver_lookup_compatible("sandbox,no-such-driver",
+						     &found_id));
+
+	return 0;
+}
+DM_TEST(dm_test_lookup_compatible, 0);
@@ -123,3 +123,46 @@ static int env_test_htab_deletes(struct unit_test_state *uts)
 }
 
 ENV_TEST(env_test_htab_deletes, 0);
+
+/* Import a whole environment and check that the entries share its buffer */
+static int env_test_htab_import(struct unit_test_state *uts)
+{
+	static const char env[] = "a=1\0b=22\0c=333\0\0garbage";
+	struct hsearch_data htab;
+	struct env_entry item, *ritem;
+	unsigned int changes;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, himport_r(&htab, env, sizeof(env), '\0', 0, 0, 0,
+				 NULL));
+	ut_asserteq(3, htab.filled);
+	ut_assertnonnull(htab.import_data);
+	ut_asserteq(sizeof("a=1\0b=22\0c=333"), htab.import_size);
+
+	/* Lookups do not count as changes, updates and deletions do */
+	changes = htab.changes;
+	item.key = "b";
+	item.data = NULL;
+	ut_assert(hsearch_r(item, ENV_FIND, &ritem, &htab, 0));
+	ut_asserteq_str("22", ritem->data);
+	ut_assert(ritem->data >= htab.import_data &&
+		  ritem->data < htab.import_data + htab.import_size);
+	ut_asserteq(changes, htab.changes);
+
+	item.data = "4444";
+	ut_assert(hsearch_r(item, ENV_ENTER, &ritem, &htab, 0));
+	ut_asserteq_str("4444", ritem->data);
+	ut_assert(changes != htab.changes);
+
+	changes = htab.changes;
+	ut_asserteq(1, hdelete_r("a", &htab, 0));
+	ut_assert(changes != htab.changes);
+	ut_asserteq(2, htab.filled);
+
+	hdestroy_r(&htab);
+	ut_assertnull(htab.import_data);
+
+	return 0;
+}
+
+ENV_TEST(env_test_htab_import, 0);
@@ -17,22 +17,22 @@ static int check_lmb(struct unit_test_state *uts, struct lmb *lmb,
 {
 	if (ram_size) {
 		ut_asserteq(lmb->memory.cnt, 1);
-		ut_asserteq(lmb->memory.region[0].base, ram_base);
-		ut_asserteq(lmb->memory.region[0].size, ram_size);
+		ut_asserteq(lmb_regions(&lmb->memory)[0].base, ram_base);
+		ut_asserteq(lmb_regions(&lmb->memory)[0].size, ram_size);
 	}
 
 	ut_asserteq(lmb->reserved.cnt, num_reserved);
 	if (num_reserved > 0) {
-		ut_asserteq(lmb->reserved.region[0].base, base1);
-		ut_asserteq(lmb->reserved.region[0].size, size1);
+		ut_asserteq(lmb_regions(&lmb->reserved)[0].base, base1);
+		ut_asserteq(lmb_regions(&lmb->reserved)[0].size, size1);
 	}
 	if (num_reserved > 1) {
-		ut_asserteq(lmb->reserved.region[1].base, base2);
-		ut_asserteq(lmb->reserved.region[1].size, size2);
+		ut_asserteq(lmb_regions(&lmb->reserved)[1].base, base2);
+		ut_asserteq(lmb_regions(&lmb->reserved)[1].size, size2);
 	}
 	if (num_reserved > 2) {
-		ut_asserteq(lmb->reserved.region[2].base, base3);
-		ut_asserteq(lmb->reserved.region[2].size, size3);
+		ut_asserteq(lmb_regions(&lmb->reserved)[2].base, base3);
+		ut_asserteq(lmb_regions(&lmb->reserved)[2].size, size3);
 	}
 	return 0;
 }
@@ -78,14 +78,14 @@ static int test_multi_alloc(struct unit_test_state *uts, const phys_addr_t ram,
 
 	if (ram0_size) {
 		ut_asserteq(lmb.memory.cnt, 2);
-		ut_asserteq(lmb.memory.region[0].base, ram0);
-		ut_asserteq(lmb.memory.region[0].size, ram0_size);
-		ut_asserteq(lmb.memory.region[1].base, ram);
-		ut_asserteq(lmb.memory.region[1].size, ram_size);
+		ut_asserteq(lmb_regions(&lmb.memory)[0].base, ram0);
+		ut_asserteq(lmb_regions(&lmb.memory)[0].size, ram0_size);
+		ut_asserteq(lmb_regions(&lmb.memory)[1].base, ram);
+		ut_asserteq(lmb_regions(&lmb.memory)[1].size, ram_size);
 	} else {
 		ut_asserteq(lmb.memory.cnt, 1);
-		ut_asserteq(lmb.memory.region[0].base, ram);
-		ut_asserteq(lmb.memory.region[0].size, ram_size);
+		ut_asserteq(lmb_regions(&lmb.memory)[0].base, ram);
+		ut_asserteq(lmb_regions(&lmb.memory)[0].size, ram_size);
 	}
 
 	/* reserve 64KiB somewhere */
@@ -156,14 +156,14 @@ static int test_multi_alloc(struct unit_test_state *uts, const phys_addr_t ram,
 
 	if (ram0_size) {
 		ut_asserteq(lmb.memory.cnt, 2);
-		ut_asserteq(lmb.memory.region[0].base, ram0);
-		ut_asserteq(lmb.memory.region[0].size, ram0_size);
-		ut_asserteq(lmb.memory.region[1].base, ram);
-		ut_asserteq(lmb.memory.region[1].size, ram_size);
+		ut_asserteq(lmb_regions(&lmb.memory)[0].base, ram0);
+		ut_asserteq(lmb_regions(&lmb.memory)[0].size, ram0_size);
+		ut_asserteq(lmb_regions(&lmb.memory)[1].base, ram);
+		ut_asserteq(lmb_regions(&lmb.memory)[1].size, ram_size);
 	} else {
 		ut_asserteq(lmb.memory.cnt, 1);
-		ut_asserteq(lmb.memory.region[0].base, ram);
-		ut_asserteq(lmb.memory.region[0].size, ram_size);
+		ut_asserteq(lmb_regions(&lmb.memory)[0].base, ram);
+		ut_asserteq(lmb_regions(&lmb.memory)[0].size, ram_size);
 	}
 
 	return 0;
@@ -655,3 +655,56 @@ static int lib_test_lmb_get_free_size(struct unit_test_state *uts)
 
 DM_TEST(lib_test_lmb_get_free_size,
 	DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Reserve more regions than fit in struct lmb_region and allocate around them */
+static int lib_test_lmb_many_regions(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t ram_size = 0x20000000;
+	const int count = 4 * MAX_LMB_REGIONS;
+	struct lmb lmb;
+	phys_addr_t a;
+	long ret;
+	int i;
+
+	lmb_init(&lmb);
+	ret = lmb_add(&lmb, ram, ram_size);
+	ut_asserteq(ret, 0);
+
+	/* Reserve every other 1 MiB, in reverse order, ending at the top */
+	for (i = count - 1; i >= 0; i--) {
+		ret = lmb_reserve(&lmb, ram + ram_size - (2 * i + 1) * 0x100000,
+				  0x100000);
+		ut_asserteq(ret, 0);
+	}
+	ut_asserteq(lmb.reserved.cnt, count);
+	for (i = 1; i < count; i++)
+		ut_assert(lmb_regions(&lmb.reserved)[i - 1].base <
+			  lmb_regions(&lmb.reserved)[i].base);
+
+	ut_asserteq(lmb_is_reserved(&lmb, ram + ram_size - 1), 1);
+	ut_asserteq(lmb_is_reserved(&lmb, ram + ram_size - 0x100001), 0);
+	ut_asserteq(lmb_get_free_size(&lmb, ram + ram_size - 0x180000),
+		    0x80000);
+
+	/* 2 MiB does not fit in any hole, so it goes right below all of them */
+	a = lmb_alloc(&lmb, 0x200000, 0x100000);
+	ut_asserteq(a, ram + ram_size - (2 * count + 1) * 0x100000);
+	ut_asserteq(lmb.reserved.cnt, count);
+
+	/* 1 MiB fills the highest hole, merging two regions */
+	a = lmb_alloc(&lmb, 0x100000, 0x100000);
+	ut_asserteq(a, ram + ram_size - 0x200000);
+	ut_asserteq(lmb.reserved.cnt, count - 1);
+
+	ret = lmb_free(&lmb, a, 0x100000);
+	ut_asserteq(ret, 0);
+	ut_asserteq(lmb.reserved.cnt, count);
+
+	lmb_release(&lmb);
+	ut_asserteq(lmb.reserved.cnt, 0);
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_many_regions, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the malloc() statistics and slabs
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+static int lib_test_malloc_stats(struct unit_test_state *uts)
+{
+	struct malloc_statistics before, st;
+	char *ptr;
+
+	malloc_get_statistics(&before);
+
+	ptr = malloc(1000);
+	ut_assertnonnull(ptr);
+	malloc_get_statistics(&st);
+	ut_asserteq(before.mallocs + 1, st.mallocs);
+	ut_assert(st.in_use >= before.in_use + 1000);
+	ut_assert(st.peak_in_use >= st.in_use);
+
+	ptr = realloc(ptr, 2000);
+	ut_assertnonnull(ptr);
+	malloc_get_statistics(&st);
+	ut_asserteq(before.reallocs + 1, st.reallocs);
+	ut_assert(st.in_use >= before.in_use + 2000);
+
+	free(ptr);
+	malloc_get_statistics(&st);
+	ut_asserteq(before.frees + 1, st.frees);
+	ut_asserteq(before.in_use, st.in_use);
+
+	/* realloc() to nothing is a free() */
+	ptr = malloc(1000);
+	ut_assertnonnull(ptr);
+	ut_asserteq_ptr(NULL, realloc(ptr, 0));
+	malloc_get_statistics(&st);
+	ut_asserteq(before.frees + 2, st.frees);
+	ut_asserteq(before.in_use, st.in_use);
+
+	/* Failures are counted along with the largest one */
+	ut_asserteq_ptr(NULL, malloc(st.pool_size + 1));
+	malloc_get_statistics(&st);
+	ut_asserteq(before.failures + 1, st.failures);
+	ut_assert(st.largest_failure >= st.pool_size + 1);
+	ut_asserteq(before.in_use, st.in_use);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_malloc_stats, 0);
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+static bool malloc_in_slab(struct malloc_statistics *st, void *ptr)
+{
+	return (ulong)ptr >= st->slab_start &&
+	       (ulong)ptr < st->slab_start + st->slab_size;
+}
+
+static int lib_test_malloc_slab(struct unit_test_state *uts)
+{
+	struct malloc_statistics before, st;
+	char *small, *other, *large;
+
+	malloc_get_statistics(&before);
+	/* The pool is too small to set aside a slab area */
+	if (!before.slab_size)
+		return 0;
+
+	/* 20 bytes go to the 32-byte objects */
+	small = malloc(20);
+	ut_assertnonnull(small);
+	malloc_get_statistics(&st);
+	ut_assert(malloc_in_slab(&st, small));
+	ut_asserteq(32, st.slab[1].size);
+	ut_asserteq(before.slab[1].in_use + 1, st.slab[1].in_use);
+	ut_asserteq(before.in_use + 32, st.in_use);
+
+	/* A freed object is handed out again */
+	free(small);
+	malloc_get_statistics(&st);
+	ut_asserteq(before.slab[1].in_use, st.slab[1].in_use);
+	ut_asserteq(before.in_use, st.in_use);
+	other = malloc(32);
+	ut_asserteq_ptr(small, other);
+
+	/* Growing past the largest object moves the data out of the slab */
+	memset(other, 0x5a, 32);
+	large = realloc(other, 1000);
+	ut_assertnonnull(large);
+	malloc_get_statistics(&st);
+	ut_assert(!malloc_in_slab(&st, large));
+	ut_asserteq(0x5a, large[0]);
+	ut_asserteq(0x5a, large[31]);
+	ut_asserteq(before.slab[1].in_use, st.slab[1].in_use);
+	free(large);
+
+	/* Zeroed objects come from the slab too */
+	small = calloc(4, 16);
+	ut_assertnonnull(small);
+	malloc_get_statistics(&st);
+	ut_assert(malloc_in_slab(&st, small));
+	ut_asserteq(before.slab[2].in_use + 1, st.slab[2].in_use);
+	ut_asserteq(0, small[63]);
+	free(small);
+
+	malloc_get_statistics(&st);
+	ut_asserteq(before.in_use, st.in_use);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_malloc_slab, 0);
+#endif
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for malloc arenas
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+static int lib_test_malloc_arena(struct unit_test_state *uts)
+{
+	struct malloc_arena arena;
+	char *small[64], *large;
+	int i;
+
+	malloc_arena_init(&arena, 1024);
+	ut_asserteq_ptr(NULL, arena.blocks);
+
+	/* Small allocations are aligned and do not overlap */
+	for (i = 0; i < ARRAY_SIZE(small); i++) {
+		small[i] = malloc_arena_alloc(&arena, 20);
+		ut_assertnonnull(small[i]);
+		ut_asserteq(0, (ulong)small[i] & 15);
+		memset(small[i], i, 20);
+	}
+	for (i = 0; i < ARRAY_SIZE(small); i++)
+		ut_asserteq(i, small[i][19]);
+	ut_asserteq(ARRAY_SIZE(small) * 32, arena.used);
+
+	/* A large allocation gets its own block */
+	large = malloc_arena_alloc(&arena, 4096);
+	ut_assertnonnull(large);
+	memset(large, 0xff, 4096);
+	ut_asserteq(ARRAY_SIZE(small) - 1, small[ARRAY_SIZE(small) - 1][0]);
+
+	malloc_arena_free_all(&arena);
+	ut_asserteq_ptr(NULL, arena.blocks);
+	ut_asserteq(0, arena.used);
+
+	/* The arena can be used again */
+	ut_assertnonnull(malloc_arena_alloc(&arena, 1));
+	malloc_arena_free_all(&arena);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_malloc_arena, 0);
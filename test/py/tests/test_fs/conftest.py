@@ -14,6 +14,8 @@ supported_fs_ext = ['fat16', 'fat32']
 supported_fs_mkdir = ['fat16', 'fat32']
 supported_fs_unlink = ['fat16', 'fat32']
 supported_fs_symlink = ['ext4']
+supported_fs_erofs = ['erofs', 'erofs-lz4']
+supported_fs_squashfs = ['squashfs']
 
 #
 # Filesystem test specific setup
@@ -50,6 +52,8 @@ def pytest_configure(config):
     global supported_fs_mkdir
     global supported_fs_unlink
     global supported_fs_symlink
+    global supported_fs_erofs
+    global supported_fs_squashfs
 
     def intersect(listA, listB):
         return  [x for x in listA if x in listB]
@@ -62,6 +66,9 @@ def pytest_configure(config):
         supported_fs_mkdir =  intersect(supported_fs, supported_fs_mkdir)
         supported_fs_unlink =  intersect(supported_fs, supported_fs_unlink)
         supported_fs_symlink =  intersect(supported_fs, supported_fs_symlink)
+        supported_fs_erofs =  intersect(supported_fs, supported_fs_erofs)
+        supported_fs_squashfs =  intersect(supported_fs,
+                                           supported_fs_squashfs)
 
 def pytest_generate_tests(metafunc):
     """Parametrize fixtures, fs_obj_xxx
@@ -90,6 +97,12 @@ def pytest_generate_tests(metafunc):
     if 'fs_obj_symlink' in metafunc.fixturenames:
         metafunc.parametrize('fs_obj_symlink', supported_fs_symlink,
             indirect=True, scope='module')
+    if 'fs_obj_erofs' in metafunc.fixturenames:
+        metafunc.parametrize('fs_obj_erofs', supported_fs_erofs,
+            indirect=True, scope='module')
+    if 'fs_obj_squashfs' in metafunc.fixturenames:
+        metafunc.parametrize('fs_obj_squashfs', supported_fs_squashfs,
+            indirect=True, scope='module')
 
 #
 # Helper functions
@@ -600,3 +613,155 @@ def fs_obj_symlink(request, u_boot_config):
         call('rmdir %s' % mount_dir, shell=True)
         if fs_img:
             call('rm -f %s' % fs_img, shell=True)
+
+#
+# Helpers for the read-only file systems, whose images are built from a
+# directory on the host
+#
+def check_ubconfig_ro(config, fs_type, tool):
+    """Check that a read-only file system can be tested.
+
+    Args:
+        config: U-boot configuration.
+        fs_type: File system type, as in CONFIG_FS_xxx.
+        tool: Host tool which builds the image.
+
+    Return:
+        Nothing.
+    """
+    if not config.buildconfig.get('config_fs_%s' % fs_type, None):
+        pytest.skip('.config feature "FS_%s" not enabled' % fs_type.upper())
+    if not tool_is_in_path(tool):
+        pytest.skip('%s not found' % tool)
+
+def md5_of(fn):
+    """Get the MD5 hash of a file on the host."""
+    return check_output('md5sum %s' % fn, shell=True).decode().split()[0]
+
+def fill_ro_dir(src_dir):
+    """Create the files common to the read-only file system images.
+
+    Args:
+        src_dir: Directory to create the files in.
+
+    Return:
+        A dictionary of the MD5 hash and size of each file, by path.
+    """
+    check_call('rm -rf %s' % src_dir, shell=True)
+    check_call('mkdir -p %s/SUBDIR' % src_dir, shell=True)
+
+    # Small enough to be stored inline or in a fragment
+    check_call('dd if=/dev/urandom of=%s/%s bs=1 count=100'
+        % (src_dir, INLINE_FILE), shell=True)
+    # Incompressible, so stored as it is
+    check_call('dd if=/dev/urandom of=%s/%s bs=1M count=1'
+        % (src_dir, SMALL_FILE), shell=True)
+    # Compresses well, with an odd size
+    check_call('seq 1 300000 > %s/SUBDIR/%s'
+        % (src_dir, TEXT_FILE), shell=True)
+
+    files = {}
+    for fn in [INLINE_FILE, SMALL_FILE, 'SUBDIR/' + TEXT_FILE]:
+        path = '%s/%s' % (src_dir, fn)
+        files[fn] = [md5_of(path), os.path.getsize(path)]
+    return files
+
+#
+# Fixture for EROFS test
+#
+# NOTE: yield_fixture was deprecated since pytest-3.0
+@pytest.yield_fixture()
+def fs_obj_erofs(request, u_boot_config):
+    """Set up an EROFS image, uncompressed or compressed with LZ4.
+
+    Args:
+        request: Pytest request object.
+        u_boot_config: U-boot configuration.
+
+    Return:
+        A fixture for EROFS test, i.e. a triplet of file system type,
+        image file name and a dictionary of the MD5 hash and size of each
+        file.
+    """
+    fs_type = request.param
+    fs_img = ''
+
+    check_ubconfig_ro(u_boot_config, 'erofs', 'mkfs.erofs')
+
+    src_dir = u_boot_config.persistent_data_dir + '/erofs.src'
+    fs_img = '%s/%s.img' % (u_boot_config.persistent_data_dir, fs_type)
+    mkfs_opt = '-zlz4' if fs_type == 'erofs-lz4' else ''
+
+    try:
+        files = fill_ro_dir(src_dir)
+        check_call('rm -f %s' % fs_img, shell=True)
+        check_call('mkfs.erofs %s %s %s' % (mkfs_opt, fs_img, src_dir),
+            shell=True)
+    except CalledProcessError:
+        pytest.skip('Setup failed for filesystem: ' + fs_type)
+        return
+    else:
+        yield [fs_type, fs_img, files]
+    finally:
+        call('rm -rf %s' % src_dir, shell=True)
+        if fs_img:
+            call('rm -f %s' % fs_img, shell=True)
+
+#
+# Fixture for SquashFS test
+#
+# NOTE: yield_fixture was deprecated since pytest-3.0
+@pytest.yield_fixture()
+def fs_obj_squashfs(request, u_boot_config):
+    """Set up a SquashFS image.
+
+    Besides the common files, the image has a directory large enough to
+    need several index entries and a few symlinks.
+
+    Args:
+        request: Pytest request object.
+        u_boot_config: U-boot configuration.
+
+    Return:
+        A fixture for SquashFS test, i.e. a triplet of file system type,
+        image file name and a dictionary of the MD5 hash and size of each
+        file.
+    """
+    fs_type = request.param
+    fs_img = ''
+
+    check_ubconfig_ro(u_boot_config, 'squashfs', 'mksquashfs')
+
+    src_dir = u_boot_config.persistent_data_dir + '/squashfs.src'
+    fs_img = '%s/%s.img' % (u_boot_config.persistent_data_dir, fs_type)
+
+    try:
+        files = fill_ro_dir(src_dir)
+
+        # Directory listings are indexed every 8KiB
+        check_call('mkdir %s/%s' % (src_dir, BIG_DIR), shell=True)
+        for i in range(BIG_DIR_COUNT):
+            fn = '%s/%s' % (BIG_DIR, big_dir_name(i))
+            with open('%s/%s' % (src_dir, fn), 'w') as fd:
+                fd.write('%d\n' % i)
+            files[fn] = [md5_of('%s/%s' % (src_dir, fn)),
+                         os.path.getsize('%s/%s' % (src_dir, fn))]
+
+        check_call('ln -s %s %s/%s.link' % (SMALL_FILE, src_dir, SMALL_FILE),
+            shell=True)
+        check_call('ln -s ../%s %s/SUBDIR/%s.link'
+            % (INLINE_FILE, src_dir, INLINE_FILE), shell=True)
+        check_call('ln -s /SUBDIR %s/SUBDIR.link' % src_dir, shell=True)
+
+        check_call('rm -f %s' % fs_img, shell=True)
+        check_call('mksquashfs %s %s -noappend -no-xattrs -all-root'
+            % (src_dir, fs_img), shell=True)
+    except CalledProcessError:
+        pytest.skip('Setup failed for filesystem: ' + fs_type)
+        return
+    else:
+        yield [fs_type, fs_img, files]
+    finally:
+        call('rm -rf %s' % src_dir, shell=True)
+        if fs_img:
+            call('rm -f %s' % fs_img, shell=True)
@@ -12,5 +12,18 @@ MEDIUM_FILE='10MB.file'
 # $BIG_FILE is the name of the 2.5GB file in the file system image
 BIG_FILE='2.5GB.file'
 
+# $INLINE_FILE is the name of the 100 byte file in read-only images
+INLINE_FILE='100B.file'
+
+# $TEXT_FILE is the name of the compressible file in read-only images
+TEXT_FILE='text.file'
+
+# $BIG_DIR is a directory of $BIG_DIR_COUNT files in SquashFS images
+BIG_DIR='bigdir'
+BIG_DIR_COUNT=600
+
+def big_dir_name(i):
+    return 'file-with-a-rather-long-name-to-fill-the-listing-%04d' % i
+
 ADDR=0x01000008
 LENGTH=0x00100000
@@ -290,3 +290,35 @@ class TestFsBasic(object):
                 'setenv filesize'])
             assert(md5val[0] in ''.join(output))
             assert_fs_integrity(fs_type, fs_img)
+
+    def test_fs14(self, u_boot_console, fs_obj_basic):
+        """
+        Test Case 14 - loadfiles command, reading several files at once
+        """
+        fs_type,fs_img,md5val = fs_obj_basic
+        with u_boot_console.log.section('Test Case 14a - loadfiles'):
+            # Load the small file twice, one copy after the other
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'mw.b %x 00 200000' % ADDR,
+                'loadfiles host 0:0 %x /%s %x /SUBDIR/../%s'
+                    % (ADDR, SMALL_FILE, ADDR + 0x100000, SMALL_FILE),
+                'printenv filesize'])
+            assert('2097152 bytes read' in ''.join(output))
+            assert('filesize=100000' in ''.join(output))
+
+            output = u_boot_console.run_command_list([
+                'md5sum %x 100000' % ADDR,
+                'md5sum %x 100000' % (ADDR + 0x100000),
+                'setenv filesize'])
+            assert(''.join(output).count(md5val[0]) == 2)
+
+        with u_boot_console.log.section('Test Case 14b - loadfiles (missing)'):
+            # No file is loaded if one of them is missing
+            output = u_boot_console.run_command_list([
+                'mw.b %x 00 100' % ADDR,
+                'loadfiles host 0:0 %x /%s %x /nonexistent'
+                    % (ADDR, SMALL_FILE, ADDR + 0x100000),
+                'md5sum %x 100' % ADDR])
+            assert('Unable to find file /nonexistent' in ''.join(output))
+            assert('bytes read' not in ''.join(output))
@@ -0,0 +1,87 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: EROFS Test
+
+"""
+This test verifies reading EROFS images, uncompressed and compressed with
+LZ4, for inline, plain and compressed files.
+"""
+
+import pytest
+from fstest_defs import *
+
+@pytest.mark.boardspec('sandbox')
+class TestErofs(object):
+    def test_erofs1(self, u_boot_console, fs_obj_erofs):
+        """
+        Test Case 1 - ls
+        """
+        fs_type, fs_img, files = fs_obj_erofs
+        with u_boot_console.log.section('Test Case 1 - ls'):
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'ls host 0:0 /'])
+            assert(INLINE_FILE in ''.join(output))
+            assert(SMALL_FILE in ''.join(output))
+            assert('SUBDIR/' in ''.join(output))
+
+            output = u_boot_console.run_command('ls host 0:0 /SUBDIR')
+            assert(TEXT_FILE in output)
+
+    def test_erofs2(self, u_boot_console, fs_obj_erofs):
+        """
+        Test Case 2 - size of each file
+        """
+        fs_type, fs_img, files = fs_obj_erofs
+        with u_boot_console.log.section('Test Case 2 - size'):
+            u_boot_console.run_command('host bind 0 %s' % fs_img)
+            for fn, (md5val, size) in files.items():
+                output = u_boot_console.run_command_list([
+                    'size host 0:0 /%s' % fn,
+                    'printenv filesize'])
+                assert('filesize=%x' % size in ''.join(output))
+
+    def test_erofs3(self, u_boot_console, fs_obj_erofs):
+        """
+        Test Case 3 - load each file and check its contents
+        """
+        fs_type, fs_img, files = fs_obj_erofs
+        with u_boot_console.log.section('Test Case 3 - load'):
+            u_boot_console.run_command('host bind 0 %s' % fs_img)
+            for fn, (md5val, size) in files.items():
+                output = u_boot_console.run_command_list([
+                    'load host 0:0 %x /%s' % (ADDR, fn),
+                    'printenv filesize'])
+                assert('filesize=%x' % size in ''.join(output))
+
+                output = u_boot_console.run_command_list([
+                    'md5sum %x $filesize' % ADDR,
+                    'setenv filesize'])
+                assert(md5val in ''.join(output))
+
+    def test_erofs4(self, u_boot_console, fs_obj_erofs):
+        """
+        Test Case 4 - load part of a file
+        """
+        fs_type, fs_img, files = fs_obj_erofs
+        with u_boot_console.log.section('Test Case 4 - load at an offset'):
+            fn = 'SUBDIR/' + TEXT_FILE
+            size = files[fn][1]
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'load host 0:0 %x /%s 1000 %x' % (ADDR, fn, size - 0x1000),
+                'printenv filesize'])
+            assert('filesize=1000' in ''.join(output))
+
+    def test_erofs5(self, u_boot_console, fs_obj_erofs):
+        """
+        Test Case 5 - load a file which does not exist
+        """
+        fs_type, fs_img, files = fs_obj_erofs
+        with u_boot_console.log.section('Test Case 5 - missing file'):
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'setenv filesize',
+                'load host 0:0 %x /nosuchfile' % ADDR,
+                'printenv filesize'])
+            assert('"filesize" not defined' in ''.join(output))
@@ -0,0 +1,86 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: File Read Benchmark
+
+"""
+This test measures how fast files are read from a file system, for both a
+file which is fully allocated and a range of a sparse file, and checks the
+data read.
+"""
+
+import pytest
+import re
+from fstest_defs import *
+
+# Number of times each read is repeated
+LOOPS = 8
+
+def bench_load(u_boot_console, cmd):
+    """Run a load command LOOPS times and return the bytes and time taken.
+
+    Args:
+        u_boot_console: U-Boot console.
+        cmd: Load command to run.
+
+    Return:
+        A pair of the number of bytes read by each command and the total
+        time in ms.
+    """
+    total_ms = 0
+    size = 0
+    for i in range(LOOPS):
+        output = u_boot_console.run_command(cmd)
+        m = re.search(r'(\d+) bytes read in (\d+) ms', output)
+        assert(m)
+        size = int(m.group(1))
+        total_ms += int(m.group(2))
+    return size, total_ms
+
+def log_rate(u_boot_console, name, size, total_ms):
+    """Log the read rate of a benchmark."""
+    rate = size * LOOPS / 1024 / max(total_ms, 1)
+    u_boot_console.log.info('%s: %d bytes x %d in %d ms, %.1f MiB/s'
+        % (name, size, LOOPS, total_ms, rate * 1000 / 1024))
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.slow
+class TestFsReadBench(object):
+    def test_fs_read_bench1(self, u_boot_console, fs_obj_basic):
+        """
+        Benchmark 1 - read a fully allocated 1MB file
+        """
+        fs_type,fs_img,md5val = fs_obj_basic
+        with u_boot_console.log.section('Benchmark 1 - load (small)'):
+            u_boot_console.run_command('host bind 0 %s' % fs_img)
+            size, total_ms = bench_load(u_boot_console,
+                '%sload host 0:0 %x /%s' % (fs_type, ADDR, SMALL_FILE))
+            assert(size == 0x100000)
+            log_rate(u_boot_console, 'small file', size, total_ms)
+
+            output = u_boot_console.run_command_list([
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert(md5val[0] in ''.join(output))
+
+    def test_fs_read_bench2(self, u_boot_console, fs_obj_basic):
+        """
+        Benchmark 2 - read 16MB of a sparse file: 1MB of data, then a hole
+        """
+        fs_type,fs_img,md5val = fs_obj_basic
+        with u_boot_console.log.section('Benchmark 2 - load (sparse)'):
+            u_boot_console.run_command('host bind 0 %s' % fs_img)
+            size, total_ms = bench_load(u_boot_console,
+                '%sload host 0:0 %x /%s 0x1000000 0'
+                    % (fs_type, ADDR, BIG_FILE))
+            assert(size == 0x1000000)
+            log_rate(u_boot_console, 'sparse file', size, total_ms)
+
+            # The data comes first, then only zeroes
+            output = u_boot_console.run_command_list([
+                'md5sum %x %x' % (ADDR, LENGTH),
+                'mw.b %x 0 %x' % (ADDR + 0x1000000, LENGTH),
+                'cmp.b %x %x %x' % (ADDR + LENGTH, ADDR + 0x1000000,
+                    LENGTH),
+                'setenv filesize'])
+            assert(md5val[1] in ''.join(output))
+            assert('were the same' in ''.join(output))
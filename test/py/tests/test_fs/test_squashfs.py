@@ -0,0 +1,92 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: SquashFS Test
+
+"""
+This test verifies reading SquashFS images: files stored in fragments and
+in blocks, lookups in a directory with several index entries, and symlinks.
+"""
+
+import pytest
+from fstest_defs import *
+
+@pytest.mark.boardspec('sandbox')
+class TestSquashfs(object):
+    def test_squashfs1(self, u_boot_console, fs_obj_squashfs):
+        """
+        Test Case 1 - ls
+        """
+        fs_type, fs_img, files = fs_obj_squashfs
+        with u_boot_console.log.section('Test Case 1 - ls'):
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'ls host 0:0 /'])
+            assert(INLINE_FILE in ''.join(output))
+            assert(SMALL_FILE in ''.join(output))
+            assert('SUBDIR/' in ''.join(output))
+            assert('%s/' % BIG_DIR in ''.join(output))
+
+            output = u_boot_console.run_command('ls host 0:0 /%s' % BIG_DIR)
+            for i in [0, BIG_DIR_COUNT // 2, BIG_DIR_COUNT - 1]:
+                assert(big_dir_name(i) in output)
+            assert('%d file(s)' % BIG_DIR_COUNT in output)
+
+    def test_squashfs2(self, u_boot_console, fs_obj_squashfs):
+        """
+        Test Case 2 - size and contents of each file
+        """
+        fs_type, fs_img, files = fs_obj_squashfs
+        with u_boot_console.log.section('Test Case 2 - size and load'):
+            u_boot_console.run_command('host bind 0 %s' % fs_img)
+            for fn, (md5val, size) in files.items():
+                output = u_boot_console.run_command_list([
+                    'size host 0:0 /%s' % fn,
+                    'printenv filesize'])
+                assert('filesize=%x' % size in ''.join(output))
+
+                output = u_boot_console.run_command_list([
+                    'load host 0:0 %x /%s' % (ADDR, fn),
+                    'md5sum %x $filesize' % ADDR,
+                    'setenv filesize'])
+                assert(md5val in ''.join(output))
+
+    def test_squashfs3(self, u_boot_console, fs_obj_squashfs):
+        """
+        Test Case 3 - look up names all over a large directory
+        """
+        fs_type, fs_img, files = fs_obj_squashfs
+        with u_boot_console.log.section('Test Case 3 - directory index'):
+            u_boot_console.run_command('host bind 0 %s' % fs_img)
+            for i in [0, 1, BIG_DIR_COUNT // 3, BIG_DIR_COUNT // 2,
+                      BIG_DIR_COUNT - 1]:
+                output = u_boot_console.run_command_list([
+                    'size host 0:0 /%s/%s' % (BIG_DIR, big_dir_name(i)),
+                    'printenv filesize'])
+                assert('filesize=%x' % len('%d\n' % i) in ''.join(output))
+
+            output = u_boot_console.run_command_list([
+                'setenv filesize',
+                'size host 0:0 /%s/%s-nosuchfile' % (BIG_DIR,
+                                                      big_dir_name(1)),
+                'printenv filesize'])
+            assert('"filesize" not defined' in ''.join(output))
+
+    def test_squashfs4(self, u_boot_console, fs_obj_squashfs):
+        """
+        Test Case 4 - follow symlinks
+        """
+        fs_type, fs_img, files = fs_obj_squashfs
+        with u_boot_console.log.section('Test Case 4 - symlinks'):
+            u_boot_console.run_command('host bind 0 %s' % fs_img)
+            for link, fn in [
+                    ('%s.link' % SMALL_FILE, SMALL_FILE),
+                    ('SUBDIR/%s.link' % INLINE_FILE, INLINE_FILE),
+                    ('SUBDIR.link/%s' % TEXT_FILE, 'SUBDIR/' + TEXT_FILE)]:
+                output = u_boot_console.run_command_list([
+                    'load host 0:0 %x /%s' % (ADDR, link),
+                    'md5sum %x $filesize' % ADDR,
+                    'setenv filesize'])
+                assert(files[fn][0] in ''.join(output))
+
+            output = u_boot_console.run_command('ls host 0:0 /')
+            assert('%s.link' % SMALL_FILE in output)
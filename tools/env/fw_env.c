@@ -13,6 +13,7 @@
 #include <env.h>
 #include <errno.h>
 #include <env_flags.h>
+#include <env_log.h>
 #include <fcntl.h>
 #include <libgen.h>
 #include <linux/fs.h>
@@ -389,6 +390,176 @@ static char *envmatch(char *s1, char *s2)
 	return NULL;
 }
 
+/*
+ * Journaled environment, as written by U-Boot with CONFIG_ENV_MMC_LOG. It is
+ * turned into a plain environment when read, and written back as the first
+ * record of the other half, with the next generation.
+ */
+struct env_log {
+	void *image;	/* Journaled image as read, NULL if not journaled */
+	int half;	/* Half holding the current records */
+	uint32_t gen;	/* Generation of the records in @half */
+};
+
+static struct env_log env_log;
+
+#define ENV_LOG_HALF	(CUR_ENVSIZE / 2)
+
+static uint32_t env_log_crc(const struct env_log_hdr *hdr)
+{
+	struct env_log_hdr tmp = *hdr;
+	uint32_t crc;
+
+	tmp.crc = 0;
+	crc = crc32(0, (uint8_t *)&tmp, sizeof(tmp));
+
+	return crc32(crc, (uint8_t *)(hdr + 1), le32_to_cpu(hdr->len));
+}
+
+static uint32_t env_log_rec_size(const struct env_log_hdr *hdr)
+{
+	uint32_t size = sizeof(*hdr) + le32_to_cpu(hdr->len);
+
+	return (size + ENV_LOG_ALIGN - 1) & ~(ENV_LOG_ALIGN - 1);
+}
+
+/* Return the record at @offset in @half if it is complete, else NULL */
+static const struct env_log_hdr *env_log_record(const char *half,
+						uint32_t offset)
+{
+	const struct env_log_hdr *hdr = (const void *)(half + offset);
+
+	if (offset + sizeof(*hdr) > ENV_LOG_HALF ||
+	    le32_to_cpu(hdr->magic) != ENV_LOG_MAGIC ||
+	    le32_to_cpu(hdr->len) > ENV_LOG_HALF - offset - sizeof(*hdr) ||
+	    env_log_crc(hdr) != le32_to_cpu(hdr->crc))
+		return NULL;
+
+	return hdr;
+}
+
+/* Set ("name=value") or delete ("name") a variable, without any checks */
+static int env_log_apply(const char *entry)
+{
+	char *env, *nxt, *end;
+	size_t len;
+
+	for (env = environment.data; *env; env = nxt + 1) {
+		nxt = env + strlen(env);
+		if (envmatch((char *)entry, env)) {
+			for (end = nxt + 1; *end; end += strlen(end) + 1)
+				;
+			memmove(env, nxt + 1, end - nxt);
+			break;
+		}
+	}
+	if (!strchr(entry, '='))
+		return 0;
+
+	for (env = environment.data; *env; env += strlen(env) + 1)
+		;
+	len = strlen(entry) + 1;
+	if (env + len + 1 > &environment.data[ENV_SIZE])
+		return -1;
+	memcpy(env, entry, len);
+	env[len] = '\0';
+
+	return 0;
+}
+
+/*
+ * Load the journaled environment from environment.image into a plain one.
+ * Returns 0 if OK, -1 if the image is not journaled.
+ */
+static int env_log_read(void)
+{
+	const struct env_log_hdr *hdr, *first[2];
+	struct env_image_single *single;
+	const char *half, *entry, *end;
+	uint32_t gen, offset;
+	int i;
+
+	for (i = 0; i < 2; i++)
+		first[i] = env_log_record((char *)environment.image +
+					  i * ENV_LOG_HALF, 0);
+	if (!first[0] && !first[1])
+		return -1;
+
+	single = calloc(1, CUR_ENVSIZE);
+	if (!single)
+		return -1;
+
+	/* Use the half with the latest generation */
+	i = !first[0];
+	if (first[0] && first[1])
+		i = (int32_t)(le32_to_cpu(first[1]->gen) -
+			      le32_to_cpu(first[0]->gen)) > 0;
+	half = (char *)environment.image + i * ENV_LOG_HALF;
+	gen = le32_to_cpu(first[i]->gen);
+
+	env_log.image = environment.image;
+	env_log.half = i;
+	env_log.gen = gen;
+	environment.image = single;
+	environment.crc = &single->crc;
+	environment.data = single->data;
+	memcpy(environment.data, first[i] + 1, le32_to_cpu(first[i]->len));
+
+	/* Replay the changes up to the first incomplete record */
+	offset = env_log_rec_size(first[i]);
+	while ((hdr = env_log_record(half, offset)) &&
+	       le32_to_cpu(hdr->gen) == gen) {
+		entry = (const char *)(hdr + 1);
+		end = entry + le32_to_cpu(hdr->len);
+		for (; entry < end; entry += strlen(entry) + 1) {
+			if (*entry && env_log_apply(entry))
+				fprintf(stderr,
+					"Error: environment overflow\n");
+		}
+		offset += env_log_rec_size(hdr);
+	}
+
+	return 0;
+}
+
+/*
+ * Write the plain environment as the first record of the other half of the
+ * journaled image, and make that the image to write
+ */
+static int env_log_prepare_write(void)
+{
+	struct env_log_hdr *hdr;
+	char *half, *end;
+	size_t len;
+	void *tmp;
+
+	for (end = environment.data; *end; end += strlen(end) + 1)
+		;
+	len = end - environment.data;
+	if (sizeof(*hdr) + len > ENV_LOG_HALF) {
+		fprintf(stderr, "Error: environment too large: %zu bytes\n",
+			len);
+		return -1;
+	}
+
+	half = (char *)env_log.image + (1 - env_log.half) * ENV_LOG_HALF;
+	memset(half, '\0', ENV_LOG_HALF);
+	hdr = (struct env_log_hdr *)half;
+	memcpy(hdr + 1, environment.data, len);
+	hdr->magic = cpu_to_le32(ENV_LOG_MAGIC);
+	hdr->gen = cpu_to_le32(env_log.gen + 1);
+	hdr->len = cpu_to_le32(len);
+	hdr->crc = cpu_to_le32(env_log_crc(hdr));
+
+	env_log.half = 1 - env_log.half;
+	env_log.gen++;
+	tmp = environment.image;
+	environment.image = env_log.image;
+	env_log.image = tmp;
+
+	return 0;
+}
+
 /**
  * Search the environment for a variable.
  * Return the value, if found, or NULL, if not found.
@@ -515,6 +686,9 @@ int fw_env_flush(struct env_opts *opts)
 	 */
 	*environment.crc = crc32(0, (uint8_t *) environment.data, ENV_SIZE);
 
+	if (env_log.image && env_log_prepare_write())
+		return -1;
+
 	/* write environment back to flash */
 	if (flash_io(O_RDWR)) {
 		fprintf(stderr, "Error: can't write fw_env to flash\n");
@@ -1441,7 +1615,8 @@ int fw_env_open(struct env_opts *opts)
 
 	crc0_ok = (crc0 == *environment.crc);
 	if (!have_redund_env) {
-		if (!crc0_ok) {
+		/* A journaled environment has no CRC at the start */
+		if (!crc0_ok && env_log_read()) {
 			fprintf(stderr,
 				"Warning: Bad CRC, using default environment\n");
 			memcpy(environment.data, default_environment,
@@ -1597,6 +1772,8 @@ int fw_env_close(struct env_opts *opts)
 		free(environment.image);
 
 	environment.image = NULL;
+	free(env_log.image);
+	env_log.image = NULL;
 
 	return 0;
 }